@@ -8,11 +8,13 @@
 # You can use the following components:
 #   LuaModel
 #   URDFReader
+#   Locomotion
 # and then link to them e.g. using RBDL_LuaModel_LIBRARY.
 
 SET (RBDL_FOUND FALSE)
 SET (RBDL_LuaModel_FOUND FALSE)
 SET (RBDL_URDFReader_FOUND FALSE)
+SET (RBDL_Locomotion_FOUND FALSE)
 
 FIND_PATH (RBDL_INCLUDE_DIR rbdl/rbdl.h
 	HINTS
@@ -80,6 +82,28 @@ FIND_LIBRARY (RBDL_URDFReader_LIBRARY NAMES rbdl_urdfreader
 	/usr/lib/x86_64-linux-gnu
 	)
 
+FIND_PATH (RBDL_Locomotion_INCLUDE_DIR rbdl/addons/locomotion/locomotion.h
+	HINTS
+	$ENV{HOME}/local/include
+	$ENV{RBDL_PATH}/src
+	$ENV{RBDL_PATH}/include
+	$ENV{RBDL_INCLUDE_PATH}
+	/usr/local/include
+	/usr/include
+	)
+
+FIND_LIBRARY (RBDL_Locomotion_LIBRARY NAMES rbdl_locomotion
+	PATHS
+	$ENV{HOME}/local/lib
+	$ENV{HOME}/local/lib/x86_64-linux-gnu
+	$ENV{RBDL_PATH}
+	$ENV{RBDL_LIBRARY_PATH}
+	/usr/local/lib
+	/usr/local/lib/x86_64-linux-gnu
+	/usr/lib
+	/usr/lib/x86_64-linux-gnu
+	)
+
 IF (NOT RBDL_LIBRARY)
 	MESSAGE (ERROR "Could not find RBDL")
 ENDIF (NOT RBDL_LIBRARY)
@@ -96,6 +120,10 @@ IF (RBDL_URDFReader_INCLUDE_DIR AND RBDL_URDFReader_LIBRARY)
 	SET (RBDL_URDFReader_FOUND TRUE)
 ENDIF (RBDL_URDFReader_INCLUDE_DIR AND RBDL_URDFReader_LIBRARY)
 
+IF (RBDL_Locomotion_INCLUDE_DIR AND RBDL_Locomotion_LIBRARY)
+	SET (RBDL_Locomotion_FOUND TRUE)
+ENDIF (RBDL_Locomotion_INCLUDE_DIR AND RBDL_Locomotion_LIBRARY)
+
 IF (RBDL_FOUND)
    IF (NOT RBDL_FIND_QUIETLY)
       MESSAGE(STATUS "Found RBDL: ${RBDL_LIBRARY}")
@@ -123,4 +151,6 @@ MARK_AS_ADVANCED (
 	RBDL_LuaModel_LIBRARY
 	RBDL_URDFReader_INCLUDE_DIR
 	RBDL_URDFReader_LIBRARY
+	RBDL_Locomotion_INCLUDE_DIR
+	RBDL_Locomotion_LIBRARY
 	)
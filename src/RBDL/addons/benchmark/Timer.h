@@ -1,6 +1,7 @@
 #ifndef _TIMER_H
 #define _TIMER_H
 
+#include <chrono>
 #include <ctime>
 
 struct TimerInfo {
@@ -26,4 +27,24 @@ inline double timer_stop (TimerInfo *timer) {
   return timer->duration_sec;
 }
 
+/** Wall clock timer for benchmarks that run on several threads, for which
+ * clock() reports the accumulated CPU time of all threads. */
+struct WallTimerInfo {
+  std::chrono::steady_clock::time_point start_value;
+
+  /// duration between wall_timer_start() and wall_timer_stop() in seconds
+  double duration_sec;
+};
+
+inline void wall_timer_start (WallTimerInfo *timer) {
+  timer->start_value = std::chrono::steady_clock::now();
+}
+
+inline double wall_timer_stop (WallTimerInfo *timer) {
+  timer->duration_sec = std::chrono::duration<double> (
+      std::chrono::steady_clock::now() - timer->start_value).count();
+
+  return timer->duration_sec;
+}
+
 #endif
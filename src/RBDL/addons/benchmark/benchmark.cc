@@ -5,10 +5,14 @@
 #include <vector>
 #include <cstdlib>
 #include <iomanip>
+#include <limits>
 #include <sstream>
 #include <fstream>
+#include <thread>
 
 #include "rbdl/rbdl.h"
+#include "rbdl/SubtreePartition.h"
+#include "rbdl/ThreadPool.h"
 #include "model_generator.h"
 #include "Human36Model.h"
 #include "SampleData.h"
@@ -29,6 +33,18 @@ bool urdf_floating_base = false;
 bool have_urdfreader = false;
 #endif
 
+#ifdef RBDL_BUILD_ADDON_SIMULATION
+#include "../simulation/Integrator.h"
+#include "../simulation/Rollout.h"
+bool have_simulation = true;
+#else
+bool have_simulation = false;
+#endif
+
+#ifdef RBDL_BUILD_ADDON_CONTACT
+#include "../contact/GroundContactModel.h"
+#endif
+
 using namespace std;
 using namespace RigidBodyDynamics;
 using namespace RigidBodyDynamics::Math;
@@ -41,9 +57,16 @@ bool benchmark_run_fd_lagrangian = true;
 bool benchmark_run_id_rnea = true;
 bool benchmark_run_crba = true;
 bool benchmark_run_nle = true;
+bool benchmark_run_momentum = true;
 bool benchmark_run_calc_minv_times_tau = true;
 bool benchmark_run_contacts = false;
 bool benchmark_run_ik = false;
+bool benchmark_run_rollouts = false;
+bool benchmark_run_parallel = false;
+bool benchmark_run_ground_contact = false;
+
+int benchmark_rollout_steps = 100;
+int benchmark_max_threads = 0;
 
 bool json_output = false;
 
@@ -261,6 +284,55 @@ double run_nle_benchmark (Model *model, int sample_count) {
   return sample_data.durations.sum();
 }
 
+/** Compares the terms of a generalized momentum observer update computed
+ * by the recursive GeneralizedMomentumEffects() against the momentum
+ * M * qdot from the CRBA plus the nonlinear effects. */
+double run_momentum_benchmark (Model *model, int sample_count) {
+  SampleData sample_data;
+  sample_data.fillRandom(model->dof_count, sample_count);
+
+  // the w components of the quaternions are stored at the end of q
+  for (int i = 0; i < sample_count; i++) {
+    sample_data.q[i].conservativeResize (model->q_size);
+    sample_data.q[i].tail (model->q_size - model->dof_count).setOnes();
+  }
+
+  VectorNd momentum (VectorNd::Zero (model->dof_count));
+  MatrixNd H (MatrixNd::Zero (model->dof_count, model->dof_count));
+
+  TimerInfo tinfo;
+
+  for (int i = 0; i < sample_count; i++) {
+    timer_start (&tinfo);
+    GeneralizedMomentumEffects (*model,
+        sample_data.q[i],
+        sample_data.qdot[i],
+        sample_data.tau[i],
+        &momentum
+        );
+    sample_data.durations[i] = timer_stop (&tinfo);
+  }
+
+  report_run(*model, sample_data, "GeneralizedMomentumEffects");
+  double duration = sample_data.durations.sum();
+
+  for (int i = 0; i < sample_count; i++) {
+    timer_start (&tinfo);
+    CompositeRigidBodyAlgorithm (*model, sample_data.q[i], H, true);
+    momentum.noalias() = H * sample_data.qdot[i];
+    NonlinearEffects (*model,
+        sample_data.q[i],
+        sample_data.qdot[i],
+        sample_data.tau[i]
+        );
+    sample_data.durations[i] = timer_stop (&tinfo);
+  }
+
+  report_run(*model, sample_data, "CRBA_NonlinearEffects_Momentum");
+
+  return duration;
+}
+
 double run_calc_minv_times_tau_benchmark (Model *model, int sample_count) {
   SampleData sample_data;
   sample_data.fillRandom(model->dof_count, sample_count);
@@ -527,15 +599,285 @@ void contacts_benchmark (int sample_count, ContactsMethod contacts_method) {
 
 }
 
+#ifdef RBDL_BUILD_ADDON_SIMULATION
+double run_rollout_benchmark (Model *model, int rollout_count,
+    int step_count, unsigned int thread_count) {
+  using namespace RigidBodyDynamics::Addons::Simulation;
+
+  SampleData sample_data;
+  sample_data.fillRandom(model->dof_count, rollout_count);
+
+  MatrixNd Q0 (MatrixNd::Zero (model->q_size, rollout_count));
+  MatrixNd QDot0 (MatrixNd::Zero (model->qdot_size, rollout_count));
+  MatrixNd Tau (MatrixNd::Zero (model->qdot_size, rollout_count * step_count));
+
+  for (int r = 0; r < rollout_count; r++) {
+    Q0.block(0, r, model->dof_count, 1) = sample_data.q[r];
+    // quaternion w components of spherical joints
+    for (unsigned int i = model->dof_count; i < model->q_size; i++) {
+      Q0(i, r) = 1.;
+    }
+    VectorNd q = Q0.col(r);
+    NormalizeQuaternions (*model, q);
+    Q0.col(r) = q;
+
+    QDot0.col(r) = sample_data.qdot[r];
+    for (int k = 0; k < step_count; k++) {
+      Tau.col(r * step_count + k) = sample_data.tau[r];
+    }
+  }
+
+  RolloutEngine engine (*model, thread_count);
+  engine.num_steps = step_count;
+  engine.dt = 1.0e-3;
+
+  // warm up the worker threads and workspaces
+  engine.Run (Q0, QDot0, Tau);
+
+  WallTimerInfo tinfo;
+  wall_timer_start (&tinfo);
+  engine.Run (Q0, QDot0, Tau);
+  double duration = wall_timer_stop (&tinfo);
+
+  int total_steps = rollout_count * step_count;
+
+  BenchmarkRun run;
+  ostringstream run_name;
+  run_name << "Rollouts_threads_" << engine.GetNumThreads();
+  run.benchmark = run_name.str();
+  run.model_name = model_name;
+  run.model_dof = model->dof_count;
+  run.sample_count = total_steps;
+  run.duration = duration;
+  run.avg = duration / total_steps;
+  run.min = run.avg;
+  run.max = run.avg;
+  benchmark_runs.push_back(run);
+
+  if (!json_output) {
+    cout << "#DOF: " << setw(3) << model->dof_count
+         << " #threads: " << setw(2) << engine.GetNumThreads()
+         << " #rollouts: " << rollout_count
+         << " #steps: " << step_count
+         << " duration = " << setw(10) << duration << "(s)"
+         << " (~" << setw(10) << total_steps / duration << " steps/s, "
+         << setw(10) << rollout_count / duration << " rollouts/s)" << endl;
+  }
+
+  return duration;
+}
+
+void rollouts_benchmark (Model *model, int rollout_count, int step_count) {
+  unsigned int max_threads = benchmark_max_threads;
+  if (max_threads == 0) {
+    max_threads = std::max (1u, std::thread::hardware_concurrency());
+  }
+
+  for (unsigned int threads = 1; threads < max_threads; threads *= 2) {
+    run_rollout_benchmark (model, rollout_count, step_count, threads);
+  }
+  run_rollout_benchmark (model, rollout_count, step_count, max_threads);
+}
+#endif
+
+#if defined RBDL_BUILD_ADDON_CONTACT && defined RBDL_BUILD_ADDON_SIMULATION
+double run_ground_contact_benchmark (Model *model, int step_count) {
+  using namespace RigidBodyDynamics::Addons::Contact;
+  using namespace RigidBodyDynamics::Addons::Simulation;
+
+  // soles of 0.18 x 0.09 m, 6 mm below the L_Foot and R_Foot frames
+  // (RoK-3)
+  const char* foot_names[] = { "L_Foot", "R_Foot" };
+  CompliantGroundContact ground;
+  for (int f = 0; f < 2; f++) {
+    if (model->GetBodyId (foot_names[f]) == std::numeric_limits<unsigned int>::max()) {
+      cerr << "Ground contact benchmark: model has no body " << foot_names[f]
+        << ", skipping." << endl;
+      return 0.;
+    }
+    for (int i = 0; i < 4; i++) {
+      ground.AddContactPoint (*model, foot_names[f],
+          Vector3d ((i & 1) ? 0.09 : -0.09, (i & 2) ? 0.045 : -0.045, -0.006));
+    }
+  }
+  // softer than the defaults, which need a smaller time step for the light
+  // feet of RoK-3 with the explicit friction and damping forces
+  ground.stiffness = 5.0e4;
+  ground.damping = 300.;
+  ground.slip_velocity = 0.05;
+  ground.Bind (*model);
+
+  // standing in the zero posture with the soles on the ground, the joints
+  // are held by PD torques
+  VectorNd Q (VectorNd::Zero (model->q_size));
+  VectorNd QDot (VectorNd::Zero (model->qdot_size));
+  VectorNd Tau (VectorNd::Zero (model->qdot_size));
+  Q.tail (model->q_size - model->dof_count).setOnes();
+  NormalizeQuaternions (*model, Q);
+
+  UpdateKinematicsCustom (*model, &Q, NULL, NULL);
+  double lowest = 0.;
+  for (unsigned int i = 0; i < ground.body.size(); i++) {
+    lowest = std::min (lowest, CalcBodyToBaseCoordinates (*model, Q,
+          ground.body[i], ground.point[i], false)[2]);
+  }
+  Q[2] -= lowest;
+
+  std::vector<SpatialVector> f_ext (model->mBodies.size(), SpatialVector::Zero());
+  Integrator integrator;
+  integrator.Bind (*model);
+
+  double dt = 1.0e-3;
+  // the first 6 DoFs of a model with a quaternion are the floating base
+  unsigned int base_dofs = model->q_size > model->dof_count ? 6 : 0;
+
+  WallTimerInfo tinfo;
+  wall_timer_start (&tinfo);
+  for (int k = 0; k < step_count; k++) {
+    for (unsigned int i = base_dofs; i < model->dof_count; i++) {
+      Tau[i] = -200. * Q[i] - 2. * QDot[i];
+    }
+    for (unsigned int i = 0; i < f_ext.size(); i++) {
+      f_ext[i].setZero();
+    }
+    CalcGroundContactForces (*model, Q, QDot, ground, f_ext);
+    SimulationStep (*model, integrator, Q, QDot, Tau, dt, &f_ext);
+  }
+  double duration = wall_timer_stop (&tinfo);
+
+  BenchmarkRun run;
+  run.benchmark = "CompliantGroundContact_SemiImplicitEuler";
+  run.model_name = model_name;
+  run.model_dof = model->dof_count;
+  run.sample_count = step_count;
+  run.duration = duration;
+  run.avg = duration / step_count;
+  run.min = run.avg;
+  run.max = run.avg;
+  benchmark_runs.push_back(run);
+
+  if (!json_output) {
+    cout << "#DOF: " << setw(3) << model->dof_count
+         << " #contact points: " << ground.body.size()
+         << " #steps: " << step_count
+         << " duration = " << setw(10) << duration << "(s)"
+         << " (~" << setw(10) << duration / step_count * 1.0e6 << " us/step, "
+         << setw(8) << step_count * dt / duration << " x real time at dt = 1 ms)"
+         << endl;
+  }
+
+  return duration;
+}
+#endif
+
+enum ParallelAlgorithm {
+  ParallelAlgorithmForwardDynamics = 0,
+  ParallelAlgorithmCRBA
+};
+
+/** Runs the serial (thread_count == 0) or parallel version of the
+ * algorithm and returns the average duration of a call. */
+double run_parallel_benchmark (Model *model, int sample_count,
+    ParallelAlgorithm algorithm, unsigned int thread_count,
+    double serial_avg) {
+  SampleData sample_data;
+  sample_data.fillRandom(model->dof_count, sample_count);
+
+  ThreadPool pool (std::max (thread_count, 1u));
+  SubtreePartition partition (*model, 4 * pool.GetNumThreads());
+  MatrixNd H (MatrixNd::Zero (model->qdot_size, model->qdot_size));
+
+  WallTimerInfo tinfo;
+
+  // the first call warms up the worker threads
+  for (int i = -1; i < sample_count; i++) {
+    int k = std::max (i, 0);
+
+    wall_timer_start (&tinfo);
+    if (algorithm == ParallelAlgorithmForwardDynamics) {
+      if (thread_count == 0) {
+        ForwardDynamics (*model, sample_data.q[k], sample_data.qdot[k],
+            sample_data.tau[k], sample_data.qddot[k]);
+      } else {
+        ForwardDynamicsParallel (*model, sample_data.q[k],
+            sample_data.qdot[k], sample_data.tau[k], sample_data.qddot[k],
+            pool, partition);
+      }
+    } else {
+      if (thread_count == 0) {
+        CompositeRigidBodyAlgorithm (*model, sample_data.q[k], H, true);
+      } else {
+        CompositeRigidBodyAlgorithmParallel (*model, sample_data.q[k], H,
+            pool, partition, true);
+      }
+    }
+    double duration = wall_timer_stop (&tinfo);
+
+    if (i >= 0) {
+      sample_data.durations[i] = duration;
+    }
+  }
+
+  ostringstream run_name;
+  run_name << (algorithm == ParallelAlgorithmForwardDynamics
+      ? "ForwardDynamics" : "CRBA");
+  if (thread_count == 0) {
+    run_name << "_serial";
+  } else {
+    run_name << "Parallel_threads_" << pool.GetNumThreads();
+  }
+  register_run (*model, sample_data, run_name.str().c_str());
+
+  double avg = sample_data.durations.mean();
+
+  if (!json_output) {
+    cout << "#DOF: " << setw(3) << model->dof_count;
+    if (thread_count == 0) {
+      cout << " serial                               ";
+    } else {
+      cout << " #threads: " << setw(2) << pool.GetNumThreads()
+        << " #subtrees: " << setw(3) << partition.roots.size()
+        << " #top bodies: " << setw(3) << partition.top_bodies.size();
+    }
+    cout << " (~" << setw(10) << avg << "(s) per call";
+    if (thread_count != 0) {
+      cout << ", speedup " << setprecision(3) << serial_avg / avg
+        << setprecision(6);
+    }
+    cout << ")" << endl;
+  }
+
+  return avg;
+}
+
+void parallel_benchmark (Model *model, int sample_count,
+    ParallelAlgorithm algorithm) {
+  unsigned int max_threads = benchmark_max_threads;
+  if (max_threads == 0) {
+    max_threads = std::max (1u, std::thread::hardware_concurrency());
+  }
+
+  double serial_avg = run_parallel_benchmark (model, sample_count,
+      algorithm, 0, 0.);
+
+  for (unsigned int threads = 1; threads < max_threads; threads *= 2) {
+    run_parallel_benchmark (model, sample_count, algorithm, threads,
+        serial_avg);
+  }
+  run_parallel_benchmark (model, sample_count, algorithm, max_threads,
+      serial_avg);
+}
+
 double run_single_inverse_kinematics_benchmark(Model *model, std::vector<InverseKinematicsConstraintSet> &CS, int sample_count){
   TimerInfo tinfo;
   timer_start (&tinfo);
   VectorNd qinit = VectorNd::Zero(model->dof_count);
   VectorNd qres = VectorNd::Zero(model->dof_count);
-  VectorNd failures = VectorNd::Zero(model->dof_count);
+  VectorNd failures = VectorNd::Zero(sample_count);
 
   for (int i = 0; i < sample_count; i++) {
-    if (!InverseKinematics(*model, qinit, CS[i], qres)){
+    bool success = InverseKinematics(*model, qinit, CS[i], qres);
+    if (!success){
       failures[i] = 1;
     }
   }
@@ -545,6 +887,51 @@ double run_single_inverse_kinematics_benchmark(Model *model, std::vector<Inverse
   
 }
 
+/** The soft priority levels of a prioritized solve usually do not reach
+ * their targets, hence a success rate says little about the solver.
+ * Instead this reports the latency of the calls that converged on all
+ * levels and the number of calls that did not. */
+double run_prioritized_inverse_kinematics_benchmark(Model *model, std::vector<InverseKinematicsConstraintSet> &CS, int sample_count){
+  TimerInfo tinfo;
+  VectorNd qinit = VectorNd::Zero(model->dof_count);
+  VectorNd qres = VectorNd::Zero(model->dof_count);
+  double duration = 0.;
+  double max_duration = 0.;
+  int converged_count = 0;
+  int hard_failure_count = 0;
+
+  for (int i = 0; i < sample_count; i++) {
+    timer_start (&tinfo);
+    bool success = InverseKinematicsPrioritized(*model, qinit, CS[i], qres);
+    double call_duration = timer_stop (&tinfo);
+
+    if (!success) {
+      hard_failure_count++;
+    }
+
+    bool converged = true;
+    for (unsigned int l = 0; l < CS[i].priority_level_status.size(); l++) {
+      if (CS[i].priority_level_status[l]
+          == InverseKinematicsConstraintSet::PriorityLevelNotConverged) {
+        converged = false;
+      }
+    }
+
+    if (success && converged) {
+      converged_count++;
+      duration += call_duration;
+      max_duration = std::max (max_duration, call_duration);
+    }
+  }
+
+  std::cout << "Not converged: " << sample_count - converged_count
+    << " (hard levels failed: " << hard_failure_count << ")" << std::endl;
+  std::cout << "Latency of converged calls: mean = "
+    << duration / std::max (converged_count, 1) << "(s) max = "
+    << max_duration << "(s)  for: ";
+  return duration;
+}
+
 double run_all_inverse_kinematics_benchmark (unsigned int sample_count){
   
   //initialize the human model
@@ -573,6 +960,7 @@ double run_all_inverse_kinematics_benchmark (unsigned int sample_count){
   std::vector<InverseKinematicsConstraintSet> cs_two_full_one_point;
   std::vector<InverseKinematicsConstraintSet> cs_two_full_two_point_one_orientation;
   std::vector<InverseKinematicsConstraintSet> cs_five_full;
+  std::vector<InverseKinematicsConstraintSet> cs_prioritized;
   
   for (unsigned int i = 0; i < sample_count; i++){
     Vector3d foot_r_position = CalcBodyToBaseCoordinates (*model, sample_data.q[i], foot_r, foot_r_point);
@@ -628,6 +1016,20 @@ double run_all_inverse_kinematics_benchmark (unsigned int sample_count){
     five_full.AddFullConstraint(head, head_point, head_position, head_orientation);
     five_full.step_tol = 1e-12;
     cs_five_full.push_back(five_full);
+
+    //feet, hands, head and posture with decreasing priority
+    InverseKinematicsConstraintSet prioritized;
+    prioritized.AddFullConstraint(foot_r, foot_r_point, foot_r_position, foot_r_orientation, 0);
+    prioritized.AddFullConstraint(foot_l, foot_l_point, foot_l_position, foot_l_orientation, 0);
+    prioritized.AddPointConstraint(hand_r, hand_r_point, hand_r_position, 1);
+    prioritized.AddPointConstraint(hand_l, hand_l_point, hand_l_position, 1);
+    prioritized.AddOrientationConstraint(head, head_orientation, 2);
+    prioritized.AddPostureConstraint(VectorNd::Zero(model->q_size), 3);
+    prioritized.max_hard_priority = 2;
+    // the posture level converges linearly
+    prioritized.step_tol = 1e-10;
+    prioritized.max_steps = 2000;
+    cs_prioritized.push_back(prioritized);
   }
   
   cout << "= #DOF: " << setw(3) << model->dof_count << endl;
@@ -658,6 +1060,9 @@ double run_all_inverse_kinematics_benchmark (unsigned int sample_count){
   cout << "Constraints: 5 Bodies: 5 Full                       : "
   << " duration = " << setw(10) << duration << "(s)"
   << " (~" << setw(10) << duration / sample_count << "(s) per call)" << endl;
+
+  duration = run_prioritized_inverse_kinematics_benchmark(model, cs_prioritized, sample_count);
+  cout << "Prioritized: 2 Full > 2 Points > 1 Orien. > Posture" << endl;
   return duration;
 }
 
@@ -687,9 +1092,27 @@ void print_usage () {
   cout << "                                matrix computation using the composite rigid" << endl;
   cout << "                                body algorithm." << endl;
   cout << "  --no-nle                    : disables benchmark for the nonlinear effects." << endl;
+  cout << "  --no-momentum               : disables benchmark for the terms of the" << endl;
+  cout << "                                generalized momentum observer." << endl;
   cout << "  --no-calc-minv              : disables benchmark M^-1 * tau benchmark." << endl;
   cout << "  --only-contacts | -C        : only runs contact model benchmarks." << endl;
   cout << "  --only-ik                   : only runs inverse kinematics benchmarks." << endl;
+#if defined RBDL_BUILD_ADDON_SIMULATION
+  cout << "  --only-rollouts             : only runs the parallel rollout benchmarks" << endl;
+  cout << "                                (uses <sample_count> rollouts per run)." << endl;
+  cout << "  --rollout-steps <steps>     : number of steps per rollout (default: 100)." << endl;
+#endif
+  cout << "  --only-parallel             : only runs the scaling benchmarks of the" << endl;
+  cout << "                                parallel forward dynamics and CRBA." << endl;
+  cout << "  --threads <threads>         : maximum number of threads used for the" << endl;
+  cout << "                                rollouts and the parallel algorithms" << endl;
+  cout << "                                (default: hardware concurrency)." << endl;
+#if defined RBDL_BUILD_ADDON_CONTACT && defined RBDL_BUILD_ADDON_SIMULATION
+  cout << "  --ground-contact            : simulates <sample_count> steps of the model" << endl;
+  cout << "                                file standing on the compliant ground with" << endl;
+  cout << "                                four contact points per sole (RoK-3 bodies" << endl;
+  cout << "                                L_Foot and R_Foot)." << endl;
+#endif
   cout << "  --help | -h                 : prints this help." << endl;
 }
 
@@ -699,8 +1122,12 @@ void disable_all_benchmarks () {
   benchmark_run_id_rnea = false;
   benchmark_run_crba = false;
   benchmark_run_nle = false;
+  benchmark_run_momentum = false;
   benchmark_run_calc_minv_times_tau = false;
   benchmark_run_contacts = false;
+  benchmark_run_rollouts = false;
+  benchmark_run_parallel = false;
+  benchmark_run_ground_contact = false;
 }
 
 void parse_args (int argc, char* argv[]) {
@@ -755,6 +1182,8 @@ void parse_args (int argc, char* argv[]) {
       benchmark_run_crba = false;
     } else if (arg == "--no-nle" ) {
       benchmark_run_nle = false;
+    } else if (arg == "--no-momentum" ) {
+      benchmark_run_momentum = false;
     } else if (arg == "--no-calc-minv" ) {
       benchmark_run_calc_minv_times_tau = false;
     } else if (arg == "--only-contacts" || arg == "-C") {
@@ -763,6 +1192,34 @@ void parse_args (int argc, char* argv[]) {
     } else if (arg == "--only-ik") {
       disable_all_benchmarks();
       benchmark_run_ik = true;
+    } else if (arg == "--only-parallel") {
+      disable_all_benchmarks();
+      benchmark_run_parallel = true;
+#if defined RBDL_BUILD_ADDON_CONTACT && defined RBDL_BUILD_ADDON_SIMULATION
+    } else if (arg == "--ground-contact") {
+      benchmark_run_ground_contact = true;
+#endif
+#if defined RBDL_BUILD_ADDON_SIMULATION
+    } else if (arg == "--only-rollouts") {
+      disable_all_benchmarks();
+      benchmark_run_rollouts = true;
+#endif
+    } else if (arg == "--rollout-steps" || arg == "--threads") {
+      if (argi == argc - 1) {
+        print_usage();
+
+        cerr << "Error: missing number for " << arg << "!" << endl;
+        exit (1);
+      }
+
+      argi++;
+      stringstream value_stream (argv[argi]);
+
+      if (arg == "--rollout-steps") {
+        value_stream >> benchmark_rollout_steps;
+      } else {
+        value_stream >> benchmark_max_threads;
+      }
 #if defined (RBDL_BUILD_ADDON_LUAMODEL) || defined (RBDL_BUILD_ADDON_URDFREADER)
     } else if (model_name == "") {
       model_name = arg;
@@ -826,6 +1283,18 @@ int main (int argc, char *argv[]) {
       run_nle_benchmark (model, benchmark_sample_count);
     }
 
+    if (benchmark_run_momentum) {
+      report_section("Generalized Momentum Observer");
+      run_momentum_benchmark (model, benchmark_sample_count);
+    }
+
+#if defined RBDL_BUILD_ADDON_CONTACT && defined RBDL_BUILD_ADDON_SIMULATION
+    if (benchmark_run_ground_contact) {
+      report_section("Compliant Ground Contact Simulation");
+      run_ground_contact_benchmark (model, benchmark_sample_count);
+    }
+#endif
+
     delete model;
 
     return 0;
@@ -909,6 +1378,20 @@ int main (int argc, char *argv[]) {
     }
   }
 
+  if (benchmark_run_momentum) {
+    report_section("Generalized Momentum Observer");
+    for (int depth = 1; depth <= benchmark_model_max_depth; depth++) {
+      model = new Model();
+      model->gravity = Vector3d (0., -9.81, 0.);
+
+      generate_planar_tree (model, depth);
+
+      run_momentum_benchmark (model, benchmark_sample_count);
+
+      delete model;
+    }
+  }
+
   if (benchmark_run_calc_minv_times_tau) {
     report_section("CalcMInvTimesTau");
     for (int depth = 1; depth <= benchmark_model_max_depth; depth++) {
@@ -942,6 +1425,67 @@ int main (int argc, char *argv[]) {
     run_all_inverse_kinematics_benchmark(benchmark_sample_count);
   }
 
+  if (benchmark_run_parallel) {
+    const char* section_names[] = {
+      "Parallel Forward Dynamics: subtree ABA",
+      "Parallel Joint Space Inertia Matrix: subtree CRBA"
+    };
+    ParallelAlgorithm algorithms[] = {
+      ParallelAlgorithmForwardDynamics,
+      ParallelAlgorithmCRBA
+    };
+
+    for (int a = 0; a < 2; a++) {
+      report_section(section_names[a]);
+
+      model_name = "human36";
+      model = new Model();
+      generate_human36model(model);
+      parallel_benchmark (model, benchmark_sample_count, algorithms[a]);
+      delete model;
+
+      for (int depth = 1; depth <= benchmark_model_max_depth; depth++) {
+        ostringstream model_name_stream;
+        model_name_stream << "planar_model_depth_" << depth;
+        model_name = model_name_stream.str();
+        model = new Model();
+        model->gravity = Vector3d (0., -9.81, 0.);
+
+        generate_planar_tree (model, depth);
+
+        parallel_benchmark (model, benchmark_sample_count, algorithms[a]);
+
+        delete model;
+      }
+    }
+  }
+
+#ifdef RBDL_BUILD_ADDON_SIMULATION
+  if (benchmark_run_rollouts) {
+    report_section("Parallel Rollouts (semi-implicit Euler)");
+
+    model_name = "human36";
+    model = new Model();
+    generate_human36model(model);
+    rollouts_benchmark (model, benchmark_sample_count, benchmark_rollout_steps);
+    delete model;
+
+    for (int depth = 1; depth <= benchmark_model_max_depth; depth++) {
+      ostringstream model_name_stream;
+      model_name_stream << "planar_model_depth_" << depth;
+      model_name = model_name_stream.str();
+      model = new Model();
+      model->gravity = Vector3d (0., -9.81, 0.);
+
+      generate_planar_tree (model, depth);
+
+      rollouts_benchmark (model, benchmark_sample_count, benchmark_rollout_steps);
+
+      delete model;
+    }
+  }
+#endif
+
   if (json_output) {
     cout.precision(15);
     cout << "{" << endl;
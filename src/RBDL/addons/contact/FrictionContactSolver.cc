@@ -0,0 +1,310 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : contact
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#include <rbdl/rbdl.h>
+
+#include "FrictionContactSolver.h"
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Contact {
+
+using namespace Math;
+
+FrictionContactSet::FrictionContactSet() :
+  ground_normal (0., 0., 1.),
+  ground_height (0.),
+  ground_tangent_1 (1., 0., 0.),
+  ground_tangent_2 (0., 1., 0.),
+  max_iterations (50),
+  tolerance (1.0e-10),
+  relaxation (1.),
+  penetration_recovery (0.2),
+  activation_distance (1.0e-2),
+  warm_start (true),
+  num_iterations (0),
+  residual (0.),
+  converged (false),
+  bound (false) {
+}
+
+void FrictionContactSet::SetGroundPlane (
+  const Vector3d &normal,
+  double height) {
+  ground_normal = normal.normalized();
+  ground_height = height;
+
+  // Pick the coordinate axis least aligned with the normal to construct a
+  // well conditioned tangent basis.
+  Vector3d axis (1., 0., 0.);
+  if (fabs(ground_normal[1]) < fabs(ground_normal[0])
+      && fabs(ground_normal[1]) <= fabs(ground_normal[2])) {
+    axis = Vector3d (0., 1., 0.);
+  } else if (fabs(ground_normal[2]) < fabs(ground_normal[0])
+      && fabs(ground_normal[2]) < fabs(ground_normal[1])) {
+    axis = Vector3d (0., 0., 1.);
+  }
+
+  ground_tangent_1 = ground_normal.cross(axis).normalized();
+  ground_tangent_2 = ground_normal.cross(ground_tangent_1);
+
+  if (bound) {
+    for (unsigned int i = 0; i < size(); i++) {
+      constraints.normal[3 * i] = ground_normal;
+      constraints.normal[3 * i + 1] = ground_tangent_1;
+      constraints.normal[3 * i + 2] = ground_tangent_2;
+    }
+  }
+}
+
+unsigned int FrictionContactSet::AddContact (
+  unsigned int body_id,
+  const Vector3d &body_point,
+  double contact_mu,
+  const char *contact_name) {
+  assert (bound == false);
+  assert (contact_mu >= 0.);
+
+  std::string name_str;
+  if (contact_name != NULL) {
+    name_str = contact_name;
+  }
+
+  body.push_back (body_id);
+  point.push_back (body_point);
+  mu.push_back (contact_mu);
+  name.push_back (name_str);
+
+  return body.size() - 1;
+}
+
+bool FrictionContactSet::Bind (const Model &model) {
+  assert (bound == false);
+
+  if (bound) {
+    std::cerr << "Error: binding an already bound friction contact set!"
+      << std::endl;
+    abort();
+  }
+
+  SetGroundPlane (ground_normal, ground_height);
+
+  for (unsigned int i = 0; i < size(); i++) {
+    const char *cname = name[i].empty() ? NULL : name[i].c_str();
+    constraints.AddContactConstraint (body[i], point[i], ground_normal,
+        cname);
+    constraints.AddContactConstraint (body[i], point[i], ground_tangent_1,
+        cname);
+    constraints.AddContactConstraint (body[i], point[i], ground_tangent_2,
+        cname);
+  }
+
+  constraints.Bind (model);
+
+  unsigned int n_rows = 3 * size();
+
+  impulse = VectorNd::Zero (n_rows);
+  force = VectorNd::Zero (n_rows);
+  velocity = VectorNd::Zero (n_rows);
+  gap = VectorNd::Zero (size());
+  active.assign (size(), false);
+
+  qdot_free = VectorNd::Zero (model.dof_count);
+  Minv_GT = MatrixNd::Zero (model.dof_count, n_rows);
+  W = MatrixNd::Zero (n_rows, n_rows);
+  b = VectorNd::Zero (n_rows);
+
+#ifndef RBDL_USE_SIMPLE_MATH
+  H_llt = Eigen::LLT<MatrixNd> (model.dof_count);
+#endif
+
+  bound = true;
+
+  return bound;
+}
+
+void FrictionContactSet::clear() {
+  impulse.setZero();
+  force.setZero();
+  velocity.setZero();
+  num_iterations = 0;
+  residual = 0.;
+  converged = false;
+}
+
+RBDL_DLLAPI
+void StepFrictionContacts (
+  Model &model,
+  const VectorNd &Q,
+  const VectorNd &QDot,
+  const VectorNd &Tau,
+  double dt,
+  FrictionContactSet &FCS,
+  VectorNd &QDotNext,
+  std::vector<SpatialVector> *f_ext) {
+  assert (FCS.bound);
+  assert (dt > 0.);
+
+  ConstraintSet &CS = FCS.constraints;
+
+  // Compute C, H and the contact Jacobian G in the workspaces of the
+  // ConstraintSet.
+  NonlinearEffects (model, Q, QDot, CS.C, f_ext);
+
+  CS.H.setZero();
+  CompositeRigidBodyAlgorithm (model, Q, CS.H, false);
+
+  // NonlinearEffects() only updates X_lambda
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    model.X_base[i] = model.X_lambda[i] * model.X_base[model.lambda[i]];
+  }
+
+  CalcConstraintsJacobian (model, Q, CS, CS.G, false);
+
+  // Free motion velocities and H^-1 G^T
+  FCS.qdot_free = Tau - CS.C;
+  FCS.Minv_GT = CS.G.transpose();
+
+#ifndef RBDL_USE_SIMPLE_MATH
+  FCS.H_llt.compute (CS.H);
+  FCS.H_llt.solveInPlace (FCS.qdot_free);
+  FCS.H_llt.solveInPlace (FCS.Minv_GT);
+#else
+  FCS.qdot_free = CS.H.llt().solve (FCS.qdot_free);
+  FCS.Minv_GT = CS.H.llt().solve (FCS.Minv_GT);
+#endif
+
+  FCS.qdot_free = QDot + dt * FCS.qdot_free;
+
+  // Detect the active contacts
+  bool any_active = false;
+  for (unsigned int i = 0; i < FCS.size(); i++) {
+    Vector3d base_point = CalcBodyToBaseCoordinates (model, Q, FCS.body[i],
+        FCS.point[i], false);
+    FCS.gap[i] = FCS.ground_normal.dot(base_point) - FCS.ground_height;
+    FCS.active[i] = FCS.gap[i] < FCS.activation_distance;
+    any_active = any_active || FCS.active[i];
+
+    if (!FCS.active[i] || !FCS.warm_start) {
+      FCS.impulse[3 * i] = 0.;
+      FCS.impulse[3 * i + 1] = 0.;
+      FCS.impulse[3 * i + 2] = 0.;
+    }
+  }
+
+  FCS.num_iterations = 0;
+  FCS.residual = 0.;
+  FCS.converged = true;
+
+  if (any_active) {
+#ifdef EIGEN_CORE_H
+    FCS.W.noalias() = CS.G * FCS.Minv_GT;
+    FCS.b.noalias() = CS.G * FCS.qdot_free;
+#else
+    FCS.W = CS.G * FCS.Minv_GT;
+    FCS.b = CS.G * FCS.qdot_free;
+#endif
+
+    // Speculative contacts may approach the ground by the gap, penetrating
+    // contacts are pushed out by a fraction of the penetration.
+    for (unsigned int i = 0; i < FCS.size(); i++) {
+      if (FCS.gap[i] >= 0.) {
+        FCS.b[3 * i] += FCS.gap[i] / dt;
+      } else {
+        FCS.b[3 * i] += FCS.penetration_recovery * FCS.gap[i] / dt;
+      }
+    }
+
+    // Projected Gauss-Seidel. W is symmetric so the column access below
+    // reads contiguous memory.
+    const double omega = FCS.relaxation;
+    FCS.converged = false;
+
+    for (unsigned int iter = 0; iter < FCS.max_iterations; iter++) {
+      double max_delta = 0.;
+
+      for (unsigned int i = 0; i < FCS.size(); i++) {
+        if (!FCS.active[i]) {
+          continue;
+        }
+
+        const unsigned int k = 3 * i;
+        double old_n = FCS.impulse[k];
+        double old_t1 = FCS.impulse[k + 1];
+        double old_t2 = FCS.impulse[k + 2];
+
+        // normal direction
+        if (FCS.W(k, k) > 0.) {
+          double u_n = FCS.b[k] + FCS.W.col(k).dot(FCS.impulse);
+          FCS.impulse[k] = std::max(0., old_n - omega * u_n / FCS.W(k, k));
+        }
+
+        // tangential directions
+        if (FCS.W(k + 1, k + 1) > 0.) {
+          double u_t1 = FCS.b[k + 1] + FCS.W.col(k + 1).dot(FCS.impulse);
+          FCS.impulse[k + 1] = old_t1 - omega * u_t1 / FCS.W(k + 1, k + 1);
+        }
+        if (FCS.W(k + 2, k + 2) > 0.) {
+          double u_t2 = FCS.b[k + 2] + FCS.W.col(k + 2).dot(FCS.impulse);
+          FCS.impulse[k + 2] = old_t2 - omega * u_t2 / FCS.W(k + 2, k + 2);
+        }
+
+        // project onto the friction disk
+        double limit = FCS.mu[i] * FCS.impulse[k];
+        double t_norm = sqrt(FCS.impulse[k + 1] * FCS.impulse[k + 1]
+            + FCS.impulse[k + 2] * FCS.impulse[k + 2]);
+        if (t_norm > limit) {
+          double scale = t_norm > 0. ? limit / t_norm : 0.;
+          FCS.impulse[k + 1] *= scale;
+          FCS.impulse[k + 2] *= scale;
+        }
+
+        max_delta = std::max(max_delta, fabs(FCS.impulse[k] - old_n));
+        max_delta = std::max(max_delta, fabs(FCS.impulse[k + 1] - old_t1));
+        max_delta = std::max(max_delta, fabs(FCS.impulse[k + 2] - old_t2));
+      }
+
+      FCS.num_iterations = iter + 1;
+      FCS.residual = max_delta;
+
+      if (max_delta < FCS.tolerance) {
+        FCS.converged = true;
+        break;
+      }
+    }
+
+#ifdef EIGEN_CORE_H
+    QDotNext = FCS.qdot_free;
+    QDotNext.noalias() += FCS.Minv_GT * FCS.impulse;
+#else
+    QDotNext = FCS.qdot_free + FCS.Minv_GT * FCS.impulse;
+#endif
+  } else {
+    QDotNext = FCS.qdot_free;
+  }
+
+#ifdef EIGEN_CORE_H
+  FCS.velocity.noalias() = CS.G * QDotNext;
+#else
+  FCS.velocity = CS.G * QDotNext;
+#endif
+  FCS.force = FCS.impulse / dt;
+}
+
+}
+
+}
+
+}
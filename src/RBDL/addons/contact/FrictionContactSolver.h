@@ -0,0 +1,236 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : contact
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_CONTACT_FRICTION_CONTACT_SOLVER_H
+#define RBDL_CONTACT_FRICTION_CONTACT_SOLVER_H
+
+#include <string>
+#include <vector>
+
+#include <rbdl/rbdl_math.h>
+#include <rbdl/Constraints.h>
+
+namespace RigidBodyDynamics {
+
+struct Model;
+
+namespace Addons {
+
+namespace Contact {
+
+/** \page addon_contact_page Addon: rbdl_contact
+ *
+ * The contact addon simulates unilateral contacts with Coulomb friction
+ * between points on the model and a ground plane.
+ *
+ * The core Constraints module only models bilateral constraints: a contact
+ * point stays attached to the ground and can pull on the model. The
+ * FrictionContactSet instead formulates the contacts at the velocity level
+ * and solves for contact impulses \f$\lambda\f$ that satisfy
+ *
+ * \f[
+ *   0 \le \lambda_n \perp u_n \ge 0, \qquad
+ *   \| \lambda_t \| \le \mu \lambda_n
+ * \f]
+ *
+ * where \f$u = G \dot{q}^{+} \f$ is the contact velocity at the end of the
+ * time step. The impulses are computed with a projected Gauss-Seidel (PGS)
+ * iteration on the Delassus operator \f$W = G H^{-1} G^T\f$ that is built
+ * from the joint space inertia matrix, the nonlinear effects and the
+ * contact Jacobian stored in an ordinary ConstraintSet. The impulses of the
+ * previous step are used as initial guess (warm-starting), which typically
+ * reduces the number of PGS sweeps to a handful for persistent contacts.
+ *
+ * Usage:
+ * \code
+ * FrictionContactSet contacts;
+ * contacts.SetGroundPlane (Vector3d (0., 0., 1.), 0.);
+ * contacts.AddContact (foot_id, Vector3d ( 0.1,  0.05, -0.09), 0.8);
+ * contacts.AddContact (foot_id, Vector3d (-0.1, -0.05, -0.09), 0.8);
+ * contacts.Bind (model);
+ *
+ * for (...) {
+ *   StepFrictionContacts (model, Q, QDot, Tau, dt, contacts, QDotNext);
+ *   QDot = QDotNext;
+ *   // integrate Q with QDot (e.g. using the simulation addon)
+ * }
+ * \endcode
+ */
+
+/** \brief Set of unilateral frictional contact points against a ground plane.
+ *
+ * Every contact point is represented by three rows in the internal
+ * ConstraintSet: the normal direction followed by two orthogonal tangent
+ * directions. The impulse, force and velocity vectors are ordered in the
+ * same way, i.e. entry 3 * i is the normal component of contact i.
+ *
+ * The ground plane has to be specified before calling Bind(). Contacts
+ * that are farther away from the plane than activation_distance are
+ * treated as open and are skipped by the solver.
+ */
+struct RBDL_DLLAPI FrictionContactSet {
+  FrictionContactSet();
+
+  /** \brief Sets the ground plane n^T x = height (world coordinates).
+   *
+   * \param normal plane normal pointing away from the ground (is normalized)
+   * \param height offset of the plane along the normal
+   *
+   * \note Must be called before Bind().
+   */
+  void SetGroundPlane (const Math::Vector3d &normal, double height);
+
+  /** \brief Adds a contact point with the given friction coefficient.
+   *
+   * \param body_id the body on which the contact point is defined
+   * \param body_point the point in body coordinates
+   * \param mu Coulomb friction coefficient
+   * \param contact_name a human readable name (optional, default: NULL)
+   *
+   * \returns the index of the contact
+   */
+  unsigned int AddContact (
+    unsigned int body_id,
+    const Math::Vector3d &body_point,
+    double mu,
+    const char *contact_name = NULL);
+
+  /** \brief Initializes and allocates memory for the set.
+   *
+   * Adds the normal and tangential constraints to the internal
+   * ConstraintSet and allocates all workspaces so that
+   * StepFrictionContacts() does not allocate memory.
+   */
+  bool Bind (const Model &model);
+
+  /// \brief Returns the number of contact points.
+  size_t size() const {
+    return body.size();
+  }
+
+  /// \brief Clears the impulses, e.g. to discard the warm-start.
+  void clear();
+
+  // Contact definition
+
+  /// Bodies on which the contact points are defined.
+  std::vector<unsigned int> body;
+  /// Contact points in body coordinates.
+  std::vector<Math::Vector3d> point;
+  /// Coulomb friction coefficient of each contact.
+  std::vector<double> mu;
+  /// Names of the contacts.
+  std::vector<std::string> name;
+
+  /// Normal of the ground plane.
+  Math::Vector3d ground_normal;
+  /// Offset of the ground plane along ground_normal.
+  double ground_height;
+  /// First tangent direction (computed from the normal).
+  Math::Vector3d ground_tangent_1;
+  /// Second tangent direction (computed from the normal).
+  Math::Vector3d ground_tangent_2;
+
+  // Solver settings
+
+  /// Maximum number of projected Gauss-Seidel sweeps (default: 50).
+  unsigned int max_iterations;
+  /// Stops once the largest impulse change of a sweep drops below this
+  /// value (default: 1.0e-10).
+  double tolerance;
+  /// Successive over-relaxation factor in (0, 2) (default: 1.0).
+  double relaxation;
+  /// Fraction of the penetration that is removed per step (default: 0.2).
+  double penetration_recovery;
+  /// Contacts with a larger gap are considered open (default: 1.0e-2).
+  double activation_distance;
+  /// Whether to start from the impulses of the previous step
+  /// (default: true).
+  bool warm_start;
+
+  // Results
+
+  /// Contact impulses (normal, tangent 1, tangent 2 per contact).
+  Math::VectorNd impulse;
+  /// Average contact forces over the step, i.e. impulse / dt.
+  Math::VectorNd force;
+  /// Contact velocities at the end of the step.
+  Math::VectorNd velocity;
+  /// Signed distance of each contact point to the ground plane.
+  Math::VectorNd gap;
+  /// Whether a contact participated in the last solve.
+  std::vector<bool> active;
+  /// Number of PGS sweeps performed in the last solve.
+  unsigned int num_iterations;
+  /// Largest impulse change in the last PGS sweep.
+  double residual;
+  /// Whether the last solve reached the tolerance.
+  bool converged;
+
+  // Workspace
+
+  /// Provides H, C and the contact Jacobian G.
+  ConstraintSet constraints;
+  /// Workspace for the free motion velocities.
+  Math::VectorNd qdot_free;
+  /// Workspace for H^-1 G^T.
+  Math::MatrixNd Minv_GT;
+  /// Workspace for the Delassus operator G H^-1 G^T.
+  Math::MatrixNd W;
+  /// Workspace for the contact velocities of the free motion plus bias.
+  Math::VectorNd b;
+
+#ifndef RBDL_USE_SIMPLE_MATH
+  /// Workspace for the Cholesky decomposition of H.
+  Eigen::LLT<Math::MatrixNd> H_llt;
+#endif
+
+  bool bound;
+};
+
+/** \brief Performs a velocity level time step with frictional contacts.
+ *
+ * Computes the generalized velocities at the end of a time step of length
+ * dt such that no contact point penetrates the ground plane and all contact
+ * impulses lie inside their friction cones (approximated as friction
+ * disks). Contacts that are separated by a small gap are handled
+ * speculatively, i.e. the model may approach the ground by at most the gap
+ * within the step.
+ *
+ * The contact impulses, forces, velocities and solver diagnostics are
+ * stored in FCS.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the internal joints
+ * \param QDot  velocity vector of the internal joints
+ * \param Tau   actuations of the internal joints
+ * \param dt    length of the time step
+ * \param FCS   the contact set (must be bound)
+ * \param QDotNext (output) velocities at the end of the step
+ * \param f_ext External forces acting on the body in base coordinates
+ *        (optional, defaults to NULL)
+ */
+RBDL_DLLAPI
+void StepFrictionContacts (
+  Model &model,
+  const Math::VectorNd &Q,
+  const Math::VectorNd &QDot,
+  const Math::VectorNd &Tau,
+  double dt,
+  FrictionContactSet &FCS,
+  Math::VectorNd &QDotNext,
+  std::vector<Math::SpatialVector> *f_ext = NULL
+);
+
+}
+
+}
+
+}
+
+/* RBDL_CONTACT_FRICTION_CONTACT_SOLVER_H */
+#endif
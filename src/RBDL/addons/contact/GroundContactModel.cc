@@ -0,0 +1,266 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : contact
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#include <rbdl/rbdl.h>
+
+#include "GroundContactModel.h"
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Contact {
+
+using namespace Math;
+
+HeightMap::HeightMap() :
+  origin_x (0.),
+  origin_y (0.),
+  resolution (1.),
+  size_x (1),
+  size_y (1),
+  heights (1, 0.) {
+}
+
+HeightMap::HeightMap (double map_origin_x, double map_origin_y,
+    double map_resolution, unsigned int map_size_x, unsigned int map_size_y,
+    double height) :
+  origin_x (map_origin_x),
+  origin_y (map_origin_y),
+  resolution (map_resolution),
+  size_x (map_size_x),
+  size_y (map_size_y),
+  heights (map_size_x * map_size_y, height) {
+  assert (resolution > 0.);
+  assert (size_x > 0 && size_y > 0);
+}
+
+/** Grid cell and interpolation weight along one axis. Returns false if the
+ * coordinate lies outside of the grid and got clamped. */
+static bool grid_coordinate (double value, double origin, double resolution,
+    unsigned int size, unsigned int &index, double &weight) {
+  double grid_value = (value - origin) / resolution;
+  bool inside = true;
+
+  if (grid_value <= 0.) {
+    grid_value = 0.;
+    inside = false;
+  } else if (grid_value >= static_cast<double>(size - 1)) {
+    grid_value = static_cast<double>(size - 1);
+    inside = false;
+  }
+
+  index = std::min (static_cast<unsigned int>(grid_value),
+      size > 1 ? size - 2 : 0);
+  weight = grid_value - static_cast<double>(index);
+
+  return inside;
+}
+
+double HeightMap::GetHeight (double x, double y, Vector3d *normal) const {
+  unsigned int ix, iy;
+  double tx, ty;
+  bool inside_x = grid_coordinate (x, origin_x, resolution, size_x, ix, tx);
+  bool inside_y = grid_coordinate (y, origin_y, resolution, size_y, iy, ty);
+
+  unsigned int ix1 = std::min (ix + 1, size_x - 1);
+  unsigned int iy1 = std::min (iy + 1, size_y - 1);
+
+  double h00 = (*this)(ix, iy);
+  double h10 = (*this)(ix1, iy);
+  double h01 = (*this)(ix, iy1);
+  double h11 = (*this)(ix1, iy1);
+
+  if (normal) {
+    double dh_dx = 0.;
+    double dh_dy = 0.;
+
+    if (inside_x) {
+      dh_dx = ((1. - ty) * (h10 - h00) + ty * (h11 - h01)) / resolution;
+    }
+    if (inside_y) {
+      dh_dy = ((1. - tx) * (h01 - h00) + tx * (h11 - h10)) / resolution;
+    }
+
+    *normal = Vector3d (-dh_dx, -dh_dy, 1.).normalized();
+  }
+
+  return (1. - ty) * ((1. - tx) * h00 + tx * h10)
+    + ty * ((1. - tx) * h01 + tx * h11);
+}
+
+CompliantGroundContact::CompliantGroundContact() :
+  use_height_map (false),
+  ground_normal (0., 0., 1.),
+  ground_height (0.),
+  stiffness (1.0e5),
+  damping (1.0e3),
+  mu (0.8),
+  slip_velocity (1.0e-2),
+  bound (false) {
+}
+
+unsigned int CompliantGroundContact::AddContactPoint (
+  unsigned int body_id,
+  const Vector3d &body_point,
+  const char *point_name) {
+  std::string name_str;
+  if (point_name != NULL) {
+    name_str = point_name;
+  }
+
+  body.push_back (body_id);
+  point.push_back (body_point);
+  name.push_back (name_str);
+
+  bound = false;
+
+  return body.size() - 1;
+}
+
+unsigned int CompliantGroundContact::AddContactPoint (
+  const Model &model,
+  const char *body_name,
+  const Vector3d &body_point,
+  const char *point_name) {
+  unsigned int body_id = model.GetBodyId (body_name);
+
+  if (body_id == std::numeric_limits<unsigned int>::max()) {
+    std::cerr << "Error: cannot add ground contact point: body '"
+      << body_name << "' not found!" << std::endl;
+    abort();
+  }
+
+  return AddContactPoint (body_id, body_point, point_name);
+}
+
+void CompliantGroundContact::SetGroundPlane (
+  const Vector3d &normal,
+  double height) {
+  use_height_map = false;
+  ground_normal = normal.normalized();
+  ground_height = height;
+}
+
+void CompliantGroundContact::SetHeightMap (const HeightMap &map) {
+  use_height_map = true;
+  height_map = map;
+}
+
+bool CompliantGroundContact::Bind (const Model &model) {
+  unsigned int n_points = size();
+
+  movable_body.resize (n_points);
+  for (unsigned int i = 0; i < n_points; i++) {
+    movable_body[i] = body[i];
+    if (body[i] >= model.fixed_body_discriminator) {
+      movable_body[i] =
+        model.mFixedBodies[body[i] - model.fixed_body_discriminator].mMovableParent;
+    }
+  }
+
+  positions = MatrixNd::Zero (3, n_points);
+  velocities = MatrixNd::Zero (3, n_points);
+  normals = MatrixNd::Zero (3, n_points);
+  penetration = VectorNd::Zero (n_points);
+  normal_force = VectorNd::Zero (n_points);
+  forces = MatrixNd::Zero (3, n_points);
+
+  normal_velocity = VectorNd::Zero (n_points);
+  tangential_velocity = MatrixNd::Zero (3, n_points);
+  friction_scale = VectorNd::Zero (n_points);
+
+  bound = true;
+
+  return bound;
+}
+
+RBDL_DLLAPI
+void CalcGroundContactForces (
+  Model &model,
+  const VectorNd &Q,
+  const VectorNd &QDot,
+  CompliantGroundContact &GC,
+  std::vector<SpatialVector> &f_ext,
+  bool update_kinematics) {
+  assert (GC.bound);
+  assert (f_ext.size() == model.mBodies.size());
+
+  unsigned int n_points = GC.size();
+
+  if (update_kinematics) {
+    UpdateKinematicsCustom (model, &Q, &QDot, NULL);
+  }
+
+  // Gather the point states and the ground geometry ...
+  for (unsigned int i = 0; i < n_points; i++) {
+    GC.positions.col(i) = CalcBodyToBaseCoordinates (model, Q, GC.body[i],
+        GC.point[i], false);
+    GC.velocities.col(i) = CalcPointVelocity (model, Q, QDot, GC.body[i],
+        GC.point[i], false);
+  }
+
+  if (GC.use_height_map) {
+    for (unsigned int i = 0; i < n_points; i++) {
+      Vector3d normal;
+      double height = GC.height_map.GetHeight (GC.positions(0, i),
+          GC.positions(1, i), &normal);
+      GC.normals.col(i) = normal;
+      // vertical penetration projected onto the local surface normal
+      GC.penetration[i] = (height - GC.positions(2, i)) * normal[2];
+    }
+  } else {
+    GC.normals.colwise() = GC.ground_normal;
+    GC.penetration.noalias() = -GC.positions.transpose() * GC.ground_normal;
+    GC.penetration.array() += GC.ground_height;
+  }
+
+  // ... and evaluate the force law for all points at once.
+  GC.normal_velocity.noalias() = GC.normals.cwiseProduct(GC.velocities)
+    .colwise().sum().transpose();
+
+  GC.normal_force = (GC.penetration.array() > 0.).select (
+      (GC.stiffness * GC.penetration - GC.damping * GC.normal_velocity)
+      .cwiseMax(0.), 0.);
+
+  GC.tangential_velocity.noalias() = GC.velocities
+    - GC.normals * GC.normal_velocity.asDiagonal();
+
+  GC.friction_scale = -GC.mu * GC.normal_force.array()
+    / (GC.tangential_velocity.colwise().squaredNorm().transpose().array()
+        + GC.slip_velocity * GC.slip_velocity).sqrt();
+
+  GC.forces.noalias() = GC.normals * GC.normal_force.asDiagonal();
+  GC.forces.noalias() += GC.tangential_velocity
+    * GC.friction_scale.asDiagonal();
+
+  for (unsigned int i = 0; i < n_points; i++) {
+    if (GC.normal_force[i] <= 0.) {
+      continue;
+    }
+
+    Vector3d force = GC.forces.col(i);
+    Vector3d position = GC.positions.col(i);
+    Vector3d moment = position.cross(force);
+
+    f_ext[GC.movable_body[i]] += SpatialVector (
+        moment[0], moment[1], moment[2],
+        force[0], force[1], force[2]);
+  }
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,216 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : contact
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_CONTACT_GROUND_CONTACT_MODEL_H
+#define RBDL_CONTACT_GROUND_CONTACT_MODEL_H
+
+#include <string>
+#include <vector>
+
+#include <rbdl/rbdl_math.h>
+
+namespace RigidBodyDynamics {
+
+struct Model;
+
+namespace Addons {
+
+namespace Contact {
+
+/** \brief Regular grid of terrain heights.
+ *
+ * The height at (x, y) is interpolated bilinearly from the surrounding
+ * grid values. Outside of the grid the border values are extended.
+ */
+struct RBDL_DLLAPI HeightMap {
+  HeightMap();
+
+  /** \param origin_x x coordinate of grid column 0
+   *  \param origin_y y coordinate of grid row 0
+   *  \param resolution spacing of the grid points
+   *  \param size_x number of grid columns (along x)
+   *  \param size_y number of grid rows (along y)
+   *  \param height initial height of all grid points
+   */
+  HeightMap (double origin_x, double origin_y, double resolution,
+      unsigned int size_x, unsigned int size_y, double height = 0.);
+
+  /// \brief Access to the height of grid point (ix, iy).
+  double& operator() (unsigned int ix, unsigned int iy) {
+    return heights[iy * size_x + ix];
+  }
+  double operator() (unsigned int ix, unsigned int iy) const {
+    return heights[iy * size_x + ix];
+  }
+
+  /** \brief Returns the interpolated height and (optionally) the unit
+   * surface normal at (x, y).
+   */
+  double GetHeight (double x, double y, Math::Vector3d *normal = NULL) const;
+
+  double origin_x;
+  double origin_y;
+  double resolution;
+  unsigned int size_x;
+  unsigned int size_y;
+  /// Heights stored row by row (size_x values per row).
+  std::vector<double> heights;
+};
+
+/** \brief Penalty based ground contact for cheap simulations.
+ *
+ * Every contact point that penetrates the ground is pushed out by a linear
+ * spring-damper along the local surface normal
+ *
+ * \f[ f_n = \max(0, k \delta - d \dot{\delta}_{n}) \f]
+ *
+ * and decelerated by a regularized Coulomb friction force
+ *
+ * \f[ f_t = - \mu f_n \frac{v_t}{\sqrt{\|v_t\|^2 + v_s^2}} \f]
+ *
+ * where \f$\delta\f$ is the penetration depth, \f$v_t\f$ the tangential
+ * velocity of the point and \f$v_s\f$ the slip velocity below which the
+ * friction force fades out smoothly. The contact forces are converted into
+ * spatial forces in base coordinates and added to the external force
+ * vector that is passed to ForwardDynamics().
+ *
+ * The ground is either the plane \f$n^T x = h\f$ or a HeightMap.
+ *
+ * \code
+ * CompliantGroundContact ground;
+ * ground.AddContactPoint (model, "L_Foot", Vector3d ( 0.1,  0.05, -0.02));
+ * ground.AddContactPoint (model, "L_Foot", Vector3d (-0.1, -0.05, -0.02));
+ * ground.Bind (model);
+ *
+ * std::vector<SpatialVector> f_ext (model.mBodies.size(),
+ *     SpatialVector::Zero());
+ * for (...) {
+ *   // CalcGroundContactForces() adds to f_ext
+ *   for (unsigned int i = 0; i < f_ext.size(); i++) {
+ *     f_ext[i].setZero();
+ *   }
+ *   CalcGroundContactForces (model, Q, QDot, ground, f_ext);
+ *   ForwardDynamics (model, Q, QDot, Tau, QDDot, &f_ext);
+ *   ...
+ * }
+ * \endcode
+ */
+struct RBDL_DLLAPI CompliantGroundContact {
+  CompliantGroundContact();
+
+  /** \brief Adds a contact point on the given body.
+   *
+   * \returns the index of the contact point
+   */
+  unsigned int AddContactPoint (
+    unsigned int body_id,
+    const Math::Vector3d &body_point,
+    const char *point_name = NULL);
+
+  /** \brief Adds a contact point on the body with the given name.
+   *
+   * Aborts if the model has no body with this name.
+   */
+  unsigned int AddContactPoint (
+    const Model &model,
+    const char *body_name,
+    const Math::Vector3d &body_point,
+    const char *point_name = NULL);
+
+  /// \brief Uses the plane n^T x = height as ground (the default).
+  void SetGroundPlane (const Math::Vector3d &normal, double height);
+
+  /// \brief Uses the given height map as ground.
+  void SetHeightMap (const HeightMap &height_map);
+
+  /// \brief Allocates the workspace.
+  bool Bind (const Model &model);
+
+  /// \brief Returns the number of contact points.
+  size_t size() const {
+    return body.size();
+  }
+
+  // Contact points
+
+  std::vector<unsigned int> body;
+  std::vector<Math::Vector3d> point;
+  std::vector<std::string> name;
+  /// Movable body that receives the force of each point.
+  std::vector<unsigned int> movable_body;
+
+  // Ground
+
+  bool use_height_map;
+  Math::Vector3d ground_normal;
+  double ground_height;
+  HeightMap height_map;
+
+  // Parameters
+
+  /// Normal stiffness per contact point in N/m (default: 1.0e5).
+  double stiffness;
+  /// Normal damping per contact point in Ns/m (default: 1.0e3).
+  double damping;
+  /// Coulomb friction coefficient (default: 0.8).
+  double mu;
+  /// Tangential velocity below which friction fades out (default: 1.0e-2).
+  double slip_velocity;
+
+  // Results (one column / entry per contact point)
+
+  /// Contact point positions in base coordinates.
+  Math::MatrixNd positions;
+  /// Contact point velocities in base coordinates.
+  Math::MatrixNd velocities;
+  /// Ground normals at the contact points.
+  Math::MatrixNd normals;
+  /// Penetration depth (positive when in contact).
+  Math::VectorNd penetration;
+  /// Magnitude of the normal forces.
+  Math::VectorNd normal_force;
+  /// Contact forces in base coordinates.
+  Math::MatrixNd forces;
+
+  // Workspace
+
+  Math::VectorNd normal_velocity;
+  Math::MatrixNd tangential_velocity;
+  Math::VectorNd friction_scale;
+
+  bool bound;
+};
+
+/** \brief Computes the ground contact forces and adds them to f_ext.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the internal joints
+ * \param QDot  velocity vector of the internal joints
+ * \param GC    the bound contact model, also receives the results
+ * \param f_ext external forces in base coordinates, the contact wrenches
+ *        are added to the entries of the contact bodies
+ * \param update_kinematics whether the kinematics should be updated
+ *        (default: true)
+ */
+RBDL_DLLAPI
+void CalcGroundContactForces (
+  Model &model,
+  const Math::VectorNd &Q,
+  const Math::VectorNd &QDot,
+  CompliantGroundContact &GC,
+  std::vector<Math::SpatialVector> &f_ext,
+  bool update_kinematics = true
+);
+
+}
+
+}
+
+}
+
+/* RBDL_CONTACT_GROUND_CONTACT_MODEL_H */
+#endif
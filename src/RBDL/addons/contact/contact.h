@@ -0,0 +1,14 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : contact
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_CONTACT_H
+#define RBDL_CONTACT_H
+
+#include "FrictionContactSolver.h"
+#include "GroundContactModel.h"
+
+#endif
@@ -0,0 +1,273 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : contact
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <UnitTest++.h>
+
+#include <cmath>
+#include <iostream>
+
+#include "rbdl/rbdl.h"
+
+#include "FrictionContactSolver.h"
+
+using namespace std;
+using namespace RigidBodyDynamics;
+using namespace RigidBodyDynamics::Math;
+using namespace RigidBodyDynamics::Addons::Contact;
+
+const double TEST_PREC = 1.0e-12;
+
+struct PointMassOnGround {
+  PointMassOnGround () {
+    model = new Model;
+    model->gravity = Vector3d (0., 0., -9.81);
+
+    body_id = model->AddBody (0, SpatialTransform(),
+        Joint (JointTypeTranslationXYZ),
+        Body (1., Vector3d (0., 0., 0.), Vector3d (0.1, 0.1, 0.1)));
+
+    contacts.AddContact (body_id, Vector3d (0., 0., 0.), 0.5, "point");
+    contacts.Bind (*model);
+
+    Q = VectorNd::Zero (model->q_size);
+    QDot = VectorNd::Zero (model->qdot_size);
+    QDotNext = VectorNd::Zero (model->qdot_size);
+    QDot_ref = VectorNd::Zero (model->qdot_size);
+    Tau = VectorNd::Zero (model->qdot_size);
+
+    dt = 0.01;
+  }
+  ~PointMassOnGround () {
+    delete model;
+  }
+
+  Model *model;
+  unsigned int body_id;
+
+  FrictionContactSet contacts;
+
+  VectorNd Q;
+  VectorNd QDot;
+  VectorNd QDotNext;
+  VectorNd QDot_ref;
+  VectorNd Tau;
+
+  double dt;
+};
+
+struct FloatingBoxOnGround {
+  FloatingBoxOnGround () {
+    model = new Model;
+    model->gravity = Vector3d (0., 0., -9.81);
+
+    body_id = model->AddBody (0, SpatialTransform(),
+        Joint (JointTypeFloatingBase),
+        Body (2., Vector3d (0., 0., 0.), Vector3d (0.02, 0.02, 0.02)));
+
+    contacts.AddContact (body_id, Vector3d ( 0.1,  0.1, -0.05), 0.8);
+    contacts.AddContact (body_id, Vector3d ( 0.1, -0.1, -0.05), 0.8);
+    contacts.AddContact (body_id, Vector3d (-0.1,  0.1, -0.05), 0.8);
+    contacts.AddContact (body_id, Vector3d (-0.1, -0.1, -0.05), 0.8);
+    contacts.Bind (*model);
+
+    Q = VectorNd::Zero (model->q_size);
+    QDot = VectorNd::Zero (model->qdot_size);
+    QDotNext = VectorNd::Zero (model->qdot_size);
+    QDot_ref = VectorNd::Zero (model->qdot_size);
+    Tau = VectorNd::Zero (model->qdot_size);
+
+    Q[2] = 0.05;
+    model->SetQuaternion (body_id, Quaternion (0., 0., 0., 1.), Q);
+
+    dt = 0.001;
+  }
+  ~FloatingBoxOnGround () {
+    delete model;
+  }
+
+  Model *model;
+  unsigned int body_id;
+
+  FrictionContactSet contacts;
+
+  VectorNd Q;
+  VectorNd QDot;
+  VectorNd QDotNext;
+  VectorNd QDot_ref;
+  VectorNd Tau;
+
+  double dt;
+};
+
+TEST_FIXTURE ( PointMassOnGround, TestFrictionContactResting ) {
+  StepFrictionContacts (*model, Q, QDot, Tau, dt, contacts, QDotNext);
+
+  CHECK (contacts.active[0]);
+  CHECK (contacts.converged);
+  CHECK_ARRAY_CLOSE (QDot_ref.data(), QDotNext.data(), 3,
+      TEST_PREC);
+  CHECK_CLOSE (9.81 * dt, contacts.impulse[0], TEST_PREC);
+  CHECK_CLOSE (9.81, contacts.force[0], TEST_PREC);
+  CHECK_CLOSE (0., contacts.impulse[1], TEST_PREC);
+  CHECK_CLOSE (0., contacts.impulse[2], TEST_PREC);
+}
+
+TEST_FIXTURE ( PointMassOnGround, TestFrictionContactSticking ) {
+  Tau[0] = 2.;
+  Tau[1] = -1.;
+
+  StepFrictionContacts (*model, Q, QDot, Tau, dt, contacts, QDotNext);
+
+  CHECK_ARRAY_CLOSE (QDot_ref.data(), QDotNext.data(), 3,
+      TEST_PREC);
+  CHECK_CLOSE (-2. * dt, contacts.impulse[1] * contacts.ground_tangent_1[0]
+      + contacts.impulse[2] * contacts.ground_tangent_2[0], TEST_PREC);
+  CHECK_CLOSE ( 1. * dt, contacts.impulse[1] * contacts.ground_tangent_1[1]
+      + contacts.impulse[2] * contacts.ground_tangent_2[1], TEST_PREC);
+}
+
+TEST_FIXTURE ( PointMassOnGround, TestFrictionContactSliding ) {
+  Tau[0] = 10.;
+
+  StepFrictionContacts (*model, Q, QDot, Tau, dt, contacts, QDotNext);
+
+  CHECK_CLOSE (dt * (10. - 0.5 * 9.81), QDotNext[0], TEST_PREC);
+  CHECK_CLOSE (0., QDotNext[1], TEST_PREC);
+  CHECK_CLOSE (0., QDotNext[2], TEST_PREC);
+
+  // friction impulse lies on the boundary of the friction disk
+  double t_norm = sqrt (contacts.impulse[1] * contacts.impulse[1]
+      + contacts.impulse[2] * contacts.impulse[2]);
+  CHECK_CLOSE (0.5 * contacts.impulse[0], t_norm, TEST_PREC);
+}
+
+TEST_FIXTURE ( PointMassOnGround, TestFrictionContactLiftoff ) {
+  Tau[2] = 20.;
+
+  StepFrictionContacts (*model, Q, QDot, Tau, dt, contacts, QDotNext);
+
+  CHECK_CLOSE (dt * (20. - 9.81), QDotNext[2], TEST_PREC);
+  CHECK_CLOSE (0., contacts.impulse[0], TEST_PREC);
+  CHECK_CLOSE (0., contacts.impulse[1], TEST_PREC);
+  CHECK_CLOSE (0., contacts.impulse[2], TEST_PREC);
+}
+
+TEST_FIXTURE ( PointMassOnGround, TestFrictionContactFreeFall ) {
+  Q[2] = 1.;
+
+  StepFrictionContacts (*model, Q, QDot, Tau, dt, contacts, QDotNext);
+
+  CHECK (!contacts.active[0]);
+  CHECK_EQUAL (0u, contacts.num_iterations);
+  CHECK_CLOSE (1., contacts.gap[0], TEST_PREC);
+  CHECK_CLOSE (-9.81 * dt, QDotNext[2], TEST_PREC);
+}
+
+TEST_FIXTURE ( PointMassOnGround, TestFrictionContactSpeculative ) {
+  Q[2] = 0.005;
+  QDot[2] = -2.;
+
+  StepFrictionContacts (*model, Q, QDot, Tau, dt, contacts, QDotNext);
+
+  // may only close the gap within the step
+  CHECK (contacts.active[0]);
+  CHECK_CLOSE (-0.005 / dt, QDotNext[2], TEST_PREC);
+}
+
+TEST_FIXTURE ( PointMassOnGround, TestFrictionContactPenetrationRecovery ) {
+  Q[2] = -0.01;
+
+  StepFrictionContacts (*model, Q, QDot, Tau, dt, contacts, QDotNext);
+
+  CHECK_CLOSE (contacts.penetration_recovery * 0.01 / dt, QDotNext[2],
+      TEST_PREC);
+}
+
+TEST_FIXTURE ( PointMassOnGround, TestFrictionContactInclinedPlane ) {
+  double angle = 0.3;
+  Vector3d normal (sin(angle), 0., cos(angle));
+  contacts.SetGroundPlane (normal, 0.);
+
+  // tan(0.3) < 0.5: the point mass sticks
+  StepFrictionContacts (*model, Q, QDot, Tau, dt, contacts, QDotNext);
+  CHECK_ARRAY_CLOSE (QDot_ref.data(), QDotNext.data(), 3,
+      TEST_PREC);
+
+  // with a lower friction coefficient it slides down the plane
+  contacts.mu[0] = 0.1;
+  contacts.clear();
+  StepFrictionContacts (*model, Q, QDot, Tau, dt, contacts, QDotNext);
+
+  Vector3d v (QDotNext[0], QDotNext[1], QDotNext[2]);
+  CHECK_CLOSE (0., normal.dot(v), TEST_PREC);
+  CHECK_CLOSE (dt * 9.81 * (sin(angle) - 0.1 * cos(angle)), v.norm(),
+      TEST_PREC);
+}
+
+TEST_FIXTURE ( FloatingBoxOnGround, TestFrictionContactBoxResting ) {
+  contacts.max_iterations = 500;
+
+  unsigned int cold_iterations = 0;
+
+  for (unsigned int step = 0; step < 20; step++) {
+    StepFrictionContacts (*model, Q, QDot, Tau, dt, contacts, QDotNext);
+
+    if (step == 0) {
+      cold_iterations = contacts.num_iterations;
+    }
+
+    QDot = QDotNext;
+    for (unsigned int i = 0; i < 3; i++) {
+      Q[i] += dt * QDot[i];
+    }
+  }
+
+  // warm-started steps converge faster than the initial one
+  CHECK (contacts.converged);
+  CHECK (contacts.num_iterations < cold_iterations);
+
+  CHECK_ARRAY_CLOSE (QDot_ref.data(), QDot.data(), 6, 1.0e-8);
+  CHECK_CLOSE (0.05, Q[2], 1.0e-8);
+
+  double normal_sum = 0.;
+  for (unsigned int i = 0; i < contacts.size(); i++) {
+    CHECK (contacts.impulse[3 * i] >= 0.);
+    normal_sum += contacts.impulse[3 * i];
+  }
+  CHECK_CLOSE (2. * 9.81 * dt, normal_sum, 1.0e-8);
+}
+
+TEST_FIXTURE ( FloatingBoxOnGround, TestFrictionContactBoxFrictionCone ) {
+  // push the box sideways and let it spin
+  QDot[0] = 1.;
+  QDot[5] = 2.;
+
+  for (unsigned int step = 0; step < 10; step++) {
+    StepFrictionContacts (*model, Q, QDot, Tau, dt, contacts, QDotNext);
+
+    for (unsigned int i = 0; i < contacts.size(); i++) {
+      double n = contacts.impulse[3 * i];
+      double t = sqrt (contacts.impulse[3 * i + 1] * contacts.impulse[3 * i + 1]
+          + contacts.impulse[3 * i + 2] * contacts.impulse[3 * i + 2]);
+      CHECK (n >= 0.);
+      CHECK (t <= contacts.mu[i] * n + TEST_PREC);
+      // no contact point moves into the ground
+      CHECK (contacts.velocity[3 * i] > -1.0e-8);
+    }
+
+    QDot = QDotNext;
+  }
+
+  // friction decelerates the box
+  CHECK (QDot[0] < 1.);
+  CHECK (QDot[0] > 0.);
+}
+
+int main (int argc, char *argv[])
+{
+    return UnitTest::RunAllTests ();
+}
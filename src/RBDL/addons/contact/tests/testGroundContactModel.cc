@@ -0,0 +1,222 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : contact
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <UnitTest++.h>
+
+#include <cmath>
+#include <iostream>
+
+#include "rbdl/rbdl.h"
+
+#include "GroundContactModel.h"
+
+using namespace std;
+using namespace RigidBodyDynamics;
+using namespace RigidBodyDynamics::Math;
+using namespace RigidBodyDynamics::Addons::Contact;
+
+static const double TEST_PREC = 1.0e-12;
+
+struct PointMassGround {
+  PointMassGround () {
+    model = new Model;
+    model->gravity = Vector3d (0., 0., -9.81);
+
+    body_id = model->AddBody (0, SpatialTransform(),
+        Joint (JointTypeTranslationXYZ),
+        Body (2., Vector3d (0., 0., 0.), Vector3d (0.1, 0.1, 0.1)),
+        "ball");
+
+    ground.AddContactPoint (*model, "ball", Vector3d (0., 0., -0.1));
+    ground.Bind (*model);
+
+    Q = VectorNd::Zero (model->q_size);
+    QDot = VectorNd::Zero (model->qdot_size);
+    QDDot = VectorNd::Zero (model->qdot_size);
+    Tau = VectorNd::Zero (model->qdot_size);
+    f_ext.assign (model->mBodies.size(), SpatialVector::Zero());
+  }
+  ~PointMassGround () {
+    delete model;
+  }
+
+  Model *model;
+  unsigned int body_id;
+
+  CompliantGroundContact ground;
+
+  VectorNd Q;
+  VectorNd QDot;
+  VectorNd QDDot;
+  VectorNd Tau;
+  std::vector<SpatialVector> f_ext;
+};
+
+TEST_FIXTURE ( PointMassGround, TestGroundContactNoContact ) {
+  Q[2] = 0.2;
+  CalcGroundContactForces (*model, Q, QDot, ground, f_ext);
+
+  CHECK_CLOSE (-0.1, ground.penetration[0], TEST_PREC);
+  CHECK_CLOSE (0., ground.normal_force[0], TEST_PREC);
+  SpatialVector f_ext_ref (SpatialVector::Zero());
+  CHECK_ARRAY_CLOSE (f_ext_ref.data(), f_ext[body_id].data(), 6, TEST_PREC);
+}
+
+TEST_FIXTURE ( PointMassGround, TestGroundContactStaticEquilibrium ) {
+  double depth = 2. * 9.81 / ground.stiffness;
+  Q[0] = 0.3;
+  Q[2] = 0.1 - depth;
+
+  CalcGroundContactForces (*model, Q, QDot, ground, f_ext);
+  ForwardDynamics (*model, Q, QDot, Tau, QDDot, &f_ext);
+
+  CHECK_CLOSE (depth, ground.penetration[0], TEST_PREC);
+  CHECK_CLOSE (2. * 9.81, ground.normal_force[0], 1.0e-10);
+  Vector3d QDDot_ref (Vector3d::Zero());
+  CHECK_ARRAY_CLOSE (QDDot_ref.data(), QDDot.data(), 3, 1.0e-10);
+
+  // the force acts at the contact point (0.3, 0., -depth)
+  CHECK_CLOSE (-0.3 * 2. * 9.81, f_ext[body_id][1], 1.0e-10);
+  CHECK_CLOSE (2. * 9.81, f_ext[body_id][5], 1.0e-10);
+}
+
+TEST_FIXTURE ( PointMassGround, TestGroundContactDamping ) {
+  Q[2] = 0.1 - 1.0e-3;
+
+  QDot[2] = -0.1;
+  CalcGroundContactForces (*model, Q, QDot, ground, f_ext);
+  CHECK_CLOSE (ground.stiffness * 1.0e-3 + ground.damping * 0.1,
+      ground.normal_force[0], 1.0e-10);
+
+  // the ground never pulls on the point
+  QDot[2] = 1.;
+  CalcGroundContactForces (*model, Q, QDot, ground, f_ext);
+  CHECK_CLOSE (0., ground.normal_force[0], TEST_PREC);
+}
+
+TEST_FIXTURE ( PointMassGround, TestGroundContactFriction ) {
+  Q[2] = 0.1 - 1.0e-3;
+  QDot[0] = 3.;
+  QDot[1] = -4.;
+
+  CalcGroundContactForces (*model, Q, QDot, ground, f_ext);
+
+  double fn = ground.normal_force[0];
+  double scale = ground.mu * fn / sqrt (25. + ground.slip_velocity
+      * ground.slip_velocity);
+
+  CHECK_CLOSE (-3. * scale, ground.forces(0, 0), 1.0e-10);
+  CHECK_CLOSE ( 4. * scale, ground.forces(1, 0), 1.0e-10);
+  CHECK_CLOSE (fn, ground.forces(2, 0), 1.0e-10);
+
+  // sliding fast the friction force approaches mu * fn
+  double ft = sqrt (ground.forces(0, 0) * ground.forces(0, 0)
+      + ground.forces(1, 0) * ground.forces(1, 0));
+  CHECK (ft < ground.mu * fn);
+  CHECK_CLOSE (ground.mu * fn, ft, 1.0e-5 * fn);
+}
+
+TEST_FIXTURE ( PointMassGround, TestGroundContactInclinedPlane ) {
+  Vector3d normal (0., sin (0.2), cos (0.2));
+  ground.SetGroundPlane (normal, 0.05);
+
+  Q[1] = 0.3;
+  Q[2] = 0.1;
+  CalcGroundContactForces (*model, Q, QDot, ground, f_ext);
+
+  Vector3d contact_point (0.0, 0.3, 0.);
+  CHECK_CLOSE (0.05 - normal.dot(contact_point), ground.penetration[0],
+      TEST_PREC);
+
+  Vector3d force = ground.forces.col(0);
+  CHECK_ARRAY_CLOSE (Vector3d (normal * ground.normal_force[0]).data(),
+      force.data(), 3, 1.0e-10);
+}
+
+TEST_FIXTURE ( PointMassGround, TestGroundContactHeightMap ) {
+  // plane z = 0.1 * x + 0.05 * y sampled on a grid
+  HeightMap height_map (-1., -1., 0.25, 9, 9);
+  for (unsigned int iy = 0; iy < height_map.size_y; iy++) {
+    for (unsigned int ix = 0; ix < height_map.size_x; ix++) {
+      double x = height_map.origin_x + ix * height_map.resolution;
+      double y = height_map.origin_y + iy * height_map.resolution;
+      height_map(ix, iy) = 0.1 * x + 0.05 * y;
+    }
+  }
+
+  Vector3d normal;
+  CHECK_CLOSE (0.1 * 0.33 + 0.05 * -0.41, height_map.GetHeight (0.33, -0.41,
+        &normal), TEST_PREC);
+  Vector3d normal_ref = Vector3d (-0.1, -0.05, 1.).normalized();
+  CHECK_ARRAY_CLOSE (normal_ref.data(), normal.data(), 3, TEST_PREC);
+
+  // the border heights are extended outside of the grid
+  CHECK_CLOSE (0.1 * 1. + 0.05 * -1., height_map.GetHeight (3., -2.),
+      TEST_PREC);
+
+  ground.SetHeightMap (height_map);
+  Q[0] = 0.33;
+  Q[1] = -0.41;
+  Q[2] = 0.1;
+
+  CalcGroundContactForces (*model, Q, QDot, ground, f_ext);
+
+  CHECK_CLOSE (height_map.GetHeight (0.33, -0.41) * normal_ref[2],
+      ground.penetration[0], TEST_PREC);
+  Vector3d force = ground.forces.col(0);
+  CHECK_ARRAY_CLOSE (Vector3d (normal_ref * ground.normal_force[0]).data(),
+      force.data(), 3, 1.0e-10);
+}
+
+TEST ( TestGroundContactBoxSettles ) {
+  Model model;
+  model.gravity = Vector3d (0., 0., -9.81);
+
+  unsigned int box_id = model.AddBody (0, SpatialTransform(),
+      Joint (JointTypeFloatingBase),
+      Body (4., Vector3d (0., 0., 0.), Vector3d (0.05, 0.05, 0.05)), "box");
+
+  CompliantGroundContact ground;
+  ground.AddContactPoint (model, "box", Vector3d ( 0.1,  0.1, -0.1));
+  ground.AddContactPoint (model, "box", Vector3d ( 0.1, -0.1, -0.1));
+  ground.AddContactPoint (model, "box", Vector3d (-0.1,  0.1, -0.1));
+  ground.AddContactPoint (model, "box", Vector3d (-0.1, -0.1, -0.1));
+  ground.Bind (model);
+
+  VectorNd Q (VectorNd::Zero (model.q_size));
+  VectorNd QDot (VectorNd::Zero (model.qdot_size));
+  VectorNd QDDot (VectorNd::Zero (model.qdot_size));
+  VectorNd Tau (VectorNd::Zero (model.qdot_size));
+  std::vector<SpatialVector> f_ext (model.mBodies.size());
+
+  Q[2] = 0.15;
+  model.SetQuaternion (box_id, Quaternion (0., 0., 0., 1.), Q);
+  QDot[0] = 0.5;
+
+  // semi-implicit Euler; the box does not rotate noticeably
+  double dt = 2.0e-4;
+  for (unsigned int i = 0; i < 10000; i++) {
+    for (unsigned int j = 0; j < f_ext.size(); j++) {
+      f_ext[j].setZero();
+    }
+    CalcGroundContactForces (model, Q, QDot, ground, f_ext);
+    ForwardDynamics (model, Q, QDot, Tau, QDDot, &f_ext);
+
+    QDot += dt * QDDot;
+    for (unsigned int j = 0; j < 3; j++) {
+      Q[j] += dt * QDot[j];
+    }
+  }
+
+  // resting on the ground with a static spring deflection, friction
+  // stopped the sliding
+  double depth = 4. * 9.81 / (4. * ground.stiffness);
+  CHECK_CLOSE (0.1 - depth, Q[2], 1.0e-6);
+  CHECK_CLOSE (0., QDot[0], 1.0e-3);
+  CHECK (Q[0] > 0.);
+  CHECK_CLOSE (4. * 9.81, ground.normal_force.sum(), 1.0e-3);
+}
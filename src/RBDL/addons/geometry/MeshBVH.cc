@@ -0,0 +1,843 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : geometry
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include "MeshBVH.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "TriangleMesh.h"
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Geometry {
+
+using namespace std;
+using namespace RigidBodyDynamics::Math;
+
+namespace {
+
+const unsigned int BVH_STACK_SIZE = 64;
+
+const char BVH_CACHE_MAGIC[8] = { 'R', 'B', 'D', 'L', 'B', 'V', 'H', '1' };
+
+struct BVHCacheHeader {
+  char magic[8];
+  uint64_t mesh_hash;
+  uint32_t num_nodes;
+  uint32_t num_triangles;
+};
+
+/// FNV-1a hash of the STL data, the scale and the leaf size.
+uint64_t HashMesh (const TriangleMesh &mesh, unsigned int max_leaf_size) {
+  uint64_t hash = 14695981039346656037ULL;
+  const uint64_t prime = 1099511628211ULL;
+
+  const unsigned char *data = mesh.GetData();
+  for (size_t i = 0; i < mesh.GetDataSize(); i++) {
+    hash = (hash ^ data[i]) * prime;
+  }
+
+  double scale = mesh.GetScale();
+  unsigned char extra[sizeof(double) + sizeof(unsigned int)];
+  memcpy (extra, &scale, sizeof(double));
+  memcpy (extra + sizeof(double), &max_leaf_size, sizeof(unsigned int));
+  for (size_t i = 0; i < sizeof(extra); i++) {
+    hash = (hash ^ extra[i]) * prime;
+  }
+
+  return hash;
+}
+
+struct BuildTriangle {
+  float bound_min[3];
+  float bound_max[3];
+  float centroid[3];
+  uint32_t index;
+};
+
+struct CentroidLess {
+  CentroidLess (unsigned int axis) : axis (axis) {}
+  bool operator() (const BuildTriangle &a, const BuildTriangle &b) const {
+    return a.centroid[axis] < b.centroid[axis];
+  }
+  unsigned int axis;
+};
+
+void BuildNode (std::vector<BVHNode> &nodes,
+    std::vector<BuildTriangle> &triangles,
+    unsigned int begin,
+    unsigned int end,
+    unsigned int max_leaf_size) {
+  unsigned int node_index = static_cast<unsigned int>(nodes.size());
+  nodes.push_back (BVHNode());
+
+  float centroid_min[3], centroid_max[3];
+  BVHNode node;
+  for (unsigned int k = 0; k < 3; k++) {
+    node.bound_min[k] = centroid_min[k] = numeric_limits<float>::max();
+    node.bound_max[k] = centroid_max[k] = -numeric_limits<float>::max();
+  }
+
+  for (unsigned int i = begin; i < end; i++) {
+    for (unsigned int k = 0; k < 3; k++) {
+      node.bound_min[k] = min (node.bound_min[k], triangles[i].bound_min[k]);
+      node.bound_max[k] = max (node.bound_max[k], triangles[i].bound_max[k]);
+      centroid_min[k] = min (centroid_min[k], triangles[i].centroid[k]);
+      centroid_max[k] = max (centroid_max[k], triangles[i].centroid[k]);
+    }
+  }
+
+  unsigned int axis = 0;
+  for (unsigned int k = 1; k < 3; k++) {
+    if (centroid_max[k] - centroid_min[k]
+        > centroid_max[axis] - centroid_min[axis]) {
+      axis = k;
+    }
+  }
+
+  // degenerate clusters (all centroids equal) cannot be split
+  if (end - begin <= max_leaf_size
+      || centroid_max[axis] - centroid_min[axis] <= 0.f) {
+    node.offset = begin;
+    node.count = end - begin;
+    nodes[node_index] = node;
+    return;
+  }
+
+  unsigned int mid = begin + (end - begin) / 2;
+  nth_element (triangles.begin() + begin, triangles.begin() + mid,
+      triangles.begin() + end, CentroidLess (axis));
+
+  BuildNode (nodes, triangles, begin, mid, max_leaf_size);
+  node.offset = static_cast<uint32_t>(nodes.size());
+  node.count = 0;
+  BuildNode (nodes, triangles, mid, end, max_leaf_size);
+
+  nodes[node_index] = node;
+}
+
+inline double BoxDistanceSquared (const BVHNode &node, const Vector3d &p) {
+  double result = 0.;
+  for (unsigned int k = 0; k < 3; k++) {
+    double d = 0.;
+    if (p[k] < node.bound_min[k]) {
+      d = node.bound_min[k] - p[k];
+    } else if (p[k] > node.bound_max[k]) {
+      d = p[k] - node.bound_max[k];
+    }
+    result += d * d;
+  }
+  return result;
+}
+
+/// Slab test, returns the entry distance or a negative value for a miss.
+inline double RayBoxEntry (const BVHNode &node, const Vector3d &origin,
+    const Vector3d &inv_direction, double max_distance) {
+  double t_min = 0.;
+  double t_max = max_distance;
+  for (unsigned int k = 0; k < 3; k++) {
+    double t0 = (node.bound_min[k] - origin[k]) * inv_direction[k];
+    double t1 = (node.bound_max[k] - origin[k]) * inv_direction[k];
+    if (t0 > t1) {
+      swap (t0, t1);
+    }
+    // NaN (0 * inf) leaves the interval untouched
+    if (t0 > t_min) {
+      t_min = t0;
+    }
+    if (t1 < t_max) {
+      t_max = t1;
+    }
+    if (t_min > t_max) {
+      return -1.;
+    }
+  }
+  return t_min;
+}
+
+/// Möller-Trumbore ray triangle intersection.
+inline bool RayTriangle (const Vector3d &origin, const Vector3d &direction,
+    const Vector3d &a, const Vector3d &b, const Vector3d &c, double *t) {
+  const double epsilon = 1.0e-14;
+
+  Vector3d e1 = b - a;
+  Vector3d e2 = c - a;
+  Vector3d p = direction.cross (e2);
+  double det = e1.dot (p);
+  if (fabs (det) < epsilon) {
+    return false;
+  }
+
+  double inv_det = 1. / det;
+  Vector3d s = origin - a;
+  double u = s.dot (p) * inv_det;
+  if (u < 0. || u > 1.) {
+    return false;
+  }
+
+  Vector3d q = s.cross (e1);
+  double v = direction.dot (q) * inv_det;
+  if (v < 0. || u + v > 1.) {
+    return false;
+  }
+
+  *t = e2.dot (q) * inv_det;
+  return *t >= 0.;
+}
+
+/// Closest point on triangle abc to p (Ericson, Real-Time Collision
+/// Detection, 5.1.5).
+Vector3d ClosestPointOnTriangle (const Vector3d &p, const Vector3d &a,
+    const Vector3d &b, const Vector3d &c) {
+  Vector3d ab = b - a;
+  Vector3d ac = c - a;
+  Vector3d ap = p - a;
+  double d1 = ab.dot (ap);
+  double d2 = ac.dot (ap);
+  if (d1 <= 0. && d2 <= 0.) {
+    return a;
+  }
+
+  Vector3d bp = p - b;
+  double d3 = ab.dot (bp);
+  double d4 = ac.dot (bp);
+  if (d3 >= 0. && d4 <= d3) {
+    return b;
+  }
+
+  double vc = d1 * d4 - d3 * d2;
+  if (vc <= 0. && d1 >= 0. && d3 <= 0.) {
+    return a + ab * (d1 / (d1 - d3));
+  }
+
+  Vector3d cp = p - c;
+  double d5 = ab.dot (cp);
+  double d6 = ac.dot (cp);
+  if (d6 >= 0. && d5 <= d6) {
+    return c;
+  }
+
+  double vb = d5 * d2 - d1 * d6;
+  if (vb <= 0. && d2 >= 0. && d6 <= 0.) {
+    return a + ac * (d2 / (d2 - d6));
+  }
+
+  double va = d3 * d6 - d5 * d4;
+  if (va <= 0. && (d4 - d3) >= 0. && (d5 - d6) >= 0.) {
+    return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+  }
+
+  double denom = 1. / (va + vb + vc);
+  return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+/// Closest points of the segments p1q1 and p2q2 (Ericson, 5.1.9).
+double ClosestPointsSegments (const Vector3d &p1, const Vector3d &q1,
+    const Vector3d &p2, const Vector3d &q2, Vector3d *c1, Vector3d *c2) {
+  const double epsilon = 1.0e-14;
+
+  Vector3d d1 = q1 - p1;
+  Vector3d d2 = q2 - p2;
+  Vector3d r = p1 - p2;
+  double a = d1.squaredNorm();
+  double e = d2.squaredNorm();
+  double f = d2.dot (r);
+  double s, t;
+
+  if (a <= epsilon && e <= epsilon) {
+    s = t = 0.;
+  } else if (a <= epsilon) {
+    s = 0.;
+    t = min (max (f / e, 0.), 1.);
+  } else {
+    double c = d1.dot (r);
+    if (e <= epsilon) {
+      t = 0.;
+      s = min (max (-c / a, 0.), 1.);
+    } else {
+      double b = d1.dot (d2);
+      double denom = a * e - b * b;
+      s = denom != 0. ? min (max ((b * f - c * e) / denom, 0.), 1.) : 0.;
+      t = (b * s + f) / e;
+      if (t < 0.) {
+        t = 0.;
+        s = min (max (-c / a, 0.), 1.);
+      } else if (t > 1.) {
+        t = 1.;
+        s = min (max ((b - c) / a, 0.), 1.);
+      }
+    }
+  }
+
+  *c1 = p1 + d1 * s;
+  *c2 = p2 + d2 * t;
+  return (*c1 - *c2).squaredNorm();
+}
+
+/// Checks whether segment pq crosses triangle abc.
+bool SegmentTriangle (const Vector3d &p, const Vector3d &q, const Vector3d &a,
+    const Vector3d &b, const Vector3d &c, Vector3d *point) {
+  double t;
+  if (RayTriangle (p, q - p, a, b, c, &t) && t <= 1.) {
+    *point = p + (q - p) * t;
+    return true;
+  }
+  return false;
+}
+
+inline Vector3d ToBase (const SpatialTransform &X, const Vector3d &p) {
+  return X.E.transpose() * p + X.r;
+}
+
+}
+
+MeshBVH::MeshBVH() :
+  mesh_hash (0)
+{ }
+
+void MeshBVH::Build (const TriangleMesh &mesh, unsigned int max_leaf_size) {
+  assert (max_leaf_size > 0);
+
+  unsigned int num_triangles = mesh.GetNumTriangles();
+  std::vector<BuildTriangle> build_triangles (num_triangles);
+
+  float v[9];
+  for (unsigned int i = 0; i < num_triangles; i++) {
+    mesh.GetTriangle (i, v);
+    BuildTriangle &triangle = build_triangles[i];
+    for (unsigned int k = 0; k < 3; k++) {
+      triangle.bound_min[k] = min (v[k], min (v[3 + k], v[6 + k]));
+      triangle.bound_max[k] = max (v[k], max (v[3 + k], v[6 + k]));
+      triangle.centroid[k] = (v[k] + v[3 + k] + v[6 + k]) / 3.f;
+    }
+    triangle.index = i;
+  }
+
+  nodes.clear();
+  nodes.reserve (num_triangles > 0 ? 2 * num_triangles / max_leaf_size + 1 : 1);
+  if (num_triangles > 0) {
+    BuildNode (nodes, build_triangles, 0, num_triangles, max_leaf_size);
+  }
+
+  triangle_index.resize (num_triangles);
+  vertices.resize (9 * num_triangles);
+  for (unsigned int i = 0; i < num_triangles; i++) {
+    triangle_index[i] = build_triangles[i].index;
+    mesh.GetTriangle (triangle_index[i], &vertices[9 * i]);
+  }
+
+  mesh_hash = HashMesh (mesh, max_leaf_size);
+}
+
+bool MeshBVH::BuildCached (const TriangleMesh &mesh,
+    const std::string &cache_filename, unsigned int max_leaf_size) {
+  if (LoadCache (cache_filename, mesh, max_leaf_size)) {
+    return true;
+  }
+
+  Build (mesh, max_leaf_size);
+  if (!SaveCache (cache_filename)) {
+    cerr << "Warning: could not write BVH cache file '" << cache_filename
+      << "'." << endl;
+  }
+
+  return false;
+}
+
+bool MeshBVH::LoadCache (const std::string &filename,
+    const TriangleMesh &mesh, unsigned int max_leaf_size) {
+  MappedFile file;
+  if (!file.Open (filename) || file.GetSize() < sizeof (BVHCacheHeader)) {
+    return false;
+  }
+
+  BVHCacheHeader header;
+  memcpy (&header, file.GetData(), sizeof (header));
+
+  if (memcmp (header.magic, BVH_CACHE_MAGIC, sizeof (BVH_CACHE_MAGIC)) != 0
+      || header.num_triangles != mesh.GetNumTriangles()
+      || header.mesh_hash != HashMesh (mesh, max_leaf_size)) {
+    return false;
+  }
+
+  size_t nodes_size = header.num_nodes * sizeof (BVHNode);
+  size_t index_size = header.num_triangles * sizeof (uint32_t);
+  size_t vertices_size = 9 * header.num_triangles * sizeof (float);
+  if (file.GetSize() != sizeof (header) + nodes_size + index_size
+      + vertices_size) {
+    return false;
+  }
+
+  const unsigned char *data = file.GetData() + sizeof (header);
+  nodes.resize (header.num_nodes);
+  triangle_index.resize (header.num_triangles);
+  vertices.resize (9 * header.num_triangles);
+  if (nodes_size > 0) {
+    memcpy (&nodes[0], data, nodes_size);
+  }
+  if (index_size > 0) {
+    memcpy (&triangle_index[0], data + nodes_size, index_size);
+    memcpy (&vertices[0], data + nodes_size + index_size, vertices_size);
+  }
+  mesh_hash = header.mesh_hash;
+
+  return true;
+}
+
+bool MeshBVH::SaveCache (const std::string &filename) const {
+  FILE *file = fopen (filename.c_str(), "wb");
+  if (file == NULL) {
+    return false;
+  }
+
+  BVHCacheHeader header;
+  memcpy (header.magic, BVH_CACHE_MAGIC, sizeof (BVH_CACHE_MAGIC));
+  header.mesh_hash = mesh_hash;
+  header.num_nodes = GetNumNodes();
+  header.num_triangles = GetNumTriangles();
+
+  bool success = fwrite (&header, sizeof (header), 1, file) == 1;
+  if (success && !nodes.empty()) {
+    success = fwrite (&nodes[0], sizeof (BVHNode), nodes.size(), file)
+      == nodes.size();
+  }
+  if (success && !triangle_index.empty()) {
+    success = fwrite (&triangle_index[0], sizeof (uint32_t),
+        triangle_index.size(), file) == triangle_index.size()
+      && fwrite (&vertices[0], sizeof (float), vertices.size(), file)
+      == vertices.size();
+  }
+
+  success = (fclose (file) == 0) && success;
+  if (!success) {
+    remove (filename.c_str());
+  }
+
+  return success;
+}
+
+bool MeshBVH::RayCast (const Vector3d &origin, const Vector3d &direction,
+    double max_distance, MeshRayHit *hit) const {
+  if (nodes.empty()) {
+    return false;
+  }
+
+  double length = direction.norm();
+  assert (length > 0.);
+  Vector3d dir = direction / length;
+  Vector3d inv_direction (1. / dir[0], 1. / dir[1], 1. / dir[2]);
+
+  double closest = max_distance;
+  int closest_triangle = -1;
+
+  unsigned int stack[BVH_STACK_SIZE];
+  unsigned int stack_size = 0;
+  stack[stack_size++] = 0;
+
+  while (stack_size > 0) {
+    const BVHNode &node = nodes[stack[--stack_size]];
+    if (RayBoxEntry (node, origin, inv_direction, closest) < 0.) {
+      continue;
+    }
+
+    if (node.IsLeaf()) {
+      for (unsigned int i = node.offset; i < node.offset + node.count; i++) {
+        double t;
+        if (RayTriangle (origin, dir, GetVertex (i, 0), GetVertex (i, 1),
+              GetVertex (i, 2), &t) && t <= closest) {
+          closest = t;
+          closest_triangle = i;
+        }
+      }
+    } else {
+      assert (stack_size + 2 <= BVH_STACK_SIZE);
+      unsigned int first = static_cast<unsigned int>(&node - &nodes[0]) + 1;
+      stack[stack_size++] = node.offset;
+      stack[stack_size++] = first;
+    }
+  }
+
+  if (closest_triangle < 0) {
+    return false;
+  }
+
+  Vector3d a = GetVertex (closest_triangle, 0);
+  Vector3d normal = (GetVertex (closest_triangle, 1) - a).cross (
+      GetVertex (closest_triangle, 2) - a).normalized();
+  if (normal.dot (dir) > 0.) {
+    normal = -normal;
+  }
+
+  hit->distance = closest;
+  hit->triangle = triangle_index[closest_triangle];
+  hit->point = origin + dir * closest;
+  hit->normal = normal;
+
+  return true;
+}
+
+double MeshBVH::Distance (const Vector3d &point, Vector3d *closest_point,
+    unsigned int *triangle, double max_distance) const {
+  if (nodes.empty()) {
+    return max_distance;
+  }
+
+  double best = max_distance * max_distance;
+  int best_triangle = -1;
+  Vector3d best_point (point);
+
+  unsigned int stack[BVH_STACK_SIZE];
+  unsigned int stack_size = 0;
+  stack[stack_size++] = 0;
+
+  while (stack_size > 0) {
+    unsigned int node_index = stack[--stack_size];
+    const BVHNode &node = nodes[node_index];
+    if (BoxDistanceSquared (node, point) >= best) {
+      continue;
+    }
+
+    if (node.IsLeaf()) {
+      for (unsigned int i = node.offset; i < node.offset + node.count; i++) {
+        Vector3d p = ClosestPointOnTriangle (point, GetVertex (i, 0),
+            GetVertex (i, 1), GetVertex (i, 2));
+        double d = (p - point).squaredNorm();
+        if (d < best) {
+          best = d;
+          best_triangle = i;
+          best_point = p;
+        }
+      }
+    } else {
+      // visit the closer child first
+      assert (stack_size + 2 <= BVH_STACK_SIZE);
+      unsigned int first = node_index + 1;
+      unsigned int second = node.offset;
+      if (BoxDistanceSquared (nodes[first], point)
+          > BoxDistanceSquared (nodes[second], point)) {
+        swap (first, second);
+      }
+      stack[stack_size++] = second;
+      stack[stack_size++] = first;
+    }
+  }
+
+  if (best_triangle < 0) {
+    return max_distance;
+  }
+
+  if (closest_point) {
+    *closest_point = best_point;
+  }
+  if (triangle) {
+    *triangle = triangle_index[best_triangle];
+  }
+
+  return sqrt (best);
+}
+
+bool MeshBVH::IsInside (const Vector3d &point) const {
+  if (nodes.empty()) {
+    return false;
+  }
+
+  // Rays that graze edges or vertices can count a crossing twice or not at
+  // all, therefore three skewed rays vote.
+  static const double directions[3][3] = {
+    { 0.5773, 0.5774, 0.5775 },
+    { -0.4264, 0.6396, -0.6396 },
+    { 0.2673, -0.5345, -0.8018 }
+  };
+
+  unsigned int votes = 0;
+  for (unsigned int r = 0; r < 3; r++) {
+    Vector3d dir = Vector3d (directions[r][0], directions[r][1],
+        directions[r][2]).normalized();
+    Vector3d inv_direction (1. / dir[0], 1. / dir[1], 1. / dir[2]);
+
+    unsigned int crossings = 0;
+    unsigned int stack[BVH_STACK_SIZE];
+    unsigned int stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0) {
+      unsigned int node_index = stack[--stack_size];
+      const BVHNode &node = nodes[node_index];
+      if (RayBoxEntry (node, point, inv_direction,
+            numeric_limits<double>::infinity()) < 0.) {
+        continue;
+      }
+
+      if (node.IsLeaf()) {
+        for (unsigned int i = node.offset; i < node.offset + node.count; i++) {
+          double t;
+          if (RayTriangle (point, dir, GetVertex (i, 0), GetVertex (i, 1),
+                GetVertex (i, 2), &t)) {
+            crossings++;
+          }
+        }
+      } else {
+        assert (stack_size + 2 <= BVH_STACK_SIZE);
+        stack[stack_size++] = node.offset;
+        stack[stack_size++] = node_index + 1;
+      }
+    }
+
+    votes += crossings % 2;
+  }
+
+  return votes >= 2;
+}
+
+double MeshBVH::SignedDistance (const Vector3d &point,
+    Vector3d *closest_point) const {
+  double distance = Distance (point, closest_point);
+  return IsInside (point) ? -distance : distance;
+}
+
+double MeshBVH::MinimumAlong (const Vector3d &direction,
+    Vector3d *vertex) const {
+  double best = numeric_limits<double>::infinity();
+  if (nodes.empty()) {
+    return best;
+  }
+
+  const float *best_vertex = NULL;
+
+  unsigned int stack[BVH_STACK_SIZE];
+  unsigned int stack_size = 0;
+  stack[stack_size++] = 0;
+
+  while (stack_size > 0) {
+    unsigned int node_index = stack[--stack_size];
+    const BVHNode &node = nodes[node_index];
+
+    double bound = 0.;
+    for (unsigned int k = 0; k < 3; k++) {
+      bound += min (direction[k] * node.bound_min[k],
+          direction[k] * node.bound_max[k]);
+    }
+    if (bound >= best) {
+      continue;
+    }
+
+    if (node.IsLeaf()) {
+      const float *v = &vertices[9 * node.offset];
+      for (unsigned int i = 0; i < 3 * node.count; i++, v += 3) {
+        double d = direction[0] * v[0] + direction[1] * v[1]
+          + direction[2] * v[2];
+        if (d < best) {
+          best = d;
+          best_vertex = v;
+        }
+      }
+    } else {
+      assert (stack_size + 2 <= BVH_STACK_SIZE);
+      stack[stack_size++] = node.offset;
+      stack[stack_size++] = node_index + 1;
+    }
+  }
+
+  if (vertex && best_vertex) {
+    *vertex = Vector3d (best_vertex[0], best_vertex[1], best_vertex[2]);
+  }
+
+  return best;
+}
+
+RBDL_DLLAPI
+double TriangleDistance (
+    const Vector3d *triangle_a,
+    const Vector3d *triangle_b,
+    Vector3d *point_a,
+    Vector3d *point_b) {
+  // an edge of one triangle that crosses the other one
+  for (unsigned int i = 0; i < 3; i++) {
+    Vector3d p;
+    if (SegmentTriangle (triangle_a[i], triangle_a[(i + 1) % 3],
+          triangle_b[0], triangle_b[1], triangle_b[2], &p)
+        || SegmentTriangle (triangle_b[i], triangle_b[(i + 1) % 3],
+          triangle_a[0], triangle_a[1], triangle_a[2], &p)) {
+      *point_a = p;
+      *point_b = p;
+      return 0.;
+    }
+  }
+
+  // otherwise the closest points are on two edges or a vertex and a face
+  double best = numeric_limits<double>::infinity();
+  Vector3d c1, c2;
+
+  for (unsigned int i = 0; i < 3; i++) {
+    for (unsigned int j = 0; j < 3; j++) {
+      double d = ClosestPointsSegments (triangle_a[i], triangle_a[(i + 1) % 3],
+          triangle_b[j], triangle_b[(j + 1) % 3], &c1, &c2);
+      if (d < best) {
+        best = d;
+        *point_a = c1;
+        *point_b = c2;
+      }
+    }
+  }
+
+  for (unsigned int i = 0; i < 3; i++) {
+    c2 = ClosestPointOnTriangle (triangle_a[i], triangle_b[0], triangle_b[1],
+        triangle_b[2]);
+    double d = (triangle_a[i] - c2).squaredNorm();
+    if (d < best) {
+      best = d;
+      *point_a = triangle_a[i];
+      *point_b = c2;
+    }
+
+    c1 = ClosestPointOnTriangle (triangle_b[i], triangle_a[0], triangle_a[1],
+        triangle_a[2]);
+    d = (triangle_b[i] - c1).squaredNorm();
+    if (d < best) {
+      best = d;
+      *point_a = c1;
+      *point_b = triangle_b[i];
+    }
+  }
+
+  return sqrt (best);
+}
+
+RBDL_DLLAPI
+double MeshDistance (
+    const MeshBVH &bvh_a,
+    const SpatialTransform &X_a,
+    const MeshBVH &bvh_b,
+    const SpatialTransform &X_b,
+    Vector3d *point_a,
+    Vector3d *point_b,
+    double max_distance) {
+  if (bvh_a.nodes.empty() || bvh_b.nodes.empty()) {
+    return max_distance;
+  }
+
+  // pose of b in the frame of a: p_a = E p_b + r
+  Matrix3d E = X_a.E * X_b.E.transpose();
+  Vector3d r = X_a.E * (X_b.r - X_a.r);
+  Matrix3d E_abs = E.cwiseAbs();
+
+  double best = max_distance * max_distance;
+  bool found = false;
+  Vector3d best_a (Vector3d::Zero());
+  Vector3d best_b (Vector3d::Zero());
+
+  unsigned int stack[2 * BVH_STACK_SIZE][2];
+  unsigned int stack_size = 0;
+  stack[0][0] = 0;
+  stack[0][1] = 0;
+  stack_size = 1;
+
+  Vector3d tri_a[3], tri_b[3];
+
+  while (stack_size > 0) {
+    stack_size--;
+    unsigned int index_a = stack[stack_size][0];
+    unsigned int index_b = stack[stack_size][1];
+    const BVHNode &node_a = bvh_a.nodes[index_a];
+    const BVHNode &node_b = bvh_b.nodes[index_b];
+
+    // conservative axis aligned box of node_b in the frame of a
+    Vector3d center (
+        0.5 * (node_b.bound_min[0] + node_b.bound_max[0]),
+        0.5 * (node_b.bound_min[1] + node_b.bound_max[1]),
+        0.5 * (node_b.bound_min[2] + node_b.bound_max[2]));
+    Vector3d extent (
+        0.5 * (node_b.bound_max[0] - node_b.bound_min[0]),
+        0.5 * (node_b.bound_max[1] - node_b.bound_min[1]),
+        0.5 * (node_b.bound_max[2] - node_b.bound_min[2]));
+    center = E * center + r;
+    extent = E_abs * extent;
+
+    double box_distance = 0.;
+    for (unsigned int k = 0; k < 3; k++) {
+      double d = max (0., max (node_a.bound_min[k] - (center[k] + extent[k]),
+            (center[k] - extent[k]) - node_a.bound_max[k]));
+      box_distance += d * d;
+    }
+    if (box_distance >= best) {
+      continue;
+    }
+
+    if (node_a.IsLeaf() && node_b.IsLeaf()) {
+      for (unsigned int i = node_a.offset; i < node_a.offset + node_a.count;
+          i++) {
+        for (unsigned int k = 0; k < 3; k++) {
+          tri_a[k] = bvh_a.GetVertex (i, k);
+        }
+        for (unsigned int j = node_b.offset; j < node_b.offset + node_b.count;
+            j++) {
+          for (unsigned int k = 0; k < 3; k++) {
+            tri_b[k] = E * bvh_b.GetVertex (j, k) + r;
+          }
+          Vector3d c1, c2;
+          double d = TriangleDistance (tri_a, tri_b, &c1, &c2);
+          if (d * d < best) {
+            best = d * d;
+            found = true;
+            best_a = c1;
+            best_b = c2;
+          }
+        }
+      }
+      if (found && best == 0.) {
+        break;
+      }
+      continue;
+    }
+
+    assert (stack_size + 2 <= 2 * BVH_STACK_SIZE);
+
+    // descend into the larger of the two nodes
+    double size_a = 0., size_b = 0.;
+    for (unsigned int k = 0; k < 3; k++) {
+      size_a += node_a.bound_max[k] - node_a.bound_min[k];
+      size_b += node_b.bound_max[k] - node_b.bound_min[k];
+    }
+
+    if (node_b.IsLeaf() || (!node_a.IsLeaf() && size_a >= size_b)) {
+      stack[stack_size][0] = node_a.offset;
+      stack[stack_size++][1] = index_b;
+      stack[stack_size][0] = index_a + 1;
+      stack[stack_size++][1] = index_b;
+    } else {
+      stack[stack_size][0] = index_a;
+      stack[stack_size++][1] = node_b.offset;
+      stack[stack_size][0] = index_a;
+      stack[stack_size++][1] = index_b + 1;
+    }
+  }
+
+  if (!found) {
+    return max_distance;
+  }
+
+  if (point_a) {
+    *point_a = ToBase (X_a, best_a);
+  }
+  if (point_b) {
+    *point_b = ToBase (X_a, best_b);
+  }
+
+  return sqrt (best);
+}
+
+}
+
+}
+
+}
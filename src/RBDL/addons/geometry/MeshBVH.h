@@ -0,0 +1,219 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : geometry
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_GEOMETRY_MESH_BVH_H
+#define RBDL_GEOMETRY_MESH_BVH_H
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include <rbdl/rbdl_math.h>
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Geometry {
+
+class TriangleMesh;
+
+/** \brief Node of a flattened bounding volume hierarchy (32 bytes).
+ *
+ * The nodes are stored in depth-first order: the first child of an inner
+ * node directly follows its parent, the index of the second child is
+ * stored in offset. Leaves store the index of their first triangle in
+ * offset and the number of triangles in count.
+ */
+struct RBDL_DLLAPI BVHNode {
+  float bound_min[3];
+  float bound_max[3];
+  uint32_t offset;
+  uint32_t count;
+
+  bool IsLeaf() const { return count > 0; }
+};
+
+/// \brief Result of a ray query against a mesh.
+struct RBDL_DLLAPI MeshRayHit {
+  MeshRayHit() :
+    distance (0.),
+    triangle (0),
+    point (Math::Vector3d::Zero()),
+    normal (Math::Vector3d::Zero())
+  { }
+
+  /// Distance along the (normalized) ray direction.
+  double distance;
+  /// Index of the hit triangle in the STL file.
+  unsigned int triangle;
+  Math::Vector3d point;
+  /// Unit normal of the hit triangle facing against the ray.
+  Math::Vector3d normal;
+};
+
+/** \brief Flattened axis aligned bounding volume hierarchy over the
+ * triangles of a mesh.
+ *
+ * The hierarchy is built top-down by splitting the triangles at the median
+ * of their centroids along the largest extent. The vertices are copied
+ * into one contiguous float array in leaf order so that a traversal reads
+ * memory mostly sequentially. All queries are performed in the coordinate
+ * frame of the mesh.
+ *
+ * Building the hierarchy of a large mesh takes noticeably longer than
+ * loading it, therefore it can be stored in a cache file together with a
+ * hash of the STL data (BuildCached()). The cache is only used if the hash
+ * matches the mesh that is passed in.
+ */
+class RBDL_DLLAPI MeshBVH {
+  public:
+    MeshBVH();
+
+    /** \brief Builds the hierarchy for the given mesh.
+     *
+     * \param mesh mesh that contains the triangles
+     * \param max_leaf_size maximum number of triangles per leaf
+     */
+    void Build (const TriangleMesh &mesh, unsigned int max_leaf_size = 4);
+
+    /** \brief Loads the hierarchy from a cache file if it was built for
+     * the given mesh, otherwise builds it and writes the cache file.
+     *
+     * \returns true if the cache file was used
+     */
+    bool BuildCached (const TriangleMesh &mesh,
+        const std::string &cache_filename, unsigned int max_leaf_size = 4);
+
+    /// \brief Reads a cache file. Returns false if it does not match mesh.
+    bool LoadCache (const std::string &filename, const TriangleMesh &mesh,
+        unsigned int max_leaf_size = 4);
+    /// \brief Writes the hierarchy into a cache file.
+    bool SaveCache (const std::string &filename) const;
+
+    unsigned int GetNumTriangles() const {
+      return static_cast<unsigned int>(triangle_index.size());
+    }
+    unsigned int GetNumNodes() const {
+      return static_cast<unsigned int>(nodes.size());
+    }
+
+    /// \brief Returns vertex (0..2) of triangle i in leaf order.
+    Math::Vector3d GetVertex (unsigned int i, unsigned int vertex) const {
+      const float *v = &vertices[9 * i + 3 * vertex];
+      return Math::Vector3d (v[0], v[1], v[2]);
+    }
+
+    /** \brief Casts a ray and returns the closest hit.
+     *
+     * \param origin start of the ray
+     * \param direction direction of the ray (does not need to be normalized)
+     * \param max_distance maximum distance along the ray
+     * \param hit (output) closest hit
+     *
+     * \returns true if the ray hits a triangle within max_distance
+     */
+    bool RayCast (const Math::Vector3d &origin, const Math::Vector3d &direction,
+        double max_distance, MeshRayHit *hit) const;
+
+    /** \brief Computes the distance from point to the closest point on the
+     * mesh.
+     *
+     * \param point query point
+     * \param closest_point (output, optional) closest point on the mesh
+     * \param triangle (output, optional) STL index of the closest triangle
+     * \param max_distance triangles further away than this are ignored
+     *
+     * \returns the distance or max_distance if no triangle is closer
+     */
+    double Distance (const Math::Vector3d &point,
+        Math::Vector3d *closest_point = NULL, unsigned int *triangle = NULL,
+        double max_distance = std::numeric_limits<double>::infinity()) const;
+
+    /** \brief Checks whether point lies inside the mesh.
+     *
+     * Counts the crossings of a ray from point with the mesh. The result
+     * is only meaningful for closed meshes.
+     */
+    bool IsInside (const Math::Vector3d &point) const;
+
+    /** \brief Signed distance of point to the mesh (negative inside).
+     *
+     * The magnitude is the penetration depth for points inside of the
+     * mesh, closest_point is then the point where the penetration is
+     * resolved with the least motion.
+     */
+    double SignedDistance (const Math::Vector3d &point,
+        Math::Vector3d *closest_point = NULL) const;
+
+    /** \brief Returns the minimum of direction.dot(v) over all vertices v.
+     *
+     * \param direction direction of the query
+     * \param vertex (output, optional) vertex at which the minimum occurs
+     */
+    double MinimumAlong (const Math::Vector3d &direction,
+        Math::Vector3d *vertex = NULL) const;
+
+    /// Flattened nodes, nodes[0] is the root.
+    std::vector<BVHNode> nodes;
+    /// Vertices of the triangles in leaf order (9 floats per triangle).
+    std::vector<float> vertices;
+    /// STL index of each triangle in leaf order.
+    std::vector<uint32_t> triangle_index;
+    /// Hash of the STL data the hierarchy was built from.
+    uint64_t mesh_hash;
+};
+
+/** \brief Computes the distance between two meshes.
+ *
+ * The poses of the meshes are given as transformations from base
+ * coordinates to the mesh frames (as in Model::X_base). The distance is
+ * exact: intersecting meshes have distance 0.
+ *
+ * \param bvh_a hierarchy of the first mesh
+ * \param X_a transformation from base coordinates to the frame of bvh_a
+ * \param bvh_b hierarchy of the second mesh
+ * \param X_b transformation from base coordinates to the frame of bvh_b
+ * \param point_a (output, optional) closest point on a in base coordinates
+ * \param point_b (output, optional) closest point on b in base coordinates
+ * \param max_distance pairs further apart than this are ignored
+ *
+ * \returns the distance or max_distance if the meshes are further apart
+ */
+RBDL_DLLAPI
+double MeshDistance (
+    const MeshBVH &bvh_a,
+    const Math::SpatialTransform &X_a,
+    const MeshBVH &bvh_b,
+    const Math::SpatialTransform &X_b,
+    Math::Vector3d *point_a = NULL,
+    Math::Vector3d *point_b = NULL,
+    double max_distance = std::numeric_limits<double>::infinity()
+    );
+
+/** \brief Computes the distance between two triangles.
+ *
+ * \returns the distance (0 if the triangles intersect)
+ */
+RBDL_DLLAPI
+double TriangleDistance (
+    const Math::Vector3d *triangle_a,
+    const Math::Vector3d *triangle_b,
+    Math::Vector3d *point_a,
+    Math::Vector3d *point_b
+    );
+
+}
+
+}
+
+}
+
+/* RBDL_GEOMETRY_MESH_BVH_H */
+#endif
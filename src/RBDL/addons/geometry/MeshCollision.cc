@@ -0,0 +1,177 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : geometry
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include "MeshCollision.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+#include "rbdl/Model.h"
+
+#include "TriangleMesh.h"
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Geometry {
+
+using namespace std;
+using namespace RigidBodyDynamics::Math;
+
+MeshCollisionSet::MeshCollisionSet() :
+  bound (false)
+{ }
+
+int MeshCollisionSet::AddMesh (
+    unsigned int body_id,
+    const std::string &mesh_filename,
+    const SpatialTransform &mesh_transform,
+    double scale,
+    const std::string &cache_filename) {
+  TriangleMesh mesh;
+  if (!mesh.LoadSTL (mesh_filename, scale)) {
+    return -1;
+  }
+
+  bound = false;
+
+  bvh.push_back (MeshBVH());
+  if (cache_filename.empty()) {
+    bvh.back().Build (mesh);
+  } else {
+    bvh.back().BuildCached (mesh, cache_filename);
+  }
+
+  body.push_back (body_id);
+  X_mesh.push_back (mesh_transform);
+  X_base.push_back (mesh_transform);
+  filename.push_back (mesh_filename);
+
+  return static_cast<int>(bvh.size()) - 1;
+}
+
+int MeshCollisionSet::AddMesh (
+    Model &model,
+    const char *body_name,
+    const std::string &mesh_filename,
+    const SpatialTransform &mesh_transform,
+    double scale,
+    const std::string &cache_filename) {
+  unsigned int body_id = model.GetBodyId (body_name);
+  if (body_id == std::numeric_limits<unsigned int>::max()) {
+    cerr << "Error: cannot add mesh to unknown body '" << body_name << "'."
+      << endl;
+    abort();
+  }
+
+  return AddMesh (body_id, mesh_filename, mesh_transform, scale,
+      cache_filename);
+}
+
+void MeshCollisionSet::Bind (const Model &model) {
+  movable_body.resize (body.size());
+  for (unsigned int i = 0; i < body.size(); i++) {
+    movable_body[i] = body[i];
+    if (body[i] >= model.fixed_body_discriminator) {
+      movable_body[i] =
+        model.mFixedBodies[body[i] - model.fixed_body_discriminator].mMovableParent;
+    }
+  }
+
+  bound = true;
+}
+
+void MeshCollisionSet::UpdateTransforms (const Model &model) {
+  assert (bound);
+
+  for (unsigned int i = 0; i < bvh.size(); i++) {
+    if (body[i] >= model.fixed_body_discriminator) {
+      const FixedBody &fixed_body =
+        model.mFixedBodies[body[i] - model.fixed_body_discriminator];
+      X_base[i] = X_mesh[i] * fixed_body.mParentTransform
+        * model.X_base[movable_body[i]];
+    } else {
+      X_base[i] = X_mesh[i] * model.X_base[body[i]];
+    }
+  }
+}
+
+bool MeshCollisionSet::RayCast (const Vector3d &origin,
+    const Vector3d &direction, double max_distance,
+    MeshSetRayHit *hit) const {
+  Vector3d dir = direction.normalized();
+  double closest = max_distance;
+  bool found = false;
+
+  MeshRayHit mesh_hit;
+  for (unsigned int i = 0; i < bvh.size(); i++) {
+    const SpatialTransform &X = X_base[i];
+    if (bvh[i].RayCast (X.E * (origin - X.r), X.E * dir, closest,
+          &mesh_hit)) {
+      closest = mesh_hit.distance;
+      found = true;
+
+      hit->distance = mesh_hit.distance;
+      hit->triangle = mesh_hit.triangle;
+      hit->point = X.E.transpose() * mesh_hit.point + X.r;
+      hit->normal = X.E.transpose() * mesh_hit.normal;
+      hit->mesh = i;
+    }
+  }
+
+  return found;
+}
+
+double MeshCollisionSet::SignedDistance (unsigned int mesh,
+    const Vector3d &point, Vector3d *closest_point) const {
+  assert (mesh < bvh.size());
+
+  const SpatialTransform &X = X_base[mesh];
+  Vector3d closest_local;
+  double distance = bvh[mesh].SignedDistance (X.E * (point - X.r),
+      &closest_local);
+
+  if (closest_point) {
+    *closest_point = X.E.transpose() * closest_local + X.r;
+  }
+
+  return distance;
+}
+
+double MeshCollisionSet::MeshDistance (unsigned int mesh_a,
+    unsigned int mesh_b, Vector3d *point_a, Vector3d *point_b,
+    double max_distance) const {
+  assert (mesh_a < bvh.size() && mesh_b < bvh.size());
+
+  return Geometry::MeshDistance (bvh[mesh_a], X_base[mesh_a], bvh[mesh_b],
+      X_base[mesh_b], point_a, point_b, max_distance);
+}
+
+double MeshCollisionSet::PlanePenetration (unsigned int mesh,
+    const Vector3d &normal, double height, Vector3d *deepest_point) const {
+  assert (mesh < bvh.size());
+
+  // normal.dot(E^T v + r) = (E normal).dot(v) + normal.dot(r)
+  const SpatialTransform &X = X_base[mesh];
+  Vector3d vertex;
+  double minimum = bvh[mesh].MinimumAlong (X.E * normal, &vertex)
+    + normal.dot (X.r);
+
+  if (deepest_point) {
+    *deepest_point = X.E.transpose() * vertex + X.r;
+  }
+
+  return height - minimum;
+}
+
+}
+
+}
+
+}
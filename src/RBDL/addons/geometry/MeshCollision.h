@@ -0,0 +1,163 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : geometry
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_GEOMETRY_MESH_COLLISION_H
+#define RBDL_GEOMETRY_MESH_COLLISION_H
+
+#include <string>
+#include <vector>
+
+#include <rbdl/rbdl_math.h>
+
+#include "MeshBVH.h"
+
+namespace RigidBodyDynamics {
+
+struct Model;
+
+namespace Addons {
+
+namespace Geometry {
+
+/// \brief Result of a ray query against a MeshCollisionSet.
+struct RBDL_DLLAPI MeshSetRayHit : public MeshRayHit {
+  MeshSetRayHit() :
+    MeshRayHit(),
+    mesh (0)
+  { }
+
+  /// Index of the mesh that was hit.
+  unsigned int mesh;
+};
+
+/** \brief Collision meshes attached to the bodies of a model.
+ *
+ * Every mesh is loaded from a binary STL file and gets a MeshBVH that is
+ * optionally cached on disk. The poses of the meshes are taken from
+ * Model::X_base, therefore the kinematics have to be updated (e.g. with
+ * UpdateKinematicsCustom()) before calling UpdateTransforms(). All query
+ * points, directions and results are in base coordinates.
+ *
+ * \code
+ * MeshCollisionSet meshes;
+ * unsigned int left = meshes.AddMesh (model, "L_Foot", "meshes/L_Foot.STL");
+ * unsigned int right = meshes.AddMesh (model, "R_Foot", "meshes/R_Foot.STL");
+ * meshes.Bind (model);
+ *
+ * UpdateKinematicsCustom (model, &Q, NULL, NULL);
+ * meshes.UpdateTransforms (model);
+ * double clearance = meshes.MeshDistance (left, right);
+ * \endcode
+ */
+struct RBDL_DLLAPI MeshCollisionSet {
+  MeshCollisionSet();
+
+  /** \brief Loads a mesh and attaches it to a body.
+   *
+   * \param body_id the body the mesh is attached to (may be a fixed body)
+   * \param filename binary STL file of the mesh
+   * \param X_mesh transformation from body coordinates to the mesh frame
+   * \param scale scale factor of the vertices (e.g. 1.0e-3 for millimeters)
+   * \param cache_filename file used to cache the BVH (empty: no caching)
+   *
+   * \returns the index of the mesh or -1 if the file cannot be loaded
+   */
+  int AddMesh (
+      unsigned int body_id,
+      const std::string &filename,
+      const Math::SpatialTransform &X_mesh = Math::SpatialTransform(),
+      double scale = 1.,
+      const std::string &cache_filename = ""
+      );
+
+  /// \brief Same as above but the body is specified by its name.
+  int AddMesh (
+      Model &model,
+      const char *body_name,
+      const std::string &filename,
+      const Math::SpatialTransform &X_mesh = Math::SpatialTransform(),
+      double scale = 1.,
+      const std::string &cache_filename = ""
+      );
+
+  /// \brief Resolves fixed bodies, must be called after all meshes were added.
+  void Bind (const Model &model);
+
+  /** \brief Updates the poses of all meshes from Model::X_base.
+   */
+  void UpdateTransforms (const Model &model);
+
+  size_t size() const {
+    return bvh.size();
+  }
+
+  /** \brief Casts a ray against all meshes.
+   *
+   * \returns true if a mesh is hit within max_distance
+   */
+  bool RayCast (const Math::Vector3d &origin, const Math::Vector3d &direction,
+      double max_distance, MeshSetRayHit *hit) const;
+
+  /** \brief Distance of point to mesh (negative inside of the mesh).
+   *
+   * \param mesh index of the mesh
+   * \param point query point
+   * \param closest_point (output, optional) closest point on the surface
+   */
+  double SignedDistance (unsigned int mesh, const Math::Vector3d &point,
+      Math::Vector3d *closest_point = NULL) const;
+
+  /** \brief Distance between two meshes (0 if they intersect).
+   *
+   * \param mesh_a index of the first mesh
+   * \param mesh_b index of the second mesh
+   * \param point_a (output, optional) closest point on mesh_a
+   * \param point_b (output, optional) closest point on mesh_b
+   * \param max_distance the search stops at this distance
+   */
+  double MeshDistance (unsigned int mesh_a, unsigned int mesh_b,
+      Math::Vector3d *point_a = NULL, Math::Vector3d *point_b = NULL,
+      double max_distance = std::numeric_limits<double>::infinity()) const;
+
+  /** \brief Penetration of a mesh into the half space below a plane.
+   *
+   * The plane contains all points p with normal.dot(p) = height. The
+   * penetration is the depth of the deepest vertex below the plane and is
+   * negative if the mesh is above the plane.
+   *
+   * \param mesh index of the mesh
+   * \param normal unit normal of the plane (pointing out of the ground)
+   * \param height offset of the plane along normal
+   * \param deepest_point (output, optional) deepest vertex of the mesh
+   */
+  double PlanePenetration (unsigned int mesh, const Math::Vector3d &normal,
+      double height, Math::Vector3d *deepest_point = NULL) const;
+
+  /// Body ids the meshes are attached to.
+  std::vector<unsigned int> body;
+  /// Movable body (or movable parent of a fixed body) of each mesh.
+  std::vector<unsigned int> movable_body;
+  /// Transformation from body coordinates to the mesh frame.
+  std::vector<Math::SpatialTransform> X_mesh;
+  /// Transformation from base coordinates to the mesh frame.
+  std::vector<Math::SpatialTransform> X_base;
+  /// Bounding volume hierarchies in mesh coordinates.
+  std::vector<MeshBVH> bvh;
+  /// Source file of each mesh.
+  std::vector<std::string> filename;
+
+  bool bound;
+};
+
+}
+
+}
+
+}
+
+/* RBDL_GEOMETRY_MESH_COLLISION_H */
+#endif
@@ -0,0 +1,511 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : geometry
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include "ReachabilityMap.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+
+#include <rbdl/Kinematics.h>
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Geometry {
+
+using namespace std;
+using namespace RigidBodyDynamics::Math;
+
+namespace {
+
+const char REACHABILITY_MAP_MAGIC[8] =
+  { 'R', 'B', 'D', 'L', 'R', 'M', 'P', '1' };
+
+struct ReachabilityMapHeader {
+  char magic[8];
+  uint32_t dimensions[3];
+  uint32_t orientation_bins;
+  uint32_t root_body_id;
+  uint32_t body_id;
+  double lower[3];
+  double voxel_size;
+  double orientation_range;
+  double max_manipulability;
+};
+
+/// Per-thread state of ReachabilityMap::Build().
+struct SampleWorkspace {
+  Model model;
+  VectorNd q;
+  MatrixNd J;
+  MatrixNd J_chain;
+};
+
+/// Raises value to candidate if candidate is larger.
+void AtomicMax (std::atomic<uint32_t> &value, uint32_t candidate) {
+  uint32_t current = value.load (std::memory_order_relaxed);
+  while (candidate > current
+      && !value.compare_exchange_weak (current, candidate,
+        std::memory_order_relaxed)) {
+  }
+}
+
+/// Bit pattern of a non-negative float, the patterns are ordered like the
+/// values.
+uint32_t FloatBits (float value) {
+  uint32_t bits;
+  memcpy (&bits, &value, sizeof (bits));
+  return bits;
+}
+
+float BitsFloat (uint32_t bits) {
+  float value;
+  memcpy (&value, &bits, sizeof (value));
+  return value;
+}
+
+}
+
+ReachabilityMapParameters::ReachabilityMapParameters() :
+  lower (Vector3d::Zero()),
+  upper (Vector3d::Zero()),
+  voxel_size (0.03),
+  orientation_bins (3),
+  orientation_range (0.6),
+  num_samples (1000000),
+  samples_per_task (4096),
+  seed (0)
+{ }
+
+ReachabilityMap::ReachabilityMap() :
+  mOrientationBins (0),
+  mNumCells (0),
+  mLower (Vector3d::Zero()),
+  mVoxelSize (1.),
+  mOrientationRange (0.),
+  mMaxManipulability (0.),
+  mRootBodyId (0),
+  mBodyId (0),
+  mCells (NULL) {
+  mDimensions[0] = mDimensions[1] = mDimensions[2] = 0;
+}
+
+void ReachabilityMap::Build (const Model &model,
+    unsigned int root_body_id,
+    unsigned int body_id,
+    const Vector3d &body_point,
+    const VectorNd &Q,
+    const VectorNd &q_min,
+    const VectorNd &q_max,
+    const ReachabilityMapParameters &parameters,
+    ThreadPool &pool) {
+  assert (Q.size() == model.q_size);
+  assert (q_min.size() == model.q_size);
+  assert (q_max.size() == model.q_size);
+  assert (parameters.voxel_size > 0.);
+  assert (parameters.orientation_bins > 0);
+  assert (parameters.orientation_range > 0.
+      && parameters.orientation_range < 3.14159265358979323846);
+  assert (parameters.samples_per_task > 0);
+
+  mFile.Close();
+
+  // joints of the chain from the root to the body
+  unsigned int end_body_id = body_id;
+  Vector3d end_offset = body_point;
+  if (body_id >= model.fixed_body_discriminator) {
+    const FixedBody &fixed_body =
+      model.mFixedBodies[body_id - model.fixed_body_discriminator];
+    end_body_id = fixed_body.mMovableParent;
+    end_offset = fixed_body.mParentTransform.E.transpose() * body_point
+      + fixed_body.mParentTransform.r;
+  }
+
+  unsigned int root_movable_id = root_body_id;
+  if (root_body_id >= model.fixed_body_discriminator) {
+    root_movable_id = model.mFixedBodies[
+      root_body_id - model.fixed_body_discriminator].mMovableParent;
+  }
+
+  std::vector<unsigned int> chain;
+  for (unsigned int i = end_body_id; i != root_movable_id;
+      i = model.lambda[i]) {
+    assert (i != 0);
+    assert (model.mJoints[i].mDoFCount == 1);
+    assert (model.mJoints[i].mJointType != JointTypeCustom);
+    assert (std::isfinite (q_min[model.mJoints[i].q_index])
+        && std::isfinite (q_max[model.mJoints[i].q_index]));
+    chain.push_back (i);
+  }
+  std::reverse (chain.begin(), chain.end());
+  assert (!chain.empty());
+
+  std::vector<unsigned int> chain_q_index (chain.size());
+  for (unsigned int k = 0; k < chain.size(); k++) {
+    chain_q_index[k] = model.mJoints[chain[k]].q_index;
+  }
+
+  // grid
+  Vector3d lower = parameters.lower;
+  Vector3d upper = parameters.upper;
+  if (!(lower[0] < upper[0] && lower[1] < upper[1] && lower[2] < upper[2])) {
+    Model reference_model = model;
+    VectorNd q_reference = Q;
+    UpdateKinematicsCustom (reference_model, &q_reference, NULL, NULL);
+
+    Vector3d center = CalcBodyWorldOrientation (reference_model, q_reference,
+        root_body_id, false) * (reference_model.X_base[chain[0]].r
+        - CalcBodyToBaseCoordinates (reference_model, q_reference,
+          root_body_id, Vector3d::Zero(), false));
+
+    double reach = end_offset.norm();
+    for (unsigned int k = 1; k < chain.size(); k++) {
+      reach += model.X_T[chain[k]].r.norm();
+    }
+    reach += parameters.voxel_size;
+
+    lower = center - Vector3d (reach, reach, reach);
+    upper = center + Vector3d (reach, reach, reach);
+  }
+
+  mLower = lower;
+  mVoxelSize = parameters.voxel_size;
+  mOrientationBins = parameters.orientation_bins;
+  mOrientationRange = parameters.orientation_range;
+  mRootBodyId = root_body_id;
+  mBodyId = body_id;
+  for (unsigned int k = 0; k < 3; k++) {
+    mDimensions[k] = std::max (1u, static_cast<unsigned int>(
+          std::ceil ((upper[k] - lower[k]) / mVoxelSize)));
+  }
+
+  unsigned int orientation_cells = mOrientationBins * mOrientationBins
+    * mOrientationBins;
+  size_t num_cells = static_cast<size_t>(mDimensions[0]) * mDimensions[1]
+    * mDimensions[2] * orientation_cells;
+  assert (num_cells < static_cast<size_t>(std::numeric_limits<int>::max()));
+  mNumCells = static_cast<unsigned int>(num_cells);
+
+  // Every cell keeps the float bits of the largest values of its samples.
+  // The manipulability is offset by one so that 0 marks unreached cells.
+  std::unique_ptr<std::atomic<uint32_t>[]> cell_manipulability (
+      new std::atomic<uint32_t>[mNumCells]);
+  std::unique_ptr<std::atomic<uint32_t>[]> cell_margin (
+      new std::atomic<uint32_t>[mNumCells]);
+  for (unsigned int c = 0; c < mNumCells; c++) {
+    cell_manipulability[c] = 0;
+    cell_margin[c] = 0;
+  }
+
+  std::vector<SampleWorkspace> workspaces (pool.GetNumThreads());
+  for (unsigned int i = 0; i < workspaces.size(); i++) {
+    workspaces[i].model = model;
+    workspaces[i].q = Q;
+    workspaces[i].J = MatrixNd::Zero (6, model.qdot_size);
+    workspaces[i].J_chain = MatrixNd::Zero (6, chain.size());
+  }
+
+  unsigned int num_tasks = (parameters.num_samples
+      + parameters.samples_per_task - 1) / parameters.samples_per_task;
+
+  // Every task draws its samples from its own seeded generator, so the
+  // result does not depend on which thread runs the task.
+  pool.ParallelFor (0, num_tasks,
+      [&] (unsigned int task, unsigned int thread_id) {
+      SampleWorkspace &ws = workspaces[thread_id];
+      Model &sample_model = ws.model;
+
+      std::seed_seq seed_sequence = { parameters.seed, task };
+      std::mt19937 random_engine (seed_sequence);
+      std::uniform_real_distribution<double> unit (0., 1.);
+
+      unsigned int sample_begin = task * parameters.samples_per_task;
+      unsigned int sample_end = std::min (parameters.num_samples,
+          sample_begin + parameters.samples_per_task);
+
+      for (unsigned int s = sample_begin; s < sample_end; s++) {
+        double margin = 1.;
+        for (unsigned int k = 0; k < chain.size(); k++) {
+          unsigned int qi = chain_q_index[k];
+          double u = unit (random_engine);
+          ws.q[qi] = q_min[qi] + u * (q_max[qi] - q_min[qi]);
+          margin = std::min (margin, 2. * std::min (u, 1. - u));
+        }
+
+        UpdateKinematicsCustom (sample_model, &ws.q, NULL, NULL);
+
+        Matrix3d root_orientation = CalcBodyWorldOrientation (sample_model,
+            ws.q, root_body_id, false);
+        Vector3d position = root_orientation * (CalcBodyToBaseCoordinates (
+              sample_model, ws.q, body_id, body_point, false)
+            - CalcBodyToBaseCoordinates (sample_model, ws.q, root_body_id,
+              Vector3d::Zero(), false));
+        Matrix3d orientation = CalcBodyWorldOrientation (sample_model, ws.q,
+            body_id, false) * root_orientation.transpose();
+
+        int cell = GetCellIndex (position, orientation);
+        if (cell < 0) {
+          continue;
+        }
+
+        CalcPointJacobian6D (sample_model, ws.q, body_id, body_point, ws.J,
+            false);
+        for (unsigned int k = 0; k < chain.size(); k++) {
+          ws.J_chain.col (k) = ws.J.col (chain_q_index[k]);
+        }
+
+        double determinant = chain.size() >= 6
+          ? (ws.J_chain * ws.J_chain.transpose()).determinant()
+          : (ws.J_chain.transpose() * ws.J_chain).determinant();
+        double manipulability = std::sqrt (std::max (0., determinant));
+
+        AtomicMax (cell_manipulability[cell],
+            FloatBits (static_cast<float>(manipulability)) + 1);
+        AtomicMax (cell_margin[cell],
+            FloatBits (static_cast<float>(margin)));
+      }
+      });
+
+  // crop the grid to the reached voxels
+  unsigned int min_index[3] = { mDimensions[0], mDimensions[1],
+    mDimensions[2] };
+  unsigned int max_index[3] = { 0, 0, 0 };
+  float max_manipulability = 0.f;
+  for (unsigned int c = 0; c < mNumCells; c++) {
+    uint32_t bits = cell_manipulability[c];
+    if (bits == 0) {
+      continue;
+    }
+    max_manipulability = std::max (max_manipulability, BitsFloat (bits - 1));
+
+    unsigned int voxel = c / orientation_cells;
+    unsigned int index[3] = {
+      voxel / (mDimensions[1] * mDimensions[2]),
+      (voxel / mDimensions[2]) % mDimensions[1],
+      voxel % mDimensions[2]
+    };
+    for (unsigned int k = 0; k < 3; k++) {
+      min_index[k] = std::min (min_index[k], index[k]);
+      max_index[k] = std::max (max_index[k], index[k]);
+    }
+  }
+
+  mMaxManipulability = max_manipulability > 0.f ? max_manipulability : 1.;
+
+  if (min_index[0] > max_index[0]) {
+    cerr << "Warning: no sample reached the reachability map." << endl;
+    mDimensions[0] = mDimensions[1] = mDimensions[2] = 0;
+    mNumCells = 0;
+    mStorage.clear();
+    mCells = NULL;
+    return;
+  }
+
+  unsigned int full_dimensions[3] = { mDimensions[0], mDimensions[1],
+    mDimensions[2] };
+  for (unsigned int k = 0; k < 3; k++) {
+    mDimensions[k] = max_index[k] - min_index[k] + 1;
+    mLower[k] += min_index[k] * mVoxelSize;
+  }
+  mNumCells = mDimensions[0] * mDimensions[1] * mDimensions[2]
+    * orientation_cells;
+
+  mStorage.resize (2 * static_cast<size_t>(mNumCells));
+  unsigned int c = 0;
+  for (unsigned int x = 0; x < mDimensions[0]; x++) {
+    for (unsigned int y = 0; y < mDimensions[1]; y++) {
+      for (unsigned int z = 0; z < mDimensions[2]; z++) {
+        unsigned int voxel = ((x + min_index[0]) * full_dimensions[1]
+            + y + min_index[1]) * full_dimensions[2] + z + min_index[2];
+        for (unsigned int o = 0; o < orientation_cells; o++, c++) {
+          uint32_t bits = cell_manipulability[voxel * orientation_cells + o];
+          if (bits == 0) {
+            mStorage[2 * c] = 0;
+            mStorage[2 * c + 1] = 0;
+            continue;
+          }
+
+          double manipulability = BitsFloat (bits - 1) / mMaxManipulability;
+          double margin = BitsFloat (cell_margin[voxel * orientation_cells + o]);
+          mStorage[2 * c] = static_cast<uint8_t>(
+              1 + std::floor (254. * std::min (1., manipulability) + 0.5));
+          mStorage[2 * c + 1] = static_cast<uint8_t>(
+              std::floor (255. * std::min (1., margin) + 0.5));
+        }
+      }
+    }
+  }
+
+  mCells = &mStorage[0];
+}
+
+bool ReachabilityMap::Save (const std::string &filename) const {
+  FILE *file = fopen (filename.c_str(), "wb");
+  if (file == NULL) {
+    return false;
+  }
+
+  ReachabilityMapHeader header;
+  memcpy (header.magic, REACHABILITY_MAP_MAGIC,
+      sizeof (REACHABILITY_MAP_MAGIC));
+  for (unsigned int k = 0; k < 3; k++) {
+    header.dimensions[k] = mDimensions[k];
+    header.lower[k] = mLower[k];
+  }
+  header.orientation_bins = mOrientationBins;
+  header.root_body_id = mRootBodyId;
+  header.body_id = mBodyId;
+  header.voxel_size = mVoxelSize;
+  header.orientation_range = mOrientationRange;
+  header.max_manipulability = mMaxManipulability;
+
+  bool success = fwrite (&header, sizeof (header), 1, file) == 1;
+  if (success && mNumCells > 0) {
+    success = fwrite (mCells, 2, mNumCells, file) == mNumCells;
+  }
+
+  success = (fclose (file) == 0) && success;
+  if (!success) {
+    remove (filename.c_str());
+  }
+
+  return success;
+}
+
+bool ReachabilityMap::Load (const std::string &filename) {
+  mStorage.clear();
+  mCells = NULL;
+  mNumCells = 0;
+
+  if (!mFile.Open (filename)) {
+    cerr << "Error: could not map reachability map '" << filename << "'."
+      << endl;
+    return false;
+  }
+
+  ReachabilityMapHeader header;
+  if (mFile.GetSize() >= sizeof (header)) {
+    memcpy (&header, mFile.GetData(), sizeof (header));
+  }
+
+  size_t num_cells = 0;
+  if (mFile.GetSize() >= sizeof (header)
+      && memcmp (header.magic, REACHABILITY_MAP_MAGIC,
+        sizeof (REACHABILITY_MAP_MAGIC)) == 0) {
+    num_cells = static_cast<size_t>(header.dimensions[0])
+      * header.dimensions[1] * header.dimensions[2]
+      * header.orientation_bins * header.orientation_bins
+      * header.orientation_bins;
+  }
+
+  if (num_cells == 0 || mFile.GetSize() != sizeof (header) + 2 * num_cells) {
+    cerr << "Error: '" << filename << "' is not a valid reachability map."
+      << endl;
+    mFile.Close();
+    return false;
+  }
+
+  for (unsigned int k = 0; k < 3; k++) {
+    mDimensions[k] = header.dimensions[k];
+    mLower[k] = header.lower[k];
+  }
+  mOrientationBins = header.orientation_bins;
+  mRootBodyId = header.root_body_id;
+  mBodyId = header.body_id;
+  mVoxelSize = header.voxel_size;
+  mOrientationRange = header.orientation_range;
+  mMaxManipulability = header.max_manipulability;
+  mNumCells = static_cast<unsigned int>(num_cells);
+  mCells = mFile.GetData() + sizeof (header);
+
+  return true;
+}
+
+int ReachabilityMap::GetCellIndex (const Vector3d &position,
+    const Matrix3d &orientation) const {
+  if (mNumCells == 0) {
+    return -1;
+  }
+
+  int index = 0;
+  for (unsigned int k = 0; k < 3; k++) {
+    double voxel = std::floor ((position[k] - mLower[k]) / mVoxelSize);
+    if (!(voxel >= 0. && voxel < mDimensions[k])) {
+      return -1;
+    }
+    index = index * mDimensions[k] + static_cast<int>(voxel);
+  }
+
+  // rotation vector of the orientation, rotations by more than pi lie
+  // outside of any orientation range
+  double w_squared = 1. + orientation.trace();
+  if (!(w_squared > 0.)) {
+    return -1;
+  }
+  Quaternion quat = Quaternion::fromMatrix (orientation);
+  Vector3d axis (quat[0], quat[1], quat[2]);
+  double sin_half_angle = axis.norm();
+  Vector3d rotation_vector = Vector3d::Zero();
+  if (sin_half_angle > 0.) {
+    rotation_vector = axis
+      * (2. * std::atan2 (sin_half_angle, quat[3]) / sin_half_angle);
+  }
+
+  for (unsigned int k = 0; k < 3; k++) {
+    double bin = std::floor ((rotation_vector[k] + mOrientationRange)
+        / (2. * mOrientationRange) * mOrientationBins);
+    if (!(bin >= 0. && bin < mOrientationBins)) {
+      return -1;
+    }
+    index = index * mOrientationBins + static_cast<int>(bin);
+  }
+
+  return index;
+}
+
+bool ReachabilityMap::Query (const Vector3d &position,
+    const Matrix3d &orientation,
+    double *manipulability,
+    double *joint_margin) const {
+  int index = GetCellIndex (position, orientation);
+  bool reachable = index >= 0 && mCells[2 * index] > 0;
+
+  if (manipulability) {
+    *manipulability = reachable
+      ? (mCells[2 * index] - 1) / 254. * mMaxManipulability : 0.;
+  }
+  if (joint_margin) {
+    *joint_margin = reachable ? mCells[2 * index + 1] / 255. : 0.;
+  }
+
+  return reachable;
+}
+
+unsigned int ReachabilityMap::GetNumReachableCells() const {
+  unsigned int count = 0;
+  for (unsigned int c = 0; c < mNumCells; c++) {
+    if (mCells[2 * c] > 0) {
+      count++;
+    }
+  }
+  return count;
+}
+
+}
+
+}
+
+}
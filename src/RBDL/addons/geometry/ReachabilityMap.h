@@ -0,0 +1,196 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : geometry
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_GEOMETRY_REACHABILITY_MAP_H
+#define RBDL_GEOMETRY_REACHABILITY_MAP_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <rbdl/rbdl_math.h>
+#include <rbdl/Model.h>
+#include <rbdl/ThreadPool.h>
+
+#include "TriangleMesh.h"
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Geometry {
+
+/// \brief Settings of ReachabilityMap::Build().
+struct RBDL_DLLAPI ReachabilityMapParameters {
+  ReachabilityMapParameters();
+
+  /// Corners of the position grid in root coordinates. If lower is not
+  /// smaller than upper the box around the first joint of the chain that
+  /// contains the whole reach of the chain is used (default).
+  Math::Vector3d lower;
+  Math::Vector3d upper;
+  /// Edge length of the position voxels (default 0.03).
+  double voxel_size;
+  /// Number of bins of each component of the rotation vector (default 3).
+  unsigned int orientation_bins;
+  /// The rotation vectors are binned within [-orientation_range,
+  /// orientation_range] (default 0.6). Must be smaller than pi.
+  double orientation_range;
+  /// Number of random configurations (default 1000000).
+  unsigned int num_samples;
+  /// Number of samples that are drawn by a single task (default 4096).
+  unsigned int samples_per_task;
+  /// Seed of the random configurations (default 0).
+  unsigned int seed;
+};
+
+/** \brief Voxelized reachability map of a kinematic chain with
+ * manipulability and joint limit margin per cell.
+ *
+ * The map covers the poses of a point on a body (e.g. the sole of a
+ * foot) relative to a root body (e.g. the pelvis). The position is
+ * binned into a regular voxel grid and the orientation into a grid over
+ * the rotation vector, so a cell is a small set of 6D poses. Build()
+ * samples the joints of the chain uniformly within their limits, computes
+ * the pose and the Jacobian of every sample with the forward kinematics
+ * of the model and stores for every cell that was hit:
+ *
+ * - the largest manipulability sqrt(det(J J^T)) of the chain Jacobian
+ * - the largest joint limit margin, i.e. the minimum over the joints of
+ *   the distance to the closer limit relative to half of the range
+ *   (1: all joints centered, 0: a joint at its limit)
+ *
+ * Both values are quantized to one byte each. The grid is cropped to the
+ * cells that were reached. Save() writes a header followed by the cells
+ * and Load() maps such a file read-only (see MappedFile), so loading is
+ * instantaneous and the cells stay shared between processes.
+ *
+ * Queries take the position in root coordinates and the orientation as
+ * the rotation from root to body coordinates (as in
+ * CalcBodyWorldOrientation()). A query only computes the cell index and
+ * reads two bytes, so it can be used to prune footstep candidates before
+ * any inverse kinematics runs. Poses outside of the map are unreachable.
+ *
+ * \note The map is conservative only up to the sampling density: cells at
+ * the boundary of the workspace that were not hit by a sample are
+ * reported as unreachable.
+ */
+class RBDL_DLLAPI ReachabilityMap {
+  public:
+    ReachabilityMap();
+
+    /** \brief Builds the map by sampling the chain in parallel.
+     *
+     * \param model the model, copied for every thread
+     * \param root_body_id body (or 0) at the start of the chain
+     * \param body_id body at the end of the chain (may be fixed)
+     * \param body_point point in body coordinates
+     * \param Q configuration of all joints outside of the chain
+     * \param q_min lower limits (size q_size), used for the chain joints
+     * \param q_max upper limits (size q_size), used for the chain joints
+     * \param parameters grid and sampling settings
+     * \param pool thread pool that evaluates the samples
+     *
+     * All joints of the chain must have a single degree of freedom and
+     * finite limits. The result only depends on the parameters, not on
+     * the number of threads.
+     */
+    void Build (const Model &model,
+        unsigned int root_body_id,
+        unsigned int body_id,
+        const Math::Vector3d &body_point,
+        const Math::VectorNd &Q,
+        const Math::VectorNd &q_min,
+        const Math::VectorNd &q_max,
+        const ReachabilityMapParameters &parameters,
+        ThreadPool &pool);
+
+    /// \brief Writes the map into a file. Returns false on failure.
+    bool Save (const std::string &filename) const;
+    /** \brief Maps a file written by Save().
+     *
+     * Returns false and prints a message if the file cannot be mapped or
+     * is not a valid reachability map.
+     */
+    bool Load (const std::string &filename);
+
+    /** \brief Index of the cell of a pose or -1 if it lies outside of the
+     * map.
+     */
+    int GetCellIndex (const Math::Vector3d &position,
+        const Math::Matrix3d &orientation) const;
+
+    /// \brief Whether any sample reached the cell of the pose.
+    bool IsReachable (const Math::Vector3d &position,
+        const Math::Matrix3d &orientation) const {
+      int index = GetCellIndex (position, orientation);
+      return index >= 0 && mCells[2 * index] > 0;
+    }
+
+    /** \brief Looks up the quality of the cell of a pose.
+     *
+     * \param manipulability (output, optional) largest manipulability
+     * reached in the cell
+     * \param joint_margin (output, optional) largest joint limit margin in
+     * [0, 1] reached in the cell
+     *
+     * \returns false if the pose is unreachable (outputs are set to 0)
+     */
+    bool Query (const Math::Vector3d &position,
+        const Math::Matrix3d &orientation,
+        double *manipulability,
+        double *joint_margin) const;
+
+    unsigned int GetNumCells() const { return mNumCells; }
+    unsigned int GetNumReachableCells() const;
+    const unsigned int* GetDimensions() const { return mDimensions; }
+    unsigned int GetOrientationBins() const { return mOrientationBins; }
+    const Math::Vector3d& GetLower() const { return mLower; }
+    double GetVoxelSize() const { return mVoxelSize; }
+    double GetOrientationRange() const { return mOrientationRange; }
+    /// \brief Manipulability that corresponds to the largest quantized
+    /// value.
+    double GetMaxManipulability() const { return mMaxManipulability; }
+    unsigned int GetRootBodyId() const { return mRootBodyId; }
+    unsigned int GetBodyId() const { return mBodyId; }
+
+    /** \brief Cells, two bytes each (manipulability, joint margin).
+     *
+     * A manipulability byte of 0 marks an unreachable cell, otherwise the
+     * manipulability is (byte - 1) / 254 * GetMaxManipulability(). The
+     * joint margin is byte / 255.
+     */
+    const uint8_t* GetCells() const { return mCells; }
+
+  private:
+    ReachabilityMap (const ReachabilityMap&);
+    ReachabilityMap& operator= (const ReachabilityMap&);
+
+    unsigned int mDimensions[3];
+    unsigned int mOrientationBins;
+    unsigned int mNumCells;
+    Math::Vector3d mLower;
+    double mVoxelSize;
+    double mOrientationRange;
+    double mMaxManipulability;
+    unsigned int mRootBodyId;
+    unsigned int mBodyId;
+
+    /// Points either into mStorage or into mFile.
+    const uint8_t *mCells;
+    std::vector<uint8_t> mStorage;
+    MappedFile mFile;
+};
+
+}
+
+}
+
+}
+
+/* RBDL_GEOMETRY_REACHABILITY_MAP_H */
+#endif
@@ -0,0 +1,183 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : geometry
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include "TriangleMesh.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Geometry {
+
+using namespace std;
+
+MappedFile::MappedFile() :
+  mData (NULL),
+  mSize (0),
+#ifdef _WIN32
+  mFileHandle (NULL),
+  mMappingHandle (NULL)
+#else
+  mFileDescriptor (-1)
+#endif
+{ }
+
+MappedFile::~MappedFile() {
+  Close();
+}
+
+#ifdef _WIN32
+bool MappedFile::Open (const std::string &filename) {
+  Close();
+
+  HANDLE file = CreateFileA (filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+      NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx (file, &size) || size.QuadPart == 0) {
+    CloseHandle (file);
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMappingA (file, NULL, PAGE_READONLY, 0, 0,
+      NULL);
+  if (mapping == NULL) {
+    CloseHandle (file);
+    return false;
+  }
+
+  void *data = MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0);
+  if (data == NULL) {
+    CloseHandle (mapping);
+    CloseHandle (file);
+    return false;
+  }
+
+  mFileHandle = file;
+  mMappingHandle = mapping;
+  mData = static_cast<const unsigned char*>(data);
+  mSize = static_cast<size_t>(size.QuadPart);
+
+  return true;
+}
+
+void MappedFile::Close() {
+  if (mData) {
+    UnmapViewOfFile (mData);
+  }
+  if (mMappingHandle) {
+    CloseHandle (static_cast<HANDLE>(mMappingHandle));
+  }
+  if (mFileHandle) {
+    CloseHandle (static_cast<HANDLE>(mFileHandle));
+  }
+
+  mData = NULL;
+  mSize = 0;
+  mFileHandle = NULL;
+  mMappingHandle = NULL;
+}
+#else
+bool MappedFile::Open (const std::string &filename) {
+  Close();
+
+  int fd = open (filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat file_stat;
+  if (fstat (fd, &file_stat) != 0 || file_stat.st_size == 0) {
+    close (fd);
+    return false;
+  }
+
+  void *data = mmap (NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) {
+    close (fd);
+    return false;
+  }
+
+  mFileDescriptor = fd;
+  mData = static_cast<const unsigned char*>(data);
+  mSize = static_cast<size_t>(file_stat.st_size);
+
+  return true;
+}
+
+void MappedFile::Close() {
+  if (mData) {
+    munmap (const_cast<unsigned char*>(mData), mSize);
+  }
+  if (mFileDescriptor >= 0) {
+    close (mFileDescriptor);
+  }
+
+  mData = NULL;
+  mSize = 0;
+  mFileDescriptor = -1;
+}
+#endif
+
+TriangleMesh::TriangleMesh() :
+  mNumTriangles (0),
+  mScale (1.)
+{ }
+
+bool TriangleMesh::LoadSTL (const std::string &filename, double scale) {
+  mNumTriangles = 0;
+  mScale = scale;
+  mFilename = filename;
+
+  if (!mFile.Open (filename)) {
+    cerr << "Error: could not map STL file '" << filename << "'." << endl;
+    return false;
+  }
+
+  if (mFile.GetSize() < 84) {
+    cerr << "Error: '" << filename << "' is not a binary STL file." << endl;
+    mFile.Close();
+    return false;
+  }
+
+  uint32_t num_triangles;
+  memcpy (&num_triangles, mFile.GetData() + 80, sizeof (num_triangles));
+
+  if (mFile.GetSize() < 84 + 50 * static_cast<size_t>(num_triangles)) {
+    cerr << "Error: '" << filename << "' is truncated or an ASCII STL file "
+      << "(binary STL files are supported only)." << endl;
+    mFile.Close();
+    return false;
+  }
+
+  mNumTriangles = num_triangles;
+
+  return true;
+}
+
+}
+
+}
+
+}
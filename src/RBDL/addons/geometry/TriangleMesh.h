@@ -0,0 +1,119 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : geometry
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_GEOMETRY_TRIANGLE_MESH_H
+#define RBDL_GEOMETRY_TRIANGLE_MESH_H
+
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+#include <string>
+
+#include <rbdl/rbdl_math.h>
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Geometry {
+
+/** \brief Read-only memory mapping of a file.
+ *
+ * Uses mmap() on POSIX systems and file mapping objects on Windows. The
+ * mapping is released when the object is destroyed.
+ */
+class RBDL_DLLAPI MappedFile {
+  public:
+    MappedFile();
+    ~MappedFile();
+
+    /// \brief Maps the whole file. Returns false if it cannot be mapped.
+    bool Open (const std::string &filename);
+    void Close();
+
+    bool IsOpen() const { return mData != NULL; }
+    const unsigned char* GetData() const { return mData; }
+    size_t GetSize() const { return mSize; }
+
+  private:
+    MappedFile (const MappedFile&);
+    MappedFile& operator= (const MappedFile&);
+
+    const unsigned char *mData;
+    size_t mSize;
+#ifdef _WIN32
+    void *mFileHandle;
+    void *mMappingHandle;
+#else
+    int mFileDescriptor;
+#endif
+};
+
+/** \brief Zero-copy view on the triangles of a binary STL file.
+ *
+ * A binary STL file consists of an 80 byte header, the number of
+ * triangles as 32 bit integer and one 50 byte record per triangle (normal
+ * and three vertices as 32 bit floats followed by a 16 bit attribute).
+ * The vertices are read directly from the mapped file, nothing is copied
+ * when the mesh is loaded. ASCII STL files are not supported.
+ *
+ * The vertices are multiplied by scale when they are accessed so that
+ * meshes exported in millimeters can be used with models in meters.
+ */
+class RBDL_DLLAPI TriangleMesh {
+  public:
+    TriangleMesh();
+
+    /** \brief Maps the given binary STL file.
+     *
+     * Returns false and prints a message if the file cannot be opened or is
+     * not a valid binary STL file.
+     */
+    bool LoadSTL (const std::string &filename, double scale = 1.);
+
+    unsigned int GetNumTriangles() const { return mNumTriangles; }
+    double GetScale() const { return mScale; }
+    const std::string& GetFilename() const { return mFilename; }
+
+    /// \brief Returns vertex (0..2) of triangle index.
+    Math::Vector3d GetVertex (unsigned int index, unsigned int vertex) const {
+      float v[3];
+      std::memcpy (v, GetRecord (index) + 12 + 12 * vertex, sizeof(v));
+      return Math::Vector3d (v[0], v[1], v[2]) * mScale;
+    }
+
+    /// \brief Returns the three vertices of triangle index as floats.
+    void GetTriangle (unsigned int index, float *vertices) const {
+      std::memcpy (vertices, GetRecord (index) + 12, 9 * sizeof(float));
+      for (unsigned int i = 0; i < 9; i++) {
+        vertices[i] = static_cast<float>(vertices[i] * mScale);
+      }
+    }
+
+    /// \brief Raw bytes of the mapped file (used to validate caches).
+    const unsigned char* GetData() const { return mFile.GetData(); }
+    size_t GetDataSize() const { return mFile.GetSize(); }
+
+  private:
+    const unsigned char* GetRecord (unsigned int index) const {
+      return mFile.GetData() + 84 + 50 * static_cast<size_t>(index);
+    }
+
+    MappedFile mFile;
+    std::string mFilename;
+    unsigned int mNumTriangles;
+    double mScale;
+};
+
+}
+
+}
+
+}
+
+/* RBDL_GEOMETRY_TRIANGLE_MESH_H */
+#endif
@@ -12,5 +12,9 @@
 #include "Function.h"
 #include "SegmentedQuinticBezierToolkit.h"
 #include "SmoothSegmentedFunction.h"
+#include "TriangleMesh.h"
+#include "MeshBVH.h"
+#include "MeshCollision.h"
+#include "ReachabilityMap.h"
 
 #endif 
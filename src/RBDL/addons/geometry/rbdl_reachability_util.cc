@@ -0,0 +1,166 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : geometry
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <rbdl/rbdl.h>
+#include <rbdl/ThreadPool.h>
+#include "../urdfreader/urdfreader.h"
+
+#include "ReachabilityMap.h"
+
+using namespace std;
+using namespace RigidBodyDynamics;
+using namespace RigidBodyDynamics::Math;
+using namespace RigidBodyDynamics::Addons::Geometry;
+
+void usage (const char* argv_0) {
+  cerr << "Usage: " << argv_0 << " [options] <robot.urdf> <root_body> <body> <output_file>" << endl;
+  cerr << "Samples the joints between root_body and body and writes a reachability" << endl;
+  cerr << "map of the body point relative to root_body." << endl;
+  cerr << endl;
+  cerr << "  -f | --floatbase                      set the first mobile body as floating base" << endl;
+  cerr << "  -p | --point <x> <y> <z>              point in body coordinates (default: origin)" << endl;
+  cerr << "  -l | --limits <lower> <upper>         limits of all joints of the chain" << endl;
+  cerr << "                                        (default: -1.57 1.57)" << endl;
+  cerr << "  -j | --joint-limits <body> <lower> <upper>" << endl;
+  cerr << "                                        limits of the joint of the given body" << endl;
+  cerr << "  -v | --voxel-size <size>              edge length of the voxels (default: 0.03)" << endl;
+  cerr << "  -b | --orientation-bins <bins>        bins per rotation axis (default: 3)" << endl;
+  cerr << "  -r | --orientation-range <angle>      binned rotation range (default: 0.6)" << endl;
+  cerr << "  -s | --samples <samples>              number of samples (default: 1000000)" << endl;
+  cerr << "  -t | --threads <threads>              number of threads (default: all cores)" << endl;
+  cerr << "  -h | --help                           print this help" << endl;
+  exit (1);
+}
+
+int main (int argc, char *argv[]) {
+  bool floatbase = false;
+  Vector3d body_point = Vector3d::Zero();
+  double default_lower = -1.57;
+  double default_upper = 1.57;
+  vector<string> limit_bodies;
+  vector<double> limit_lower;
+  vector<double> limit_upper;
+  unsigned int num_threads = 0;
+  ReachabilityMapParameters parameters;
+  vector<string> positional;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "-h" || arg == "--help") {
+      usage (argv[0]);
+    } else if (arg == "-f" || arg == "--floatbase") {
+      floatbase = true;
+    } else if ((arg == "-p" || arg == "--point") && i + 3 < argc) {
+      body_point = Vector3d (atof (argv[i + 1]), atof (argv[i + 2]),
+          atof (argv[i + 3]));
+      i += 3;
+    } else if ((arg == "-l" || arg == "--limits") && i + 2 < argc) {
+      default_lower = atof (argv[i + 1]);
+      default_upper = atof (argv[i + 2]);
+      i += 2;
+    } else if ((arg == "-j" || arg == "--joint-limits") && i + 3 < argc) {
+      limit_bodies.push_back (argv[i + 1]);
+      limit_lower.push_back (atof (argv[i + 2]));
+      limit_upper.push_back (atof (argv[i + 3]));
+      i += 3;
+    } else if ((arg == "-v" || arg == "--voxel-size") && i + 1 < argc) {
+      parameters.voxel_size = atof (argv[++i]);
+    } else if ((arg == "-b" || arg == "--orientation-bins") && i + 1 < argc) {
+      parameters.orientation_bins = atoi (argv[++i]);
+    } else if ((arg == "-r" || arg == "--orientation-range") && i + 1 < argc) {
+      parameters.orientation_range = atof (argv[++i]);
+    } else if ((arg == "-s" || arg == "--samples") && i + 1 < argc) {
+      parameters.num_samples = atoi (argv[++i]);
+    } else if ((arg == "-t" || arg == "--threads") && i + 1 < argc) {
+      num_threads = atoi (argv[++i]);
+    } else if (arg[0] == '-') {
+      cerr << "Error: invalid or incomplete option '" << arg << "'!" << endl;
+      usage (argv[0]);
+    } else {
+      positional.push_back (arg);
+    }
+  }
+
+  if (positional.size() != 4) {
+    cerr << "Error: expected four arguments!" << endl;
+    usage (argv[0]);
+  }
+
+  Model model;
+  if (!Addons::URDFReadFromFile (positional[0].c_str(), &model, floatbase)) {
+    cerr << "Loading of urdf model failed!" << endl;
+    return -1;
+  }
+
+  unsigned int root_body_id = model.GetBodyId (positional[1].c_str());
+  unsigned int body_id = model.GetBodyId (positional[2].c_str());
+  if (root_body_id == numeric_limits<unsigned int>::max()
+      || body_id == numeric_limits<unsigned int>::max()) {
+    cerr << "Error: unknown body '"
+      << (body_id == numeric_limits<unsigned int>::max()
+          ? positional[2] : positional[1]) << "'!" << endl;
+    return -1;
+  }
+
+  VectorNd Q = VectorNd::Zero (model.q_size);
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    if (model.mJoints[i].mJointType == JointTypeSpherical) {
+      model.SetQuaternion (i, Quaternion (0., 0., 0., 1.), Q);
+    }
+  }
+
+  VectorNd q_min = VectorNd::Constant (model.q_size, default_lower);
+  VectorNd q_max = VectorNd::Constant (model.q_size, default_upper);
+  for (unsigned int k = 0; k < limit_bodies.size(); k++) {
+    unsigned int id = model.GetBodyId (limit_bodies[k].c_str());
+    if (id == numeric_limits<unsigned int>::max()
+        || id >= model.fixed_body_discriminator
+        || model.mJoints[id].mDoFCount != 1) {
+      cerr << "Error: '" << limit_bodies[k]
+        << "' is not a body with a single degree of freedom!" << endl;
+      return -1;
+    }
+    q_min[model.mJoints[id].q_index] = limit_lower[k];
+    q_max[model.mJoints[id].q_index] = limit_upper[k];
+  }
+
+  ThreadPool pool (num_threads);
+  ReachabilityMap reachability_map;
+  reachability_map.Build (model, root_body_id, body_id, body_point, Q,
+      q_min, q_max, parameters, pool);
+
+  if (reachability_map.GetNumCells() == 0) {
+    cerr << "Error: no sample reached the map!" << endl;
+    return -1;
+  }
+
+  if (!reachability_map.Save (positional[3])) {
+    cerr << "Error: could not write '" << positional[3] << "'!" << endl;
+    return -1;
+  }
+
+  const unsigned int *dimensions = reachability_map.GetDimensions();
+  cout << "Voxels            : " << dimensions[0] << " x " << dimensions[1]
+    << " x " << dimensions[2] << " starting at "
+    << reachability_map.GetLower().transpose() << endl;
+  cout << "Orientation bins  : " << reachability_map.GetOrientationBins()
+    << "^3" << endl;
+  cout << "Reachable cells   : " << reachability_map.GetNumReachableCells()
+    << " of " << reachability_map.GetNumCells() << endl;
+  cout << "Max manipulability: " << reachability_map.GetMaxManipulability()
+    << endl;
+  cout << "Written to        : " << positional[3] << " ("
+    << 2 * reachability_map.GetNumCells() << " bytes of cells)" << endl;
+
+  return 0;
+}
@@ -0,0 +1,322 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : geometry
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <UnitTest++.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "rbdl/rbdl.h"
+
+#include "TriangleMesh.h"
+#include "MeshBVH.h"
+#include "MeshCollision.h"
+
+using namespace std;
+using namespace RigidBodyDynamics;
+using namespace RigidBodyDynamics::Math;
+using namespace RigidBodyDynamics::Addons::Geometry;
+
+static const double TEST_PREC = 1.0e-6;
+
+static void WriteSTL (const char *filename, const vector<float> &vertices) {
+  FILE *file = fopen (filename, "wb");
+  char header[80] = "binary test mesh";
+  fwrite (header, 1, 80, file);
+  uint32_t num_triangles = static_cast<uint32_t>(vertices.size() / 9);
+  fwrite (&num_triangles, sizeof (num_triangles), 1, file);
+  for (unsigned int i = 0; i < num_triangles; i++) {
+    float normal[3] = { 0.f, 0.f, 0.f };
+    uint16_t attribute = 0;
+    fwrite (normal, sizeof (float), 3, file);
+    fwrite (&vertices[9 * i], sizeof (float), 9, file);
+    fwrite (&attribute, sizeof (attribute), 1, file);
+  }
+  fclose (file);
+}
+
+/// Closed box [0, size_x] x [0, size_y] x [0, size_z] with outward normals.
+static vector<float> BoxTriangles (float size_x, float size_y, float size_z) {
+  const float c[8][3] = {
+    { 0.f, 0.f, 0.f }, { size_x, 0.f, 0.f },
+    { size_x, size_y, 0.f }, { 0.f, size_y, 0.f },
+    { 0.f, 0.f, size_z }, { size_x, 0.f, size_z },
+    { size_x, size_y, size_z }, { 0.f, size_y, size_z }
+  };
+  const unsigned int faces[12][3] = {
+    { 0, 2, 1 }, { 0, 3, 2 }, { 4, 5, 6 }, { 4, 6, 7 },
+    { 0, 1, 5 }, { 0, 5, 4 }, { 2, 3, 7 }, { 2, 7, 6 },
+    { 1, 2, 6 }, { 1, 6, 5 }, { 0, 4, 7 }, { 0, 7, 3 }
+  };
+
+  vector<float> vertices;
+  for (unsigned int f = 0; f < 12; f++) {
+    for (unsigned int j = 0; j < 3; j++) {
+      for (unsigned int k = 0; k < 3; k++) {
+        vertices.push_back (c[faces[f][j]][k]);
+      }
+    }
+  }
+  return vertices;
+}
+
+static vector<float> RandomTriangles (unsigned int count) {
+  srand (42);
+  vector<float> vertices;
+  for (unsigned int i = 0; i < count; i++) {
+    float center[3];
+    for (unsigned int k = 0; k < 3; k++) {
+      center[k] = static_cast<float>(rand()) / RAND_MAX;
+    }
+    for (unsigned int j = 0; j < 3; j++) {
+      for (unsigned int k = 0; k < 3; k++) {
+        vertices.push_back (center[k]
+            + 0.05f * (static_cast<float>(rand()) / RAND_MAX - 0.5f));
+      }
+    }
+  }
+  return vertices;
+}
+
+TEST ( TestTriangleMeshLoadSTL ) {
+  vector<float> box = BoxTriangles (1.f, 2.f, 3.f);
+  WriteSTL ("testMeshCollision_box.stl", box);
+
+  TriangleMesh mesh;
+  CHECK (mesh.LoadSTL ("testMeshCollision_box.stl", 0.5));
+  CHECK_EQUAL (12u, mesh.GetNumTriangles());
+
+  for (unsigned int i = 0; i < 12; i++) {
+    for (unsigned int j = 0; j < 3; j++) {
+      Vector3d vertex = mesh.GetVertex (i, j);
+      for (unsigned int k = 0; k < 3; k++) {
+        CHECK_CLOSE (0.5 * box[9 * i + 3 * j + k], vertex[k], TEST_PREC);
+      }
+    }
+  }
+
+  CHECK (!mesh.LoadSTL ("testMeshCollision_missing.stl"));
+  CHECK_EQUAL (0u, mesh.GetNumTriangles());
+
+  remove ("testMeshCollision_box.stl");
+}
+
+TEST ( TestMeshBVHQueriesMatchBruteForce ) {
+  vector<float> soup = RandomTriangles (500);
+  WriteSTL ("testMeshCollision_soup.stl", soup);
+
+  TriangleMesh mesh;
+  CHECK (mesh.LoadSTL ("testMeshCollision_soup.stl"));
+
+  MeshBVH bvh;
+  bvh.Build (mesh, 4);
+  CHECK_EQUAL (500u, bvh.GetNumTriangles());
+
+  for (unsigned int n = 0; n < bvh.GetNumNodes(); n++) {
+    CHECK (bvh.nodes[n].IsLeaf() || bvh.nodes[n].offset > n + 1);
+    CHECK (!bvh.nodes[n].IsLeaf() || bvh.nodes[n].count <= 4);
+  }
+
+  for (unsigned int q = 0; q < 20; q++) {
+    Vector3d point (
+        1.5 * static_cast<double>(rand()) / RAND_MAX - 0.25,
+        1.5 * static_cast<double>(rand()) / RAND_MAX - 0.25,
+        1.5 * static_cast<double>(rand()) / RAND_MAX - 0.25);
+
+    // closest point by brute force over all triangles
+    double brute_force = numeric_limits<double>::infinity();
+    Vector3d triangle_a[3], triangle_b[3];
+    triangle_b[0] = triangle_b[1] = triangle_b[2] = point;
+    for (unsigned int i = 0; i < mesh.GetNumTriangles(); i++) {
+      for (unsigned int j = 0; j < 3; j++) {
+        triangle_a[j] = mesh.GetVertex (i, j);
+      }
+      Vector3d c1, c2;
+      brute_force = min (brute_force,
+          TriangleDistance (triangle_a, triangle_b, &c1, &c2));
+    }
+
+    Vector3d closest;
+    unsigned int triangle;
+    double distance = bvh.Distance (point, &closest, &triangle);
+    CHECK_CLOSE (brute_force, distance, TEST_PREC);
+    CHECK_CLOSE (distance, (closest - point).norm(), TEST_PREC);
+    CHECK (triangle < 500u);
+
+    // a ray through the centroid of the closest triangle hits it or a
+    // triangle in front of it
+    Vector3d centroid = (mesh.GetVertex (triangle, 0)
+        + mesh.GetVertex (triangle, 1) + mesh.GetVertex (triangle, 2)) / 3.;
+    MeshRayHit hit;
+    CHECK (bvh.RayCast (point, centroid - point, 10., &hit));
+    CHECK (hit.distance <= (centroid - point).norm() + TEST_PREC);
+    CHECK (hit.distance >= distance - TEST_PREC);
+  }
+
+  remove ("testMeshCollision_soup.stl");
+}
+
+TEST ( TestMeshBVHBoxQueries ) {
+  WriteSTL ("testMeshCollision_box.stl", BoxTriangles (1.f, 1.f, 1.f));
+  TriangleMesh mesh;
+  CHECK (mesh.LoadSTL ("testMeshCollision_box.stl"));
+
+  MeshBVH bvh;
+  bvh.Build (mesh, 2);
+
+  MeshRayHit hit;
+  CHECK (bvh.RayCast (Vector3d (0.3, 0.4, 5.), Vector3d (0., 0., -2.), 10.,
+        &hit));
+  CHECK_CLOSE (4., hit.distance, TEST_PREC);
+  CHECK_CLOSE (1., hit.point[2], TEST_PREC);
+  CHECK_CLOSE (1., hit.normal[2], TEST_PREC);
+  CHECK (!bvh.RayCast (Vector3d (0.3, 0.4, 5.), Vector3d (0., 0., -1.), 3.,
+        &hit));
+  CHECK (!bvh.RayCast (Vector3d (0.3, 0.4, 5.), Vector3d (0., 0., 1.), 10.,
+        &hit));
+
+  CHECK (bvh.IsInside (Vector3d (0.5, 0.5, 0.5)));
+  CHECK (bvh.IsInside (Vector3d (0.9, 0.1, 0.2)));
+  CHECK (!bvh.IsInside (Vector3d (1.5, 0.5, 0.5)));
+
+  Vector3d closest;
+  CHECK_CLOSE (-0.1, bvh.SignedDistance (Vector3d (0.5, 0.5, 0.9),
+        &closest), TEST_PREC);
+  CHECK_CLOSE (1., closest[2], TEST_PREC);
+  CHECK_CLOSE (sqrt (2.) * 0.5, bvh.SignedDistance (Vector3d (1.5, 0.5,
+          1.5)), TEST_PREC);
+
+  Vector3d vertex;
+  CHECK_CLOSE (-2., bvh.MinimumAlong (Vector3d (-1., -1., 0.), &vertex),
+      TEST_PREC);
+  CHECK_CLOSE (1., vertex[0], TEST_PREC);
+  CHECK_CLOSE (1., vertex[1], TEST_PREC);
+
+  remove ("testMeshCollision_box.stl");
+}
+
+TEST ( TestMeshBVHCache ) {
+  WriteSTL ("testMeshCollision_soup.stl", RandomTriangles (200));
+  TriangleMesh mesh;
+  CHECK (mesh.LoadSTL ("testMeshCollision_soup.stl"));
+
+  remove ("testMeshCollision_soup.bvh");
+
+  MeshBVH built;
+  CHECK (!built.BuildCached (mesh, "testMeshCollision_soup.bvh"));
+
+  MeshBVH cached;
+  CHECK (cached.BuildCached (mesh, "testMeshCollision_soup.bvh"));
+  CHECK_EQUAL (built.GetNumNodes(), cached.GetNumNodes());
+  CHECK_EQUAL (built.GetNumTriangles(), cached.GetNumTriangles());
+  CHECK (built.vertices == cached.vertices);
+  CHECK (built.triangle_index == cached.triangle_index);
+  CHECK_EQUAL (0, memcmp (&built.nodes[0], &cached.nodes[0],
+        built.nodes.size() * sizeof (BVHNode)));
+
+  // a different scale (or mesh) invalidates the cache
+  TriangleMesh scaled_mesh;
+  CHECK (scaled_mesh.LoadSTL ("testMeshCollision_soup.stl", 2.));
+  MeshBVH scaled;
+  CHECK (!scaled.LoadCache ("testMeshCollision_soup.bvh", scaled_mesh));
+
+  remove ("testMeshCollision_soup.bvh");
+  remove ("testMeshCollision_soup.stl");
+}
+
+TEST ( TestMeshDistanceTransformed ) {
+  WriteSTL ("testMeshCollision_box.stl", BoxTriangles (1.f, 1.f, 1.f));
+  TriangleMesh mesh;
+  CHECK (mesh.LoadSTL ("testMeshCollision_box.stl"));
+  MeshBVH bvh;
+  bvh.Build (mesh, 2);
+
+  SpatialTransform X_a;
+  SpatialTransform X_b = Xrotz (-M_PI * 0.25) * Xtrans (Vector3d (2.5, 0., 0.));
+
+  // the closest point of b is its origin corner at x = 2.5
+  Vector3d point_a, point_b;
+  double distance = MeshDistance (bvh, X_a, bvh, X_b, &point_a, &point_b);
+  CHECK_CLOSE (1.5, distance, TEST_PREC);
+  CHECK_CLOSE (1., point_a[0], TEST_PREC);
+  CHECK_CLOSE (2.5, point_b[0], TEST_PREC);
+  CHECK_CLOSE (0., point_b[1], TEST_PREC);
+
+  CHECK_CLOSE (1., MeshDistance (bvh, X_a, bvh, X_b, NULL, NULL, 1.),
+      TEST_PREC);
+
+  X_b = Xrotx (0.3) * Xtrans (Vector3d (0.5, 0.5, 0.5));
+  CHECK_CLOSE (0., MeshDistance (bvh, X_a, bvh, X_b), TEST_PREC);
+
+  remove ("testMeshCollision_box.stl");
+}
+
+TEST ( TestMeshCollisionSetModel ) {
+  WriteSTL ("testMeshCollision_box.stl",
+      BoxTriangles (0.2f, 0.1f, 0.05f));
+
+  Model model;
+  unsigned int leg_id = model.AddBody (0, Xtrans (Vector3d (0., 0., 1.)),
+      Joint (SpatialVector (0., 1., 0., 0., 0., 0.)),
+      Body (1., Vector3d (0., 0., -0.5), Vector3d (0.1, 0.1, 0.1)), "leg");
+  unsigned int foot_id = model.AddBody (leg_id,
+      Xtrans (Vector3d (0., 0., -1.)), Joint (JointTypeFixed),
+      Body (0.5, Vector3d (0., 0., 0.), Vector3d (0.1, 0.1, 0.1)), "foot");
+
+  MeshCollisionSet meshes;
+  CHECK_EQUAL (0, meshes.AddMesh (model, "foot", "testMeshCollision_box.stl",
+        Xtrans (Vector3d (-0.1, -0.05, 0.))));
+  CHECK_EQUAL (-1, meshes.AddMesh (leg_id, "testMeshCollision_missing.stl"));
+  CHECK_EQUAL (1u, meshes.size());
+  meshes.Bind (model);
+  CHECK_EQUAL (foot_id, meshes.body[0]);
+  CHECK_EQUAL (leg_id, meshes.movable_body[0]);
+
+  VectorNd Q = VectorNd::Zero (model.q_size);
+  UpdateKinematicsCustom (model, &Q, NULL, NULL);
+  meshes.UpdateTransforms (model);
+
+  // the sole of the foot is at the origin of the base
+  Vector3d deepest_point;
+  CHECK_CLOSE (0., meshes.PlanePenetration (0, Vector3d (0., 0., 1.), 0.,
+        &deepest_point), TEST_PREC);
+  CHECK_CLOSE (0., deepest_point[2], TEST_PREC);
+
+  MeshSetRayHit hit;
+  CHECK (meshes.RayCast (Vector3d (0.05, 0., -1.), Vector3d (0., 0., 1.), 5.,
+        &hit));
+  CHECK_EQUAL (0u, hit.mesh);
+  CHECK_CLOSE (1., hit.distance, TEST_PREC);
+  CHECK_CLOSE (-1., hit.normal[2], TEST_PREC);
+
+  // rotating the leg swings one edge of the foot into the ground
+  Q[0] = -0.1;
+  UpdateKinematicsCustom (model, &Q, NULL, NULL);
+  meshes.UpdateTransforms (model);
+
+  Vector3d toe = CalcBodyToBaseCoordinates (model, Q, foot_id,
+      Vector3d (0.1, 0., 0.), false);
+  Vector3d heel = CalcBodyToBaseCoordinates (model, Q, foot_id,
+      Vector3d (-0.1, 0., 0.), false);
+  Vector3d lowest = toe[2] < heel[2] ? toe : heel;
+
+  double penetration = meshes.PlanePenetration (0, Vector3d (0., 0., 1.), 0.,
+      &deepest_point);
+  CHECK (penetration > 0.);
+  CHECK_CLOSE (-lowest[2], penetration, TEST_PREC);
+  CHECK_CLOSE (lowest[0], deepest_point[0], TEST_PREC);
+
+  Vector3d center = CalcBodyToBaseCoordinates (model, Q, foot_id,
+      Vector3d (0., 0., 0.025), false);
+  CHECK_CLOSE (-0.025, meshes.SignedDistance (0, center), TEST_PREC);
+  CHECK_CLOSE (1., meshes.SignedDistance (0, lowest - Vector3d (0., 0., 1.)),
+      TEST_PREC);
+
+  remove ("testMeshCollision_box.stl");
+}
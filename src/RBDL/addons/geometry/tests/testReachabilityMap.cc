@@ -0,0 +1,228 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : geometry
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <UnitTest++.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "rbdl/rbdl.h"
+#include "rbdl/ThreadPool.h"
+
+#include "ReachabilityMap.h"
+
+using namespace std;
+using namespace RigidBodyDynamics;
+using namespace RigidBodyDynamics::Math;
+using namespace RigidBodyDynamics::Addons::Geometry;
+
+/// Left leg of the RoK-3 biped on a fixed pelvis, returns the foot id.
+static unsigned int AddRok3Leg (Model &model) {
+  Body link (1., Vector3d (0., 0., -0.1), Vector3d (0.01, 0.01, 0.01));
+
+  unsigned int hip_yaw_id = model.AddBody (0,
+      Xtrans (Vector3d (0., 0.105, -0.1512)), Joint (JointTypeRevoluteZ),
+      link);
+  unsigned int hip_roll_id = model.AddBody (hip_yaw_id, SpatialTransform(),
+      Joint (JointTypeRevoluteX), link);
+  unsigned int hip_pitch_id = model.AddBody (hip_roll_id, SpatialTransform(),
+      Joint (JointTypeRevoluteY), link);
+  unsigned int knee_id = model.AddBody (hip_pitch_id,
+      Xtrans (Vector3d (0., 0., -0.35)), Joint (JointTypeRevoluteY), link);
+  unsigned int ankle_pitch_id = model.AddBody (knee_id,
+      Xtrans (Vector3d (0., -0.001, -0.35)), Joint (JointTypeRevoluteY), link);
+  unsigned int ankle_roll_id = model.AddBody (ankle_pitch_id,
+      SpatialTransform(), Joint (JointTypeRevoluteX), link);
+
+  return model.AddBody (ankle_roll_id, Xtrans (Vector3d (0., 0.001, -0.09)),
+      Joint (JointTypeFixed), link);
+}
+
+/// Pose of the foot relative to the pelvis.
+static void FootPose (Model &model, VectorNd &Q, unsigned int foot_id,
+    Vector3d &position, Matrix3d &orientation) {
+  UpdateKinematicsCustom (model, &Q, NULL, NULL);
+  position = CalcBodyToBaseCoordinates (model, Q, foot_id, Vector3d::Zero(),
+      false);
+  orientation = CalcBodyWorldOrientation (model, Q, foot_id, false);
+}
+
+TEST ( TestReachabilityMapSingleJoint ) {
+  // a point at distance 0.5 on a revolute joint moves on a circle and has
+  // the constant manipulability sqrt(1 + 0.5^2)
+  Model model;
+  unsigned int body_id = model.AddBody (0, SpatialTransform(),
+      Joint (JointTypeRevoluteZ),
+      Body (1., Vector3d (0.5, 0., 0.), Vector3d (0.1, 0.1, 0.1)));
+  Vector3d point (0.5, 0., 0.);
+
+  VectorNd Q = VectorNd::Zero (model.q_size);
+  VectorNd q_min = VectorNd::Constant (model.q_size, -0.9);
+  VectorNd q_max = VectorNd::Constant (model.q_size, 0.9);
+
+  ReachabilityMapParameters parameters;
+  parameters.voxel_size = 0.05;
+  parameters.orientation_bins = 4;
+  parameters.orientation_range = 1.;
+  parameters.num_samples = 20000;
+
+  ThreadPool pool (2);
+  ReachabilityMap reachability_map;
+  reachability_map.Build (model, 0, body_id, point, Q, q_min, q_max,
+      parameters, pool);
+
+  CHECK (reachability_map.GetNumReachableCells() > 0);
+  CHECK_CLOSE (sqrt (1.25), reachability_map.GetMaxManipulability(), 1.0e-6);
+
+  // the grid is cropped to the reached voxels
+  CHECK (reachability_map.GetLower()[0] > 0.2);
+  CHECK_EQUAL (1u, reachability_map.GetDimensions()[2]);
+
+  for (unsigned int i = 0; i <= 8; i++) {
+    double angle = -0.8 + 0.2 * i;
+    Q[0] = angle;
+    UpdateKinematicsCustom (model, &Q, NULL, NULL);
+    Vector3d position = CalcBodyToBaseCoordinates (model, Q, body_id, point,
+        false);
+    Matrix3d orientation = CalcBodyWorldOrientation (model, Q, body_id,
+        false);
+
+    double manipulability, joint_margin;
+    CHECK (reachability_map.Query (position, orientation, &manipulability,
+          &joint_margin));
+    CHECK_CLOSE (sqrt (1.25), manipulability, 1.0e-6);
+    // the margin of the best sample in the cell is close to the margin
+    // of the pose
+    CHECK_CLOSE (1. - fabs (angle) / 0.9, joint_margin, 0.15);
+
+    // the same position with a different orientation or a larger radius
+    // is not reachable
+    CHECK (!reachability_map.IsReachable (position, orientation * rotz (1.)));
+    CHECK (!reachability_map.IsReachable (position * 1.3, orientation));
+  }
+
+  // behind the joint
+  CHECK (!reachability_map.IsReachable (Vector3d (-0.5, 0., 0.),
+        Matrix3d::Identity()));
+}
+
+TEST ( TestReachabilityMapRok3Leg ) {
+  Model model;
+  unsigned int foot_id = AddRok3Leg (model);
+
+  VectorNd Q = VectorNd::Zero (model.q_size);
+  VectorNd q_min = VectorNd::Constant (model.q_size, -0.6);
+  VectorNd q_max = VectorNd::Constant (model.q_size, 0.6);
+  // knee and ankle pitch
+  q_min[3] = 0.;
+  q_max[3] = 2.;
+  q_min[4] = -1.2;
+  q_max[4] = 0.6;
+
+  ReachabilityMapParameters parameters;
+  parameters.voxel_size = 0.08;
+  parameters.orientation_bins = 4;
+  parameters.orientation_range = 2.;
+  parameters.num_samples = 60000;
+
+  ThreadPool pool (1);
+  ReachabilityMap reachability_map;
+  reachability_map.Build (model, 0, foot_id, Vector3d::Zero(), Q, q_min,
+      q_max, parameters, pool);
+
+  CHECK (reachability_map.GetNumReachableCells() > 0);
+  CHECK (reachability_map.GetNumReachableCells()
+      < reachability_map.GetNumCells());
+
+  // random poses of the leg are reachable and have a positive quality
+  std::mt19937 random_engine (42);
+  std::uniform_real_distribution<double> unit (0., 1.);
+  unsigned int num_reachable = 0;
+  for (unsigned int i = 0; i < 100; i++) {
+    VectorNd q (Q);
+    for (unsigned int k = 0; k < model.q_size; k++) {
+      // stay within the orientation range
+      q[k] = q_min[k] + (0.3 + 0.4 * unit (random_engine))
+        * (q_max[k] - q_min[k]);
+    }
+    Vector3d position;
+    Matrix3d orientation;
+    FootPose (model, q, foot_id, position, orientation);
+
+    double manipulability, joint_margin;
+    if (reachability_map.Query (position, orientation, &manipulability,
+          &joint_margin)) {
+      num_reachable++;
+      CHECK (manipulability > 0.);
+      CHECK (joint_margin > 0.);
+    }
+  }
+  CHECK (num_reachable >= 95);
+
+  // far away poses and yaw angles beyond the hip yaw limit are not
+  // reachable
+  Vector3d position;
+  Matrix3d orientation;
+  VectorNd q (Q);
+  q[3] = 1.;
+  q[2] = -0.5;
+  q[4] = -0.5;
+  FootPose (model, q, foot_id, position, orientation);
+  CHECK (reachability_map.IsReachable (position, orientation));
+  CHECK (!reachability_map.IsReachable (position + Vector3d (0., 0., -1.),
+        orientation));
+  CHECK (!reachability_map.IsReachable (position, orientation * rotz (1.5)));
+
+  // the result does not depend on the number of threads
+  ThreadPool pool_3 (3);
+  ReachabilityMap reachability_map_3;
+  reachability_map_3.Build (model, 0, foot_id, Vector3d::Zero(), Q, q_min,
+      q_max, parameters, pool_3);
+
+  CHECK_EQUAL (reachability_map.GetNumCells(),
+      reachability_map_3.GetNumCells());
+  CHECK (memcmp (reachability_map.GetCells(), reachability_map_3.GetCells(),
+        2 * reachability_map.GetNumCells()) == 0);
+
+  // saved and mapped maps answer the same
+  CHECK (reachability_map.Save ("testReachabilityMap.rmap"));
+  ReachabilityMap mapped_map;
+  CHECK (mapped_map.Load ("testReachabilityMap.rmap"));
+
+  CHECK_EQUAL (reachability_map.GetNumCells(), mapped_map.GetNumCells());
+  CHECK_EQUAL (foot_id, mapped_map.GetBodyId());
+  CHECK_CLOSE (reachability_map.GetMaxManipulability(),
+      mapped_map.GetMaxManipulability(), 1.0e-12);
+  CHECK (memcmp (reachability_map.GetCells(), mapped_map.GetCells(),
+        2 * reachability_map.GetNumCells()) == 0);
+
+  double manipulability, mapped_manipulability;
+  CHECK (mapped_map.Query (position, orientation, &mapped_manipulability,
+        NULL));
+  reachability_map.Query (position, orientation, &manipulability, NULL);
+  CHECK_CLOSE (manipulability, mapped_manipulability, 1.0e-12);
+
+  remove ("testReachabilityMap.rmap");
+}
+
+TEST ( TestReachabilityMapLoadInvalid ) {
+  FILE *file = fopen ("testReachabilityMap_invalid.rmap", "wb");
+  char data[128] = "not a reachability map";
+  fwrite (data, 1, sizeof (data), file);
+  fclose (file);
+
+  ReachabilityMap reachability_map;
+  CHECK (!reachability_map.Load ("testReachabilityMap_invalid.rmap"));
+  CHECK (!reachability_map.Load ("testReachabilityMap_missing.rmap"));
+  CHECK_EQUAL (0u, reachability_map.GetNumCells());
+  CHECK (!reachability_map.IsReachable (Vector3d::Zero(),
+        Matrix3d::Identity()));
+
+  remove ("testReachabilityMap_invalid.rmap");
+}
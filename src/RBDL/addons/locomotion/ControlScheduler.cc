@@ -0,0 +1,261 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include "ControlScheduler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Locomotion {
+
+using namespace std;
+
+namespace {
+
+double SecondsSince (const std::chrono::steady_clock::time_point &start) {
+  return std::chrono::duration<double> (
+      std::chrono::steady_clock::now() - start).count();
+}
+
+void AddRunTime (ControlScheduler::TaskStats &stats, double run_time) {
+  stats.num_runs++;
+  stats.last_time = run_time;
+  stats.max_time = max (stats.max_time, run_time);
+  stats.total_time += run_time;
+}
+
+}
+
+ControlScheduler::ControlScheduler() :
+  tick_time (0.001),
+  wait_for_workers (false),
+  tick (0),
+  last_tick_time (0.),
+  max_tick_time (0.),
+  num_tick_overruns (0),
+  mStarted (false) {
+}
+
+ControlScheduler::~ControlScheduler() {
+  Stop();
+}
+
+unsigned int ControlScheduler::AddTask (const std::string &name,
+    const TaskFunction &function,
+    unsigned int period,
+    unsigned int offset,
+    bool worker) {
+  assert (period > 0 && offset < period);
+  assert (!mStarted);
+
+  unique_ptr<Task> task (new Task);
+  task->function = function;
+  task->ready = false;
+  task->released = false;
+  task->busy = false;
+  task->completed = false;
+  task->stop = false;
+  task->stats.name = name;
+  task->stats.period = period;
+  task->stats.offset = offset;
+  task->stats.worker = worker;
+
+  mTasks.push_back (std::move (task));
+  return static_cast<unsigned int>(mTasks.size() - 1);
+}
+
+void ControlScheduler::AddOutput (unsigned int task_id,
+    ChannelBase &channel) {
+  assert (task_id < mTasks.size());
+  assert (!mStarted);
+
+  mTasks[task_id]->outputs.push_back (&channel);
+}
+
+void ControlScheduler::SetReleaseFunction (unsigned int task_id,
+    const TaskFunction &function) {
+  assert (task_id < mTasks.size());
+  assert (mTasks[task_id]->stats.worker);
+  assert (!mStarted);
+
+  mTasks[task_id]->release_function = function;
+}
+
+void ControlScheduler::Start() {
+  if (mStarted) {
+    return;
+  }
+  mStarted = true;
+
+  for (unsigned int i = 0; i < mTasks.size(); i++) {
+    Task &task = *mTasks[i];
+    if (task.stats.worker) {
+      task.stop = false;
+      task.thread = std::thread (&ControlScheduler::WorkerLoop, this,
+          std::ref (task));
+    }
+  }
+}
+
+void ControlScheduler::Stop() {
+  if (!mStarted) {
+    return;
+  }
+
+  for (unsigned int i = 0; i < mTasks.size(); i++) {
+    Task &task = *mTasks[i];
+    if (task.stats.worker) {
+      {
+        std::lock_guard<std::mutex> lock (task.mutex);
+        task.stop = true;
+      }
+      task.condition.notify_all();
+      task.thread.join();
+    }
+  }
+
+  mStarted = false;
+}
+
+void ControlScheduler::Tick() {
+  Start();
+
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+
+  for (unsigned int i = 0; i < mTasks.size(); i++) {
+    if (mTasks[i]->stats.worker && IsDue (*mTasks[i])) {
+      CollectWorker (*mTasks[i]);
+    }
+  }
+
+  for (unsigned int i = 0; i < mTasks.size(); i++) {
+    if (!mTasks[i]->stats.worker && IsDue (*mTasks[i])) {
+      RunInline (*mTasks[i]);
+    }
+  }
+
+  for (unsigned int i = 0; i < mTasks.size(); i++) {
+    if (mTasks[i]->stats.worker && IsDue (*mTasks[i])) {
+      ReleaseWorker (*mTasks[i]);
+    }
+  }
+
+  last_tick_time = SecondsSince (start);
+  max_tick_time = max (max_tick_time, last_tick_time);
+  if (last_tick_time > tick_time) {
+    num_tick_overruns++;
+  }
+  tick++;
+}
+
+ControlScheduler::TaskStats ControlScheduler::GetTaskStats (
+    unsigned int task_id) const {
+  assert (task_id < mTasks.size());
+
+  const Task &task = *mTasks[task_id];
+  std::lock_guard<std::mutex> lock (task.mutex);
+  return task.stats;
+}
+
+bool ControlScheduler::IsDue (const Task &task) const {
+  return tick % task.stats.period == task.stats.offset;
+}
+
+void ControlScheduler::RunInline (Task &task) {
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+
+  task.function();
+
+  double run_time = SecondsSince (start);
+  for (unsigned int i = 0; i < task.outputs.size(); i++) {
+    task.outputs[i]->Publish();
+  }
+
+  // only this thread writes the stats, the lock is for GetTaskStats()
+  std::lock_guard<std::mutex> lock (task.mutex);
+  AddRunTime (task.stats, run_time);
+  if (run_time > task.stats.period * tick_time) {
+    task.stats.num_overruns++;
+  }
+}
+
+void ControlScheduler::CollectWorker (Task &task) {
+  std::unique_lock<std::mutex> lock (task.mutex);
+
+  if (task.busy) {
+    if (!wait_for_workers) {
+      task.stats.num_overruns++;
+      task.ready = false;
+      return;
+    }
+    task.condition.wait (lock, [&task] { return !task.busy; });
+  }
+
+  // the worker does not write while it is idle
+  if (task.completed) {
+    for (unsigned int i = 0; i < task.outputs.size(); i++) {
+      task.outputs[i]->Publish();
+    }
+    task.completed = false;
+  }
+  task.ready = true;
+}
+
+void ControlScheduler::ReleaseWorker (Task &task) {
+  if (!task.ready) {
+    return;
+  }
+  task.ready = false;
+
+  if (task.release_function) {
+    task.release_function();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock (task.mutex);
+    task.released = true;
+    task.busy = true;
+  }
+  task.condition.notify_all();
+}
+
+void ControlScheduler::WorkerLoop (Task &task) {
+  std::unique_lock<std::mutex> lock (task.mutex);
+
+  while (true) {
+    task.condition.wait (lock, [&task] { return task.released || task.stop; });
+    if (!task.released) {
+      break;
+    }
+    task.released = false;
+    lock.unlock();
+
+    std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+    task.function();
+    double run_time = SecondsSince (start);
+
+    lock.lock();
+    AddRunTime (task.stats, run_time);
+    task.busy = false;
+    task.completed = true;
+    task.condition.notify_all();
+  }
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,292 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_LOCOMOTION_CONTROL_SCHEDULER_H
+#define RBDL_LOCOMOTION_CONTROL_SCHEDULER_H
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rbdl/rbdl_config.h>
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Locomotion {
+
+/// \brief Channel whose written values are made visible by Publish().
+class RBDL_DLLAPI ChannelBase {
+  public:
+    virtual ~ChannelBase() {}
+
+    /// \brief Makes the last written value visible to the readers.
+    virtual void Publish() = 0;
+};
+
+/** \brief Channel between tasks with one writer and any number of readers.
+ *
+ * The writer fills the back buffer with Write(). Publish() swaps it with
+ * the front buffer, which the readers copy with Read(). Only the swap and
+ * the copies of Read() hold the lock, so a reader never sees a partially
+ * written value and the writer never waits for a reader to finish its
+ * work. Assigning a value of the same size does not allocate memory for
+ * the Eigen types.
+ *
+ * The ControlScheduler publishes the outputs of a task (see
+ * ControlScheduler::AddOutput()), Publish() must only be called while the
+ * writer does not write.
+ */
+template <typename T>
+class DoubleBufferedChannel : public ChannelBase {
+  public:
+    explicit DoubleBufferedChannel (const T &initial = T()) :
+      mFront (0),
+      mWritten (false),
+      mSequence (0) {
+      mBuffers[0] = initial;
+      mBuffers[1] = initial;
+    }
+
+    /// \brief Writes the value to the back buffer (writer only).
+    void Write (const T &value) {
+      mBuffers[1 - mFront] = value;
+      mWritten = true;
+    }
+
+    void Publish() {
+      if (!mWritten) {
+        return;
+      }
+
+      std::lock_guard<std::mutex> lock (mMutex);
+      mFront = 1 - mFront;
+      mSequence++;
+      mWritten = false;
+    }
+
+    /** \brief Copies the last published value.
+     *
+     * \returns the number of values published so far, so that a reader
+     * can tell whether the value is new (0 for the initial value)
+     */
+    unsigned long Read (T &value) const {
+      std::lock_guard<std::mutex> lock (mMutex);
+      value = mBuffers[mFront];
+      return mSequence;
+    }
+
+    /// \brief Number of values published so far.
+    unsigned long GetSequence() const {
+      std::lock_guard<std::mutex> lock (mMutex);
+      return mSequence;
+    }
+
+  private:
+    DoubleBufferedChannel (const DoubleBufferedChannel&);
+    DoubleBufferedChannel& operator= (const DoubleBufferedChannel&);
+
+    T mBuffers[2];
+    unsigned int mFront;
+    bool mWritten;
+    unsigned long mSequence;
+    mutable std::mutex mMutex;
+};
+
+/** \brief Runs control tasks at integer multiples of a base tick.
+ *
+ * Each task runs every period ticks, starting at tick offset. Inline tasks
+ * run on the thread that calls Tick() in the order in which they were
+ * added. Worker tasks run on a thread of their own, so that a long task
+ * (e.g. an MPC or a planner) does not delay the inline tasks. Every
+ * Tick() has three phases:
+ *
+ * 1. The jobs of the worker tasks that are due are collected and their
+ *    outputs are published.
+ * 2. The inline tasks that are due run, their outputs are published after
+ *    each task.
+ * 3. The worker tasks that are due run their release function (see
+ *    SetReleaseFunction()) and are released.
+ *
+ * A worker job starts at some time after its release, while the inline
+ * tasks of the following ticks may publish new values. A worker task that
+ * copies its inputs in the release function thus sees the values of the
+ * tick of its release. Its results become visible one period later, at
+ * its next release. If a job has not finished by then, the release is
+ * skipped and counted as an overrun, unless wait_for_workers is set: then
+ * Tick() waits for the job, which makes the results independent of the
+ * timing of the threads (e.g. in a simulation that may run slower than
+ * real time). An inline task overruns if it takes longer than its period.
+ *
+ * The tasks exchange data through channels such as
+ * DoubleBufferedChannel. Tasks must not share other data unless they all
+ * run inline.
+ *
+ * \code
+ * ControlScheduler scheduler;
+ * scheduler.tick_time = 0.001;
+ * unsigned int mpc_task = scheduler.AddTask ("mpc", solve_mpc, 10, 0, true);
+ * scheduler.AddOutput (mpc_task, com_plan_channel);
+ * scheduler.AddTask ("servo", servo, 1);
+ *
+ * // every 1 ms
+ * scheduler.Tick();
+ * \endcode
+ */
+class RBDL_DLLAPI ControlScheduler {
+  public:
+    typedef std::function<void ()> TaskFunction;
+
+    /// Timing of a task.
+    struct TaskStats {
+      TaskStats() :
+        period (1),
+        offset (0),
+        worker (false),
+        num_runs (0),
+        num_overruns (0),
+        last_time (0.),
+        max_time (0.),
+        total_time (0.) {
+      }
+
+      /// Mean run time in seconds.
+      double GetMeanTime() const {
+        return num_runs > 0 ? total_time / num_runs : 0.;
+      }
+
+      std::string name;
+      unsigned int period;
+      unsigned int offset;
+      bool worker;
+
+      /// Number of completed runs.
+      unsigned long num_runs;
+      /// Number of runs that took longer than the period (inline) or
+      /// releases skipped because the last job had not finished (worker).
+      unsigned long num_overruns;
+      /// Wall clock time of the last run in seconds.
+      double last_time;
+      /// Largest run time in seconds.
+      double max_time;
+      /// Sum of all run times in seconds.
+      double total_time;
+    };
+
+    ControlScheduler();
+    /// \brief Calls Stop().
+    ~ControlScheduler();
+
+    /** \brief Adds a task and returns its id.
+     *
+     * \param name name of the task (statistics only)
+     * \param function function that runs the task
+     * \param period period in ticks (> 0)
+     * \param offset first tick (< period)
+     * \param worker whether the task runs on a thread of its own
+     */
+    unsigned int AddTask (const std::string &name,
+        const TaskFunction &function,
+        unsigned int period,
+        unsigned int offset = 0,
+        bool worker = false);
+
+    /// \brief Publishes the channel after each run of the task.
+    void AddOutput (unsigned int task_id, ChannelBase &channel);
+
+    /** \brief Sets a function that runs on the thread of Tick() right
+     * before each release of a worker task.
+     *
+     * The job of the task has finished at this point, so the function may
+     * copy the inputs of the next job to data that only the task uses.
+     */
+    void SetReleaseFunction (unsigned int task_id,
+        const TaskFunction &function);
+
+    /// \brief Starts the threads of the worker tasks (called by the first
+    /// Tick() if needed).
+    void Start();
+
+    /// \brief Waits for the running jobs and stops the threads.
+    void Stop();
+
+    /// \brief Runs the tasks that are due at the current tick and advances
+    /// the tick.
+    void Tick();
+
+    unsigned int GetNumTasks() const {
+      return static_cast<unsigned int>(mTasks.size());
+    }
+
+    /// \brief Copy of the timing of a task (may be called while a job runs).
+    TaskStats GetTaskStats (unsigned int task_id) const;
+
+    // Settings
+
+    /// Duration of a tick in seconds (default: 0.001).
+    double tick_time;
+    /// Whether Tick() waits for late worker jobs instead of skipping their
+    /// release (default: false).
+    bool wait_for_workers;
+
+    // Outputs
+
+    /// Number of completed Tick() calls.
+    unsigned long tick;
+    /// Wall clock time of the last Tick() in seconds.
+    double last_tick_time;
+    /// Largest last_tick_time.
+    double max_tick_time;
+    /// Number of Tick() calls that took longer than tick_time.
+    unsigned long num_tick_overruns;
+
+  private:
+    ControlScheduler (const ControlScheduler&);
+    ControlScheduler& operator= (const ControlScheduler&);
+
+    struct Task {
+      TaskFunction function;
+      TaskFunction release_function;
+      std::vector<ChannelBase*> outputs;
+      /// Whether the worker is collected in this tick and can be released.
+      bool ready;
+
+      // Worker state, guarded by mutex
+      std::thread thread;
+      mutable std::mutex mutex;
+      std::condition_variable condition;
+      bool released;
+      bool busy;
+      bool completed;
+      bool stop;
+
+      TaskStats stats;
+    };
+
+    bool IsDue (const Task &task) const;
+    void RunInline (Task &task);
+    void CollectWorker (Task &task);
+    void ReleaseWorker (Task &task);
+    void WorkerLoop (Task &task);
+
+    std::vector<std::unique_ptr<Task> > mTasks;
+    bool mStarted;
+};
+
+}
+
+}
+
+}
+
+/* RBDL_LOCOMOTION_CONTROL_SCHEDULER_H */
+#endif
@@ -0,0 +1,284 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include "FloatingBaseEstimator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <rbdl/rbdl.h>
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Locomotion {
+
+using namespace std;
+using namespace RigidBodyDynamics::Math;
+
+namespace {
+
+// first index of each block of the error state
+const unsigned int Position = 0;
+const unsigned int Velocity = 3;
+const unsigned int Orientation = 6;
+const unsigned int LeftFoot = 9;
+const unsigned int RightFoot = 12;
+const unsigned int AccelerometerBias = 15;
+const unsigned int GyroscopeBias = 18;
+
+/// Rotation matrix of the rotation vector phi.
+Matrix3d RotationExp (const Vector3d &phi) {
+  double angle = phi.norm();
+  if (angle < 1.0e-12) {
+    return Matrix3d::Identity() + VectorCrossMatrix (phi);
+  }
+  return Eigen::AngleAxisd (angle, phi / angle).toRotationMatrix();
+}
+
+}
+
+FloatingBaseEstimator::FloatingBaseEstimator() :
+  gravity (0., 0., -9.81),
+  accelerometer_noise (0.01),
+  gyroscope_noise (0.001),
+  accelerometer_bias_noise (0.001),
+  gyroscope_bias_noise (0.0001),
+  contact_noise (0.001),
+  swing_noise (10.),
+  kinematics_noise (0.002),
+  position (Vector3d::Zero()),
+  velocity (Vector3d::Zero()),
+  orientation (Matrix3d::Identity()),
+  left_foot (Vector3d::Zero()),
+  right_foot (Vector3d::Zero()),
+  accelerometer_bias (Vector3d::Zero()),
+  gyroscope_bias (Vector3d::Zero()),
+  covariance (StateMatrix::Identity()),
+  update_time (0.),
+  max_update_time (0.),
+  total_update_time (0.),
+  num_updates (0),
+  mLeftFootId (0),
+  mRightFootId (0) {
+}
+
+void FloatingBaseEstimator::Init (Model &model,
+    unsigned int left_foot_id,
+    unsigned int right_foot_id,
+    const VectorNd &q,
+    const Vector3d &position,
+    const Matrix3d &orientation) {
+  mLeftFootId = left_foot_id;
+  mRightFootId = right_foot_id;
+
+  this->position = position;
+  this->orientation = orientation;
+  velocity.setZero();
+  accelerometer_bias.setZero();
+  gyroscope_bias.setZero();
+
+  Vector3d left_foot_in_base = CalcBodyToBaseCoordinates (model, q,
+      left_foot_id, Vector3d::Zero(), true);
+  Vector3d right_foot_in_base = CalcBodyToBaseCoordinates (model, q,
+      right_foot_id, Vector3d::Zero(), false);
+  left_foot = position + orientation * left_foot_in_base;
+  right_foot = position + orientation * right_foot_in_base;
+
+  covariance.setZero();
+  covariance.diagonal().segment<3> (Position).setConstant (1.0e-6);
+  covariance.diagonal().segment<3> (Velocity).setConstant (1.0e-2);
+  covariance.diagonal().segment<3> (Orientation).setConstant (1.0e-2);
+  covariance.diagonal().segment<3> (AccelerometerBias).setConstant (1.0e-3);
+  covariance.diagonal().segment<3> (GyroscopeBias).setConstant (1.0e-4);
+
+  // the feet inherit the uncertainty of the base pose,
+  // p_i = r + R s_i gives dp_i = dr - [R s_i]x dphi + R ds_i
+  StateMatrix &P = covariance;
+  const unsigned int foot_index[2] = { LeftFoot, RightFoot };
+  const Vector3d foot_in_base[2] = { left_foot_in_base, right_foot_in_base };
+  for (unsigned int i = 0; i < 2; i++) {
+    Matrix3d foot_cross = VectorCrossMatrix (orientation * foot_in_base[i]);
+    unsigned int f = foot_index[i];
+    P.block<3, 3> (f, Position) = P.block<3, 3> (Position, Position);
+    P.block<3, 3> (f, Orientation) = -foot_cross
+      * P.block<3, 3> (Orientation, Orientation);
+    P.block<3, 3> (Position, f) = P.block<3, 3> (f, Position).transpose();
+    P.block<3, 3> (Orientation, f) = P.block<3, 3> (f, Orientation)
+      .transpose();
+  }
+  for (unsigned int i = 0; i < 2; i++) {
+    for (unsigned int j = 0; j < 2; j++) {
+      Matrix3d foot_cross_i = VectorCrossMatrix (orientation
+          * foot_in_base[i]);
+      Matrix3d foot_cross_j = VectorCrossMatrix (orientation
+          * foot_in_base[j]);
+      P.block<3, 3> (foot_index[i], foot_index[j]) =
+        P.block<3, 3> (Position, Position) + foot_cross_i
+        * P.block<3, 3> (Orientation, Orientation)
+        * foot_cross_j.transpose();
+    }
+    P.block<3, 3> (foot_index[i], foot_index[i]).diagonal().array() +=
+      kinematics_noise * kinematics_noise;
+  }
+
+  update_time = 0.;
+  max_update_time = 0.;
+  total_update_time = 0.;
+  num_updates = 0;
+}
+
+void FloatingBaseEstimator::Update (const Vector3d &gyroscope,
+    const Vector3d &accelerometer,
+    double dt,
+    Model &model,
+    const VectorNd &q,
+    bool left_contact,
+    bool right_contact) {
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+
+  // the kinematics are updated once by the first call
+  Vector3d left_foot_in_base = CalcBodyToBaseCoordinates (model, q,
+      mLeftFootId, Vector3d::Zero(), true);
+  Vector3d right_foot_in_base = CalcBodyToBaseCoordinates (model, q,
+      mRightFootId, Vector3d::Zero(), false);
+
+  Predict (gyroscope, accelerometer, dt, left_contact, right_contact);
+  Correct (left_foot_in_base, right_foot_in_base);
+
+  update_time = std::chrono::duration<double> (
+      std::chrono::steady_clock::now() - start).count();
+  max_update_time = max (max_update_time, update_time);
+  total_update_time += update_time;
+  num_updates++;
+}
+
+void FloatingBaseEstimator::Predict (const Vector3d &gyroscope,
+    const Vector3d &accelerometer,
+    double dt,
+    bool left_contact,
+    bool right_contact) {
+  Vector3d force = orientation * (accelerometer - accelerometer_bias);
+  Vector3d omega = gyroscope - gyroscope_bias;
+  Vector3d acceleration = force + gravity;
+
+  // Error state transition F = I + E, where E only has the blocks
+  //   r:   dt (v) - dt^2/2 [R f]x (phi) - dt^2/2 R (b_f)
+  //   v:   -dt [R f]x (phi) - dt R (b_f)
+  //   phi: -dt R (b_w)
+  // P <- F P F^T is computed on the rows and columns of r, v and phi only.
+  Matrix3d force_cross = VectorCrossMatrix (force);
+  double dt2 = 0.5 * dt * dt;
+  StateMatrix &P = covariance;
+
+  // P <- F P (the rows of r use the old rows of v, v the old rows of phi)
+  P.middleRows<3> (Position) += dt * P.middleRows<3> (Velocity)
+    - dt2 * force_cross * P.middleRows<3> (Orientation)
+    - dt2 * orientation * P.middleRows<3> (AccelerometerBias);
+  P.middleRows<3> (Velocity) -= dt * force_cross * P.middleRows<3> (
+      Orientation)
+    + dt * orientation * P.middleRows<3> (AccelerometerBias);
+  P.middleRows<3> (Orientation) -= dt * orientation * P.middleRows<3> (
+      GyroscopeBias);
+
+  // P <- P F^T
+  P.middleCols<3> (Position) += dt * P.middleCols<3> (Velocity)
+    - dt2 * P.middleCols<3> (Orientation) * force_cross.transpose()
+    - dt2 * P.middleCols<3> (AccelerometerBias) * orientation.transpose();
+  P.middleCols<3> (Velocity) -= dt * P.middleCols<3> (Orientation)
+    * force_cross.transpose()
+    + dt * P.middleCols<3> (AccelerometerBias) * orientation.transpose();
+  P.middleCols<3> (Orientation) -= dt * P.middleCols<3> (GyroscopeBias)
+    * orientation.transpose();
+
+  // discretized process noise, all isotropic so that it is diagonal
+  double left_noise = left_contact ? contact_noise : swing_noise;
+  double right_noise = right_contact ? contact_noise : swing_noise;
+  P.diagonal().segment<3> (Velocity).array() +=
+    dt * accelerometer_noise * accelerometer_noise;
+  P.diagonal().segment<3> (Orientation).array() +=
+    dt * gyroscope_noise * gyroscope_noise;
+  P.diagonal().segment<3> (LeftFoot).array() += dt * left_noise * left_noise;
+  P.diagonal().segment<3> (RightFoot).array() +=
+    dt * right_noise * right_noise;
+  P.diagonal().segment<3> (AccelerometerBias).array() +=
+    dt * accelerometer_bias_noise * accelerometer_bias_noise;
+  P.diagonal().segment<3> (GyroscopeBias).array() +=
+    dt * gyroscope_bias_noise * gyroscope_bias_noise;
+
+  // state
+  position += dt * velocity + dt2 * acceleration;
+  velocity += dt * acceleration;
+  orientation = orientation * RotationExp (dt * omega);
+}
+
+void FloatingBaseEstimator::Correct (const Vector3d &left_foot_in_base,
+    const Vector3d &right_foot_in_base) {
+  typedef Eigen::Matrix<double, StateSize, MeasurementSize> GainMatrix;
+  typedef Eigen::Matrix<double, MeasurementSize, MeasurementSize>
+    InnovationMatrix;
+  typedef Eigen::Matrix<double, MeasurementSize, 1> MeasurementVector;
+
+  StateMatrix &P = covariance;
+
+  // Measurement s_i = R^T (p_i - r) with the non-zero Jacobian blocks
+  //   r: -R^T, phi: R^T [p_i - r]x, p_i: R^T
+  const unsigned int foot_index[2] = { LeftFoot, RightFoot };
+  const Vector3d foot[2] = { left_foot, right_foot };
+  const Vector3d measured[2] = { left_foot_in_base, right_foot_in_base };
+
+  Matrix3d distance_cross[2];
+  MeasurementVector innovation;
+  GainMatrix PHt;
+  for (unsigned int i = 0; i < 2; i++) {
+    Vector3d distance = foot[i] - position;
+    distance_cross[i] = VectorCrossMatrix (distance);
+    innovation.segment<3> (3 * i) = measured[i]
+      - orientation.transpose() * distance;
+    PHt.middleCols<3> (3 * i) = (P.middleCols<3> (foot_index[i])
+        - P.middleCols<3> (Position)
+        - P.middleCols<3> (Orientation) * distance_cross[i]) * orientation;
+  }
+
+  InnovationMatrix S;
+  for (unsigned int i = 0; i < 2; i++) {
+    S.middleRows<3> (3 * i) = orientation.transpose() * (
+        PHt.middleRows<3> (foot_index[i])
+        - PHt.middleRows<3> (Position)
+        + distance_cross[i] * PHt.middleRows<3> (Orientation));
+  }
+  S.diagonal().array() += kinematics_noise * kinematics_noise;
+
+  // K = P H^T S^-1
+  GainMatrix K = S.llt().solve (PHt.transpose()).transpose();
+  StateVector correction = K * innovation;
+
+  P.noalias() -= K * PHt.transpose();
+  P = 0.5 * (P + P.transpose()).eval();
+
+  position += correction.segment<3> (Position);
+  velocity += correction.segment<3> (Velocity);
+  orientation = RotationExp (correction.segment<3> (Orientation))
+    * orientation;
+  left_foot += correction.segment<3> (LeftFoot);
+  right_foot += correction.segment<3> (RightFoot);
+  accelerometer_bias += correction.segment<3> (AccelerometerBias);
+  gyroscope_bias += correction.segment<3> (GyroscopeBias);
+
+  // keep the rotation orthonormal
+  orientation = Eigen::Quaterniond (orientation).normalized()
+    .toRotationMatrix();
+}
+
+}
+
+}
+
+}
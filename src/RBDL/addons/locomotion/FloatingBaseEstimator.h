@@ -0,0 +1,184 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_LOCOMOTION_FLOATING_BASE_ESTIMATOR_H
+#define RBDL_LOCOMOTION_FLOATING_BASE_ESTIMATOR_H
+
+#include <rbdl/rbdl_math.h>
+
+namespace RigidBodyDynamics {
+
+struct Model;
+
+namespace Addons {
+
+namespace Locomotion {
+
+/** \brief Extended Kalman filter for the pose and velocity of a floating
+ * base from an IMU and the kinematics of two legs.
+ *
+ * The filter state contains the base position \f$r\f$, velocity \f$v\f$
+ * and orientation \f$R\f$ (base to world), the world positions of both
+ * feet \f$p_l, p_r\f$ and the biases of the accelerometer and the
+ * gyroscope. The IMU is assumed to be mounted at the origin of the base
+ * frame and drives the prediction:
+ *
+ * \f[ \dot{r} = v, \quad \dot{v} = R (f - b_f) + g, \quad
+ *     \dot{R} = R \, [\omega - b_\omega]_\times \f]
+ *
+ * The correction uses the foot positions in the base frame that the leg
+ * kinematics give, \f$s_i = R^T (p_i - r)\f$. A foot that is on the ground
+ * is expected to stay where it is, the process noise of a foot in the air
+ * is large so that its position simply follows the kinematics. The
+ * orientation error is kept in the world frame, \f$R = \exp
+ * ([\delta\phi]_\times) \hat{R}\f$.
+ *
+ * All matrices have a fixed size. The prediction only touches the
+ * covariance blocks of the position, velocity and orientation rows and
+ * columns and the correction only the blocks of the measurement Jacobian,
+ * so every Update() performs the same small number of operations and
+ * does not allocate memory.
+ *
+ * \code
+ * FloatingBaseEstimator estimator;
+ * estimator.Init (leg_model, left_foot_id, right_foot_id, q,
+ *     base_position, base_orientation);
+ *
+ * // every control cycle
+ * estimator.Update (gyroscope, accelerometer, 0.001, leg_model, q,
+ *     left_contact, right_contact);
+ * // estimator.position, estimator.velocity, estimator.orientation
+ * \endcode
+ */
+class RBDL_DLLAPI FloatingBaseEstimator {
+  public:
+    enum {
+      StateSize = 21,
+      MeasurementSize = 6
+    };
+
+    typedef Eigen::Matrix<double, StateSize, StateSize> StateMatrix;
+    typedef Eigen::Matrix<double, StateSize, 1> StateVector;
+
+    FloatingBaseEstimator();
+
+    /** \brief Resets the estimate to the given base pose at rest.
+     *
+     * The feet are placed with the kinematics of q. The model has to be
+     * fixed at the base, i.e. its base coordinates are the coordinates of
+     * the base frame of the robot.
+     *
+     * \param model leg model with the base as root
+     * \param left_foot_id body of the left foot contact point
+     * \param right_foot_id body of the right foot contact point
+     * \param q joint positions of model
+     * \param position base position in world coordinates
+     * \param orientation base orientation (base to world)
+     */
+    void Init (Model &model,
+        unsigned int left_foot_id,
+        unsigned int right_foot_id,
+        const Math::VectorNd &q,
+        const Math::Vector3d &position,
+        const Math::Matrix3d &orientation);
+
+    /** \brief Predicts with the IMU and corrects with the leg kinematics.
+     *
+     * Computes the forward kinematics of model for q (updating the
+     * kinematic state of model) and measures the timing statistics.
+     *
+     * \param gyroscope angular velocity in base coordinates
+     * \param accelerometer specific force (acceleration minus gravity) in
+     * base coordinates
+     * \param dt time since the last update
+     * \param model leg model that was passed to Init()
+     * \param q joint positions of model
+     * \param left_contact whether the left foot is on the ground
+     * \param right_contact whether the right foot is on the ground
+     */
+    void Update (const Math::Vector3d &gyroscope,
+        const Math::Vector3d &accelerometer,
+        double dt,
+        Model &model,
+        const Math::VectorNd &q,
+        bool left_contact,
+        bool right_contact);
+
+    /// \brief Prediction step of Update() with the IMU readings.
+    void Predict (const Math::Vector3d &gyroscope,
+        const Math::Vector3d &accelerometer,
+        double dt,
+        bool left_contact,
+        bool right_contact);
+
+    /** \brief Correction step of Update() with foot positions in base
+     * coordinates.
+     */
+    void Correct (const Math::Vector3d &left_foot_in_base,
+        const Math::Vector3d &right_foot_in_base);
+
+    // Settings, standard deviations of the continuous noise
+
+    /// Gravitational acceleration (default: (0, 0, -9.81)).
+    Math::Vector3d gravity;
+    /// Accelerometer noise in m/s^2/sqrt(Hz) (default: 0.01).
+    double accelerometer_noise;
+    /// Gyroscope noise in rad/s/sqrt(Hz) (default: 0.001).
+    double gyroscope_noise;
+    /// Accelerometer bias random walk in m/s^3/sqrt(Hz) (default: 0.001).
+    double accelerometer_bias_noise;
+    /// Gyroscope bias random walk in rad/s^2/sqrt(Hz) (default: 0.0001).
+    double gyroscope_bias_noise;
+    /// Slip of a foot on the ground in m/sqrt(s) (default: 0.001).
+    double contact_noise;
+    /// Motion of a foot in the air in m/sqrt(s) (default: 10.0).
+    double swing_noise;
+    /// Error of the leg kinematics in m (default: 0.002).
+    double kinematics_noise;
+
+    // Estimate
+
+    Math::Vector3d position;
+    Math::Vector3d velocity;
+    /// Base to world rotation.
+    Math::Matrix3d orientation;
+    Math::Vector3d left_foot;
+    Math::Vector3d right_foot;
+    Math::Vector3d accelerometer_bias;
+    Math::Vector3d gyroscope_bias;
+    /// Covariance of the error state (r, v, phi, p_l, p_r, b_f, b_w).
+    StateMatrix covariance;
+
+    // Timing statistics of Update()
+
+    /// Wall clock time of the last Update() in seconds.
+    double update_time;
+    /// Largest update_time since Init().
+    double max_update_time;
+    /// Sum of all update times since Init().
+    double total_update_time;
+    /// Number of calls of Update() since Init().
+    unsigned long num_updates;
+
+    /// \brief Average update time in seconds.
+    double GetMeanUpdateTime() const {
+      return num_updates > 0 ? total_update_time / num_updates : 0.;
+    }
+
+  private:
+    unsigned int mLeftFootId;
+    unsigned int mRightFootId;
+};
+
+}
+
+}
+
+}
+
+/* RBDL_LOCOMOTION_FLOATING_BASE_ESTIMATOR_H */
+#endif
@@ -0,0 +1,211 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include "ForceTorqueProcessing.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Locomotion {
+
+using namespace std;
+using namespace RigidBodyDynamics::Math;
+
+namespace {
+
+/// Center of pressure on the sole from a wrench in the sensor frame.
+Vector3d CenterOfPressure (const Vector3d &force, const Vector3d &moment,
+    double sensor_height) {
+  return Vector3d (
+      (-moment[1] - force[0] * sensor_height) / force[2],
+      (moment[0] - force[1] * sensor_height) / force[2],
+      -sensor_height);
+}
+
+/// Contact with hysteresis on the normal force.
+bool UpdateContact (bool contact, double normal_force, double on_force,
+    double off_force) {
+  if (contact) {
+    return normal_force >= off_force;
+  }
+  return normal_force > on_force;
+}
+
+}
+
+BiquadFilterBank::BiquadFilterBank() :
+  mNumChannels (0) {
+}
+
+void BiquadFilterBank::Init (unsigned int num_channels,
+    double sample_time,
+    double cutoff_frequency,
+    unsigned int order) {
+  assert (order > 0 && order % 2 == 0);
+  assert (cutoff_frequency > 0. && cutoff_frequency * sample_time < 0.5);
+
+  mNumChannels = num_channels;
+
+  // bilinear transform with the cutoff prewarped, section k has the
+  // quality 1 / (2 sin ((2k + 1) pi / (2 n)))
+  unsigned int num_sections = order / 2;
+  double K = tan (M_PI * cutoff_frequency * sample_time);
+  mSections.resize (num_sections);
+  for (unsigned int k = 0; k < num_sections; k++) {
+    double damping = 2. * sin ((2. * k + 1.) * M_PI / (2. * order));
+    double norm = 1. / (1. + damping * K + K * K);
+
+    Section &section = mSections[k];
+    section.b0 = K * K * norm;
+    section.b1 = 2. * section.b0;
+    section.b2 = section.b0;
+    section.a1 = 2. * (K * K - 1.) * norm;
+    section.a2 = (1. - damping * K + K * K) * norm;
+  }
+
+  mState1.assign (num_sections, Eigen::ArrayXd::Zero (num_channels));
+  mState2.assign (num_sections, Eigen::ArrayXd::Zero (num_channels));
+  mSectionInput = Eigen::ArrayXd::Zero (num_channels);
+}
+
+void BiquadFilterBank::Reset (const VectorNd &value) {
+  assert (value.size() == mNumChannels);
+
+  // every section has unit gain at DC
+  for (unsigned int k = 0; k < mSections.size(); k++) {
+    const Section &section = mSections[k];
+    mState2[k] = (section.b2 - section.a2) * value.array();
+    mState1[k] = (section.b1 - section.a1) * value.array() + mState2[k];
+  }
+}
+
+void BiquadFilterBank::Filter (const VectorNd &input, VectorNd &output) {
+  assert (input.size() == mNumChannels);
+  assert (output.size() == mNumChannels);
+
+  mSectionInput = input.array();
+  for (unsigned int k = 0; k < mSections.size(); k++) {
+    const Section &section = mSections[k];
+    if (k > 0) {
+      mSectionInput = output.array();
+    }
+
+    // y = b0 x + z1, z1 = b1 x - a1 y + z2, z2 = b2 x - a2 y
+    output.array() = section.b0 * mSectionInput + mState1[k];
+    mState1[k] = section.b1 * mSectionInput - section.a1 * output.array()
+      + mState2[k];
+    mState2[k] = section.b2 * mSectionInput - section.a2 * output.array();
+  }
+}
+
+FootWrenchProcessor::FootWrenchProcessor() :
+  sensor_height (0.),
+  contact_on_force (50.),
+  contact_off_force (20.),
+  left_force (Vector3d::Zero()),
+  left_moment (Vector3d::Zero()),
+  right_force (Vector3d::Zero()),
+  right_moment (Vector3d::Zero()),
+  left_cop (Vector3d::Zero()),
+  right_cop (Vector3d::Zero()),
+  left_contact (false),
+  right_contact (false),
+  zmp (Vector3d::Zero()),
+  update_time (0.),
+  max_update_time (0.) {
+}
+
+void FootWrenchProcessor::Init (double sample_time,
+    double cutoff_frequency,
+    unsigned int filter_order) {
+  assert (contact_off_force <= contact_on_force);
+
+  mFilter.Init (12, sample_time, cutoff_frequency, filter_order);
+  mChannels = VectorNd::Zero (12);
+
+  left_force.setZero();
+  left_moment.setZero();
+  right_force.setZero();
+  right_moment.setZero();
+  left_cop = Vector3d (0., 0., -sensor_height);
+  right_cop = Vector3d (0., 0., -sensor_height);
+  left_contact = false;
+  right_contact = false;
+  zmp.setZero();
+  update_time = 0.;
+  max_update_time = 0.;
+}
+
+void FootWrenchProcessor::Update (const Vector3d &left_force,
+    const Vector3d &left_moment,
+    const Vector3d &right_force,
+    const Vector3d &right_moment) {
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+
+  mChannels.segment<3> (0) = left_force;
+  mChannels.segment<3> (3) = left_moment;
+  mChannels.segment<3> (6) = right_force;
+  mChannels.segment<3> (9) = right_moment;
+  mFilter.Filter (mChannels, mChannels);
+
+  this->left_force = mChannels.segment<3> (0);
+  this->left_moment = mChannels.segment<3> (3);
+  this->right_force = mChannels.segment<3> (6);
+  this->right_moment = mChannels.segment<3> (9);
+
+  left_contact = UpdateContact (left_contact, this->left_force[2],
+      contact_on_force, contact_off_force);
+  right_contact = UpdateContact (right_contact, this->right_force[2],
+      contact_on_force, contact_off_force);
+
+  if (left_contact) {
+    left_cop = CenterOfPressure (this->left_force, this->left_moment,
+        sensor_height);
+  } else {
+    left_cop = Vector3d (0., 0., -sensor_height);
+  }
+  if (right_contact) {
+    right_cop = CenterOfPressure (this->right_force, this->right_moment,
+        sensor_height);
+  } else {
+    right_cop = Vector3d (0., 0., -sensor_height);
+  }
+
+  update_time = std::chrono::duration<double> (
+      std::chrono::steady_clock::now() - start).count();
+  max_update_time = max (max_update_time, update_time);
+}
+
+bool FootWrenchProcessor::ComputeZMP (const Vector3d &left_position,
+    const Matrix3d &left_orientation,
+    const Vector3d &right_position,
+    const Matrix3d &right_orientation) {
+  double left_weight = left_contact ? left_force[2] : 0.;
+  double right_weight = right_contact ? right_force[2] : 0.;
+  if (left_weight + right_weight <= 0.) {
+    return false;
+  }
+
+  zmp = (left_weight * (left_position + left_orientation * left_cop)
+      + right_weight * (right_position + right_orientation * right_cop))
+    / (left_weight + right_weight);
+
+  return true;
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,186 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_LOCOMOTION_FORCE_TORQUE_PROCESSING_H
+#define RBDL_LOCOMOTION_FORCE_TORQUE_PROCESSING_H
+
+#include <vector>
+
+#include <rbdl/rbdl_math.h>
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Locomotion {
+
+/** \brief Butterworth low-pass filter that is applied to many channels at
+ * once.
+ *
+ * The filter is a cascade of second order sections (biquads) in
+ * transposed direct form II that are designed with the bilinear transform.
+ * All channels share the coefficients, so each section is evaluated with
+ * a few coefficient-wise array operations over all channels that Eigen
+ * vectorizes. The state is allocated by Init(), Filter() does not allocate
+ * memory.
+ */
+class RBDL_DLLAPI BiquadFilterBank {
+  public:
+    /// Coefficients of a section, y = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1
+    /// z^-1 + a2 z^-2) x.
+    struct Section {
+      double b0, b1, b2;
+      double a1, a2;
+    };
+
+    BiquadFilterBank();
+
+    /** \brief Designs the filter and resets all channels to zero.
+     *
+     * \param num_channels number of filtered channels
+     * \param sample_time sample time in seconds
+     * \param cutoff_frequency -3 dB frequency in Hz (below the Nyquist
+     * frequency)
+     * \param order filter order, a positive even number
+     */
+    void Init (unsigned int num_channels,
+        double sample_time,
+        double cutoff_frequency,
+        unsigned int order = 2);
+
+    /// \brief Sets the state as if value had been the input forever.
+    void Reset (const Math::VectorNd &value);
+
+    /** \brief Filters one sample of all channels.
+     *
+     * output may be the same vector as input.
+     */
+    void Filter (const Math::VectorNd &input, Math::VectorNd &output);
+
+    unsigned int GetNumChannels() const { return mNumChannels; }
+    const std::vector<Section> &GetSections() const { return mSections; }
+
+  private:
+    unsigned int mNumChannels;
+    std::vector<Section> mSections;
+    /// States z1 and z2 of every section over all channels.
+    std::vector<Eigen::ArrayXd> mState1;
+    std::vector<Eigen::ArrayXd> mState2;
+    Eigen::ArrayXd mSectionInput;
+};
+
+/** \brief Processes the wrenches of the force/torque sensors of both feet.
+ *
+ * Each Update() filters the 12 channels (force and moment of both feet) in
+ * one BiquadFilterBank, computes the center of pressure of each foot and
+ * detects the contacts with a hysteresis on the normal force: a foot is in
+ * contact once its normal force exceeds contact_on_force and loses contact
+ * when it drops below contact_off_force.
+ *
+ * The wrenches are the ones that the ground applies to the foot, expressed
+ * in the sensor frame. The sole is parallel to the xy plane of the sensor
+ * frame at sensor_height below the sensor origin, so the center of
+ * pressure of a foot is
+ *
+ * \f[ p_x = \frac{-\tau_y - f_x d}{f_z}, \quad
+ *     p_y = \frac{\tau_x - f_y d}{f_z}, \quad p_z = -d. \f]
+ *
+ * ComputeZMP() combines the centers of pressure of the feet in contact to
+ * the ZMP in the frame of the given sensor poses.
+ *
+ * \code
+ * FootWrenchProcessor processor;
+ * processor.sensor_height = 0.006;
+ * processor.Init (0.001, 30.);
+ *
+ * // every control cycle
+ * processor.Update (left_force, left_moment, right_force, right_moment);
+ * processor.ComputeZMP (left_position, left_orientation,
+ *     right_position, right_orientation);
+ * // processor.left_contact, processor.left_cop, processor.zmp
+ * \endcode
+ */
+class RBDL_DLLAPI FootWrenchProcessor {
+  public:
+    FootWrenchProcessor();
+
+    /** \brief Designs the filter and resets the outputs.
+     *
+     * \param sample_time sample time of Update() in seconds
+     * \param cutoff_frequency -3 dB frequency of the filter in Hz
+     * \param filter_order order of the Butterworth filter (even)
+     */
+    void Init (double sample_time,
+        double cutoff_frequency,
+        unsigned int filter_order = 2);
+
+    /// \brief Filters the wrenches, updates the centers of pressure and the
+    /// contacts.
+    void Update (const Math::Vector3d &left_force,
+        const Math::Vector3d &left_moment,
+        const Math::Vector3d &right_force,
+        const Math::Vector3d &right_moment);
+
+    /** \brief Computes the ZMP from the feet in contact.
+     *
+     * \param left_position origin of the left sensor frame
+     * \param left_orientation left sensor to the frame of the positions
+     * \param right_position origin of the right sensor frame
+     * \param right_orientation right sensor to the frame of the positions
+     *
+     * \returns false if no foot is in contact (zmp is not changed)
+     */
+    bool ComputeZMP (const Math::Vector3d &left_position,
+        const Math::Matrix3d &left_orientation,
+        const Math::Vector3d &right_position,
+        const Math::Matrix3d &right_orientation);
+
+    // Settings
+
+    /// Distance of the sole below the sensor origin (default: 0.0).
+    double sensor_height;
+    /// Normal force above which a foot gets into contact (default: 50.0).
+    double contact_on_force;
+    /// Normal force below which a foot loses contact (default: 20.0).
+    double contact_off_force;
+
+    // Outputs of the last Update()
+
+    /// Filtered wrenches in the sensor frames.
+    Math::Vector3d left_force;
+    Math::Vector3d left_moment;
+    Math::Vector3d right_force;
+    Math::Vector3d right_moment;
+    /// Centers of pressure in the sensor frames (the sole center if the
+    /// foot is not in contact).
+    Math::Vector3d left_cop;
+    Math::Vector3d right_cop;
+    bool left_contact;
+    bool right_contact;
+
+    /// ZMP of the last successful ComputeZMP().
+    Math::Vector3d zmp;
+
+    /// Wall clock time of the last Update() in seconds.
+    double update_time;
+    /// Largest update_time since Init().
+    double max_update_time;
+
+  private:
+    BiquadFilterBank mFilter;
+    /// Force and moment of the left and the right foot.
+    Math::VectorNd mChannels;
+};
+
+}
+
+}
+
+}
+
+/* RBDL_LOCOMOTION_FORCE_TORQUE_PROCESSING_H */
+#endif
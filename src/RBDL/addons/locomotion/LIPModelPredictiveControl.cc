@@ -0,0 +1,356 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include "LIPModelPredictiveControl.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include "ZMPPreviewControl.h"
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Locomotion {
+
+using namespace std;
+using namespace RigidBodyDynamics::Math;
+
+namespace {
+
+/// Moves the start point into the bounds and activates the bounds that
+/// were active in the previous solution or that the point was moved to.
+void PrepareStart (const VectorNd &lower, const VectorNd &upper,
+    VectorNd &zmp, std::vector<signed char> &active) {
+  for (unsigned int i = 0; i < zmp.size(); i++) {
+    if (active[i] < 0 || zmp[i] <= lower[i]) {
+      zmp[i] = lower[i];
+      active[i] = -1;
+    } else if (active[i] > 0 || zmp[i] >= upper[i]) {
+      zmp[i] = upper[i];
+      active[i] = 1;
+    }
+  }
+}
+
+}
+
+LIPModelPredictiveControl::LIPModelPredictiveControl() :
+  zmp_weight (1.),
+  jerk_weight (1.0e-6),
+  max_iterations (50),
+  warm_start (true),
+  state_x (Vector3d::Zero()),
+  state_y (Vector3d::Zero()),
+  jerk_x (0.),
+  jerk_y (0.),
+  iterations (0),
+  solve_time (0.),
+  max_solve_time (0.),
+  mHorizon (0),
+  mSampleTime (0.),
+  mCoMHeight (0.),
+  mGravity (0.),
+  mFirstJerkScale (0.) {
+}
+
+void LIPModelPredictiveControl::Init (unsigned int horizon,
+    double sample_time,
+    double com_height,
+    double gravity) {
+  assert (horizon > 0);
+  assert (sample_time > 0.);
+  assert (jerk_weight > 0.);
+
+  unsigned int N = horizon;
+  double T = sample_time;
+
+  mHorizon = horizon;
+  mSampleTime = sample_time;
+  mCoMHeight = com_height;
+  mGravity = gravity;
+
+  Matrix3d A (
+      1., T, 0.5 * T * T,
+      0., 1., T,
+      0., 0., 1.);
+  Vector3d B (T * T * T / 6., 0.5 * T * T, T);
+  Vector3d C (1., 0., -com_height / gravity);
+
+  // Row i predicts sample i + 1: p_{i+1} = C A^{i+1} x + sum_j C A^{i-j} B u_j
+  mPs.resize (N, 3);
+  VectorNd CAB (N);
+  Vector3d CA = A.transpose() * C;
+  for (unsigned int i = 0; i < N; i++) {
+    mPs.row (i) = CA.transpose();
+    CAB[i] = CA.dot (B);
+    CA = A.transpose() * CA;
+  }
+  // CA^k B with k = i - j, the first entry is C B
+  for (unsigned int i = N - 1; i > 0; i--) {
+    CAB[i] = CAB[i - 1];
+  }
+  CAB[0] = C.dot (B);
+
+  MatrixNd Pu = MatrixNd::Zero (N, N);
+  for (unsigned int i = 0; i < N; i++) {
+    for (unsigned int j = 0; j <= i; j++) {
+      Pu(i, j) = CAB[i - j];
+    }
+  }
+
+  MatrixNd Pu_inverse = Pu.triangularView<Eigen::Lower>().solve (
+      MatrixNd::Identity (N, N));
+  MatrixNd M = Pu_inverse.transpose() * Pu_inverse;
+
+  mG = zmp_weight * MatrixNd::Identity (N, N) + jerk_weight * M;
+  mGs = jerk_weight * M * mPs;
+  mFirstJerkScale = 1. / Pu(0, 0);
+
+  state_x.setZero();
+  state_y.setZero();
+
+  double infinity = std::numeric_limits<double>::infinity();
+  zmp_reference_x = VectorNd::Zero (N);
+  zmp_reference_y = VectorNd::Zero (N);
+  zmp_lower_x = VectorNd::Constant (N, -infinity);
+  zmp_lower_y = VectorNd::Constant (N, -infinity);
+  zmp_upper_x = VectorNd::Constant (N, infinity);
+  zmp_upper_y = VectorNd::Constant (N, infinity);
+
+  zmp_x = VectorNd::Zero (N);
+  zmp_y = VectorNd::Zero (N);
+  jerk_x = 0.;
+  jerk_y = 0.;
+  iterations = 0;
+  solve_time = 0.;
+  max_solve_time = 0.;
+
+  mActiveX.assign (N, 0);
+  mActiveY.assign (N, 0);
+
+  mLinear = VectorNd::Zero (N);
+  mGradient = VectorNd::Zero (N);
+  mStep = VectorNd::Zero (N);
+  mFactor = MatrixNd::Zero (N, N);
+  mFree.assign (N, 0);
+}
+
+void LIPModelPredictiveControl::SetReferences (
+    const WalkingPlan &plan,
+    long first_sample,
+    long sample_step,
+    double foot_half_length,
+    double foot_half_width) {
+  Vector3d reference, left_foot, right_foot;
+  bool left_contact, right_contact;
+
+  for (unsigned int i = 0; i < mHorizon; i++) {
+    long sample = first_sample + i * sample_step;
+    plan.Evaluate (sample, reference, &left_foot, &right_foot);
+    plan.EvaluateSupport (sample, left_contact, right_contact);
+
+    zmp_reference_x[i] = reference[0];
+    zmp_reference_y[i] = reference[1];
+
+    const Vector3d &first = left_contact ? left_foot : right_foot;
+    const Vector3d &second = right_contact ? right_foot : left_foot;
+    zmp_lower_x[i] = min (first[0], second[0]) - foot_half_length;
+    zmp_upper_x[i] = max (first[0], second[0]) + foot_half_length;
+    zmp_lower_y[i] = min (first[1], second[1]) - foot_half_width;
+    zmp_upper_y[i] = max (first[1], second[1]) + foot_half_width;
+  }
+}
+
+void LIPModelPredictiveControl::SetReferences (
+    const WalkingPatternGenerator &walking,
+    long first_sample,
+    long sample_step,
+    double foot_half_length,
+    double foot_half_width) {
+  SetReferences (walking.GetPlan(), first_sample, sample_step,
+      foot_half_length, foot_half_width);
+}
+
+bool LIPModelPredictiveControl::Solve() {
+  assert (mHorizon > 0);
+
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+
+  if (!warm_start) {
+    zmp_x = zmp_reference_x;
+    zmp_y = zmp_reference_y;
+    std::fill (mActiveX.begin(), mActiveX.end(), 0);
+    std::fill (mActiveY.begin(), mActiveY.end(), 0);
+  }
+
+  iterations = 0;
+  bool success = SolveAxis (state_x, zmp_reference_x, zmp_lower_x,
+      zmp_upper_x, zmp_x, mActiveX);
+  success = SolveAxis (state_y, zmp_reference_y, zmp_lower_y, zmp_upper_y,
+      zmp_y, mActiveY) && success;
+
+  // u_0 = (p_1 - (P_s x)_0) / P_u(0, 0)
+  jerk_x = mFirstJerkScale * (zmp_x[0] - mPs(0, 0) * state_x[0]
+      - mPs(0, 1) * state_x[1] - mPs(0, 2) * state_x[2]);
+  jerk_y = mFirstJerkScale * (zmp_y[0] - mPs(0, 0) * state_y[0]
+      - mPs(0, 1) * state_y[1] - mPs(0, 2) * state_y[2]);
+
+  solve_time = std::chrono::duration<double> (
+      std::chrono::steady_clock::now() - start).count();
+  max_solve_time = max (max_solve_time, solve_time);
+
+  return success;
+}
+
+void LIPModelPredictiveControl::Integrate (double dt) {
+  double dt2 = dt * dt;
+  double dt3 = dt2 * dt;
+
+  state_x = Vector3d (
+      state_x[0] + dt * state_x[1] + 0.5 * dt2 * state_x[2]
+        + dt3 / 6. * jerk_x,
+      state_x[1] + dt * state_x[2] + 0.5 * dt2 * jerk_x,
+      state_x[2] + dt * jerk_x);
+  state_y = Vector3d (
+      state_y[0] + dt * state_y[1] + 0.5 * dt2 * state_y[2]
+        + dt3 / 6. * jerk_y,
+      state_y[1] + dt * state_y[2] + 0.5 * dt2 * jerk_y,
+      state_y[2] + dt * jerk_y);
+}
+
+bool LIPModelPredictiveControl::SolveAxis (const Vector3d &state,
+    const VectorNd &reference,
+    const VectorNd &lower,
+    const VectorNd &upper,
+    VectorNd &zmp,
+    std::vector<signed char> &active) {
+  unsigned int N = mHorizon;
+
+  PrepareStart (lower, upper, zmp, active);
+
+  // gradient G p + h with h = -Q_e p^ref - R P_u^{-T} P_u^{-1} P_s x
+  mLinear = -zmp_weight * reference;
+  mLinear.noalias() -= mGs * state;
+
+  for (unsigned int iteration = 1; iteration <= max_iterations;
+      iteration++) {
+    iterations++;
+
+    mGradient.noalias() = mG * zmp;
+    mGradient += mLinear;
+
+    unsigned int num_free = 0;
+    for (unsigned int i = 0; i < N; i++) {
+      if (active[i] == 0) {
+        mFree[num_free++] = i;
+      }
+    }
+
+    if (num_free > 0) {
+      // Newton step on the free samples: G_FF d_F = -g_F, Cholesky
+      // factorization of G_FF in the lower triangle of mFactor
+      for (unsigned int a = 0; a < num_free; a++) {
+        for (unsigned int b = 0; b <= a; b++) {
+          double value = mG(mFree[a], mFree[b]);
+          for (unsigned int k = 0; k < b; k++) {
+            value -= mFactor(a, k) * mFactor(b, k);
+          }
+          if (a == b) {
+            mFactor(a, a) = sqrt (value);
+          } else {
+            mFactor(a, b) = value / mFactor(b, b);
+          }
+        }
+      }
+
+      for (unsigned int a = 0; a < num_free; a++) {
+        double value = -mGradient[mFree[a]];
+        for (unsigned int k = 0; k < a; k++) {
+          value -= mFactor(a, k) * mStep[k];
+        }
+        mStep[a] = value / mFactor(a, a);
+      }
+      for (unsigned int a = num_free; a-- > 0;) {
+        double value = mStep[a];
+        for (unsigned int k = a + 1; k < num_free; k++) {
+          value -= mFactor(k, a) * mStep[k];
+        }
+        mStep[a] = value / mFactor(a, a);
+      }
+
+      // largest feasible step and the bound that blocks it
+      double alpha = 1.;
+      int blocking = -1;
+      signed char blocking_side = 0;
+      for (unsigned int a = 0; a < num_free; a++) {
+        unsigned int i = mFree[a];
+        if (zmp[i] + mStep[a] > upper[i]) {
+          double alpha_i = (upper[i] - zmp[i]) / mStep[a];
+          if (alpha_i < alpha) {
+            alpha = alpha_i;
+            blocking = i;
+            blocking_side = 1;
+          }
+        } else if (zmp[i] + mStep[a] < lower[i]) {
+          double alpha_i = (lower[i] - zmp[i]) / mStep[a];
+          if (alpha_i < alpha) {
+            alpha = alpha_i;
+            blocking = i;
+            blocking_side = -1;
+          }
+        }
+      }
+
+      for (unsigned int a = 0; a < num_free; a++) {
+        zmp[mFree[a]] += alpha * mStep[a];
+      }
+
+      if (blocking >= 0) {
+        active[blocking] = blocking_side;
+        zmp[blocking] = blocking_side > 0 ? upper[blocking] : lower[blocking];
+        continue;
+      }
+
+      mGradient.noalias() = mG * zmp;
+      mGradient += mLinear;
+    }
+
+    // the free samples are optimal, release the active bound with the
+    // most negative multiplier
+    int release = -1;
+    double min_multiplier = -1.0e-10;
+    for (unsigned int i = 0; i < N; i++) {
+      if (active[i] == 0) {
+        continue;
+      }
+      double multiplier = active[i] < 0 ? mGradient[i] : -mGradient[i];
+      if (multiplier < min_multiplier) {
+        min_multiplier = multiplier;
+        release = i;
+      }
+    }
+
+    if (release < 0) {
+      return true;
+    }
+    active[release] = 0;
+  }
+
+  return false;
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,204 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_LOCOMOTION_LIP_MODEL_PREDICTIVE_CONTROL_H
+#define RBDL_LOCOMOTION_LIP_MODEL_PREDICTIVE_CONTROL_H
+
+#include <vector>
+
+#include <rbdl/rbdl_math.h>
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Locomotion {
+
+class WalkingPatternGenerator;
+struct WalkingPlan;
+
+/** \brief Model predictive control of the center of mass with the linear
+ * inverted pendulum (cart-table) model.
+ *
+ * Both horizontal axes use the jerk driven cart-table model of
+ * ZMPPreviewGains. Over a horizon of N samples of length T the predicted
+ * ZMPs are affine in the jerks, \f$P = P_s x + P_u U\f$ with a lower
+ * triangular \f$P_u\f$. The condensed QP
+ *
+ * \f[ \min_U \frac{1}{2} Q_e \|P - P^{ref}\|^2 + \frac{1}{2} R \|U\|^2
+ *     \quad \textrm{s.t.} \quad P^{min} \leq P \leq P^{max} \f]
+ *
+ * is solved in the predicted ZMPs instead of the jerks. This turns the
+ * support polygon constraints into bounds and the Hessian
+ *
+ * \f[ G = Q_e I + R P_u^{-T} P_u^{-1} \f]
+ *
+ * into a constant that is computed once by Init(). Each Solve() only forms
+ * the gradient from the current state and references and runs a primal
+ * active set method for bound constrained QPs. It is warm started with
+ * the previous solution and its active bounds, which usually leaves one
+ * or two linear solves on the free samples per cycle. All buffers are
+ * allocated by Init(), Solve() does not allocate memory.
+ *
+ * A typical use runs Solve() at a lower rate (e.g. 100 Hz) than the joint
+ * control and applies the first jerk with Integrate() at the joint rate:
+ *
+ * \code
+ * LIPModelPredictiveControl mpc;
+ * mpc.Init (16, 0.1, 0.8);
+ *
+ * // every 10 ms
+ * mpc.SetReferences (walking, walking.sample + 100, 100, 0.09, 0.045);
+ * mpc.Solve();
+ *
+ * // every 1 ms
+ * mpc.Integrate (0.001);
+ * // mpc.state_x[0], mpc.state_y[0]
+ * \endcode
+ */
+class RBDL_DLLAPI LIPModelPredictiveControl {
+  public:
+    LIPModelPredictiveControl();
+
+    /** \brief Builds the prediction matrices and the Hessian.
+     *
+     * \param horizon number of predicted samples N
+     * \param sample_time length of a predicted sample T
+     * \param com_height height of the center of mass above the ground
+     * \param gravity gravitational acceleration
+     *
+     * Uses the current zmp_weight and jerk_weight. Resets the state, the
+     * references (zero without bounds) and the warm start.
+     */
+    void Init (unsigned int horizon,
+        double sample_time,
+        double com_height,
+        double gravity = 9.81);
+
+    /** \brief Sets references and bounds from a walking plan.
+     *
+     * Predicted sample i is evaluated at plan sample first_sample + i *
+     * sample_step. The ZMP reference is the one of the plan, the bounds
+     * are the bounding box of the rectangles of the feet that are on the
+     * ground.
+     *
+     * \param plan the walking plan, e.g. WalkingPatternGenerator::GetPlan()
+     * \param first_sample plan sample of the first predicted sample
+     * \param sample_step plan samples per predicted sample
+     * \param foot_half_length half length of the support rectangle (x)
+     * \param foot_half_width half width of the support rectangle (y)
+     */
+    void SetReferences (const WalkingPlan &plan,
+        long first_sample,
+        long sample_step,
+        double foot_half_length,
+        double foot_half_width);
+
+    /// \brief Sets references and bounds from the plan of a generator.
+    void SetReferences (const WalkingPatternGenerator &walking,
+        long first_sample,
+        long sample_step,
+        double foot_half_length,
+        double foot_half_width);
+
+    /** \brief Solves the QP of both axes for the current state.
+     *
+     * \returns false if an axis did not converge within max_iterations
+     * (the last iterate, which satisfies the bounds, is kept)
+     */
+    bool Solve();
+
+    /// \brief Advances the state by dt with the first jerk of the solution.
+    void Integrate (double dt);
+
+    /// \brief Horizon N.
+    unsigned int GetHorizon() const { return mHorizon; }
+
+    // Settings
+
+    /// Weight \f$Q_e\f$ of the ZMP tracking error (default: 1.0).
+    double zmp_weight;
+    /// Weight \f$R\f$ of the jerk (default: 1.0e-6).
+    double jerk_weight;
+    /// Maximum number of active set iterations per axis (default: 50).
+    unsigned int max_iterations;
+    /// Start from the previous solution and its active bounds (default:
+    /// true).
+    bool warm_start;
+
+    // State
+
+    /// Cart-table states (position, velocity, acceleration) of x and y.
+    Math::Vector3d state_x;
+    Math::Vector3d state_y;
+
+    // References of the N predicted samples
+
+    Math::VectorNd zmp_reference_x;
+    Math::VectorNd zmp_reference_y;
+    Math::VectorNd zmp_lower_x;
+    Math::VectorNd zmp_lower_y;
+    Math::VectorNd zmp_upper_x;
+    Math::VectorNd zmp_upper_y;
+
+    // Results of the last Solve()
+
+    /// Predicted ZMPs.
+    Math::VectorNd zmp_x;
+    Math::VectorNd zmp_y;
+    /// First jerk of the solution, applied by Integrate().
+    double jerk_x;
+    double jerk_y;
+    /// Active set iterations of both axes.
+    unsigned int iterations;
+    /// Wall clock time of the last Solve() in seconds.
+    double solve_time;
+    /// Largest solve_time since Init().
+    double max_solve_time;
+
+  private:
+    bool SolveAxis (const Math::Vector3d &state,
+        const Math::VectorNd &reference,
+        const Math::VectorNd &lower,
+        const Math::VectorNd &upper,
+        Math::VectorNd &zmp,
+        std::vector<signed char> &active);
+
+    unsigned int mHorizon;
+    double mSampleTime;
+    double mCoMHeight;
+    double mGravity;
+
+    /// Predicted ZMPs of the state (N x 3).
+    Math::MatrixNd mPs;
+    /// Hessian in the predicted ZMPs (N x N).
+    Math::MatrixNd mG;
+    /// State part of the gradient R P_u^{-T} P_u^{-1} P_s (N x 3).
+    Math::MatrixNd mGs;
+    /// First jerk per first predicted ZMP, 1 / P_u(0, 0).
+    double mFirstJerkScale;
+
+    /// Active bounds per sample (0: free, -1: lower, 1: upper).
+    std::vector<signed char> mActiveX;
+    std::vector<signed char> mActiveY;
+
+    // Workspace
+    Math::VectorNd mLinear;
+    Math::VectorNd mGradient;
+    Math::VectorNd mStep;
+    Math::MatrixNd mFactor;
+    std::vector<unsigned int> mFree;
+};
+
+}
+
+}
+
+}
+
+/* RBDL_LOCOMOTION_LIP_MODEL_PREDICTIVE_CONTROL_H */
+#endif
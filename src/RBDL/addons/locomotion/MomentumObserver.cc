@@ -0,0 +1,110 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include "MomentumObserver.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+#include <rbdl/rbdl.h>
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Locomotion {
+
+using namespace std;
+using namespace RigidBodyDynamics::Math;
+
+MomentumObserver::MomentumObserver() :
+  gain (50.),
+  threshold (10.),
+  collision (false),
+  update_time (0.),
+  max_update_time (0.) {
+}
+
+void MomentumObserver::Init (Model &model,
+    const VectorNd &q,
+    const VectorNd &qdot) {
+  assert (gain > 0.);
+
+  residual = VectorNd::Zero (model.qdot_size);
+  momentum = VectorNd::Zero (model.qdot_size);
+  mInitialMomentum = VectorNd::Zero (model.qdot_size);
+  mIntegral = VectorNd::Zero (model.qdot_size);
+  mEffects = VectorNd::Zero (model.qdot_size);
+  mJacobian = MatrixNd::Zero (3, model.qdot_size);
+  exceeded.assign (model.qdot_size, false);
+  collision = false;
+
+  GeneralizedMomentumEffects (model, q, qdot, mEffects, &mInitialMomentum);
+  momentum = mInitialMomentum;
+
+  update_time = 0.;
+  max_update_time = 0.;
+}
+
+void MomentumObserver::Update (Model &model,
+    const VectorNd &q,
+    const VectorNd &qdot,
+    const VectorNd &tau,
+    double dt) {
+  assert (residual.size() == model.qdot_size);
+  assert (gain * dt < 1.);
+
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+
+  // explicit Euler with the effects and the residual of the last step,
+  // the momentum of the current state
+  mIntegral += dt * (tau - mEffects + residual);
+  GeneralizedMomentumEffects (model, q, qdot, mEffects, &momentum);
+  residual = gain * (momentum - mInitialMomentum - mIntegral);
+
+  collision = false;
+  for (unsigned int i = 0; i < model.qdot_size; i++) {
+    exceeded[i] = fabs (residual[i]) > threshold;
+    collision = collision || exceeded[i];
+  }
+
+  update_time = std::chrono::duration<double> (
+      std::chrono::steady_clock::now() - start).count();
+  max_update_time = max (max_update_time, update_time);
+}
+
+void MomentumObserver::EstimateContactForce (Model &model,
+    const VectorNd &q,
+    unsigned int body_id,
+    const Vector3d &body_point,
+    Vector3d &force,
+    bool update_kinematics,
+    unsigned int base_dofs) {
+  assert (base_dofs + 3 <= model.qdot_size);
+
+  mJacobian.setZero();
+  CalcPointJacobian (model, q, body_id, body_point, mJacobian,
+      update_kinematics);
+
+  // normal equations J J^T f = J r of the 3 x 3 system
+  unsigned int num_dofs = model.qdot_size - base_dofs;
+  Matrix3d JJt;
+  JJt.noalias() = mJacobian.rightCols (num_dofs)
+    * mJacobian.rightCols (num_dofs).transpose();
+  Vector3d Jr;
+  Jr.noalias() = mJacobian.rightCols (num_dofs) * residual.tail (num_dofs);
+  force = JJt.ldlt().solve (Jr);
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,140 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_LOCOMOTION_MOMENTUM_OBSERVER_H
+#define RBDL_LOCOMOTION_MOMENTUM_OBSERVER_H
+
+#include <vector>
+
+#include <rbdl/rbdl_math.h>
+
+namespace RigidBodyDynamics {
+
+struct Model;
+
+namespace Addons {
+
+namespace Locomotion {
+
+/** \brief Estimates the external joint forces from the commanded joint
+ * forces and the joint states.
+ *
+ * The observer compares the generalized momentum \f$ p = M(q) \dot{q} \f$
+ * with the momentum that the commanded forces explain:
+ *
+ * \f[ r = K \left( p - p_0 - \int_0^t (\tau + C^T \dot{q} - g + r) \, dt
+ * \right) \f]
+ *
+ * The residual r is a first order low-pass (time constant 1 / gain) of the
+ * external joint forces \f$ J^T f \f$. No joint accelerations and no
+ * inverse of the inertia matrix are needed: each Update() calls
+ * GeneralizedMomentumEffects() which computes p and \f$ g - C^T \dot{q}
+ * \f$ in O(n). All buffers are allocated by Init(), Update() and
+ * EstimateContactForce() do not allocate memory.
+ *
+ * A joint collides if the magnitude of its residual exceeds threshold.
+ * EstimateContactForce() converts the residual to the force at a contact
+ * point, e.g. to detect the foot contacts without force sensors.
+ *
+ * \code
+ * MomentumObserver observer;
+ * observer.gain = 50.;
+ * observer.Init (model, q, qdot);
+ *
+ * // every control cycle with the torques commanded in the last cycle
+ * observer.Update (model, q, qdot, tau, 0.001);
+ * // observer.residual, observer.collision
+ * \endcode
+ */
+class RBDL_DLLAPI MomentumObserver {
+  public:
+    MomentumObserver();
+
+    /// \brief Allocates the buffers and starts the observer at the state
+    /// q, qdot with a zero residual.
+    void Init (Model &model,
+        const Math::VectorNd &q,
+        const Math::VectorNd &qdot);
+
+    /** \brief Updates the residual.
+     *
+     * \param model the model passed to Init()
+     * \param q joint positions
+     * \param qdot joint velocities
+     * \param tau joint forces that act since the last Update()
+     * \param dt time since the last Update() in seconds
+     */
+    void Update (Model &model,
+        const Math::VectorNd &q,
+        const Math::VectorNd &qdot,
+        const Math::VectorNd &tau,
+        double dt);
+
+    /** \brief Computes the force at a point of a body that explains the
+     * residual best (least squares on \f$ J^T f = r \f$).
+     *
+     * \param model the model passed to Init()
+     * \param q joint positions of the last Update()
+     * \param body_id body of the contact point
+     * \param body_point contact point in body coordinates
+     * \param force force in base coordinates (output)
+     * \param update_kinematics whether the kinematics of q must be updated
+     * \param base_dofs number of leading joint forces that are ignored,
+     * e.g. 6 for a floating base that is loaded by the contacts of both
+     * feet while the joints of each leg are only loaded by its own foot
+     */
+    void EstimateContactForce (Model &model,
+        const Math::VectorNd &q,
+        unsigned int body_id,
+        const Math::Vector3d &body_point,
+        Math::Vector3d &force,
+        bool update_kinematics = true,
+        unsigned int base_dofs = 0);
+
+    // Settings
+
+    /// Gain of the observer in 1/s, the bandwidth of the residual
+    /// (default: 50.0). gain * dt must stay below 1.
+    double gain;
+    /// Residual magnitude above which a joint collides (default: 10.0).
+    double threshold;
+
+    // Outputs of the last Update()
+
+    /// Estimated external joint forces.
+    Math::VectorNd residual;
+    /// Generalized momentum M(q) qdot.
+    Math::VectorNd momentum;
+    /// Whether the residual of each joint exceeds threshold.
+    std::vector<bool> exceeded;
+    /// Whether any joint exceeds threshold.
+    bool collision;
+
+    /// Wall clock time of the last Update() in seconds.
+    double update_time;
+    /// Largest update_time since Init().
+    double max_update_time;
+
+  private:
+    /// Momentum at Init().
+    Math::VectorNd mInitialMomentum;
+    /// Integral of tau + C^T qdot - g + r.
+    Math::VectorNd mIntegral;
+    /// g - C^T qdot.
+    Math::VectorNd mEffects;
+    /// Point Jacobian of EstimateContactForce().
+    Math::MatrixNd mJacobian;
+};
+
+}
+
+}
+
+}
+
+/* RBDL_LOCOMOTION_MOMENTUM_OBSERVER_H */
+#endif
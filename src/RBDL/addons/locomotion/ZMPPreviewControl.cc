@@ -0,0 +1,452 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include "ZMPPreviewControl.h"
+
+#include <stdint.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Locomotion {
+
+using namespace std;
+using namespace RigidBodyDynamics::Math;
+
+namespace {
+
+const char ZMP_PREVIEW_GAINS_MAGIC[8] =
+  { 'R', 'B', 'D', 'L', 'Z', 'M', 'P', '1' };
+
+struct ZMPPreviewGainsHeader {
+  char magic[8];
+  double sample_time;
+  double com_height;
+  double gravity;
+  double preview_time;
+  double zmp_weight;
+  double jerk_weight;
+  double state_gain[3];
+  uint32_t num_preview_steps;
+  uint32_t reserved;
+};
+
+void SetCartTableModel (ZMPPreviewGains &gains) {
+  double T = gains.sample_time;
+
+  gains.A = Matrix3d (
+      1., T, 0.5 * T * T,
+      0., 1., T,
+      0., 0., 1.);
+  gains.B = Vector3d (T * T * T / 6., 0.5 * T * T, T);
+  gains.C = Vector3d (1., 0., -gains.com_height / gains.gravity);
+}
+
+long SamplesOf (double time, double sample_time) {
+  return static_cast<long> (floor (time / sample_time + 0.5));
+}
+
+}
+
+ZMPPreviewGains::ZMPPreviewGains() :
+  sample_time (0.001),
+  com_height (0.8),
+  gravity (9.81),
+  preview_time (1.6),
+  zmp_weight (1.),
+  jerk_weight (1.0e-6),
+  state_gain (Vector3d::Zero()) {
+  SetCartTableModel (*this);
+}
+
+bool ZMPPreviewGains::Compute() {
+  assert (sample_time > 0.);
+  assert (com_height > 0.);
+  assert (jerk_weight > 0.);
+
+  SetCartTableModel (*this);
+
+  // Fixed point iteration of the Riccati difference equation. Its cost is
+  // negligible for the 3x3 system, even at small sample times where the
+  // closed loop poles are close to the unit circle.
+  Matrix3d Q = zmp_weight * C * C.transpose();
+  Matrix3d P = Q;
+  bool converged = false;
+
+  for (unsigned int i = 0; i < 1000000; i++) {
+    Vector3d PB = P * B;
+    double s = jerk_weight + B.dot (PB);
+    Vector3d APB = A.transpose() * PB;
+    Matrix3d P_next = A.transpose() * P * A - APB * APB.transpose() / s + Q;
+
+    double change = (P_next - P).norm();
+    P = P_next;
+    if (change <= 1.0e-12 * P.norm()) {
+      converged = true;
+      break;
+    }
+  }
+
+  if (!converged) {
+    cerr << "Error: ZMP preview Riccati iteration did not converge." << endl;
+    return false;
+  }
+
+  double s = jerk_weight + B.dot (P * B);
+  state_gain = A.transpose() * P * B / s;
+
+  Matrix3d A_closed = A - B * state_gain.transpose();
+  unsigned int num_preview_steps = static_cast<unsigned int> (
+      SamplesOf (preview_time, sample_time));
+  preview_gains.resize (num_preview_steps);
+
+  Vector3d X = zmp_weight * C;
+  for (unsigned int j = 0; j < num_preview_steps; j++) {
+    preview_gains[j] = B.dot (X) / s;
+    X = A_closed.transpose() * X;
+  }
+
+  // The reference is assumed to stay at its last value beyond the window,
+  // so the remaining gains are added to the last one. This makes the
+  // preview gains sum up to the position gain and any constant reference
+  // an equilibrium independent of the window length.
+  if (num_preview_steps > 0) {
+    preview_gains[num_preview_steps - 1] += B.dot (
+        (Matrix3d::Identity() - A_closed.transpose()).inverse() * X) / s;
+  }
+
+  return true;
+}
+
+bool ZMPPreviewGains::Save (const std::string &filename) const {
+  FILE *file = fopen (filename.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+
+  ZMPPreviewGainsHeader header;
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, ZMP_PREVIEW_GAINS_MAGIC,
+      sizeof (ZMP_PREVIEW_GAINS_MAGIC));
+  header.sample_time = sample_time;
+  header.com_height = com_height;
+  header.gravity = gravity;
+  header.preview_time = preview_time;
+  header.zmp_weight = zmp_weight;
+  header.jerk_weight = jerk_weight;
+  for (unsigned int i = 0; i < 3; i++) {
+    header.state_gain[i] = state_gain[i];
+  }
+  header.num_preview_steps = GetNumPreviewSteps();
+
+  bool success = fwrite (&header, sizeof (header), 1, file) == 1;
+  if (success && header.num_preview_steps > 0) {
+    success = fwrite (preview_gains.data(), sizeof (double),
+        header.num_preview_steps, file) == header.num_preview_steps;
+  }
+
+  return fclose (file) == 0 && success;
+}
+
+bool ZMPPreviewGains::Load (const std::string &filename) {
+  FILE *file = fopen (filename.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+
+  ZMPPreviewGainsHeader header;
+  bool success = fread (&header, sizeof (header), 1, file) == 1
+    && memcmp (header.magic, ZMP_PREVIEW_GAINS_MAGIC,
+        sizeof (ZMP_PREVIEW_GAINS_MAGIC)) == 0;
+
+  VectorNd gains;
+  if (success) {
+    gains.resize (header.num_preview_steps);
+    success = header.num_preview_steps == 0
+      || fread (gains.data(), sizeof (double), header.num_preview_steps,
+          file) == header.num_preview_steps;
+  }
+  fclose (file);
+
+  if (!success) {
+    return false;
+  }
+
+  sample_time = header.sample_time;
+  com_height = header.com_height;
+  gravity = header.gravity;
+  preview_time = header.preview_time;
+  zmp_weight = header.zmp_weight;
+  jerk_weight = header.jerk_weight;
+  state_gain = Vector3d (header.state_gain[0], header.state_gain[1],
+      header.state_gain[2]);
+  preview_gains = gains;
+  SetCartTableModel (*this);
+
+  return true;
+}
+
+bool ZMPPreviewGains::LoadOrCompute (const std::string &cache_filename) {
+  ZMPPreviewGains cached;
+  if (cached.Load (cache_filename)
+      && cached.sample_time == sample_time
+      && cached.com_height == com_height
+      && cached.gravity == gravity
+      && cached.preview_time == preview_time
+      && cached.zmp_weight == zmp_weight
+      && cached.jerk_weight == jerk_weight) {
+    *this = cached;
+    return true;
+  }
+
+  if (!Compute()) {
+    return false;
+  }
+
+  if (!Save (cache_filename)) {
+    cerr << "Warning: could not write ZMP preview gains to '"
+      << cache_filename << "'." << endl;
+  }
+
+  return true;
+}
+
+void WalkingPlan::Evaluate (long at_sample,
+    Vector3d &zmp_at_sample,
+    Vector3d *left_foot_at_sample,
+    Vector3d *right_foot_at_sample) const {
+  long num_steps = footsteps.size();
+  long t = at_sample - start_sample;
+
+  if (num_steps == 0 || t < 0) {
+    zmp_at_sample = zmp_targets[0];
+    if (left_foot_at_sample) {
+      *left_foot_at_sample = left_at_step[0];
+    }
+    if (right_foot_at_sample) {
+      *right_foot_at_sample = right_at_step[0];
+    }
+    return;
+  }
+
+  long step = std::min (t / step_samples, num_steps);
+  long t_step = t - step * step_samples;
+
+  // double support: the ZMP moves to the next support foot (or to the
+  // middle of both feet after the last step)
+  const Vector3d &zmp_start = zmp_targets[step];
+  const Vector3d &zmp_end = zmp_targets[step + 1];
+  if (t_step < double_support_samples) {
+    double s = static_cast<double> (t_step) / double_support_samples;
+    zmp_at_sample = zmp_start + s * (zmp_end - zmp_start);
+  } else {
+    zmp_at_sample = zmp_end;
+  }
+
+  if (!left_foot_at_sample && !right_foot_at_sample) {
+    return;
+  }
+
+  Vector3d left = left_at_step[step];
+  Vector3d right = right_at_step[step];
+
+  if (step < num_steps && t_step >= double_support_samples) {
+    double s = static_cast<double> (t_step - double_support_samples)
+      / (step_samples - double_support_samples);
+    double h = 0.5 * (1. - cos (M_PI * s));
+
+    const Footstep &footstep = footsteps[step];
+    Vector3d &swing = footstep.left ? left : right;
+    swing += h * (footstep.position - swing);
+    swing[2] += step_height * sin (M_PI * s);
+  }
+
+  if (left_foot_at_sample) {
+    *left_foot_at_sample = left;
+  }
+  if (right_foot_at_sample) {
+    *right_foot_at_sample = right;
+  }
+}
+
+void WalkingPlan::EvaluateSupport (long at_sample,
+    bool &left_contact,
+    bool &right_contact) const {
+  long num_steps = footsteps.size();
+  long t = at_sample - start_sample;
+
+  left_contact = true;
+  right_contact = true;
+
+  if (t < 0 || t >= num_steps * step_samples) {
+    return;
+  }
+
+  long step = t / step_samples;
+  if (t - step * step_samples >= double_support_samples) {
+    if (footsteps[step].left) {
+      left_contact = false;
+    } else {
+      right_contact = false;
+    }
+  }
+}
+
+WalkingPatternGenerator::WalkingPatternGenerator() :
+  step_time (0.8),
+  double_support_time (0.2),
+  step_height (0.05),
+  sample (0),
+  state_x (Vector3d::Zero()),
+  state_y (Vector3d::Zero()),
+  com_position (Vector3d::Zero()),
+  com_velocity (Vector3d::Zero()),
+  com_acceleration (Vector3d::Zero()),
+  zmp (Vector3d::Zero()),
+  zmp_reference (Vector3d::Zero()),
+  left_foot (Vector3d::Zero()),
+  right_foot (Vector3d::Zero()),
+  mPreviewHead (0) {
+}
+
+void WalkingPatternGenerator::Init (const ZMPPreviewGains &gains,
+    const Vector3d &left_foot_position,
+    const Vector3d &right_foot_position) {
+  assert (gains.GetNumPreviewSteps() > 0);
+
+  mGains = gains;
+  sample = 0;
+
+  Vector3d center = 0.5 * (left_foot_position + right_foot_position);
+  state_x = Vector3d (center[0], 0., 0.);
+  state_y = Vector3d (center[1], 0., 0.);
+  left_foot = left_foot_position;
+  right_foot = right_foot_position;
+  zmp_reference = center;
+
+  SetFootsteps (std::vector<Footstep>(), 0.);
+}
+
+void WalkingPatternGenerator::SetFootsteps (
+    const std::vector<Footstep> &footsteps,
+    double start_delay) {
+  double T = mGains.sample_time;
+
+  mPlan.footsteps = footsteps;
+  mPlan.start_sample = sample + SamplesOf (start_delay, T);
+  mPlan.step_samples = std::max (1l, SamplesOf (step_time, T));
+  mPlan.double_support_samples = std::min (mPlan.step_samples - 1,
+      SamplesOf (double_support_time, T));
+  mPlan.step_height = step_height;
+
+  unsigned int num_steps = footsteps.size();
+  std::vector<Vector3d> &left_at_step = mPlan.left_at_step;
+  std::vector<Vector3d> &right_at_step = mPlan.right_at_step;
+  std::vector<Vector3d> &zmp_targets = mPlan.zmp_targets;
+  left_at_step.resize (num_steps + 1);
+  right_at_step.resize (num_steps + 1);
+  zmp_targets.resize (num_steps + 2);
+
+  left_at_step[0] = left_foot;
+  right_at_step[0] = right_foot;
+  zmp_targets[0] = zmp_reference;
+
+  for (unsigned int i = 0; i < num_steps; i++) {
+    zmp_targets[i + 1] = footsteps[i].left ? right_at_step[i]
+      : left_at_step[i];
+    left_at_step[i + 1] = footsteps[i].left ? footsteps[i].position
+      : left_at_step[i];
+    right_at_step[i + 1] = footsteps[i].left ? right_at_step[i]
+      : footsteps[i].position;
+  }
+  zmp_targets[num_steps + 1] = 0.5
+    * (left_at_step[num_steps] + right_at_step[num_steps]);
+
+  unsigned int num_preview_steps = mGains.GetNumPreviewSteps();
+  mPreviewX.resize (num_preview_steps);
+  mPreviewY.resize (num_preview_steps);
+  mPreviewHead = 0;
+
+  Vector3d reference;
+  for (unsigned int j = 0; j < num_preview_steps; j++) {
+    EvaluatePlan (sample + 1 + j, reference, NULL, NULL);
+    mPreviewX[j] = reference[0];
+    mPreviewY[j] = reference[1];
+  }
+
+  UpdateOutputs();
+}
+
+void WalkingPatternGenerator::Step() {
+  unsigned int N = mPreviewX.size();
+  unsigned int first = N - mPreviewHead;
+
+  // the window wraps around the end of the ring buffer
+  const VectorNd &f = mGains.preview_gains;
+  double preview_x = f.head (first).dot (mPreviewX.segment (mPreviewHead,
+        first)) + f.tail (mPreviewHead).dot (mPreviewX.head (mPreviewHead));
+  double preview_y = f.head (first).dot (mPreviewY.segment (mPreviewHead,
+        first)) + f.tail (mPreviewHead).dot (mPreviewY.head (mPreviewHead));
+
+  double jerk_x = preview_x - mGains.state_gain.dot (state_x);
+  double jerk_y = preview_y - mGains.state_gain.dot (state_y);
+
+  state_x = mGains.A * state_x + mGains.B * jerk_x;
+  state_y = mGains.A * state_y + mGains.B * jerk_y;
+  sample++;
+
+  // the slot of the current sample becomes the end of the window
+  Vector3d reference;
+  EvaluatePlan (sample + N, reference, NULL, NULL);
+  mPreviewX[mPreviewHead] = reference[0];
+  mPreviewY[mPreviewHead] = reference[1];
+  mPreviewHead = mPreviewHead + 1 < N ? mPreviewHead + 1 : 0;
+
+  UpdateOutputs();
+}
+
+bool WalkingPatternGenerator::IsFinished() const {
+  return sample >= mPlan.GetEndSample();
+}
+
+void WalkingPatternGenerator::EvaluatePlan (long at_sample,
+    Vector3d &zmp_at_sample,
+    Vector3d *left_foot_at_sample,
+    Vector3d *right_foot_at_sample) const {
+  mPlan.Evaluate (at_sample, zmp_at_sample, left_foot_at_sample,
+      right_foot_at_sample);
+}
+
+void WalkingPatternGenerator::EvaluateSupport (long at_sample,
+    bool &left_contact,
+    bool &right_contact) const {
+  mPlan.EvaluateSupport (at_sample, left_contact, right_contact);
+}
+
+void WalkingPatternGenerator::UpdateOutputs() {
+  EvaluatePlan (sample, zmp_reference, &left_foot, &right_foot);
+
+  com_position = Vector3d (state_x[0], state_y[0],
+      zmp_reference[2] + mGains.com_height);
+  com_velocity = Vector3d (state_x[1], state_y[1], 0.);
+  com_acceleration = Vector3d (state_x[2], state_y[2], 0.);
+  zmp = Vector3d (mGains.C.dot (state_x), mGains.C.dot (state_y),
+      zmp_reference[2]);
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,311 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_LOCOMOTION_ZMP_PREVIEW_CONTROL_H
+#define RBDL_LOCOMOTION_ZMP_PREVIEW_CONTROL_H
+
+#include <string>
+#include <vector>
+
+#include <rbdl/rbdl_math.h>
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Locomotion {
+
+/** \brief Gains of the cart-table ZMP preview controller.
+ *
+ * The horizontal center of mass motion along one axis is modelled as a
+ * cart on a table of height \f$z_c\f$ that is driven by its jerk \f$u\f$:
+ *
+ * \f[ x_{k+1} = A x_k + B u_k, \quad p_k = C x_k, \quad
+ *     x = (c, \dot{c}, \ddot{c})^T, \quad C = (1, 0, -z_c / g) \f]
+ *
+ * where \f$p\f$ is the ZMP. Compute() solves the discrete algebraic
+ * Riccati equation of the cost \f$\sum Q_e (p_k - p^{ref}_k)^2 + R u_k^2\f$
+ * and derives the state feedback and the preview gains of
+ *
+ * \f[ u_k = -K x_k + \sum_{j=1}^{N} f_j p^{ref}_{k+j}. \f]
+ *
+ * The gains only depend on the settings, so they are computed once and
+ * kept in a cache file (see LoadOrCompute()).
+ */
+struct RBDL_DLLAPI ZMPPreviewGains {
+  ZMPPreviewGains();
+
+  /** \brief Solves the Riccati equation and computes the gains of the
+   * current settings.
+   *
+   * \returns false if the iteration did not converge
+   */
+  bool Compute();
+
+  /// \brief Writes settings and gains into a file. Returns false on failure.
+  bool Save (const std::string &filename) const;
+
+  /** \brief Reads gains written by Save().
+   *
+   * The settings are overwritten by the ones stored in the file. Returns
+   * false if the file cannot be read or is not a gain file.
+   */
+  bool Load (const std::string &filename);
+
+  /** \brief Loads the gains from the cache file if it was written for the
+   * current settings, otherwise computes them and updates the cache.
+   *
+   * Returns false only if the gains could not be computed. A cache file
+   * that cannot be written is reported but not treated as an error.
+   */
+  bool LoadOrCompute (const std::string &cache_filename);
+
+  /// \brief Number of gains (preview_time / sample_time).
+  unsigned int GetNumPreviewSteps() const {
+    return preview_gains.size();
+  }
+
+  // Settings
+
+  /// Controller sample time in seconds (default: 0.001).
+  double sample_time;
+  /// Height of the center of mass above the ground (default: 0.8).
+  double com_height;
+  /// Gravitational acceleration (default: 9.81).
+  double gravity;
+  /// Length of the preview window in seconds (default: 1.6).
+  double preview_time;
+  /// Weight \f$Q_e\f$ of the ZMP tracking error (default: 1.0).
+  double zmp_weight;
+  /// Weight \f$R\f$ of the jerk (default: 1.0e-6).
+  double jerk_weight;
+
+  // Results
+
+  Math::Matrix3d A;
+  Math::Vector3d B;
+  Math::Vector3d C;
+  /// State feedback gain \f$K\f$.
+  Math::Vector3d state_gain;
+  /// Preview gains \f$f_1, \ldots, f_N\f$.
+  Math::VectorNd preview_gains;
+};
+
+/** \brief Footstep of a walking plan.
+ *
+ * The foot is placed with its sole center (the point that the ZMP
+ * reference is attached to) at position.
+ */
+struct RBDL_DLLAPI Footstep {
+  Footstep() :
+    position (Math::Vector3d::Zero()),
+    left (true) {
+  }
+  Footstep (const Math::Vector3d &position, bool left) :
+    position (position),
+    left (left) {
+  }
+
+  Math::Vector3d position;
+  /// Whether the left or the right foot is placed.
+  bool left;
+};
+
+/** \brief Footstep plan of a WalkingPatternGenerator in samples.
+ *
+ * Holds only what is needed to evaluate the ZMP reference, the foot
+ * positions and the support phases at arbitrary samples (a few entries
+ * per footstep), so it can be handed to other consumers of the plan, e.g.
+ * a LIPModelPredictiveControl running in another thread, without copying
+ * the preview window and the gains of the generator. Assigning a plan to
+ * one that already holds as many footsteps does not allocate memory.
+ */
+struct RBDL_DLLAPI WalkingPlan {
+  WalkingPlan() :
+    start_sample (0),
+    step_samples (1),
+    double_support_samples (0),
+    step_height (0.) {
+  }
+
+  /** \brief Evaluates the plan at the given sample.
+   *
+   * \param sample sample index
+   * \param zmp (output) ZMP reference
+   * \param left_foot (output, optional) left foot position
+   * \param right_foot (output, optional) right foot position
+   */
+  void Evaluate (long sample,
+      Math::Vector3d &zmp,
+      Math::Vector3d *left_foot,
+      Math::Vector3d *right_foot) const;
+
+  /** \brief Returns which feet are on the ground at the given sample.
+   *
+   * Both feet are on the ground outside of the single support phases.
+   */
+  void EvaluateSupport (long sample,
+      bool &left_contact,
+      bool &right_contact) const;
+
+  /// \brief First sample after the plan has been completed.
+  long GetEndSample() const {
+    return start_sample
+      + static_cast<long> (footsteps.size()) * step_samples
+      + double_support_samples;
+  }
+
+  /// Sample at which the first step starts.
+  long start_sample;
+  /// Duration of a step including double support.
+  long step_samples;
+  /// Double support duration at the start of each step.
+  long double_support_samples;
+  /// Lift of the swing foot.
+  double step_height;
+  std::vector<Footstep> footsteps;
+  /// Foot positions at the start of every step and after the plan.
+  std::vector<Math::Vector3d> left_at_step;
+  std::vector<Math::Vector3d> right_at_step;
+  /// ZMP targets before the plan, of every step and after the plan.
+  std::vector<Math::Vector3d> zmp_targets;
+};
+
+/** \brief Walking pattern generator based on ZMP preview control.
+ *
+ * A footstep plan is turned into a ZMP reference that stays at the sole
+ * of the support foot during single support and moves linearly to the
+ * next support foot during double support. Each call of Step() advances
+ * the plan by one sample: it feeds the reference of the preview window
+ * into the ZMP preview controller of both horizontal axes and outputs the
+ * center of mass and the foot positions of the current sample. The swing
+ * foot follows a smooth horizontal profile with a sine shaped lift.
+ *
+ * The preview window is kept in a ring buffer that is filled once when
+ * the plan is set, afterwards Step() evaluates the plan at a single
+ * sample and computes two dot products of the window with the preview
+ * gains. It does not allocate memory.
+ *
+ * \code
+ * ZMPPreviewGains gains;
+ * gains.com_height = 0.8;
+ * gains.LoadOrCompute ("zmp_preview_gains.bin");
+ *
+ * WalkingPatternGenerator walking;
+ * walking.Init (gains, left_sole, right_sole);
+ * walking.SetFootsteps (footsteps);
+ *
+ * // every control cycle
+ * walking.Step();
+ * // walking.com_position, walking.left_foot, walking.right_foot
+ * \endcode
+ */
+class RBDL_DLLAPI WalkingPatternGenerator {
+  public:
+    WalkingPatternGenerator();
+
+    /** \brief Resets the generator to standing with the center of mass
+     * above the middle of both feet.
+     *
+     * The gains are copied, the com height of the output is taken from
+     * gains.com_height.
+     */
+    void Init (const ZMPPreviewGains &gains,
+        const Math::Vector3d &left_foot,
+        const Math::Vector3d &right_foot);
+
+    /** \brief Replaces the plan by the given footsteps.
+     *
+     * The first step starts start_delay seconds after the current sample
+     * from the current foot positions (both feet must be on the ground).
+     * After the last step the ZMP moves to the middle of both feet. This
+     * refills the preview window, so it costs one plan evaluation per
+     * preview sample.
+     */
+    void SetFootsteps (const std::vector<Footstep> &footsteps,
+        double start_delay = 0.5);
+
+    /// \brief Advances the pattern by one sample.
+    void Step();
+
+    /// \brief Whether all footsteps have been completed.
+    bool IsFinished() const;
+
+    /** \brief Evaluates the plan at the given sample.
+     *
+     * \param sample sample index (may lie in the future)
+     * \param zmp (output) ZMP reference
+     * \param left_foot (output, optional) left foot position
+     * \param right_foot (output, optional) right foot position
+     */
+    void EvaluatePlan (long sample,
+        Math::Vector3d &zmp,
+        Math::Vector3d *left_foot,
+        Math::Vector3d *right_foot) const;
+
+    /** \brief Returns which feet are on the ground at the given sample.
+     *
+     * Both feet are on the ground outside of the single support phases.
+     */
+    void EvaluateSupport (long sample,
+        bool &left_contact,
+        bool &right_contact) const;
+
+    /// \brief The current plan (without the preview window).
+    const WalkingPlan &GetPlan() const {
+      return mPlan;
+    }
+
+    // Settings (used by the next call of SetFootsteps())
+
+    /// Duration of a step including double support (default: 0.8).
+    double step_time;
+    /// Double support duration at the start of each step (default: 0.2).
+    double double_support_time;
+    /// Lift of the swing foot (default: 0.05).
+    double step_height;
+
+    // State and outputs of the current sample
+
+    /// Index of the current sample.
+    long sample;
+    /// Cart-table states (position, velocity, acceleration) of x and y.
+    Math::Vector3d state_x;
+    Math::Vector3d state_y;
+
+    Math::Vector3d com_position;
+    Math::Vector3d com_velocity;
+    Math::Vector3d com_acceleration;
+    /// ZMP of the cart-table model.
+    Math::Vector3d zmp;
+    /// ZMP reference of the current sample.
+    Math::Vector3d zmp_reference;
+    Math::Vector3d left_foot;
+    Math::Vector3d right_foot;
+
+  private:
+    void UpdateOutputs();
+
+    ZMPPreviewGains mGains;
+
+    WalkingPlan mPlan;
+
+    /// Ring buffer of the ZMP references of samples sample + 1 to
+    /// sample + N, the reference of sample + 1 is at mPreviewHead.
+    Math::VectorNd mPreviewX;
+    Math::VectorNd mPreviewY;
+    unsigned int mPreviewHead;
+};
+
+}
+
+}
+
+}
+
+/* RBDL_LOCOMOTION_ZMP_PREVIEW_CONTROL_H */
+#endif
@@ -0,0 +1,18 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_LOCOMOTION_H
+#define RBDL_LOCOMOTION_H
+
+#include "ZMPPreviewControl.h"
+#include "LIPModelPredictiveControl.h"
+#include "FloatingBaseEstimator.h"
+#include "ForceTorqueProcessing.h"
+#include "MomentumObserver.h"
+#include "ControlScheduler.h"
+
+#endif
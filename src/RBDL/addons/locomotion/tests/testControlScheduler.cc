@@ -0,0 +1,166 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <UnitTest++.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ControlScheduler.h"
+
+using namespace std;
+using namespace RigidBodyDynamics::Addons::Locomotion;
+
+namespace {
+
+void Sleep (double seconds) {
+  std::this_thread::sleep_for (std::chrono::duration<double> (seconds));
+}
+
+}
+
+TEST ( TestControlSchedulerRates ) {
+  ControlScheduler scheduler;
+  vector<string> log;
+  unsigned int counts[4] = { 0, 0, 0, 0 };
+
+  scheduler.AddTask ("servo", [&] { counts[0]++; log.push_back ("servo"); }, 1);
+  scheduler.AddTask ("estimation", [&] { counts[1]++; log.push_back ("estimation"); }, 2, 1);
+  scheduler.AddTask ("mpc", [&] { counts[2]++; }, 10, 3);
+  scheduler.AddTask ("planner", [&] { counts[3]++; }, 100);
+
+  for (unsigned int k = 0; k < 1000; k++) {
+    scheduler.Tick();
+  }
+
+  CHECK_EQUAL (1000u, counts[0]);
+  CHECK_EQUAL (500u, counts[1]);
+  CHECK_EQUAL (100u, counts[2]);
+  CHECK_EQUAL (10u, counts[3]);
+  CHECK_EQUAL (1000ul, scheduler.tick);
+
+  // tasks of a tick run in the order in which they were added
+  CHECK_EQUAL ("servo", log[0]);
+  CHECK_EQUAL ("servo", log[1]);
+  CHECK_EQUAL ("estimation", log[2]);
+  CHECK_EQUAL ("servo", log[3]);
+
+  ControlScheduler::TaskStats stats = scheduler.GetTaskStats (1);
+  CHECK_EQUAL ("estimation", stats.name);
+  CHECK_EQUAL (500ul, stats.num_runs);
+  CHECK_EQUAL (0ul, stats.num_overruns);
+  CHECK (stats.max_time >= stats.last_time);
+  CHECK (stats.GetMeanTime() <= stats.max_time);
+}
+
+TEST ( TestDoubleBufferedChannel ) {
+  DoubleBufferedChannel<vector<double> > channel (vector<double> (3, 1.));
+
+  vector<double> value;
+  CHECK_EQUAL (0ul, channel.Read (value));
+  CHECK_EQUAL (1., value[2]);
+
+  // a written value is only visible once it is published
+  channel.Write (vector<double> (3, 2.));
+  channel.Read (value);
+  CHECK_EQUAL (1., value[2]);
+
+  channel.Publish();
+  CHECK_EQUAL (1ul, channel.Read (value));
+  CHECK_EQUAL (2., value[2]);
+
+  // publishing without a new value changes nothing
+  channel.Publish();
+  CHECK_EQUAL (1ul, channel.GetSequence());
+
+  channel.Write (vector<double> (3, 3.));
+  channel.Publish();
+  CHECK_EQUAL (2ul, channel.Read (value));
+  CHECK_EQUAL (3., value[2]);
+}
+
+TEST ( TestControlSchedulerDeterministicWorker ) {
+  ControlScheduler scheduler;
+  scheduler.wait_for_workers = true;
+
+  // servo -> (tick) -> worker doubles it -> (doubled) -> servo
+  DoubleBufferedChannel<long> tick_channel (-1);
+  DoubleBufferedChannel<long> doubled_channel (-1);
+  vector<long> received;
+
+  unsigned int producer = scheduler.AddTask ("producer", [&] {
+      tick_channel.Write (static_cast<long> (scheduler.tick));
+      }, 1);
+  scheduler.AddOutput (producer, tick_channel);
+
+  long input = 0;
+  unsigned int worker = scheduler.AddTask ("worker", [&] {
+      Sleep (0.002);
+      doubled_channel.Write (2 * input);
+      }, 10, 0, true);
+  scheduler.SetReleaseFunction (worker, [&] { tick_channel.Read (input); });
+  scheduler.AddOutput (worker, doubled_channel);
+
+  scheduler.AddTask ("consumer", [&] {
+      long value;
+      doubled_channel.Read (value);
+      received.push_back (value);
+      }, 1);
+
+  for (unsigned int k = 0; k < 200; k++) {
+    scheduler.Tick();
+  }
+  scheduler.Stop();
+
+  // the job released at tick 10 i reads 10 i and is visible from tick
+  // 10 (i + 1) on
+  for (long k = 0; k < 200; k++) {
+    long expected = (k < 10) ? -1 : 2 * (10 * (k / 10) - 10);
+    CHECK_EQUAL (expected, received[k]);
+  }
+
+  ControlScheduler::TaskStats stats = scheduler.GetTaskStats (worker);
+  CHECK_EQUAL (20ul, stats.num_runs);
+  CHECK_EQUAL (0ul, stats.num_overruns);
+  CHECK (stats.GetMeanTime() >= 0.002);
+}
+
+TEST ( TestControlSchedulerOverruns ) {
+  ControlScheduler scheduler;
+  scheduler.tick_time = 0.001;
+
+  unsigned int servo_runs = 0;
+  scheduler.AddTask ("servo", [&] { servo_runs++; }, 1);
+  unsigned int slow = scheduler.AddTask ("slow", [&] { Sleep (0.02); }, 2,
+      0, true);
+  unsigned int late = scheduler.AddTask ("late", [&] { Sleep (0.003); }, 2,
+      1);
+
+  // the worker takes 10 periods, its releases are skipped while the
+  // servo keeps running every tick
+  for (unsigned int k = 0; k < 50; k++) {
+    scheduler.Tick();
+    Sleep (0.001);
+  }
+  scheduler.Stop();
+
+  CHECK_EQUAL (50u, servo_runs);
+
+  ControlScheduler::TaskStats slow_stats = scheduler.GetTaskStats (slow);
+  CHECK (slow_stats.num_overruns > 0);
+  CHECK (slow_stats.num_runs + slow_stats.num_overruns <= 25ul);
+  CHECK (slow_stats.max_time >= 0.02);
+
+  // the inline task takes longer than its period of 2 ms
+  ControlScheduler::TaskStats late_stats = scheduler.GetTaskStats (late);
+  CHECK_EQUAL (25ul, late_stats.num_runs);
+  CHECK_EQUAL (25ul, late_stats.num_overruns);
+  CHECK (scheduler.num_tick_overruns >= 25ul);
+  CHECK (scheduler.max_tick_time >= 0.003);
+}
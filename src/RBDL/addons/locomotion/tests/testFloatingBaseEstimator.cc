@@ -0,0 +1,154 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <UnitTest++.h>
+
+#include <cmath>
+
+#include "rbdl/rbdl.h"
+
+#include "FloatingBaseEstimator.h"
+
+using namespace std;
+using namespace RigidBodyDynamics;
+using namespace RigidBodyDynamics::Math;
+using namespace RigidBodyDynamics::Addons::Locomotion;
+
+/// Base with two point feet on translational joints, q holds the foot
+/// positions relative to the hips.
+struct FloatingBaseFixture {
+  FloatingBaseFixture() {
+    Body foot (0.5, Vector3d (0., 0., 0.), Vector3d (0.001, 0.001, 0.001));
+    Joint translation (JointTypeTranslationXYZ);
+    left_id = model.AddBody (0, Xtrans (Vector3d (0., 0.1, 0.)),
+        translation, foot, "left_foot");
+    right_id = model.AddBody (0, Xtrans (Vector3d (0., -0.1, 0.)),
+        translation, foot, "right_foot");
+    q = VectorNd::Zero (model.q_size);
+
+    position = Vector3d (0., 0., 0.8);
+    velocity = Vector3d::Zero();
+    orientation = Matrix3d::Identity();
+    left_foot = Vector3d (0., 0.1, 0.);
+    right_foot = Vector3d (0., -0.1, 0.);
+    accelerometer_bias = Vector3d (0.05, -0.03, 0.02);
+    gyroscope_bias = Vector3d (0.01, -0.02, 0.005);
+    gravity = Vector3d (0., 0., -9.81);
+  }
+
+  /// Integrates the true motion like the estimator does and returns the
+  /// IMU readings of the step in gyroscope and accelerometer.
+  void Step (const Vector3d &acceleration, const Vector3d &omega, double dt,
+      Vector3d &gyroscope, Vector3d &accelerometer) {
+    gyroscope = omega + gyroscope_bias;
+    accelerometer = orientation.transpose() * (acceleration - gravity)
+      + accelerometer_bias;
+
+    position += dt * velocity + 0.5 * dt * dt * acceleration;
+    velocity += dt * acceleration;
+    Eigen::AngleAxisd rotation (dt * omega.norm(), omega.normalized());
+    orientation = orientation * rotation.toRotationMatrix();
+
+    // joint positions that keep the feet at their world positions
+    q.segment<3> (0) = orientation.transpose() * (left_foot - position)
+      - Vector3d (0., 0.1, 0.);
+    q.segment<3> (3) = orientation.transpose() * (right_foot - position)
+      - Vector3d (0., -0.1, 0.);
+  }
+
+  Model model;
+  unsigned int left_id;
+  unsigned int right_id;
+  VectorNd q;
+
+  Vector3d position;
+  Vector3d velocity;
+  Matrix3d orientation;
+  Vector3d left_foot;
+  Vector3d right_foot;
+  Vector3d accelerometer_bias;
+  Vector3d gyroscope_bias;
+  Vector3d gravity;
+};
+
+TEST_FIXTURE ( FloatingBaseFixture, TestFloatingBaseEstimatorConvergence ) {
+  q.segment<3> (0) = Vector3d (0., 0., -0.8);
+  q.segment<3> (3) = Vector3d (0., 0., -0.8);
+
+  // start with a tilted estimate and unknown biases
+  FloatingBaseEstimator estimator;
+  Matrix3d tilt = Eigen::AngleAxisd (0.05, Vector3d (1., 1., 0.)
+      .normalized()).toRotationMatrix();
+  estimator.Init (model, left_id, right_id, q, position, tilt);
+
+  double dt = 0.001;
+  Vector3d gyroscope, accelerometer;
+  for (unsigned int k = 0; k < 10000; k++) {
+    double t = k * dt;
+    Vector3d acceleration (0.5 * sin (2. * t), 0.3 * cos (3. * t),
+        0.2 * sin (4. * t));
+    // turning about the vertical separates the tilt from the
+    // accelerometer bias
+    Vector3d omega (0.3 * sin (t), 0.2 * cos (2. * t), 0.5 * cos (0.5 * t));
+    Step (acceleration, omega, dt, gyroscope, accelerometer);
+
+    estimator.Update (gyroscope, accelerometer, dt, model, q, true, true);
+  }
+
+  CHECK ((estimator.velocity - velocity).norm() < 5.0e-3);
+  // the position is only known relative to the initial foot positions
+  CHECK ((estimator.position - position).norm() < 0.02);
+
+  // roll and pitch are observable through gravity
+  Vector3d up_estimate = estimator.orientation.transpose()
+    * Vector3d (0., 0., 1.);
+  Vector3d up = orientation.transpose() * Vector3d (0., 0., 1.);
+  CHECK ((up_estimate - up).norm() < 2.0e-3);
+
+  CHECK ((estimator.gyroscope_bias - gyroscope_bias).norm() < 1.0e-3);
+
+  CHECK_EQUAL (10000ul, estimator.num_updates);
+  CHECK (estimator.update_time > 0.);
+  CHECK (estimator.max_update_time >= estimator.update_time);
+  CHECK (estimator.GetMeanUpdateTime() > 0.);
+  CHECK (estimator.GetMeanUpdateTime() <= estimator.max_update_time);
+}
+
+TEST_FIXTURE ( FloatingBaseFixture, TestFloatingBaseEstimatorSwingFoot ) {
+  accelerometer_bias.setZero();
+  gyroscope_bias.setZero();
+  q.segment<3> (0) = Vector3d (0., 0., -0.8);
+  q.segment<3> (3) = Vector3d (0., 0., -0.8);
+
+  FloatingBaseEstimator estimator;
+  estimator.Init (model, left_id, right_id, q, position, orientation);
+
+  // the base moves forward while the left foot steps 0.2 ahead
+  double dt = 0.001;
+  Vector3d gyroscope, accelerometer;
+  for (unsigned int k = 0; k < 2000; k++) {
+    double t = k * dt;
+    bool swing = (k >= 500 && k < 1500);
+    if (swing) {
+      double phase = (k - 500) / 1000.;
+      left_foot = Vector3d (0.1 * (1. - cos (M_PI * phase)), 0.1,
+          0.05 * sin (M_PI * phase));
+    }
+    Vector3d acceleration (0.1 * M_PI * sin (M_PI * t), 0., 0.);
+    Step (acceleration, Vector3d::Zero(), dt, gyroscope, accelerometer);
+
+    estimator.Update (gyroscope, accelerometer, dt, model, q, !swing, true);
+
+    // the stance foot does not move
+    CHECK ((estimator.right_foot - right_foot).norm() < 1.0e-3);
+  }
+
+  CHECK_ARRAY_CLOSE (left_foot.data(), estimator.left_foot.data(), 3,
+      1.0e-3);
+  CHECK_ARRAY_CLOSE (velocity.data(), estimator.velocity.data(), 3, 1.0e-3);
+  CHECK_ARRAY_CLOSE (position.data(), estimator.position.data(), 3, 1.0e-3);
+}
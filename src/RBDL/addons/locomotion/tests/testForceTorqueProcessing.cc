@@ -0,0 +1,168 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <UnitTest++.h>
+
+#include <cmath>
+#include <complex>
+
+#include "rbdl/rbdl.h"
+
+#include "ForceTorqueProcessing.h"
+
+using namespace std;
+using namespace RigidBodyDynamics;
+using namespace RigidBodyDynamics::Math;
+using namespace RigidBodyDynamics::Addons::Locomotion;
+
+/// Magnitude of the frequency response of the cascade at frequency in Hz.
+static double FilterGain (const BiquadFilterBank &filter, double frequency,
+    double sample_time) {
+  complex<double> z_inverse = exp (complex<double> (0.,
+        -2. * M_PI * frequency * sample_time));
+  complex<double> gain (1., 0.);
+  for (unsigned int k = 0; k < filter.GetSections().size(); k++) {
+    const BiquadFilterBank::Section &s = filter.GetSections()[k];
+    gain *= (s.b0 + s.b1 * z_inverse + s.b2 * z_inverse * z_inverse)
+      / (1. + s.a1 * z_inverse + s.a2 * z_inverse * z_inverse);
+  }
+  return abs (gain);
+}
+
+TEST ( TestBiquadFilterBankDesign ) {
+  for (unsigned int order = 2; order <= 6; order += 2) {
+    BiquadFilterBank filter;
+    filter.Init (4, 0.001, 30., order);
+    CHECK_EQUAL (order / 2, filter.GetSections().size());
+
+    CHECK_CLOSE (1., FilterGain (filter, 0., 0.001), 1.0e-12);
+    CHECK_CLOSE (sqrt (0.5), FilterGain (filter, 30., 0.001), 1.0e-12);
+    // n * 20 dB per decade
+    CHECK (FilterGain (filter, 300., 0.001) < pow (0.1, order) * 1.5);
+  }
+}
+
+TEST ( TestBiquadFilterBankChannels ) {
+  BiquadFilterBank filter;
+  filter.Init (3, 0.001, 20., 4);
+
+  // every channel matches a single channel filter
+  BiquadFilterBank single;
+  single.Init (1, 0.001, 20., 4);
+
+  VectorNd input (3), output (3), single_input (1), single_output (1);
+  for (unsigned int k = 0; k < 500; k++) {
+    double t = k * 0.001;
+    input << 1., sin (2. * M_PI * 5. * t), (k % 2 == 0) ? 1. : -1.;
+    filter.Filter (input, output);
+
+    single_input[0] = input[1];
+    single.Filter (single_input, single_output);
+    CHECK_CLOSE (single_output[0], output[1], 1.0e-14);
+  }
+
+  // step response settles, the alternating sign is removed
+  CHECK_CLOSE (1., output[0], 1.0e-6);
+  CHECK (fabs (output[2]) < 1.0e-3);
+
+  // a reset state stays at its value, filtering in place
+  VectorNd value (3);
+  value << 1., -2., 3.;
+  filter.Reset (value);
+  input = value;
+  filter.Filter (input, input);
+  CHECK_ARRAY_CLOSE (value.data(), input.data(), 3, 1.0e-12);
+}
+
+TEST ( TestFootWrenchProcessorCenterOfPressure ) {
+  FootWrenchProcessor processor;
+  processor.sensor_height = 0.006;
+  processor.Init (0.001, 50.);
+
+  // point forces on the soles, moments about the sensor origins
+  Vector3d left_point (0.05, -0.02, -0.006);
+  Vector3d left_force (5., -3., 200.);
+  Vector3d right_point (-0.03, 0.01, -0.006);
+  Vector3d right_force (-2., 1., 100.);
+  Vector3d left_moment = left_point.cross (left_force);
+  Vector3d right_moment = right_point.cross (right_force);
+
+  for (unsigned int k = 0; k < 300; k++) {
+    processor.Update (left_force, left_moment, right_force, right_moment);
+  }
+
+  CHECK (processor.left_contact && processor.right_contact);
+  CHECK_ARRAY_CLOSE (left_point.data(), processor.left_cop.data(), 3,
+      1.0e-9);
+  CHECK_ARRAY_CLOSE (right_point.data(), processor.right_cop.data(), 3,
+      1.0e-9);
+
+  // feet side by side, the right one turned by 90 degrees about z
+  Vector3d left_position (0., 0.1, 0.006);
+  Vector3d right_position (0., -0.1, 0.006);
+  Matrix3d right_orientation;
+  right_orientation << 0., -1., 0.,
+                    1., 0., 0.,
+                    0., 0., 1.;
+  CHECK (processor.ComputeZMP (left_position, Matrix3d::Identity(),
+        right_position, right_orientation));
+
+  Vector3d zmp = (200. * (left_position + left_point)
+      + 100. * (right_position + right_orientation * right_point)) / 300.;
+  CHECK_ARRAY_CLOSE (zmp.data(), processor.zmp.data(), 3, 1.0e-9);
+  CHECK_CLOSE (0., processor.zmp[2], 1.0e-12);
+
+  CHECK (processor.update_time > 0.);
+  CHECK (processor.max_update_time >= processor.update_time);
+}
+
+TEST ( TestFootWrenchProcessorContactHysteresis ) {
+  FootWrenchProcessor processor;
+  processor.contact_on_force = 50.;
+  processor.contact_off_force = 20.;
+  processor.Init (0.001, 100.);
+
+  Vector3d zero (Vector3d::Zero());
+  Vector3d right_force (0., 0., 300.);
+
+  // a noisy normal force between the thresholds does not switch
+  unsigned int num_switches = 0;
+  bool contact = processor.left_contact;
+  for (unsigned int k = 0; k < 1000; k++) {
+    double normal = 35. + 10. * sin (0.3 * k) + ((k % 3) - 1.) * 4.;
+    processor.Update (Vector3d (0., 0., normal), zero, right_force, zero);
+    num_switches += (processor.left_contact != contact);
+    contact = processor.left_contact;
+  }
+  CHECK_EQUAL (0u, num_switches);
+  CHECK (!processor.left_contact);
+  CHECK (processor.right_contact);
+
+  // loading the foot switches once, the contact holds until the force
+  // drops below the lower threshold
+  for (unsigned int k = 0; k < 100; k++) {
+    processor.Update (Vector3d (0., 0., 100.), zero, right_force, zero);
+  }
+  CHECK (processor.left_contact);
+  for (unsigned int k = 0; k < 100; k++) {
+    processor.Update (Vector3d (0., 0., 25.), zero, right_force, zero);
+  }
+  CHECK (processor.left_contact);
+  for (unsigned int k = 0; k < 100; k++) {
+    processor.Update (Vector3d (0., 0., 10.), zero, right_force, zero);
+  }
+  CHECK (!processor.left_contact);
+
+  // the sole center is reported without contact, the ZMP uses the right
+  // foot only
+  CHECK_ARRAY_CLOSE (Vector3d::Zero().eval().data(),
+      processor.left_cop.data(), 3, 1.0e-12);
+  CHECK (processor.ComputeZMP (Vector3d (0., 0.1, 0.), Matrix3d::Identity(),
+        Vector3d (0., -0.1, 0.), Matrix3d::Identity()));
+  CHECK_ARRAY_CLOSE (Vector3d (0., -0.1, 0.).data(), processor.zmp.data(),
+      3, 1.0e-9);
+}
@@ -0,0 +1,193 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <UnitTest++.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "rbdl/rbdl.h"
+
+#include "LIPModelPredictiveControl.h"
+#include "ZMPPreviewControl.h"
+
+using namespace std;
+using namespace RigidBodyDynamics;
+using namespace RigidBodyDynamics::Math;
+using namespace RigidBodyDynamics::Addons::Locomotion;
+
+/// Prediction matrices of the cart-table model built from the recursion.
+static void BuildPrediction (unsigned int N, double T, double com_height,
+    MatrixNd &Ps, MatrixNd &Pu) {
+  MatrixNd A (3, 3);
+  A << 1., T, 0.5 * T * T,
+    0., 1., T,
+    0., 0., 1.;
+  VectorNd B (3);
+  B << T * T * T / 6., 0.5 * T * T, T;
+  VectorNd C (3);
+  C << 1., 0., -com_height / 9.81;
+
+  Ps = MatrixNd::Zero (N, 3);
+  Pu = MatrixNd::Zero (N, N);
+  for (unsigned int j = 0; j < N; j++) {
+    VectorNd x = B;
+    for (unsigned int i = j; i < N; i++) {
+      Pu(i, j) = C.dot (x);
+      x = A * x;
+    }
+  }
+  MatrixNd X = A;
+  for (unsigned int i = 0; i < N; i++) {
+    Ps.row (i) = C.transpose() * X;
+    X = A * X;
+  }
+}
+
+TEST ( TestLIPMPCUnconstrained ) {
+  LIPModelPredictiveControl mpc;
+  mpc.Init (16, 0.1, 0.8);
+  mpc.state_x = Vector3d (0.05, 0.1, -0.2);
+  mpc.state_y = Vector3d (-0.02, 0., 0.);
+  for (unsigned int i = 0; i < 16; i++) {
+    mpc.zmp_reference_x[i] = 0.01 * i;
+  }
+
+  CHECK (mpc.Solve());
+
+  // the jerks of the condensed problem in the jerk variables
+  MatrixNd Ps, Pu;
+  BuildPrediction (16, 0.1, 0.8, Ps, Pu);
+  VectorNd x (3);
+  x << 0.05, 0.1, -0.2;
+  MatrixNd H = Pu.transpose() * Pu + 1.0e-6 * MatrixNd::Identity (16, 16);
+  VectorNd U = H.llt().solve (Pu.transpose() * (mpc.zmp_reference_x
+        - Ps * x));
+  VectorNd P = Ps * x + Pu * U;
+
+  CHECK_ARRAY_CLOSE (P.data(), mpc.zmp_x.data(), 16, 1.0e-8);
+  CHECK_CLOSE (U[0], mpc.jerk_x, 1.0e-5 * fabs (U[0]));
+  CHECK (mpc.solve_time > 0.);
+}
+
+TEST ( TestLIPMPCConstrained ) {
+  LIPModelPredictiveControl mpc;
+  mpc.Init (16, 0.1, 0.8);
+  // pushed forward, the ZMP has to stay within the foot
+  mpc.state_x = Vector3d (0., 0.4, 0.);
+  mpc.zmp_lower_x.setConstant (-0.05);
+  mpc.zmp_upper_x.setConstant (0.05);
+
+  CHECK (mpc.Solve());
+
+  for (unsigned int i = 0; i < 16; i++) {
+    CHECK (mpc.zmp_x[i] >= -0.05 && mpc.zmp_x[i] <= 0.05);
+  }
+  // the ZMP moves to the front edge to decelerate
+  CHECK_CLOSE (0.05, mpc.zmp_x[0], 1.0e-12);
+
+  // projected gradient on the same problem
+  MatrixNd Ps, Pu;
+  BuildPrediction (16, 0.1, 0.8, Ps, Pu);
+  VectorNd x (3);
+  x << 0., 0.4, 0.;
+  MatrixNd Pu_inverse = Pu.inverse();
+  MatrixNd G = MatrixNd::Identity (16, 16)
+    + 1.0e-6 * Pu_inverse.transpose() * Pu_inverse;
+  VectorNd h = -1.0e-6 * Pu_inverse.transpose() * Pu_inverse * Ps * x;
+  double step = 1. / G.selfadjointView<Eigen::Upper>().eigenvalues().maxCoeff();
+
+  VectorNd p = VectorNd::Zero (16);
+  for (unsigned int k = 0; k < 200000; k++) {
+    p -= step * (G * p + h);
+    for (unsigned int i = 0; i < 16; i++) {
+      p[i] = min (0.05, max (-0.05, p[i]));
+    }
+  }
+  CHECK_ARRAY_CLOSE (p.data(), mpc.zmp_x.data(), 16, 1.0e-6);
+
+  // solving the same problem again from the previous solution takes a
+  // single iteration per axis, a cold start finds the same solution
+  VectorNd zmp_x = mpc.zmp_x;
+  CHECK (mpc.Solve());
+  CHECK_EQUAL (2u, mpc.iterations);
+
+  mpc.warm_start = false;
+  CHECK (mpc.Solve());
+  CHECK (mpc.iterations > 2u);
+  CHECK_ARRAY_CLOSE (zmp_x.data(), mpc.zmp_x.data(), 16, 1.0e-10);
+}
+
+TEST ( TestLIPMPCPushRecovery ) {
+  LIPModelPredictiveControl mpc;
+  mpc.Init (16, 0.1, 0.8);
+  mpc.zmp_lower_x.setConstant (-0.1);
+  mpc.zmp_upper_x.setConstant (0.1);
+  mpc.zmp_lower_y.setConstant (-0.15);
+  mpc.zmp_upper_y.setConstant (0.15);
+
+  mpc.state_x = Vector3d (0., 0.25, 0.);
+  mpc.state_y = Vector3d (0., -0.2, 0.);
+
+  // 100 Hz MPC, 1 kHz integration
+  double max_x = 0.;
+  for (unsigned int cycle = 0; cycle < 300; cycle++) {
+    CHECK (mpc.Solve());
+    CHECK (fabs (mpc.zmp_x[0]) <= 0.1 && fabs (mpc.zmp_y[0]) <= 0.15);
+
+    for (unsigned int k = 0; k < 10; k++) {
+      mpc.Integrate (0.001);
+    }
+    max_x = max (max_x, mpc.state_x[0]);
+  }
+
+  // the center of mass is caught and brought back above the reference
+  CHECK (max_x > 0.02);
+  CHECK (fabs (mpc.state_x[0]) < 0.005 && fabs (mpc.state_y[0]) < 0.005);
+  CHECK (fabs (mpc.state_x[1]) < 0.01 && fabs (mpc.state_y[1]) < 0.01);
+  CHECK (mpc.max_solve_time >= mpc.solve_time);
+}
+
+TEST ( TestLIPMPCWalkingReferences ) {
+  ZMPPreviewGains gains;
+  gains.sample_time = 0.01;
+  CHECK (gains.Compute());
+
+  WalkingPatternGenerator walking;
+  walking.Init (gains, Vector3d (0., 0.1, 0.), Vector3d (0., -0.1, 0.));
+  vector<Footstep> footsteps;
+  footsteps.push_back (Footstep (Vector3d (0.2, 0.1, 0.), true));
+  walking.SetFootsteps (footsteps, 0.);
+
+  LIPModelPredictiveControl mpc;
+  mpc.Init (16, 0.1, 0.8);
+  // samples 0, 10, ..., 150 of the plan: double support until sample 20,
+  // single support on the right foot until 80, then both feet again
+  mpc.SetReferences (walking, 0, 10, 0.1, 0.05);
+
+  CHECK_CLOSE (-0.1, mpc.zmp_lower_x[0], 1.0e-12);
+  CHECK_CLOSE (0.1, mpc.zmp_upper_x[0], 1.0e-12);
+  CHECK_CLOSE (-0.15, mpc.zmp_lower_y[0], 1.0e-12);
+  CHECK_CLOSE (0.15, mpc.zmp_upper_y[0], 1.0e-12);
+
+  CHECK_CLOSE (-0.1, mpc.zmp_reference_y[5], 1.0e-12);
+  CHECK_CLOSE (-0.15, mpc.zmp_lower_y[5], 1.0e-12);
+  CHECK_CLOSE (-0.05, mpc.zmp_upper_y[5], 1.0e-12);
+  CHECK_CLOSE (0.1, mpc.zmp_upper_x[5], 1.0e-12);
+
+  CHECK_CLOSE (0.3, mpc.zmp_upper_x[12], 1.0e-12);
+  CHECK_CLOSE (0.15, mpc.zmp_upper_y[12], 1.0e-12);
+  for (unsigned int i = 0; i < 16; i++) {
+    CHECK (mpc.zmp_lower_x[i] <= mpc.zmp_reference_x[i]);
+    CHECK (mpc.zmp_reference_x[i] <= mpc.zmp_upper_x[i]);
+    CHECK (mpc.zmp_lower_y[i] <= mpc.zmp_reference_y[i]);
+    CHECK (mpc.zmp_reference_y[i] <= mpc.zmp_upper_y[i]);
+  }
+
+  CHECK (mpc.Solve());
+}
@@ -0,0 +1,161 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <UnitTest++.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "rbdl/rbdl.h"
+
+#include "MomentumObserver.h"
+
+using namespace std;
+using namespace RigidBodyDynamics;
+using namespace RigidBodyDynamics::Math;
+using namespace RigidBodyDynamics::Addons::Locomotion;
+
+/// Spatial arm with four revolute joints, the links point along z.
+struct MomentumObserverFixture {
+  MomentumObserverFixture() {
+    model.gravity = Vector3d (0., 0., -9.81);
+
+    Body link (1.5, Vector3d (0., 0., 0.15), Vector3d (0.01, 0.01, 0.002));
+    unsigned int id = model.AddBody (0, SpatialTransform(),
+        Joint (JointTypeRevoluteZ), link);
+    id = model.AddBody (id, Xtrans (Vector3d (0., 0., 0.3)),
+        Joint (JointTypeRevoluteY), link);
+    id = model.AddBody (id, Xtrans (Vector3d (0., 0., 0.3)),
+        Joint (JointTypeRevoluteY), link);
+    tip_id = model.AddBody (id, Xtrans (Vector3d (0., 0., 0.3)),
+        Joint (JointTypeRevoluteX), link);
+    tip_point = Vector3d (0., 0., 0.3);
+
+    q = VectorNd::Zero (model.q_size);
+    qdot = VectorNd::Zero (model.qdot_size);
+    qddot = VectorNd::Zero (model.qdot_size);
+    tau = VectorNd::Zero (model.qdot_size);
+    f_ext.assign (model.mBodies.size(), SpatialVector::Zero());
+  }
+
+  /// Gravity compensated PD control to a moving target.
+  void Control (double t, double amplitude = 0.4) {
+    NonlinearEffects (model, q, VectorNd::Zero (model.qdot_size), tau);
+    for (unsigned int i = 0; i < model.qdot_size; i++) {
+      double target = amplitude * sin (1.5 * t + i);
+      tau[i] += 100. * (target - q[i]) - 10. * qdot[i];
+    }
+  }
+
+  /// Applies force at the tip and integrates one step.
+  void Step (const Vector3d &force, double dt) {
+    Vector3d point = CalcBodyToBaseCoordinates (model, q, tip_id, tip_point);
+    f_ext[tip_id].head<3>() = point.cross (force);
+    f_ext[tip_id].tail<3>() = force;
+
+    ForwardDynamics (model, q, qdot, tau, qddot, &f_ext);
+    qdot += dt * qddot;
+    q += dt * qdot;
+  }
+
+  /// External joint forces of force at the tip.
+  VectorNd ExternalTorques (const Vector3d &force) {
+    MatrixNd G (MatrixNd::Zero (3, model.qdot_size));
+    CalcPointJacobian (model, q, tip_id, tip_point, G);
+    return G.transpose() * force;
+  }
+
+  Model model;
+  unsigned int tip_id;
+  Vector3d tip_point;
+  VectorNd q;
+  VectorNd qdot;
+  VectorNd qddot;
+  VectorNd tau;
+  vector<SpatialVector> f_ext;
+};
+
+TEST_FIXTURE ( MomentumObserverFixture, TestMomentumObserverExternalForce ) {
+  q << 0.1, 0.3, -0.2, 0.1;
+  qdot << 0.2, -0.1, 0.3, 0.;
+
+  MomentumObserver observer;
+  observer.gain = 500.;
+  observer.threshold = 1.;
+  observer.Init (model, q, qdot);
+
+  // free motion, the residual stays at zero
+  double dt = 1.0e-4;
+  Vector3d force (10., -5., 8.);
+  unsigned int num_steps = 10000;
+  unsigned int contact_step = 5000;
+  for (unsigned int k = 0; k < num_steps; k++) {
+    // the target stops moving at the contact
+    Control (min (k, contact_step) * dt);
+    if (k < contact_step) {
+      Step (Vector3d::Zero(), dt);
+    } else {
+      Step (force, dt);
+    }
+    // observer uses the commanded torques of the step that led to q, qdot
+    observer.Update (model, q, qdot, tau, dt);
+
+    if (k == contact_step - 1) {
+      CHECK (observer.residual.norm() < 1.0e-2);
+      CHECK (!observer.collision);
+    }
+  }
+
+  // the residual converges to J^T f
+  VectorNd external = ExternalTorques (force);
+  CHECK_ARRAY_CLOSE (external.data(), observer.residual.data(),
+      external.size(), 1.0e-2);
+  CHECK (observer.collision);
+
+  Vector3d force_estimate;
+  observer.EstimateContactForce (model, q, tip_id, tip_point,
+      force_estimate);
+  CHECK_ARRAY_CLOSE (force.data(), force_estimate.data(), 3, 5.0e-2);
+
+  // the last three joints suffice
+  observer.EstimateContactForce (model, q, tip_id, tip_point,
+      force_estimate, false, 1);
+  CHECK_ARRAY_CLOSE (force.data(), force_estimate.data(), 3, 5.0e-2);
+
+  MatrixNd M (MatrixNd::Zero (model.qdot_size, model.qdot_size));
+  CompositeRigidBodyAlgorithm (model, q, M);
+  VectorNd momentum = M * qdot;
+  CHECK_ARRAY_CLOSE (momentum.data(), observer.momentum.data(),
+      momentum.size(), 1.0e-10);
+
+  CHECK (observer.update_time > 0.);
+  CHECK (observer.max_update_time >= observer.update_time);
+}
+
+TEST_FIXTURE ( MomentumObserverFixture, TestMomentumObserverCollisionJoints ) {
+  MomentumObserver observer;
+  observer.gain = 50.;
+  observer.threshold = 2.;
+  observer.Init (model, q, qdot);
+
+  // a push along x on the tip of the upright arm only loads the pitch
+  // joints
+  double dt = 1.0e-4;
+  Vector3d force (20., 0., 0.);
+  for (unsigned int k = 0; k < 3000; k++) {
+    Control (0., 0.);
+    Step (force, dt);
+    observer.Update (model, q, qdot, tau, dt);
+  }
+
+  CHECK (observer.collision);
+  CHECK (!observer.exceeded[0]);
+  CHECK (observer.exceeded[1]);
+  CHECK (observer.exceeded[2]);
+  CHECK (!observer.exceeded[3]);
+}
@@ -0,0 +1,220 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : locomotion
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <UnitTest++.h>
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "rbdl/rbdl.h"
+
+#include "ZMPPreviewControl.h"
+
+using namespace std;
+using namespace RigidBodyDynamics;
+using namespace RigidBodyDynamics::Math;
+using namespace RigidBodyDynamics::Addons::Locomotion;
+
+TEST ( TestZMPPreviewGainsCompute ) {
+  ZMPPreviewGains gains;
+  CHECK (gains.Compute());
+
+  CHECK_EQUAL (1600u, gains.GetNumPreviewSteps());
+
+  // the closed loop is stable
+  Matrix3d A_closed = gains.A - gains.B * gains.state_gain.transpose();
+  Matrix3d A_power = Matrix3d::Identity();
+  for (unsigned int i = 0; i < 10000; i++) {
+    A_power = A_closed * A_power;
+  }
+  CHECK (A_power.norm() < 1.0e-3);
+
+  // a constant reference is held by the state at rest: the preview gains
+  // sum up to the position gain
+  CHECK_CLOSE (gains.state_gain[0], gains.preview_gains.sum(),
+      1.0e-8 * gains.state_gain[0]);
+
+  // the gains decay over the preview window
+  CHECK (fabs (gains.preview_gains[gains.GetNumPreviewSteps() - 2])
+      < 0.001 * fabs (gains.preview_gains[0]));
+}
+
+TEST ( TestZMPPreviewGainsCache ) {
+  const char *filename = "testZMPPreviewGains.bin";
+  remove (filename);
+
+  ZMPPreviewGains gains;
+  gains.sample_time = 0.005;
+  gains.com_height = 0.7;
+  CHECK (gains.LoadOrCompute (filename));
+
+  // the cache is used for the same settings
+  ZMPPreviewGains cached;
+  cached.sample_time = 0.005;
+  cached.com_height = 0.7;
+  CHECK (cached.Load (filename));
+  cached.preview_gains[0] += 1.;
+  CHECK (cached.Save (filename));
+
+  ZMPPreviewGains loaded;
+  loaded.sample_time = 0.005;
+  loaded.com_height = 0.7;
+  CHECK (loaded.LoadOrCompute (filename));
+  CHECK_EQUAL (gains.GetNumPreviewSteps(), loaded.GetNumPreviewSteps());
+  CHECK_CLOSE (gains.preview_gains[0] + 1., loaded.preview_gains[0],
+      1.0e-12);
+  CHECK_ARRAY_CLOSE (gains.state_gain.data(), loaded.state_gain.data(), 3,
+      1.0e-12);
+  CHECK_ARRAY_CLOSE (gains.C.data(), loaded.C.data(), 3, 1.0e-12);
+
+  // other settings recompute and replace the cache
+  ZMPPreviewGains other;
+  other.sample_time = 0.005;
+  other.com_height = 0.9;
+  CHECK (other.LoadOrCompute (filename));
+  CHECK (fabs (other.state_gain[0] - gains.state_gain[0]) > 1.);
+
+  ZMPPreviewGains replaced;
+  CHECK (replaced.Load (filename));
+  CHECK_EQUAL (0.9, replaced.com_height);
+  CHECK_ARRAY_CLOSE (other.preview_gains.data(),
+      replaced.preview_gains.data(), other.GetNumPreviewSteps(), 1.0e-12);
+
+  remove (filename);
+
+  CHECK (!replaced.Load ("testZMPPreviewGains_missing.bin"));
+}
+
+TEST ( TestWalkingPatternGeneratorStanding ) {
+  ZMPPreviewGains gains;
+  gains.sample_time = 0.005;
+  CHECK (gains.Compute());
+
+  WalkingPatternGenerator walking;
+  walking.Init (gains, Vector3d (0.02, 0.1, 0.), Vector3d (0.02, -0.1, 0.));
+
+  for (unsigned int i = 0; i < 400; i++) {
+    walking.Step();
+  }
+
+  CHECK (walking.IsFinished());
+  CHECK_ARRAY_CLOSE (Vector3d (0.02, 0., 0.8).data(),
+      walking.com_position.data(), 3, 1.0e-9);
+  CHECK (walking.com_velocity.norm() < 1.0e-9);
+}
+
+TEST ( TestWalkingPatternGeneratorWalk ) {
+  ZMPPreviewGains gains;
+  CHECK (gains.Compute());
+
+  Vector3d left_start (0., 0.105, 0.);
+  Vector3d right_start (0., -0.105, 0.);
+
+  WalkingPatternGenerator walking;
+  walking.Init (gains, left_start, right_start);
+
+  vector<Footstep> footsteps;
+  footsteps.push_back (Footstep (Vector3d (0.1, 0.105, 0.), true));
+  footsteps.push_back (Footstep (Vector3d (0.3, -0.105, 0.), false));
+  footsteps.push_back (Footstep (Vector3d (0.5, 0.105, 0.), true));
+  footsteps.push_back (Footstep (Vector3d (0.5, -0.105, 0.), false));
+  walking.SetFootsteps (footsteps, 0.5);
+
+  // the ZMP reference is at the support foot during single support
+  Vector3d zmp_reference;
+  Vector3d left_foot, right_foot;
+  walking.EvaluatePlan (1000, zmp_reference, &left_foot, &right_foot);
+  CHECK_ARRAY_CLOSE (right_start.data(), zmp_reference.data(), 3, 1.0e-12);
+  CHECK_ARRAY_CLOSE (right_start.data(), right_foot.data(), 3, 1.0e-12);
+  CHECK (left_foot[0] > 0. && left_foot[0] < 0.1);
+  CHECK (left_foot[2] > 0.);
+
+  double max_zmp_error = 0.;
+  double max_left_height = 0.;
+  double min_com_y = 0.;
+  unsigned int num_samples = 0;
+
+  while (!walking.IsFinished() && num_samples < 10000) {
+    walking.Step();
+    num_samples++;
+
+    max_zmp_error = max (max_zmp_error,
+        (walking.zmp - walking.zmp_reference).norm());
+    max_left_height = max (max_left_height, walking.left_foot[2]);
+    min_com_y = min (min_com_y, walking.com_position[1]);
+
+    // the feet never leave the plan
+    CHECK (walking.right_foot[2] >= 0. && walking.left_foot[2] >= 0.);
+  }
+
+  // 0.5 s delay, 4 steps and the final double support
+  CHECK_EQUAL (3900u, num_samples);
+
+  // the cart-table ZMP follows the reference closely
+  CHECK (max_zmp_error < 0.03);
+  CHECK_CLOSE (walking.step_height, max_left_height, 1.0e-4);
+  // the center of mass shifts over the right foot for the first step
+  CHECK (min_com_y < -0.02);
+
+  CHECK_ARRAY_CLOSE (footsteps[2].position.data(), walking.left_foot.data(),
+      3, 1.0e-12);
+  CHECK_ARRAY_CLOSE (footsteps[3].position.data(), walking.right_foot.data(),
+      3, 1.0e-12);
+
+  // the center of mass comes to rest above the middle of the feet
+  for (unsigned int i = 0; i < 2000; i++) {
+    walking.Step();
+  }
+  CHECK_ARRAY_CLOSE (Vector3d (0.5, 0., 0.8).data(),
+      walking.com_position.data(), 3, 0.005);
+  CHECK (walking.com_velocity.norm() < 0.01);
+}
+
+TEST ( TestWalkingPlanCopy ) {
+  ZMPPreviewGains gains;
+  gains.sample_time = 0.005;
+  CHECK (gains.Compute());
+
+  WalkingPatternGenerator walking;
+  walking.Init (gains, Vector3d (0., 0.105, 0.), Vector3d (0., -0.105, 0.));
+
+  vector<Footstep> footsteps;
+  footsteps.push_back (Footstep (Vector3d (0.2, -0.105, 0.), false));
+  footsteps.push_back (Footstep (Vector3d (0.4, 0.105, 0.), true));
+  footsteps.push_back (Footstep (Vector3d (0.4, -0.105, 0.), false));
+  walking.SetFootsteps (footsteps, 0.2);
+
+  WalkingPlan plan = walking.GetPlan();
+  for (unsigned int i = 0; i < 100; i++) {
+    walking.Step();
+  }
+  // 0.2 s delay, 3 steps and the final double support
+  CHECK_EQUAL (560, plan.GetEndSample());
+
+  for (long sample = 0; sample < plan.GetEndSample() + 50; sample += 7) {
+    Vector3d zmp, left_foot, right_foot;
+    Vector3d plan_zmp, plan_left_foot, plan_right_foot;
+    walking.EvaluatePlan (sample, zmp, &left_foot, &right_foot);
+    plan.Evaluate (sample, plan_zmp, &plan_left_foot, &plan_right_foot);
+    CHECK_ARRAY_EQUAL (zmp.data(), plan_zmp.data(), 3);
+    CHECK_ARRAY_EQUAL (left_foot.data(), plan_left_foot.data(), 3);
+    CHECK_ARRAY_EQUAL (right_foot.data(), plan_right_foot.data(), 3);
+
+    bool left_contact, right_contact;
+    bool plan_left_contact, plan_right_contact;
+    walking.EvaluateSupport (sample, left_contact, right_contact);
+    plan.EvaluateSupport (sample, plan_left_contact, plan_right_contact);
+    CHECK_EQUAL (left_contact, plan_left_contact);
+    CHECK_EQUAL (right_contact, plan_right_contact);
+  }
+}
+
+int main (int argc, char *argv[])
+{
+    return UnitTest::RunAllTests ();
+}
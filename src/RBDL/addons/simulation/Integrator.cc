@@ -0,0 +1,191 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : simulation
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <cassert>
+#include <cmath>
+#include <iostream>
+
+#include <rbdl/rbdl.h>
+
+#include "Integrator.h"
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Simulation {
+
+using namespace Math;
+
+Integrator::Integrator (IntegratorType integrator_type) :
+  type (integrator_type),
+  verlet_iterations (1),
+  num_steps (0),
+  bound (false) {
+}
+
+bool Integrator::Bind (const Model &model) {
+  // RK4 needs all four stages, the other schemes only use the first one
+  qddot.assign (4, VectorNd::Zero (model.qdot_size));
+  qdot.assign (4, VectorNd::Zero (model.qdot_size));
+  q_stage = VectorNd::Zero (model.q_size);
+  qdot_stage = VectorNd::Zero (model.qdot_size);
+
+  num_steps = 0;
+  bound = true;
+
+  return bound;
+}
+
+RBDL_DLLAPI
+void IntegrateQ (
+  const Model &model,
+  const VectorNd &Q,
+  const VectorNd &QDot,
+  double dt,
+  VectorNd &QNext) {
+  assert (Q.size() == model.q_size);
+  assert (QDot.size() == model.qdot_size);
+
+  if (&QNext != &Q) {
+    QNext = Q;
+  }
+
+  for (unsigned int i = 1; i < model.mJoints.size(); i++) {
+    unsigned int q_index = model.mJoints[i].q_index;
+
+    if (model.mJoints[i].mJointType == JointTypeSpherical) {
+      // QDot holds the angular velocity in the joint frame, hence the
+      // rotation increment is applied from the right.
+      Vector3d omega (QDot[q_index], QDot[q_index + 1], QDot[q_index + 2]);
+      double omega_norm = omega.norm();
+      double half_angle = 0.5 * dt * omega_norm;
+
+      // sin(half_angle) / omega_norm with a series expansion near zero
+      double s = 0.5 * dt * (1. - half_angle * half_angle / 6.);
+      if (half_angle > 1.0e-6) {
+        s = sin (half_angle) / omega_norm;
+      }
+
+      Quaternion delta (omega[0] * s, omega[1] * s, omega[2] * s,
+          cos (half_angle));
+      Quaternion quat = model.GetQuaternion (i, QNext) * delta;
+      model.SetQuaternion (i, Quaternion (quat / quat.norm()), QNext);
+    } else {
+      for (unsigned int j = 0; j < model.mJoints[i].mDoFCount; j++) {
+        QNext[q_index + j] += dt * QDot[q_index + j];
+      }
+    }
+  }
+}
+
+RBDL_DLLAPI
+void NormalizeQuaternions (
+  const Model &model,
+  VectorNd &Q) {
+  for (unsigned int i = 1; i < model.mJoints.size(); i++) {
+    if (model.mJoints[i].mJointType == JointTypeSpherical) {
+      Quaternion quat = model.GetQuaternion (i, Q);
+      model.SetQuaternion (i, Quaternion (quat / quat.norm()), Q);
+    }
+  }
+}
+
+RBDL_DLLAPI
+void SimulationStep (
+  Model &model,
+  Integrator &integrator,
+  VectorNd &Q,
+  VectorNd &QDot,
+  const VectorNd &Tau,
+  double dt,
+  std::vector<SpatialVector> *f_ext) {
+  assert (integrator.bound);
+  assert (integrator.q_stage.size() == model.q_size);
+
+  std::vector<VectorNd> &k_qddot = integrator.qddot;
+  std::vector<VectorNd> &k_qdot = integrator.qdot;
+
+  switch (integrator.type) {
+    case IntegratorTypeSemiImplicitEuler:
+      ForwardDynamics (model, Q, QDot, Tau, k_qddot[0], f_ext);
+      QDot += dt * k_qddot[0];
+      IntegrateQ (model, Q, QDot, dt, Q);
+      break;
+
+    case IntegratorTypeRungeKutta4:
+      ForwardDynamics (model, Q, QDot, Tau, k_qddot[0], f_ext);
+      k_qdot[0] = QDot;
+
+      k_qdot[1] = QDot + (0.5 * dt) * k_qddot[0];
+      IntegrateQ (model, Q, k_qdot[0], 0.5 * dt, integrator.q_stage);
+      ForwardDynamics (model, integrator.q_stage, k_qdot[1], Tau, k_qddot[1],
+          f_ext);
+
+      k_qdot[2] = QDot + (0.5 * dt) * k_qddot[1];
+      IntegrateQ (model, Q, k_qdot[1], 0.5 * dt, integrator.q_stage);
+      ForwardDynamics (model, integrator.q_stage, k_qdot[2], Tau, k_qddot[2],
+          f_ext);
+
+      k_qdot[3] = QDot + dt * k_qddot[2];
+      IntegrateQ (model, Q, k_qdot[2], dt, integrator.q_stage);
+      ForwardDynamics (model, integrator.q_stage, k_qdot[3], Tau, k_qddot[3],
+          f_ext);
+
+      integrator.qdot_stage = (1. / 6.) * (k_qdot[0] + 2. * k_qdot[1]
+          + 2. * k_qdot[2] + k_qdot[3]);
+      IntegrateQ (model, Q, integrator.qdot_stage, dt, Q);
+      QDot += (dt / 6.) * (k_qddot[0] + 2. * k_qddot[1] + 2. * k_qddot[2]
+          + k_qddot[3]);
+      break;
+
+    case IntegratorTypeVerlet:
+      // half step of the velocities, full step of the positions
+      ForwardDynamics (model, Q, QDot, Tau, k_qddot[0], f_ext);
+      k_qdot[0] = QDot + (0.5 * dt) * k_qddot[0];
+      IntegrateQ (model, Q, k_qdot[0], dt, Q);
+
+      // second half step of the velocities which is implicit in QDot for
+      // velocity dependent forces (e.g. the Coriolis forces of articulated
+      // models). Starting the iteration from the half step velocity would
+      // make the scheme first order for them.
+      QDot = k_qdot[0] + (0.5 * dt) * k_qddot[0];
+      for (unsigned int j = 0; j < integrator.verlet_iterations; j++) {
+        ForwardDynamics (model, Q, QDot, Tau, k_qddot[1], f_ext);
+        QDot = k_qdot[0] + (0.5 * dt) * k_qddot[1];
+      }
+      break;
+
+    default:
+      std::cerr << "Error: invalid integrator type!" << std::endl;
+      assert (0);
+      abort();
+  }
+
+  integrator.num_steps++;
+}
+
+RBDL_DLLAPI
+void SimulationSteps (
+  Model &model,
+  Integrator &integrator,
+  VectorNd &Q,
+  VectorNd &QDot,
+  const VectorNd &Tau,
+  double dt,
+  unsigned int num_steps,
+  std::vector<SpatialVector> *f_ext) {
+  for (unsigned int i = 0; i < num_steps; i++) {
+    SimulationStep (model, integrator, Q, QDot, Tau, dt, f_ext);
+  }
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,181 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : simulation
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_SIMULATION_INTEGRATOR_H
+#define RBDL_SIMULATION_INTEGRATOR_H
+
+#include <vector>
+
+#include <rbdl/rbdl_math.h>
+
+namespace RigidBodyDynamics {
+
+struct Model;
+
+namespace Addons {
+
+namespace Simulation {
+
+/** \page addon_simulation_page Addon: rbdl_simulation
+ *
+ * The simulation addon provides time-stepping integrators on top of
+ * ForwardDynamics().
+ *
+ * Joint positions of models with \ref joint_singularities "spherical
+ * joints" (and therefore also JointTypeFloatingBase) do not live in a
+ * vector space: the quaternion of such a joint has to stay normalized and
+ * the corresponding entries of QDot are angular velocities and not the
+ * derivatives of the quaternion coefficients. IntegrateQ() therefore
+ * advances the quaternions on the rotation group with the exponential map
+ * and all other coordinates with a plain Euler update. All integrators of
+ * this addon use IntegrateQ() for every position update.
+ *
+ * All memory is allocated when the Integrator is bound to a model such
+ * that SimulationStep() and SimulationSteps() do not allocate.
+ *
+ * \code
+ * Integrator integrator (IntegratorTypeRungeKutta4);
+ * integrator.Bind (model);
+ *
+ * // advance 100 steps of 1 ms
+ * SimulationSteps (model, integrator, Q, QDot, Tau, 1.0e-3, 100);
+ * \endcode
+ */
+
+/// \brief Available time-stepping schemes.
+enum IntegratorType {
+  /// First order symplectic (semi-implicit) Euler: velocities first, then
+  /// positions with the new velocities. One ForwardDynamics() call per step.
+  IntegratorTypeSemiImplicitEuler = 0,
+  /// Classical fourth order Runge-Kutta, with the position stages computed
+  /// on the rotation group. Four ForwardDynamics() calls per step.
+  IntegratorTypeRungeKutta4,
+  /// Second order Stoermer-Verlet (velocity Verlet) scheme. It is only
+  /// symplectic for a constant mass matrix (e.g. a single body). For
+  /// articulated models M(q) depends on q, so the energy error slowly
+  /// drifts instead of staying bounded. 1 + verlet_iterations
+  /// ForwardDynamics() calls per step.
+  IntegratorTypeVerlet
+};
+
+/** \brief Integrator settings and preallocated workspace.
+ */
+struct RBDL_DLLAPI Integrator {
+  Integrator (IntegratorType integrator_type = IntegratorTypeSemiImplicitEuler);
+
+  /** \brief Allocates the workspace for the given model.
+   *
+   * Must be called before the first step and again when the integrator is
+   * used with a model of a different size.
+   */
+  bool Bind (const Model &model);
+
+  /// The time-stepping scheme.
+  IntegratorType type;
+  /// Fixed-point iterations of the implicit velocity update of the Verlet
+  /// scheme (default: 1). The iteration starts from the velocity
+  /// extrapolated with the accelerations at the start of the step, so a
+  /// single iteration is second order also for velocity dependent forces.
+  unsigned int verlet_iterations;
+
+  /// Number of steps performed since the last Bind().
+  unsigned int num_steps;
+
+  // Workspace
+
+  /// Accelerations of the stages (one for Euler and Verlet, four for RK4).
+  std::vector<Math::VectorNd> qddot;
+  /// Velocities of the stages.
+  std::vector<Math::VectorNd> qdot;
+  /// Positions of the current stage.
+  Math::VectorNd q_stage;
+  /// Velocities of the current stage.
+  Math::VectorNd qdot_stage;
+
+  bool bound;
+};
+
+/** \brief Advances the joint positions with the given velocities.
+ *
+ * Computes QNext = Q (+) dt * QDot where (+) is the ordinary addition for
+ * all coordinates except for spherical joints. Their quaternions are
+ * rotated by the exponential map of the (body-fixed) angular velocity
+ * which keeps them normalized.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the internal joints
+ * \param QDot  velocity vector of the internal joints
+ * \param dt    length of the time step
+ * \param QNext (output) new state vector, may be the same object as Q
+ */
+RBDL_DLLAPI
+void IntegrateQ (
+  const Model &model,
+  const Math::VectorNd &Q,
+  const Math::VectorNd &QDot,
+  double dt,
+  Math::VectorNd &QNext
+);
+
+/** \brief Normalizes the quaternions of all spherical joints in Q.
+ *
+ * Useful for states that were modified by other means than IntegrateQ(),
+ * e.g. by interpolation.
+ */
+RBDL_DLLAPI
+void NormalizeQuaternions (
+  const Model &model,
+  Math::VectorNd &Q
+);
+
+/** \brief Performs a single time step with constant actuation.
+ *
+ * \param model rigid body model
+ * \param integrator bound integrator
+ * \param Q     (input/output) state vector of the internal joints
+ * \param QDot  (input/output) velocity vector of the internal joints
+ * \param Tau   actuations of the internal joints (constant over the step)
+ * \param dt    length of the time step
+ * \param f_ext External forces acting on the body in base coordinates
+ *        (optional, defaults to NULL)
+ */
+RBDL_DLLAPI
+void SimulationStep (
+  Model &model,
+  Integrator &integrator,
+  Math::VectorNd &Q,
+  Math::VectorNd &QDot,
+  const Math::VectorNd &Tau,
+  double dt,
+  std::vector<Math::SpatialVector> *f_ext = NULL
+);
+
+/** \brief Performs num_steps time steps with constant actuation.
+ *
+ * Equivalent to calling SimulationStep() num_steps times but avoids the
+ * per call overhead for long rollouts.
+ */
+RBDL_DLLAPI
+void SimulationSteps (
+  Model &model,
+  Integrator &integrator,
+  Math::VectorNd &Q,
+  Math::VectorNd &QDot,
+  const Math::VectorNd &Tau,
+  double dt,
+  unsigned int num_steps,
+  std::vector<Math::SpatialVector> *f_ext = NULL
+);
+
+}
+
+}
+
+}
+
+/* RBDL_SIMULATION_INTEGRATOR_H */
+#endif
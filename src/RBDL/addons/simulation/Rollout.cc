@@ -0,0 +1,148 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : simulation
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <cassert>
+#include <iostream>
+
+#include <rbdl/rbdl.h>
+
+#include "Rollout.h"
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Simulation {
+
+using namespace Math;
+
+RolloutEngine::RolloutEngine (const Model &model, unsigned int num_threads) :
+  integrator_type (IntegratorTypeSemiImplicitEuler),
+  dt (1.0e-3),
+  num_steps (1),
+  record_trajectories (false),
+  pool (num_threads) {
+  if (!model.mCustomJoints.empty()) {
+    std::cerr << "Error: RolloutEngine does not support models with "
+      << "custom joints (the thread copies would share them)." << std::endl;
+    assert (0);
+    abort();
+  }
+
+  workspaces.resize (pool.GetNumThreads());
+
+  for (unsigned int i = 0; i < workspaces.size(); i++) {
+    ThreadWorkspace &ws = workspaces[i];
+    ws.model = model;
+    ws.q = VectorNd::Zero (model.q_size);
+    ws.qdot = VectorNd::Zero (model.qdot_size);
+    ws.tau = VectorNd::Zero (model.qdot_size);
+    ws.f_ext.assign (model.mBodies.size(), SpatialVector::Zero());
+  }
+}
+
+void RolloutEngine::Run (
+    const MatrixNd &Q0,
+    const MatrixNd &QDot0,
+    const MatrixNd &Tau) {
+  const Model &model = workspaces[0].model;
+  unsigned int num_rollouts = Q0.cols();
+
+  assert (Q0.rows() == model.q_size);
+  assert (QDot0.rows() == model.qdot_size);
+  assert (QDot0.cols() == num_rollouts);
+  assert (Tau.rows() == model.qdot_size);
+  assert (Tau.cols() == num_rollouts * num_steps);
+
+  if (Tau.cols() != num_rollouts * num_steps) {
+    std::cerr << "Error: expected " << num_rollouts * num_steps
+      << " actuation columns for the rollouts but got " << Tau.cols()
+      << "!" << std::endl;
+    abort();
+  }
+
+  final_q.resize (model.q_size, num_rollouts);
+  final_qdot.resize (model.qdot_size, num_rollouts);
+  costs.resize (num_rollouts);
+
+  if (record_trajectories) {
+    trajectory_q.resize (model.q_size, num_rollouts * (num_steps + 1));
+    trajectory_qdot.resize (model.qdot_size, num_rollouts * (num_steps + 1));
+  }
+
+  for (unsigned int i = 0; i < workspaces.size(); i++) {
+    workspaces[i].integrator.type = integrator_type;
+    if (!workspaces[i].integrator.bound) {
+      workspaces[i].integrator.Bind (workspaces[i].model);
+    }
+  }
+
+  pool.ParallelFor (0, num_rollouts,
+      [this, &Q0, &QDot0, &Tau] (unsigned int rollout,
+        unsigned int thread_id) {
+      RunSingle (rollout, thread_id, Q0, QDot0, Tau);
+      });
+}
+
+void RolloutEngine::RunSingle (
+    unsigned int rollout,
+    unsigned int thread_id,
+    const MatrixNd &Q0,
+    const MatrixNd &QDot0,
+    const MatrixNd &Tau) {
+  ThreadWorkspace &ws = workspaces[thread_id];
+
+  ws.q = Q0.col (rollout);
+  ws.qdot = QDot0.col (rollout);
+
+  unsigned int trajectory_offset = rollout * (num_steps + 1);
+  if (record_trajectories) {
+    trajectory_q.col (trajectory_offset) = ws.q;
+    trajectory_qdot.col (trajectory_offset) = ws.qdot;
+  }
+
+  double cost = 0.;
+
+  for (unsigned int k = 0; k < num_steps; k++) {
+    ws.tau = Tau.col (rollout * num_steps + k);
+
+    if (stage_cost) {
+      cost += stage_cost (k, ws.q, ws.qdot, ws.tau);
+    }
+
+    std::vector<SpatialVector> *f_ext = NULL;
+    if (external_forces) {
+      for (unsigned int i = 0; i < ws.f_ext.size(); i++) {
+        ws.f_ext[i].setZero();
+      }
+      external_forces (ws.model, k, ws.q, ws.qdot, ws.f_ext);
+      f_ext = &ws.f_ext;
+    }
+
+    SimulationStep (ws.model, ws.integrator, ws.q, ws.qdot, ws.tau, dt,
+        f_ext);
+
+    if (record_trajectories) {
+      trajectory_q.col (trajectory_offset + k + 1) = ws.q;
+      trajectory_qdot.col (trajectory_offset + k + 1) = ws.qdot;
+    }
+  }
+
+  if (terminal_cost) {
+    cost += terminal_cost (ws.q, ws.qdot);
+  }
+
+  final_q.col (rollout) = ws.q;
+  final_qdot.col (rollout) = ws.qdot;
+  costs[rollout] = cost;
+}
+
+}
+
+}
+
+}
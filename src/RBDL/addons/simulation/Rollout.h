@@ -0,0 +1,160 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : simulation
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_SIMULATION_ROLLOUT_H
+#define RBDL_SIMULATION_ROLLOUT_H
+
+#include <functional>
+#include <vector>
+
+#include <rbdl/rbdl_math.h>
+#include <rbdl/Model.h>
+#include <rbdl/ThreadPool.h>
+
+#include "Integrator.h"
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+namespace Simulation {
+
+/** \brief Running cost of a rollout.
+ *
+ * Called before each step with the current state and the actuation of the
+ * step.
+ */
+typedef std::function<double (
+    unsigned int step,
+    const Math::VectorNd &Q,
+    const Math::VectorNd &QDot,
+    const Math::VectorNd &Tau)> RolloutStageCost;
+
+/// \brief Cost of the final state of a rollout.
+typedef std::function<double (
+    const Math::VectorNd &Q,
+    const Math::VectorNd &QDot)> RolloutTerminalCost;
+
+/** \brief Computes external forces (e.g. ground contact) before each step.
+ *
+ * The model is the per-thread copy of the rollout engine and may be used
+ * for kinematic queries. f_ext is cleared before each call.
+ */
+typedef std::function<void (
+    Model &model,
+    unsigned int step,
+    const Math::VectorNd &Q,
+    const Math::VectorNd &QDot,
+    std::vector<Math::SpatialVector> &f_ext)> RolloutExternalForces;
+
+/** \brief Simulates batches of trajectories in parallel.
+ *
+ * Each rollout starts from its own initial state and applies its own
+ * sequence of actuations. The rollouts are distributed over a
+ * work-stealing ThreadPool and every thread uses its own copy of the
+ * Model and its own Integrator, so the model passed to the constructor is
+ * never modified.
+ *
+ * All inputs and outputs are stored in contiguous, column-major matrices
+ * with one column per state:
+ *
+ * - Q0: q_size x num_rollouts, QDot0: qdot_size x num_rollouts
+ * - Tau: qdot_size x (num_rollouts * num_steps), the actuation of step k
+ *   of rollout r is column r * num_steps + k
+ * - final_q, final_qdot: like Q0 and QDot0
+ * - trajectory_q, trajectory_qdot (if record_trajectories is set):
+ *   num_steps + 1 states per rollout, the state after step k of rollout r
+ *   is column r * (num_steps + 1) + k + 1
+ *
+ * \note The cost and external force callbacks are invoked concurrently
+ * from several threads and must therefore be thread-safe.
+ *
+ * \note Models with custom joints are not supported: the per-thread copies
+ * would share the CustomJoint objects of Model::mCustomJoints, which
+ * jcalc() writes to. The constructor aborts for such models.
+ */
+struct RBDL_DLLAPI RolloutEngine {
+  /** \param model the model that is copied for every thread
+   * \param num_threads number of threads (0: hardware concurrency)
+   */
+  RolloutEngine (const Model &model, unsigned int num_threads = 0);
+
+  /** \brief Simulates all rollouts.
+   *
+   * The number of rollouts is the number of columns of Q0.
+   */
+  void Run (
+      const Math::MatrixNd &Q0,
+      const Math::MatrixNd &QDot0,
+      const Math::MatrixNd &Tau);
+
+  /// \brief Number of threads used for the rollouts.
+  unsigned int GetNumThreads () const {
+    return pool.GetNumThreads();
+  }
+
+  // Settings
+
+  /// Integration scheme (default: IntegratorTypeSemiImplicitEuler).
+  IntegratorType integrator_type;
+  /// Length of each step.
+  double dt;
+  /// Number of steps per rollout.
+  unsigned int num_steps;
+  /// Whether all intermediate states are stored.
+  bool record_trajectories;
+  /// Optional running cost.
+  RolloutStageCost stage_cost;
+  /// Optional terminal cost.
+  RolloutTerminalCost terminal_cost;
+  /// Optional external forces.
+  RolloutExternalForces external_forces;
+
+  // Results
+
+  Math::MatrixNd final_q;
+  Math::MatrixNd final_qdot;
+  /// Accumulated stage and terminal cost of each rollout.
+  Math::VectorNd costs;
+  Math::MatrixNd trajectory_q;
+  Math::MatrixNd trajectory_qdot;
+
+  // Workspace
+
+  struct ThreadWorkspace {
+    Model model;
+    Integrator integrator;
+    Math::VectorNd q;
+    Math::VectorNd qdot;
+    Math::VectorNd tau;
+    std::vector<Math::SpatialVector> f_ext;
+  };
+
+  std::vector<ThreadWorkspace> workspaces;
+
+  ThreadPool pool;
+
+  private:
+    RolloutEngine (const RolloutEngine&);
+    RolloutEngine& operator= (const RolloutEngine&);
+
+    void RunSingle (
+        unsigned int rollout,
+        unsigned int thread_id,
+        const Math::MatrixNd &Q0,
+        const Math::MatrixNd &QDot0,
+        const Math::MatrixNd &Tau);
+};
+
+}
+
+}
+
+}
+
+/* RBDL_SIMULATION_ROLLOUT_H */
+#endif
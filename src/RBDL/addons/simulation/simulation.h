@@ -0,0 +1,14 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : simulation
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_SIMULATION_H
+#define RBDL_SIMULATION_H
+
+#include "Integrator.h"
+#include "Rollout.h"
+
+#endif
@@ -0,0 +1,328 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : simulation
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <UnitTest++.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "rbdl/rbdl.h"
+#include "rbdl/rbdl_utils.h"
+
+#include "Integrator.h"
+
+using namespace std;
+using namespace RigidBodyDynamics;
+using namespace RigidBodyDynamics::Math;
+using namespace RigidBodyDynamics::Addons::Simulation;
+
+const double TEST_PREC = 1.0e-12;
+
+struct FloatingBody {
+  FloatingBody () {
+    model = new Model;
+    model->gravity = Vector3d (0., 0., -9.81);
+
+    body_id = model->AddBody (0, SpatialTransform(),
+        Joint (JointTypeFloatingBase),
+        Body (1.5, Vector3d (0., 0., 0.), Vector3d (0.1, 0.2, 0.3)));
+
+    Q = VectorNd::Zero (model->q_size);
+    QDot = VectorNd::Zero (model->qdot_size);
+    Tau = VectorNd::Zero (model->qdot_size);
+
+    model->SetQuaternion (body_id,
+        Quaternion::fromZYXAngles (Vector3d (0.3, -0.2, 0.1)), Q);
+  }
+  ~FloatingBody () {
+    delete model;
+  }
+
+  Model *model;
+  unsigned int body_id;
+
+  VectorNd Q;
+  VectorNd QDot;
+  VectorNd Tau;
+};
+
+struct Pendulum {
+  Pendulum () {
+    model = new Model;
+    model->gravity = Vector3d (0., -9.81, 0.);
+
+    body_id = model->AddBody (0, SpatialTransform(),
+        Joint (JointTypeRevoluteZ),
+        Body (1., Vector3d (1., 0., 0.), Vector3d (0.01, 0.01, 0.01)));
+
+    Q = VectorNd::Zero (model->q_size);
+    QDot = VectorNd::Zero (model->qdot_size);
+    Tau = VectorNd::Zero (model->qdot_size);
+  }
+  ~Pendulum () {
+    delete model;
+  }
+
+  double CalcEnergy () {
+    return Utils::CalcKineticEnergy (*model, Q, QDot)
+      + Utils::CalcPotentialEnergy (*model, Q);
+  }
+
+  Model *model;
+  unsigned int body_id;
+
+  VectorNd Q;
+  VectorNd QDot;
+  VectorNd Tau;
+};
+
+struct TriplePendulum {
+  TriplePendulum () {
+    model = new Model;
+    model->gravity = Vector3d (0., -9.81, 0.);
+
+    unsigned int parent_id = 0;
+    for (unsigned int i = 0; i < 3; i++) {
+      parent_id = model->AddBody (parent_id,
+          i == 0 ? SpatialTransform() : Xtrans (Vector3d (1., 0., 0.)),
+          Joint (JointTypeRevoluteZ),
+          Body (1., Vector3d (0.5, 0., 0.), Vector3d (0.01, 0.01, 0.1)));
+    }
+
+    Q = VectorNd::Zero (model->q_size);
+    QDot = VectorNd::Zero (model->qdot_size);
+    Tau = VectorNd::Zero (model->qdot_size);
+
+    Q[0] = 0.5;
+    Q[1] = -0.3;
+    Q[2] = 0.8;
+  }
+  ~TriplePendulum () {
+    delete model;
+  }
+
+  double CalcEnergy () {
+    return Utils::CalcKineticEnergy (*model, Q, QDot)
+      + Utils::CalcPotentialEnergy (*model, Q);
+  }
+
+  /// Largest energy error when integrating for the given duration.
+  double CalcEnergyDrift (IntegratorType type, double dt, double duration) {
+    VectorNd Q0 (Q);
+    double energy_0 = CalcEnergy();
+    double drift = 0.;
+
+    Integrator integrator (type);
+    integrator.Bind (*model);
+    unsigned int num_steps = static_cast<unsigned int>(duration / dt + 0.5);
+    for (unsigned int i = 0; i < 100; i++) {
+      SimulationSteps (*model, integrator, Q, QDot, Tau, dt, num_steps / 100);
+      drift = std::max (drift, fabs (CalcEnergy() - energy_0));
+    }
+
+    Q = Q0;
+    QDot.setZero();
+    return drift;
+  }
+
+  Model *model;
+
+  VectorNd Q;
+  VectorNd QDot;
+  VectorNd Tau;
+};
+
+TEST_FIXTURE ( FloatingBody, TestIntegrateQMatchesPointVelocity ) {
+  QDot[0] = 0.1;
+  QDot[1] = 0.2;
+  QDot[2] = 0.3;
+  QDot[3] = 0.3;
+  QDot[4] = -0.5;
+  QDot[5] = 0.7;
+
+  Vector3d body_point (0.1, 0.2, 0.3);
+  Vector3d point_velocity = CalcPointVelocity (*model, Q, QDot, body_id,
+      body_point);
+  Vector3d point_position = CalcBodyToBaseCoordinates (*model, Q, body_id,
+      body_point);
+
+  double dt = 1.0e-7;
+  VectorNd QNext (Q);
+  IntegrateQ (*model, Q, QDot, dt, QNext);
+
+  Vector3d point_position_next = CalcBodyToBaseCoordinates (*model, QNext,
+      body_id, body_point);
+
+  CHECK_ARRAY_CLOSE (point_velocity.data(),
+      Vector3d ((point_position_next - point_position) / dt).data(), 3, 1.0e-6);
+  CHECK_CLOSE (1., model->GetQuaternion (body_id, QNext).norm(), TEST_PREC);
+}
+
+TEST_FIXTURE ( FloatingBody, TestIntegrateQInPlace ) {
+  QDot[3] = 1.;
+  QDot[4] = 2.;
+  QDot[5] = 3.;
+
+  VectorNd QNext (Q);
+  IntegrateQ (*model, Q, QDot, 0.1, QNext);
+  IntegrateQ (*model, Q, QDot, 0.1, Q);
+
+  CHECK_ARRAY_CLOSE (QNext.data(), Q.data(), model->q_size, TEST_PREC);
+}
+
+TEST_FIXTURE ( FloatingBody, TestIntegrateQConstantRotation ) {
+  // a constant angular velocity is integrated exactly, independent of the
+  // number of steps
+  QDot[3] = 1.;
+  QDot[4] = -2.;
+  QDot[5] = 0.5;
+
+  VectorNd QRef (Q);
+  IntegrateQ (*model, Q, QDot, 1., QRef);
+
+  for (unsigned int i = 0; i < 1000; i++) {
+    IntegrateQ (*model, Q, QDot, 1.0e-3, Q);
+  }
+
+  CHECK_ARRAY_CLOSE (QRef.data(), Q.data(), model->q_size, 1.0e-12);
+  CHECK_CLOSE (1., model->GetQuaternion (body_id, Q).norm(), TEST_PREC);
+}
+
+TEST_FIXTURE ( FloatingBody, TestSimulationBallistic ) {
+  QDot[0] = 1.;
+  QDot[2] = 2.;
+
+  double dt = 1.0e-2;
+  unsigned int num_steps = 50;
+  double t = dt * num_steps;
+
+  VectorNd Q0 (Q);
+  VectorNd QDot0 (QDot);
+
+  // RK4 and Verlet are exact for constant accelerations
+  Integrator rk4 (IntegratorTypeRungeKutta4);
+  rk4.Bind (*model);
+  SimulationSteps (*model, rk4, Q, QDot, Tau, dt, num_steps);
+
+  CHECK_EQUAL (num_steps, rk4.num_steps);
+  CHECK_CLOSE (t, Q[0], TEST_PREC);
+  CHECK_CLOSE (2. * t - 0.5 * 9.81 * t * t, Q[2], TEST_PREC);
+  CHECK_CLOSE (2. - 9.81 * t, QDot[2], TEST_PREC);
+  CHECK_ARRAY_CLOSE (Q0.data() + 3, Q.data() + 3, 4, TEST_PREC);
+
+  Q = Q0;
+  QDot = QDot0;
+  Integrator verlet (IntegratorTypeVerlet);
+  verlet.Bind (*model);
+  SimulationSteps (*model, verlet, Q, QDot, Tau, dt, num_steps);
+
+  CHECK_CLOSE (2. * t - 0.5 * 9.81 * t * t, Q[2], TEST_PREC);
+  CHECK_CLOSE (2. - 9.81 * t, QDot[2], TEST_PREC);
+
+  // semi-implicit Euler uses the new velocity for the position update
+  Q = Q0;
+  QDot = QDot0;
+  Integrator euler (IntegratorTypeSemiImplicitEuler);
+  euler.Bind (*model);
+  SimulationSteps (*model, euler, Q, QDot, Tau, dt, num_steps);
+
+  CHECK_CLOSE (2. * t - 9.81 * dt * dt * num_steps * (num_steps + 1) * 0.5,
+      Q[2], TEST_PREC);
+  CHECK_CLOSE (2. - 9.81 * t, QDot[2], TEST_PREC);
+}
+
+TEST_FIXTURE ( FloatingBody, TestSimulationTorqueFreeSpin ) {
+  // rotation about a principal axis keeps the angular velocity constant
+  model->gravity.setZero();
+  QDot[5] = 3.;
+
+  VectorNd QRef (Q);
+  IntegrateQ (*model, Q, QDot, 2., QRef);
+
+  Integrator rk4 (IntegratorTypeRungeKutta4);
+  rk4.Bind (*model);
+  SimulationSteps (*model, rk4, Q, QDot, Tau, 1.0e-2, 200);
+
+  CHECK_ARRAY_CLOSE (QRef.data(), Q.data(), model->q_size, 1.0e-10);
+  CHECK_CLOSE (3., QDot[5], 1.0e-10);
+}
+
+TEST_FIXTURE ( Pendulum, TestSimulationStepsMatchesSteps ) {
+  Q[0] = 0.5;
+  VectorNd Q0 (Q);
+
+  Integrator integrator (IntegratorTypeVerlet);
+  integrator.Bind (*model);
+
+  for (unsigned int i = 0; i < 10; i++) {
+    SimulationStep (*model, integrator, Q, QDot, Tau, 1.0e-3);
+  }
+
+  VectorNd Q_steps (Q0);
+  VectorNd QDot_steps (VectorNd::Zero (model->qdot_size));
+  SimulationSteps (*model, integrator, Q_steps, QDot_steps, Tau, 1.0e-3, 10);
+
+  CHECK_EQUAL (20u, integrator.num_steps);
+  CHECK_ARRAY_CLOSE (Q.data(), Q_steps.data(), 1, TEST_PREC);
+  CHECK_ARRAY_CLOSE (QDot.data(), QDot_steps.data(), 1, TEST_PREC);
+}
+
+TEST_FIXTURE ( Pendulum, TestSimulationEnergyConservation ) {
+  Q[0] = 0.5;
+  VectorNd Q0 (Q);
+  double energy_0 = CalcEnergy();
+
+  double dt = 1.0e-3;
+  unsigned int num_steps = 10000;
+
+  Integrator rk4 (IntegratorTypeRungeKutta4);
+  rk4.Bind (*model);
+  SimulationSteps (*model, rk4, Q, QDot, Tau, dt, num_steps);
+  CHECK_CLOSE (energy_0, CalcEnergy(), 1.0e-9);
+
+  // the symplectic schemes have a bounded energy error
+  Q = Q0;
+  QDot.setZero();
+  Integrator verlet (IntegratorTypeVerlet);
+  verlet.Bind (*model);
+  SimulationSteps (*model, verlet, Q, QDot, Tau, dt, num_steps);
+  CHECK_CLOSE (energy_0, CalcEnergy(), 1.0e-5);
+
+  Q = Q0;
+  QDot.setZero();
+  Integrator euler (IntegratorTypeSemiImplicitEuler);
+  euler.Bind (*model);
+  SimulationSteps (*model, euler, Q, QDot, Tau, dt, num_steps);
+  CHECK_CLOSE (energy_0, CalcEnergy(), 5.0e-2);
+}
+
+TEST_FIXTURE ( TriplePendulum, TestSimulationEnergyDriftChain ) {
+  // the mass matrix depends on q and the Coriolis forces on QDot: the
+  // energy error (initial energy 18.8) of the Verlet scheme drifts slowly
+  // but stays far below the one of the first order scheme
+  double dt = 1.0e-3;
+  double duration = 10.;
+
+  CHECK (CalcEnergyDrift (IntegratorTypeRungeKutta4, dt, duration) < 1.0e-5);
+
+  double verlet_drift = CalcEnergyDrift (IntegratorTypeVerlet, dt, duration);
+  CHECK (verlet_drift < 5.0e-2);
+
+  double euler_drift = CalcEnergyDrift (IntegratorTypeSemiImplicitEuler, dt,
+      duration);
+  CHECK (verlet_drift < 0.1 * euler_drift);
+
+  // second order: halving the time step reduces the drift
+  CHECK (CalcEnergyDrift (IntegratorTypeVerlet, 0.5 * dt, duration)
+      < 0.5 * verlet_drift);
+}
+
+int main (int argc, char *argv[])
+{
+    return UnitTest::RunAllTests ();
+}
@@ -0,0 +1,145 @@
+/*
+ * RBDL - Rigid Body Dynamics Library: Addon : simulation
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <UnitTest++.h>
+
+#include <cmath>
+#include <iostream>
+
+#include "rbdl/rbdl.h"
+
+#include "Integrator.h"
+#include "Rollout.h"
+
+using namespace std;
+using namespace RigidBodyDynamics;
+using namespace RigidBodyDynamics::Math;
+using namespace RigidBodyDynamics::Addons::Simulation;
+
+const double TEST_PREC = 1.0e-12;
+
+struct DoublePendulumRollouts {
+  DoublePendulumRollouts () {
+    model = new Model;
+    model->gravity = Vector3d (0., -9.81, 0.);
+
+    Body body (1., Vector3d (0.5, 0., 0.), Vector3d (0.01, 0.01, 0.01));
+    unsigned int body_1 = model->AddBody (0, SpatialTransform(),
+        Joint (JointTypeRevoluteZ), body);
+    model->AddBody (body_1, Xtrans (Vector3d (1., 0., 0.)),
+        Joint (JointTypeRevoluteZ), body);
+
+    num_rollouts = 13;
+    num_steps = 20;
+
+    Q0 = MatrixNd::Zero (model->q_size, num_rollouts);
+    QDot0 = MatrixNd::Zero (model->qdot_size, num_rollouts);
+    Tau = MatrixNd::Zero (model->qdot_size, num_rollouts * num_steps);
+
+    for (unsigned int r = 0; r < num_rollouts; r++) {
+      Q0(0, r) = 0.1 * r;
+      Q0(1, r) = -0.05 * r;
+      QDot0(0, r) = 0.2;
+
+      for (unsigned int k = 0; k < num_steps; k++) {
+        Tau(0, r * num_steps + k) = sin (0.1 * (r + k));
+        Tau(1, r * num_steps + k) = 0.5 * cos (0.2 * k);
+      }
+    }
+  }
+  ~DoublePendulumRollouts () {
+    delete model;
+  }
+
+  Model *model;
+
+  unsigned int num_rollouts;
+  unsigned int num_steps;
+
+  MatrixNd Q0;
+  MatrixNd QDot0;
+  MatrixNd Tau;
+};
+
+TEST_FIXTURE ( DoublePendulumRollouts, TestRolloutMatchesSequential ) {
+  RolloutEngine engine (*model, 4);
+  engine.integrator_type = IntegratorTypeRungeKutta4;
+  engine.dt = 1.0e-3;
+  engine.num_steps = num_steps;
+  engine.record_trajectories = true;
+
+  engine.Run (Q0, QDot0, Tau);
+
+  CHECK_EQUAL (4u, engine.GetNumThreads());
+  CHECK_EQUAL (num_rollouts, engine.final_q.cols());
+  CHECK_EQUAL (num_rollouts * (num_steps + 1), engine.trajectory_q.cols());
+
+  Integrator integrator (IntegratorTypeRungeKutta4);
+  integrator.Bind (*model);
+
+  for (unsigned int r = 0; r < num_rollouts; r++) {
+    VectorNd q = Q0.col (r);
+    VectorNd qdot = QDot0.col (r);
+
+    for (unsigned int k = 0; k < num_steps; k++) {
+      VectorNd tau = Tau.col (r * num_steps + k);
+      SimulationStep (*model, integrator, q, qdot, tau, 1.0e-3);
+
+      VectorNd traj_q = engine.trajectory_q.col (r * (num_steps + 1) + k + 1);
+      CHECK_ARRAY_CLOSE (q.data(), traj_q.data(), 2, TEST_PREC);
+    }
+
+    VectorNd final_q = engine.final_q.col (r);
+    VectorNd final_qdot = engine.final_qdot.col (r);
+    CHECK_ARRAY_CLOSE (q.data(), final_q.data(), 2, TEST_PREC);
+    CHECK_ARRAY_CLOSE (qdot.data(), final_qdot.data(), 2, TEST_PREC);
+  }
+}
+
+TEST_FIXTURE ( DoublePendulumRollouts, TestRolloutCosts ) {
+  RolloutEngine engine (*model, 3);
+  engine.num_steps = num_steps;
+  engine.stage_cost = [] (unsigned int, const VectorNd &,
+      const VectorNd &, const VectorNd &tau) {
+    return tau.squaredNorm();
+  };
+  engine.terminal_cost = [] (const VectorNd &q, const VectorNd &) {
+    return q[0];
+  };
+
+  engine.Run (Q0, QDot0, Tau);
+
+  for (unsigned int r = 0; r < num_rollouts; r++) {
+    double cost = engine.final_q(0, r);
+    for (unsigned int k = 0; k < num_steps; k++) {
+      cost += Tau.col (r * num_steps + k).squaredNorm();
+    }
+    CHECK_CLOSE (cost, engine.costs[r], TEST_PREC);
+  }
+}
+
+TEST_FIXTURE ( DoublePendulumRollouts, TestRolloutExternalForces ) {
+  // a pure torque about z on the first body acts like an actuation
+  RolloutEngine engine (*model, 2);
+  engine.num_steps = num_steps;
+  engine.external_forces = [] (Model &, unsigned int, const VectorNd &,
+      const VectorNd &, std::vector<SpatialVector> &f_ext) {
+    f_ext[1][2] = 1.;
+  };
+
+  MatrixNd Tau_zero = MatrixNd::Zero (Tau.rows(), Tau.cols());
+  engine.Run (Q0, QDot0, Tau_zero);
+  MatrixNd final_q_force = engine.final_q;
+
+  MatrixNd Tau_torque = Tau_zero;
+  Tau_torque.row (0).setOnes();
+  engine.external_forces = RolloutExternalForces();
+  engine.Run (Q0, QDot0, Tau_torque);
+
+  CHECK_ARRAY_CLOSE (engine.final_q.data(), final_q_force.data(),
+      final_q_force.size(), TEST_PREC);
+}
@@ -19,6 +19,8 @@
 namespace RigidBodyDynamics {
 
 struct Model;
+struct SubtreePartition;
+class ThreadPool;
 
 /** \page dynamics_page Dynamics
  *
@@ -71,6 +73,44 @@ RBDL_DLLAPI void NonlinearEffects (
     std::vector<Math::SpatialVector> *f_ext = NULL
     );
 
+/** \brief Computes the gravity and the transposed Coriolis forces that
+ * drive the generalized momentum
+ *
+ * The generalized momentum \f$ p = M(q) \dot{q} \f$ evolves with
+ *   \f$ \dot{p} = \tau + \tau_\textit{ext} - g(q) + C^T(q, \dot{q})
+ *   \dot{q} \f$
+ * (as \f$ \dot{M} = C + C^T \f$). This function computes
+ *   \f$ \tau = g(q) - C^T(q, \dot{q}) \dot{q} \f$
+ * and optionally \f$ p \f$ with one forward and one backward sweep, i.e.
+ * in O(n) without forming \f$ M \f$ or \f$ \dot{M} \f$. The backward
+ * sweep accumulates the composite gravity forces and the composite
+ * momenta \f$ h^c_i \f$ of the subtrees and uses
+ *   \f$ (C^T \dot{q})_i = -S_i^T (v_i \times^* h^c_i) \f$.
+ *
+ * This is the input of generalized momentum observers that estimate the
+ * external joint forces from the commanded forces and the joint states.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the internal joints
+ * \param QDot  velocity vector of the internal joints
+ * \param Tau   gravity minus transposed Coriolis forces (output)
+ * \param Momentum generalized momentum \f$ M(q) \dot{q} \f$ (optional
+ * output, defaults to NULL)
+ *
+ * \note The result is exact for joints whose motion subspace is constant
+ * in the body frame (revolute, prismatic, spherical, translational and
+ * floating base joints). For the Euler angle joints and custom joints
+ * with a configuration dependent motion subspace the term
+ * \f$ \dot{S} \dot{q} \f$ is neglected.
+ */
+RBDL_DLLAPI void GeneralizedMomentumEffects (
+    Model &model,
+    const Math::VectorNd &Q,
+    const Math::VectorNd &QDot,
+    Math::VectorNd &Tau,
+    Math::VectorNd *Momentum = NULL
+    );
+
 /** \brief Computes the joint space inertia matrix by using the Composite Rigid Body Algorithm
  *
  * This function computes the joint space inertia matrix from a given model and
@@ -93,6 +133,36 @@ RBDL_DLLAPI void CompositeRigidBodyAlgorithm (
     bool update_kinematics = true
     );
 
+/** \brief Computes the joint space inertia matrix with the Composite Rigid
+ * Body Algorithm on multiple threads.
+ *
+ * Same as CompositeRigidBodyAlgorithm() but the composite inertias and the
+ * entries of H of the independent subtrees of the partition are computed
+ * concurrently on the threads of the pool. The results are identical to
+ * CompositeRigidBodyAlgorithm() (see ForwardDynamicsParallel()).
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the model
+ * \param H     a matrix where the result will be stored in
+ * \param pool  thread pool that runs the subtrees
+ * \param partition subtrees of the model (see SubtreePartition)
+ * \param update_kinematics  whether the kinematics should be updated (safer, but at a higher computational cost!)
+ *
+ * \note As for CompositeRigidBodyAlgorithm() only the non-zero entries of
+ * H are written.
+ *
+ * \note No speedup has been measured yet: the CRBA runs of "benchmark
+ * --only-parallel" so far were all on a single core.
+ */
+RBDL_DLLAPI void CompositeRigidBodyAlgorithmParallel (
+    Model& model,
+    const Math::VectorNd &Q,
+    Math::MatrixNd &H,
+    ThreadPool &pool,
+    const SubtreePartition &partition,
+    bool update_kinematics = true
+    );
+
 /** \brief Computes forward dynamics with the Articulated Body Algorithm
  *
  * This function computes the generalized accelerations from given
@@ -117,6 +187,93 @@ RBDL_DLLAPI void ForwardDynamics (
     std::vector<Math::SpatialVector> *f_ext = NULL
     );
 
+/** \brief Computes forward dynamics with the Articulated Body Algorithm
+ * on multiple threads.
+ *
+ * Same as ForwardDynamics() but the independent subtrees of the given
+ * partition are processed concurrently on the threads of the pool. The
+ * bodies that connect the subtrees with the root are processed by the
+ * calling thread. Every body accumulates the contributions of its
+ * children in the same order as ForwardDynamics() and therefore the
+ * results are identical.
+ *
+ * Only pays off for models with many branches (e.g. multiple robots or
+ * large trees). The partition should contain a small multiple of the
+ * number of threads as subtrees, e.g.:
+ *
+ * \code
+ * ThreadPool pool (4);
+ * SubtreePartition partition (model, 4 * pool.GetNumThreads());
+ * ForwardDynamicsParallel (model, Q, QDot, Tau, QDDot, pool, partition);
+ * \endcode
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the internal joints
+ * \param QDot  velocity vector of the internal joints
+ * \param Tau   actuations of the internal joints
+ * \param QDDot accelerations of the internal joints (output)
+ * \param pool  thread pool that runs the subtrees
+ * \param partition subtrees of the model (see SubtreePartition)
+ * \param f_ext External forces acting on the body in base coordinates (optional, defaults to NULL)
+ *
+ * \note The debug log (RBDL_ENABLE_LOGGING) is not thread-safe.
+ *
+ * \note The multi-core speedup is unmeasured: "benchmark --only-parallel"
+ * has only been run on a single core host, where one thread is on par
+ * with ForwardDynamics() and more threads only add pool overhead. Measure
+ * with "--only-parallel --threads <n>" on the target machine first.
+ */
+RBDL_DLLAPI void ForwardDynamicsParallel (
+    Model &model,
+    const Math::VectorNd &Q,
+    const Math::VectorNd &QDot,
+    const Math::VectorNd &Tau,
+    Math::VectorNd &QDDot,
+    ThreadPool &pool,
+    const SubtreePartition &partition,
+    std::vector<Math::SpatialVector> *f_ext = NULL
+    );
+
+#ifndef RBDL_USE_SIMPLE_MATH
+/** \brief Computes hybrid dynamics: the accelerations of some degrees of
+ * freedom are prescribed, the torques of the others are given.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the internal joints
+ * \param QDot  velocity vector of the internal joints
+ * \param prescribed for every degree of freedom whether its acceleration
+ *              is prescribed (true) or its torque is given (false)
+ * \param QDDot accelerations of the internal joints. The prescribed entries
+ *              are input, the others are output.
+ * \param Tau   actuations of the internal joints. The entries that are not
+ *              prescribed are input, the others are output.
+ * \param f_ext External forces acting on the body in base coordinates (optional, defaults to NULL)
+ *
+ * This function computes the unknown accelerations and the torques
+ * needed for the prescribed accelerations in a single run of the
+ * Articulated %Body Algorithm in \f$O(n_{\textit{dof}})\f$ time (see RBDA,
+ * Section 9.2). Joints whose accelerations are prescribed are treated as
+ * rigid in the articulated body inertias and their prescribed motion is
+ * added to the bias accelerations. Multi dof joints may mix prescribed
+ * and free degrees of freedom.
+ *
+ * Without any prescribed accelerations the result is the same as
+ * ForwardDynamics(), with all accelerations prescribed the same as
+ * InverseDynamics().
+ *
+ * \note Only available when RBDL is built with Eigen3.
+ */
+RBDL_DLLAPI void HybridDynamics (
+    Model &model,
+    const Math::VectorNd &Q,
+    const Math::VectorNd &QDot,
+    const std::vector<bool> &prescribed,
+    Math::VectorNd &QDDot,
+    Math::VectorNd &Tau,
+    std::vector<Math::SpatialVector> *f_ext = NULL
+    );
+#endif
+
 /** \brief Computes forward dynamics by building and solving the full Lagrangian equation
  *
  * This method builds and solves the linear system
@@ -176,6 +333,49 @@ RBDL_DLLAPI void CalcMInvTimesTau (
     bool update_kinematics=true
     );
 
+#ifndef RBDL_USE_SIMPLE_MATH
+/** \brief Computes the inverse of the joint space inertia matrix directly
+ * in quadratic time.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the generalized positions
+ * \param Minv  matrix where the inverse of the joint space inertia matrix
+ *              will be stored (has to be of size dof_count x dof_count)
+ * \param update_kinematics whether the kinematics should be updated (safer, but at a higher computational cost)
+ * \param body_ids ids of the movable bodies whose joint blocks of
+ *              \f$M^{-1}\f$ are needed (optional, defaults to NULL and
+ *              computes the full matrix)
+ *
+ * This function computes \f$M(q)^{-1}\f$ with the recursive sweeps of
+ * the Articulated %Body Algorithm applied to all columns of the identity
+ * at once in \f$O(n_{\textit{dof}}^2)\f$ time, i.e. without forming
+ * \f$M(q)\f$ and factorizing it. The column wise forces and accelerations
+ * of the sweeps are kept in Model::minv_F and Model::minv_P which are
+ * allocated on the first call, i.e. only models that use this function
+ * pay for them and subsequent calls do not allocate.
+ *
+ * When body_ids is given only the entries \f$M^{-1}_{ij}\f$ for which
+ * the degrees of freedom i and j both belong to the joints of the listed
+ * bodies are computed, which skips the forward sweep for all bodies that
+ * are neither listed nor ancestors of a listed body. The remaining
+ * entries of Minv are unspecified.
+ *
+ * \note When calling this function repeatedly for the same values of Q
+ * make sure to set update_kinematics to false as this reuses the
+ * transformations and articulated body inertias of the previous call of
+ * this function or of CalcMInvTimesTau().
+ *
+ * \note Only available when RBDL is built with Eigen3.
+ */
+RBDL_DLLAPI void CalcMInv (
+    Model &model,
+    const Math::VectorNd &Q,
+    Math::MatrixNd &Minv,
+    bool update_kinematics=true,
+    const std::vector<unsigned int> *body_ids = NULL
+    );
+#endif
+
 /** @} */
 
 }
@@ -0,0 +1,178 @@
+/*
+ * RBDL - Rigid Body Dynamics Library
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_INVERSE_KINEMATICS_MULTI_START_H
+#define RBDL_INVERSE_KINEMATICS_MULTI_START_H
+
+#include <atomic>
+#include <random>
+#include <vector>
+
+#include "rbdl/rbdl_math.h"
+#include "rbdl/Model.h"
+#include "rbdl/Kinematics.h"
+#include "rbdl/ThreadPool.h"
+
+namespace RigidBodyDynamics {
+
+/** \brief Solves inverse kinematics problems from several initial guesses
+ * in parallel.
+ *
+ * Iterative inverse kinematics converges to the local solution that the
+ * initial guess leads to and may fail close to the workspace boundary
+ * although other initial guesses would succeed. Solve() therefore starts
+ * InverseKinematics() (or InverseKinematicsPrioritized()) from every
+ * column of a seed matrix. The seeds are distributed over a work-stealing
+ * ThreadPool, every thread uses its own copy of the Model and of the
+ * constraint set, so the model passed to the constructor and the
+ * constraint set passed to Solve() are never modified.
+ *
+ * The seeds are started in the order of the columns. If
+ * stop_at_first_solution is set, the first seed that converges cancels the
+ * seeds that are still running (through
+ * InverseKinematicsConstraintSet::cancel) and the seeds that have not been
+ * started yet are skipped. Putting the current posture into the first
+ * column therefore keeps the latency of the easy cases at the one of a
+ * single solve.
+ *
+ * Among all converged seeds the solution closest to the current posture
+ * (see ConfigurationDistance()) is selected.
+ *
+ * \note Models with custom joints are not supported: the per-thread copies
+ * would share the CustomJoint objects of Model::mCustomJoints, which
+ * jcalc() writes to. The constructor aborts for such models.
+ *
+ * Example:
+ * \code
+ * InverseKinematicsMultiStart multi_start (model, 4);
+ * MatrixNd seeds;
+ * multi_start.GenerateSeeds (Q, CS, 8, seeds);
+ * if (multi_start.Solve (Q, seeds, CS, Qres)) {
+ *   ...
+ * }
+ * \endcode
+ */
+struct RBDL_DLLAPI InverseKinematicsMultiStart {
+  enum SeedStatus {
+    SeedSkipped = 0,
+    SeedConverged,
+    SeedFailed,
+    SeedCancelled
+  };
+
+  /** \param model the model that is copied for every thread
+   * \param num_threads number of threads (0: hardware concurrency)
+   */
+  InverseKinematicsMultiStart (const Model &model,
+      unsigned int num_threads = 0);
+
+  /** \brief Runs the inverse kinematics from every column of Seeds.
+   *
+   * \param Qcurrent current posture that is used to select the solution
+   * \param Seeds initial guesses, one column of size q_size each
+   * \param CS constraints and solver parameters, copied for every thread
+   * \param Qres the selected solution (the seed result with the smallest
+   * residual if no seed converged)
+   *
+   * \returns true if at least one seed converged.
+   */
+  bool Solve (
+      const Math::VectorNd &Qcurrent,
+      const Math::MatrixNd &Seeds,
+      const InverseKinematicsConstraintSet &CS,
+      Math::VectorNd &Qres);
+
+  /** \brief Creates num_seeds initial guesses around Qcurrent.
+   *
+   * The first column is Qcurrent itself. For the other columns every
+   * entry with finite limits in CS is drawn uniformly within its limits,
+   * every other entry is offset from Qcurrent by a uniform value in
+   * [-seed_range, seed_range]. Spherical joints are rotated about a
+   * random axis by an angle in the same interval.
+   */
+  void GenerateSeeds (
+      const Math::VectorNd &Qcurrent,
+      const InverseKinematicsConstraintSet &CS,
+      unsigned int num_seeds,
+      Math::MatrixNd &Seeds);
+
+  /** \brief Distance between two postures.
+   *
+   * Square root of the sum of the squared differences of all entries,
+   * the difference of a spherical joint is the angle of the relative
+   * rotation of its quaternions.
+   */
+  double ConfigurationDistance (
+      const Math::VectorNd &Q0,
+      const Math::VectorNd &Q1) const;
+
+  /// \brief Number of threads used for the seeds.
+  unsigned int GetNumThreads () const {
+    return pool.GetNumThreads();
+  }
+
+  // Settings
+
+  /// Whether InverseKinematicsPrioritized() is used instead of
+  /// InverseKinematics() (default false).
+  bool prioritized;
+  /// Whether the first converged seed cancels the others (default true).
+  bool stop_at_first_solution;
+  /// A seed has converged if the solver succeeded and the norm of the
+  /// residuals of the constraints with a priority of at most
+  /// max_solution_priority is below solution_tol (default 1.0e-8).
+  double solution_tol;
+  /// Lowest priority level that has to be satisfied by a solution
+  /// (default: all levels).
+  unsigned int max_solution_priority;
+  /// Half width of the random offsets of GenerateSeeds() (default 0.5).
+  double seed_range;
+
+  // Results of the last call of Solve(), one entry per seed
+
+  std::vector<SeedStatus> seed_status;
+  /// Residual norm of the satisfied priority levels.
+  Math::VectorNd seed_error_norms;
+  /// Distance of the result of each seed to Qcurrent.
+  Math::VectorNd seed_distances;
+  Math::MatrixNd seed_results;
+  /// Column of the selected solution.
+  unsigned int best_seed;
+  unsigned int num_converged;
+
+  // Workspace
+
+  struct ThreadWorkspace {
+    Model model;
+    InverseKinematicsConstraintSet CS;
+    Math::VectorNd q;
+  };
+
+  std::vector<ThreadWorkspace> workspaces;
+
+  std::mt19937 random_engine;
+  std::atomic<bool> cancelled;
+  std::atomic<unsigned int> next_seed;
+
+  ThreadPool pool;
+
+  private:
+    InverseKinematicsMultiStart (const InverseKinematicsMultiStart&);
+    InverseKinematicsMultiStart& operator= (
+        const InverseKinematicsMultiStart&);
+
+    void SolveSeed (
+        unsigned int seed,
+        unsigned int thread_id,
+        const Math::VectorNd &Qcurrent,
+        const Math::MatrixNd &Seeds);
+};
+
+}
+
+/* RBDL_INVERSE_KINEMATICS_MULTI_START_H */
+#endif
@@ -644,6 +644,24 @@ struct RBDL_DLLAPI Joint {
   int custom_joint_index;
 };
 
+/** \brief Computes the sine and cosine of all revolute and Euler joint
+ * angles in one batch.
+ *
+ * The results are stored in Model::sin_q and Model::cos_q and are used by
+ * jcalc(), jcalc_XJ() and jcalc_X_lambda_S() if they are called with
+ * sincos_computed = true for the same q. They are computed by
+ * Math::SinCos(), i.e. with the default RBDL_USE_SIMD_SINCOS they may
+ * differ from std::sin() and std::cos() in the last bit.
+ *
+ * \param model    the rigid body model
+ * \param q        joint state variables
+ */
+RBDL_DLLAPI
+void jcalc_sincos (
+    Model &model,
+    const Math::VectorNd &q
+    );
+
 /** \brief Computes all variables for a joint model
  *
  *  By appropriate modification of this function all types of joints can be
@@ -653,26 +671,31 @@ struct RBDL_DLLAPI Joint {
  * \param joint_id the id of the joint we are interested in. This will be used to determine the type of joint and also the entries of \f[ q, \dot{q} \f].
  * \param q        joint state variables
  * \param qdot     joint velocity variables
+ * \param sincos_computed whether jcalc_sincos() was called for q (default:
+ * false)
  */
 RBDL_DLLAPI
 void jcalc (
     Model &model,
     unsigned int joint_id,
     const Math::VectorNd &q,
-    const Math::VectorNd &qdot
+    const Math::VectorNd &qdot,
+    bool sincos_computed = false
     );
 
 RBDL_DLLAPI
 Math::SpatialTransform jcalc_XJ (
     Model &model,
     unsigned int joint_id,
-    const Math::VectorNd &q);
+    const Math::VectorNd &q,
+    bool sincos_computed = false);
 
 RBDL_DLLAPI
 void jcalc_X_lambda_S (
     Model &model,
     unsigned int joint_id,
-    const Math::VectorNd &q
+    const Math::VectorNd &q,
+    bool sincos_computed = false
     );
 
 struct RBDL_DLLAPI CustomJoint {
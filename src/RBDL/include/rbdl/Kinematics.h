@@ -10,6 +10,7 @@
 
 #include "rbdl/rbdl_math.h"
 #include <assert.h>
+#include <atomic>
 #include <iostream>
 #include "rbdl/Logging.h"
 
@@ -321,7 +322,7 @@ RBDL_DLLAPI
  * \param target_pos a vector of target positions
  * \param Qres output of the computed inverse kinematics
  * \param step_tol tolerance used for convergence detection
- * \param lambda damping factor for the least squares function
+ * \param lambda initial damping factor for the least squares function
  * \param max_iter maximum number of steps that should be performed
  * \returns true on success, false otherwise
  *
@@ -334,6 +335,11 @@ RBDL_DLLAPI
  * step_tol or if the error between body points and target gets smaller
  * than step_tol. Otherwise it returns false.
  *
+ * The iteration is carried out by
+ * InverseKinematics (Model&, const Math::VectorNd&, InverseKinematicsConstraintSet&, Math::VectorNd&)
+ * with a point constraint for every target and a fixed damping (see
+ * InverseKinematicsConstraintSet::adaptive_damping).
+ *
  * The parameter \f$\lambda\f$ is the damping factor that has to
  * be chosen carefully. In case of unreachable positions higher values (e.g
  * 0.9) can be helpful. Otherwise values of 0.0001, 0.001, 0.01, 0.1 might
@@ -362,22 +368,77 @@ struct RBDL_DLLAPI InverseKinematicsConstraintSet {
   enum ConstraintType {
     ConstraintTypePosition = 0,
     ConstraintTypeOrientation,
-    ConstraintTypeFull
+    ConstraintTypeFull,
+    ConstraintTypeCoM,
+    ConstraintTypePosture
+  };
+
+  /// \brief Convergence status of a priority level after
+  /// InverseKinematicsPrioritized().
+  enum PriorityLevelStatus {
+    /// The residual of the level is below constraint_tol.
+    PriorityLevelSatisfied = 0,
+    /// The level reached its least squares solution in the null space of
+    /// the higher levels (its step is below step_tol) but its residual
+    /// conflicts with them.
+    PriorityLevelConverged,
+    /// The solver stopped (max_steps, cancel) before the level converged.
+    PriorityLevelNotConverged
   };
 
   InverseKinematicsConstraintSet();
 
   Math::MatrixNd J; /// the Jacobian of all constraints
-  Math::MatrixNd G; /// temporary storage of a single body Jacobian
+  Math::MatrixNd G; /// motion subspaces of all joints in base coordinates, shared by the Jacobians of all constraints
   Math::VectorNd e; /// Vector with all the constraint residuals.
 
   unsigned int num_constraints; //size of all constraints
-  double lambda; /// Damping factor, the default value of 1.0e-6 is reasonable for most problems
+  double lambda; /// Initial damping factor of the Levenberg-Marquardt steps, the default value of 1.0e-9 is reasonable for most problems
   unsigned int num_steps; // The number of iterations performed
   unsigned int max_steps; // Maximum number of steps (default 300), abort if more steps are performed.
   double step_tol; // Step tolerance (default = 1.0e-12). If the computed step length is smaller than this value the algorithm terminates successfully (i.e. returns true). If error_norm is still larger than constraint_tol then this usually means that the target is unreachable.
   double constraint_tol; // Constraint tolerance (default = 1.0e-12). If error_norm is smaller than this value the algorithm terminates successfully, i.e. all constraints are satisfied.
   double error_norm; // Norm of the constraint residual vector.
+  bool adaptive_damping; // Whether the damping is adapted to the progress of the steps (default true). If false every step is taken with the damping lambda (classic damped least squares).
+  double max_level_step_norm; // Maximum norm of the step of a single priority level in InverseKinematicsPrioritized() (default 0.5).
+  unsigned int max_hard_priority; // Constraints with a priority up to this value are hard constraints (default 0): InverseKinematicsPrioritized() only succeeds if their residuals are below constraint_tol.
+  const std::atomic<bool> *cancel; // Optional flag (default NULL) that is polled once per iteration. Once it is set the solvers stop and return false.
+
+  // Joint limits for the entries of Q (optional). Either empty or of size
+  // q_size, use +/- infinity for unlimited entries. Limits of the
+  // quaternion entries of spherical joints are ignored.
+  Math::VectorNd q_min;
+  Math::VectorNd q_max;
+
+  // convergence diagnostics of the last call of InverseKinematics()
+  double step_norm; // Norm of the last computed step.
+  double damping; // Damping factor of the Levenberg-Marquardt steps at termination.
+  unsigned int num_rejected_steps; // Number of steps that did not reduce the residual and were rejected.
+
+  // workspace of InverseKinematics(), allocated on the first call
+  Math::MatrixNd A; /// damped normal matrix of the smaller of J^T J and J J^T
+  Math::VectorNd delta_q; /// Levenberg-Marquardt step
+  Math::VectorNd e_trial; /// constraint residuals after the step
+  Math::VectorNd q_trial; /// state after the step
+  Math::VectorNd z; /// temporary storage for the dual form of the step and the predicted residual
+
+  // convergence diagnostics of the last call of InverseKinematicsPrioritized()
+  std::vector<double> priority_error_norms; // Norm of the constraint residuals of each priority level.
+  std::vector<double> priority_step_norms; // Norm of the last (unlimited) step of each priority level.
+  std::vector<PriorityLevelStatus> priority_level_status; // Convergence status of each priority level.
+
+  // workspace of InverseKinematicsPrioritized(), allocated on the first call
+  Math::MatrixNd Z; /// orthonormal basis of the null space of the higher priority levels (leading columns)
+  Math::MatrixNd J_priority; /// transposed Jacobians of the levels in the null space of the higher levels, columns sorted by priority
+  Math::VectorNd e_priority; /// residuals of the levels after the steps of the higher levels
+  Math::VectorNd level_step; /// step of a level in the null space of the higher levels
+  Math::VectorNd householder_workspace;
+  std::vector<unsigned int> priority_constraints; /// constraint indices sorted by priority
+  std::vector<unsigned int> priority_levels; /// first entry of each priority level in priority_constraints and the constraint count
+
+  // workspace of the center of mass constraints
+  std::vector<double> subtree_masses;
+  std::vector<Math::Vector3d> subtree_mass_moments; /// sum of mass times center of mass (base coordinates) of each subtree
 
   // everything to define a IKin constraint
   std::vector<ConstraintType> constraint_type;
@@ -385,21 +446,62 @@ struct RBDL_DLLAPI InverseKinematicsConstraintSet {
   std::vector<Math::Vector3d> body_points;
   std::vector<Math::Vector3d> target_positions;
   std::vector<Math::Matrix3d> target_orientations;
+  std::vector<Math::VectorNd> target_postures;
   std::vector<unsigned int> constraint_row_index;
+  // Priority level of each constraint, 0 is the highest priority. Only
+  // used by InverseKinematicsPrioritized().
+  std::vector<unsigned int> constraint_priority;
 
   // Adds a point constraint that tries to get a body point close to a 
   // point described in base coordinates.
-  unsigned int AddPointConstraint (unsigned int body_id, const Math::Vector3d &body_point, const Math::Vector3d &target_pos);
+  unsigned int AddPointConstraint (unsigned int body_id, const Math::Vector3d &body_point, const Math::Vector3d &target_pos, unsigned int priority = 0);
   // Adds an orientation constraint that tries to align a body to the
   // orientation specified as a rotation matrix expressed in base
   // coordinates.
-  unsigned int AddOrientationConstraint (unsigned int body_id, const Math::Matrix3d &target_orientation);
+  unsigned int AddOrientationConstraint (unsigned int body_id, const Math::Matrix3d &target_orientation, unsigned int priority = 0);
   // Adds a constraint on both location and orientation of a body.
-  unsigned int AddFullConstraint (unsigned int body_id, const Math::Vector3d &body_point, const Math::Vector3d &target_pos, const Math::Matrix3d &target_orientation);
+  unsigned int AddFullConstraint (unsigned int body_id, const Math::Vector3d &body_point, const Math::Vector3d &target_pos, const Math::Matrix3d &target_orientation, unsigned int priority = 0);
+  // Adds a constraint that tries to get the center of mass of the model
+  // close to a point described in base coordinates.
+  unsigned int AddCoMConstraint (const Math::Vector3d &target_com, unsigned int priority = 0);
+  // Adds a constraint that tries to get all joints close to the posture
+  // target_q (of size q_size), usually with the lowest priority. It has a
+  // row for each entry of Q, spherical joints use the rotation to the
+  // target orientation.
+  unsigned int AddPostureConstraint (const Math::VectorNd &target_q, unsigned int priority = 0);
   // Clears all entries of the constraint setting
   unsigned int ClearConstraints();  
 };
 
+/** \brief Computes the inverse kinematics for a set of constraints with
+ * an adaptive Levenberg-Marquardt method.
+ *
+ * \param model rigid body model
+ * \param Qinit initial guess for the state
+ * \param CS constraint set, also holds the parameters, the workspace and
+ * the convergence diagnostics
+ * \param Qres output of the computed inverse kinematics
+ * \returns true on success, false otherwise
+ *
+ * Each iteration computes the Jacobians of all constraints in a single
+ * pass: the motion subspaces of the joints are transformed to base
+ * coordinates once and shared by all constraints. The step
+ *   \f[ \Delta q = (J^T J + \mu I)^{-1} J^T e \f]
+ * is computed with a Cholesky factorization of the smaller of
+ * \f$J^T J + \mu I\f$ and \f$J J^T + \mu I\f$. Steps that do not
+ * reduce the residual are rejected and the damping \f$\mu\f$ (starting
+ * with CS.lambda) is adapted from the ratio of the actual to the
+ * predicted reduction (Nielsen's update) unless CS.adaptive_damping is
+ * false. As every descent method it may end in a local minimum of the
+ * residual if the initial guess is poor. Steps are projected onto the
+ * joint limits CS.q_min and CS.q_max and spherical joints are updated on
+ * their quaternions, so floating base models are supported.
+ *
+ * The function returns true if CS.error_norm gets smaller than
+ * CS.constraint_tol or the step length gets smaller than CS.step_tol and
+ * false if CS.max_steps is reached. All buffers are kept in CS so that
+ * repeated calls with the same constraints do not allocate memory.
+ */
 RBDL_DLLAPI bool InverseKinematics (
     Model &model,
     const Math::VectorNd &Qinit,
@@ -407,6 +509,64 @@ RBDL_DLLAPI bool InverseKinematics (
     Math::VectorNd &Qres
     );
 
+#ifndef RBDL_USE_SIMPLE_MATH
+/** \brief Computes the inverse kinematics for a set of prioritized
+ * constraints in the null spaces of the higher priorities.
+ *
+ * \param model rigid body model
+ * \param Qinit initial guess for the state
+ * \param CS constraint set with the priority of each constraint, also
+ * holds the parameters, the workspace and the convergence diagnostics
+ * \param Qres output of the computed inverse kinematics
+ * \returns true on success, false otherwise
+ *
+ * Constraints of a lower priority level (larger value of
+ * CS.constraint_priority) are only satisfied as far as they do not
+ * interfere with the constraints of the higher levels, e.g. stance foot,
+ * center of mass, swing foot and posture for a biped. Each iteration
+ * computes the Jacobians of all constraints once (as InverseKinematics())
+ * and solves the levels in the order of their priority as a hierarchy of
+ * least squares problems: with an orthonormal basis \f$Z_{k-1}\f$ of the
+ * null space of the higher levels the step is
+ *   \f[ \Delta q_k = \Delta q_{k-1} + Z_{k-1} \hat{J}_k^T (\hat{J}_k
+ *   \hat{J}_k^T + \mu_k I)^{-1} (e_k - J_k \Delta q_{k-1}), \qquad
+ *   \hat{J}_k = J_k Z_{k-1} \f]
+ * and the basis for the next level follows from a Householder QR
+ * decomposition of \f$\hat{J}_k^T\f$. A level uses as many directions
+ * of the null space as it has rows, a level with at least as many rows
+ * as remaining directions takes all of them (e.g. a posture constraint).
+ * All factorizations are of the size of a single level and the
+ * Jacobians are computed once per iteration for all levels.
+ *
+ * The damping of a level grows with its residual, \f$\mu_k = \lambda +
+ * \frac{1}{2} |e_k|^2\f$ for levels with fewer rows than remaining
+ * directions and \f$\mu_k = \lambda + 0.3 |e_k|\f$ for the others, with
+ * \f$\lambda\f$ = CS.lambda (CS.adaptive_damping is ignored). Levels
+ * with unreachable targets therefore converge to their least squares
+ * solution instead of oscillating close to singular configurations (e.g.
+ * stretched legs). The Gauss-Newton model of a level that conflicts with
+ * the higher levels (e.g. a posture level) misses the curvature of their
+ * null space, which grows with the residual; without the damping the
+ * iteration can drift away and pull the higher levels along. The step of
+ * each level is additionally limited to CS.max_level_step_norm.
+ *
+ * Joint limits, spherical joints and the termination criteria are handled
+ * as in InverseKinematics(). The iteration stops once all constraints are
+ * satisfied, the step length gets smaller than CS.step_tol or after
+ * CS.max_steps steps. The function returns true if the residuals of all
+ * hard levels (priority up to CS.max_hard_priority) are below
+ * CS.constraint_tol, regardless of the lower levels.
+ * CS.priority_error_norms and CS.priority_level_status report the
+ * residual and the convergence of each level.
+ */
+RBDL_DLLAPI bool InverseKinematicsPrioritized (
+    Model &model,
+    const Math::VectorNd &Qinit,
+    InverseKinematicsConstraintSet &CS,
+    Math::VectorNd &Qres
+    );
+#endif
+
 /** @} */
 
 }
@@ -182,6 +182,13 @@ struct RBDL_DLLAPI Model {
 
   std::vector<unsigned int> mJointUpdateOrder;
 
+  /// \brief Indices of the revolute and Euler joint angles in q.
+  std::vector<unsigned int> sincos_q_index;
+  /// \brief Sine and cosine of q, only the entries listed in
+  /// sincos_q_index are computed (see jcalc_sincos()).
+  Math::VectorNd sin_q;
+  Math::VectorNd cos_q;
+
   /// \brief Transformations from the parent body to the frame of the joint.
   // It is expressed in the coordinate frame of the parent.
   std::vector<Math::SpatialTransform> X_T;
@@ -205,8 +212,8 @@ struct RBDL_DLLAPI Model {
 
   /// \brief The velocity dependent spatial acceleration
   std::vector<Math::SpatialVector> c;
-  /// \brief The spatial inertia of the bodies 
-  std::vector<Math::SpatialMatrix> IA;
+  /// \brief The articulated body inertia of the bodies
+  std::vector<Math::SpatialArticulatedBodyInertia> IA;
   /// \brief The spatial bias force
   std::vector<Math::SpatialVector> pA;
   /// \brief Temporary variable U_i (RBDA p. 130)
@@ -223,6 +230,14 @@ struct RBDL_DLLAPI Model {
   std::vector<Math::SpatialRigidBodyInertia> Ic;
   std::vector<Math::SpatialVector> hc;
   std::vector<Math::SpatialVector> hdotc;
+  /// \brief Articulated forces of all columns of the identity (used only
+  /// in CalcMInv(), 6 rows per body, dof_count columns, empty until the
+  /// first call)
+  Math::MatrixNd minv_F;
+  /// \brief Spatial accelerations of all columns of the identity (used
+  /// only in CalcMInv(), 6 rows per body, dof_count columns, empty until
+  /// the first call)
+  Math::MatrixNd minv_P;
 
   ////////////////////////////////////
   // Bodies
@@ -135,6 +135,184 @@ struct RBDL_DLLAPI SpatialRigidBodyInertia {
   double Ixx, Iyx, Iyy, Izx, Izy, Izz;
 };
 
+/** \brief Compact representation for symmetric spatial matrices such as
+ * articulated body inertias.
+ *
+ * The matrix is stored as its 3x3 blocks
+ *
+ * \f[ I = \begin{bmatrix} A & B \\ B^T & D \end{bmatrix} \f]
+ *
+ * where only the lower triangles of the symmetric blocks A and D are kept
+ * (21 instead of 36 values).
+ */
+struct RBDL_DLLAPI SpatialArticulatedBodyInertia {
+  SpatialArticulatedBodyInertia() {
+    setZero();
+  }
+  SpatialArticulatedBodyInertia (const SpatialMatrix &mat) {
+    createFromMatrix (mat);
+  }
+  SpatialArticulatedBodyInertia (const SpatialRigidBodyInertia &rbi) {
+    *this = rbi;
+  }
+
+  SpatialArticulatedBodyInertia& operator= (
+      const SpatialRigidBodyInertia &rbi) {
+    A[0] = rbi.Ixx;
+    A[1] = rbi.Iyx; A[2] = rbi.Iyy;
+    A[3] = rbi.Izx; A[4] = rbi.Izy; A[5] = rbi.Izz;
+
+    B[0] =     0.; B[1] = -rbi.h[2]; B[2] =  rbi.h[1];
+    B[3] =  rbi.h[2]; B[4] =     0.; B[5] = -rbi.h[0];
+    B[6] = -rbi.h[1]; B[7] =  rbi.h[0]; B[8] =     0.;
+
+    D[0] = rbi.m;
+    D[1] = 0.; D[2] = rbi.m;
+    D[3] = 0.; D[4] = 0.; D[5] = rbi.m;
+
+    return *this;
+  }
+
+  void setZero() {
+    for (unsigned int k = 0; k < 6; k++) {
+      A[k] = 0.;
+      D[k] = 0.;
+    }
+    for (unsigned int k = 0; k < 9; k++) {
+      B[k] = 0.;
+    }
+  }
+
+  /// Index of element (row, col) in the packed lower triangle of A or D.
+  static unsigned int packedIndex (unsigned int row, unsigned int col) {
+    return row >= col ? row * (row + 1) / 2 + col : col * (col + 1) / 2 + row;
+  }
+
+  /// Initializes from the lower triangles and the lower left block of mat.
+  void createFromMatrix (const SpatialMatrix &mat) {
+    for (unsigned int k = 0; k < 3; k++) {
+      for (unsigned int l = 0; l <= k; l++) {
+        A[packedIndex (k, l)] = mat(k,l);
+        D[packedIndex (k, l)] = mat(3 + k, 3 + l);
+      }
+      for (unsigned int l = 0; l < 3; l++) {
+        B[3 * k + l] = mat(3 + l, k);
+      }
+    }
+  }
+
+  double operator() (unsigned int row, unsigned int col) const {
+    if (row < 3 && col < 3) {
+      return A[packedIndex (row, col)];
+    } else if (row >= 3 && col >= 3) {
+      return D[packedIndex (row - 3, col - 3)];
+    } else if (row < 3) {
+      return B[3 * row + col - 3];
+    }
+    return B[3 * col + row - 3];
+  }
+
+  SpatialMatrix toMatrix() const {
+    SpatialMatrix result;
+    for (unsigned int k = 0; k < 6; k++) {
+      for (unsigned int l = 0; l < 6; l++) {
+        result(k,l) = (*this)(k,l);
+      }
+    }
+    return result;
+  }
+
+  SpatialVector operator* (const SpatialVector &v) const {
+    return SpatialVector (
+        A[0] * v[0] + A[1] * v[1] + A[3] * v[2]
+        + B[0] * v[3] + B[1] * v[4] + B[2] * v[5],
+        A[1] * v[0] + A[2] * v[1] + A[4] * v[2]
+        + B[3] * v[3] + B[4] * v[4] + B[5] * v[5],
+        A[3] * v[0] + A[4] * v[1] + A[5] * v[2]
+        + B[6] * v[3] + B[7] * v[4] + B[8] * v[5],
+        B[0] * v[0] + B[3] * v[1] + B[6] * v[2]
+        + D[0] * v[3] + D[1] * v[4] + D[3] * v[5],
+        B[1] * v[0] + B[4] * v[1] + B[7] * v[2]
+        + D[1] * v[3] + D[2] * v[4] + D[4] * v[5],
+        B[2] * v[0] + B[5] * v[1] + B[8] * v[2]
+        + D[3] * v[3] + D[4] * v[4] + D[5] * v[5]
+        );
+  }
+
+  Matrix63 operator* (const Matrix63 &mat) const {
+    Matrix63 result;
+    for (unsigned int k = 0; k < 3; k++) {
+      SpatialVector column = (*this) * SpatialVector (
+          mat(0,k), mat(1,k), mat(2,k), mat(3,k), mat(4,k), mat(5,k));
+      for (unsigned int l = 0; l < 6; l++) {
+        result(l,k) = column[l];
+      }
+    }
+    return result;
+  }
+
+  SpatialArticulatedBodyInertia& operator+= (
+      const SpatialArticulatedBodyInertia &other) {
+    for (unsigned int k = 0; k < 6; k++) {
+      A[k] += other.A[k];
+      D[k] += other.D[k];
+    }
+    for (unsigned int k = 0; k < 9; k++) {
+      B[k] += other.B[k];
+    }
+    return *this;
+  }
+
+  /** Adds the symmetric rank one matrix alpha * u * u^T.
+   */
+  void rankUpdate (const SpatialVector &u, double alpha) {
+    for (unsigned int k = 0; k < 3; k++) {
+      double alpha_u_k = alpha * u[k];
+      double alpha_u_3k = alpha * u[3 + k];
+      for (unsigned int l = 0; l <= k; l++) {
+        A[packedIndex (k, l)] += alpha_u_k * u[l];
+        D[packedIndex (k, l)] += alpha_u_3k * u[3 + l];
+      }
+      for (unsigned int l = 0; l < 3; l++) {
+        B[3 * k + l] += alpha_u_k * u[3 + l];
+      }
+    }
+  }
+
+  /** Adds alpha * U * M * U^T for a symmetric 3x3 matrix M.
+   */
+  void rankUpdate (const Matrix63 &U, const Matrix3d &M, double alpha) {
+    // W = alpha * U * M
+    double W[6][3];
+    for (unsigned int k = 0; k < 6; k++) {
+      for (unsigned int l = 0; l < 3; l++) {
+        W[k][l] = alpha * (U(k,0) * M(0,l) + U(k,1) * M(1,l)
+            + U(k,2) * M(2,l));
+      }
+    }
+
+    for (unsigned int k = 0; k < 3; k++) {
+      for (unsigned int l = 0; l <= k; l++) {
+        A[packedIndex (k, l)] += W[k][0] * U(l,0) + W[k][1] * U(l,1)
+          + W[k][2] * U(l,2);
+        D[packedIndex (k, l)] += W[3 + k][0] * U(3 + l,0)
+          + W[3 + k][1] * U(3 + l,1) + W[3 + k][2] * U(3 + l,2);
+      }
+      for (unsigned int l = 0; l < 3; l++) {
+        B[3 * k + l] += W[k][0] * U(3 + l,0) + W[k][1] * U(3 + l,1)
+          + W[k][2] * U(3 + l,2);
+      }
+    }
+  }
+
+  /// Lower triangle of the upper left block (xx, yx, yy, zx, zy, zz).
+  double A[6];
+  /// Upper right block stored row by row.
+  double B[9];
+  /// Lower triangle of the lower right block (xx, yx, yy, zx, zy, zz).
+  double D[6];
+};
+
 /** \brief Compact representation of spatial transformations.
  *
  * Instead of using a verbose 6x6 matrix, this structure only stores a 3x3
@@ -230,6 +408,77 @@ struct RBDL_DLLAPI SpatialTransform {
         - VectorCrossMatrix (E_T_mr) * VectorCrossMatrix (r));
   }
 
+  /** Same as X^T I X for an articulated body inertia I.
+   *
+   * With X = [1 0; -(E r)x 1] * diag(E, E) and the blocks A, B and D of I
+   * this is diag(E^T, E^T) J diag(E, E) where
+   *
+   * J = [A - B rx - (B rx)^T - rx D rx,  B + rx D; (B + rx D)^T, D]
+   *
+   * and rx is the cross product matrix of E r.
+   */
+  SpatialArticulatedBodyInertia applyTranspose (
+      const SpatialArticulatedBodyInertia &I) const {
+    Vector3d Er = E * r;
+
+    // products with the cross product matrix of E r
+    Matrix3d D, B_rx, rx_D;
+    for (unsigned int k = 0; k < 3; k++) {
+      for (unsigned int l = 0; l < 3; l++) {
+        D(k,l) = I.D[SpatialArticulatedBodyInertia::packedIndex (k, l)];
+      }
+    }
+    for (unsigned int k = 0; k < 3; k++) {
+      B_rx(k,0) = I.B[3 * k + 1] * Er[2] - I.B[3 * k + 2] * Er[1];
+      B_rx(k,1) = I.B[3 * k + 2] * Er[0] - I.B[3 * k] * Er[2];
+      B_rx(k,2) = I.B[3 * k] * Er[1] - I.B[3 * k + 1] * Er[0];
+      rx_D(0,k) = Er[1] * D(2,k) - Er[2] * D(1,k);
+      rx_D(1,k) = Er[2] * D(0,k) - Er[0] * D(2,k);
+      rx_D(2,k) = Er[0] * D(1,k) - Er[1] * D(0,k);
+    }
+
+    Matrix3d A, B;
+    for (unsigned int k = 0; k < 3; k++) {
+      for (unsigned int l = 0; l < 3; l++) {
+        double rx_D_rx = rx_D(k,(l + 1) % 3) * Er[(l + 2) % 3]
+          - rx_D(k,(l + 2) % 3) * Er[(l + 1) % 3];
+        A(k,l) = I.A[SpatialArticulatedBodyInertia::packedIndex (k, l)]
+          - B_rx(k,l) - B_rx(l,k) - rx_D_rx;
+        B(k,l) = I.B[3 * k + l] + rx_D(k,l);
+      }
+    }
+
+    // rotation E^T M E, only the lower triangles of the symmetric blocks
+    Matrix3d A_E = A * E;
+    Matrix3d B_E = B * E;
+    Matrix3d D_E = D * E;
+
+    SpatialArticulatedBodyInertia result;
+    for (unsigned int k = 0; k < 3; k++) {
+      for (unsigned int l = 0; l <= k; l++) {
+        unsigned int index = SpatialArticulatedBodyInertia::packedIndex (k, l);
+        result.A[index] = E(0,k) * A_E(0,l) + E(1,k) * A_E(1,l)
+          + E(2,k) * A_E(2,l);
+        result.D[index] = E(0,k) * D_E(0,l) + E(1,k) * D_E(1,l)
+          + E(2,k) * D_E(2,l);
+      }
+      for (unsigned int l = 0; l < 3; l++) {
+        result.B[3 * k + l] = E(0,k) * B_E(0,l) + E(1,k) * B_E(1,l)
+          + E(2,k) * B_E(2,l);
+      }
+    }
+
+    return result;
+  }
+
+  /** Same as X^T I X for a symmetric spatial matrix I.
+   *
+   * \note Only the lower triangle of I is used.
+   */
+  SpatialMatrix applyTransposeSymmetric (const SpatialMatrix &I) const {
+    return applyTranspose (SpatialArticulatedBodyInertia (I)).toMatrix();
+  }
+
   SpatialVector applyAdjoint (const SpatialVector &f_sp) {
     Vector3d En_rxf = E * (Vector3d (f_sp[0], f_sp[1], f_sp[2]) - r.cross(Vector3d (f_sp[3], f_sp[4], f_sp[5])));
     //		Vector3d En_rxf = E * (Vector3d (f_sp[0], f_sp[1], f_sp[2]) - r.cross(Eigen::Map<Vector3d> (&(f_sp[3]))));
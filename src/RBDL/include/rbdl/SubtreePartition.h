@@ -0,0 +1,66 @@
+/*
+ * RBDL - Rigid Body Dynamics Library
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_SUBTREE_PARTITION_H
+#define RBDL_SUBTREE_PARTITION_H
+
+#include <vector>
+
+#include "rbdl/rbdl_config.h"
+
+namespace RigidBodyDynamics {
+
+struct Model;
+
+/** \brief Splits the kinematic tree of a model into independent subtrees
+ * for the parallel algorithms.
+ *
+ * The movable bodies of the model are divided into a set of subtrees and
+ * the remaining top bodies that connect the subtrees with the root. The
+ * tree is split at its branch points until each subtree contains at most
+ * (body count / num_subtrees) bodies (rounded up) so that the work is
+ * spread over roughly num_subtrees tasks. Top bodies are processed by the
+ * calling thread, the subtrees concurrently.
+ *
+ * Serial chains cannot be split and remain a single subtree even if they
+ * exceed this size, e.g. the legs of a biped.
+ *
+ * The partition only depends on the structure of the model and has to
+ * be recomputed when bodies are added.
+ */
+struct RBDL_DLLAPI SubtreePartition {
+  SubtreePartition ();
+  /// \brief Same as calling Init (model, num_subtrees).
+  SubtreePartition (const Model &model, unsigned int num_subtrees);
+
+  /** \brief Computes the partition of the model.
+   *
+   * \param model the model whose kinematic tree is split
+   * \param num_subtrees the desired number of subtrees, usually a small
+   * multiple of the number of threads
+   */
+  void Init (const Model &model, unsigned int num_subtrees);
+
+  /// \brief Number of movable bodies (including the root) of the model.
+  unsigned int body_count;
+  /// \brief Bodies that are not part of any subtree (ascending order).
+  std::vector<unsigned int> top_bodies;
+  /// \brief Top bodies and roots of the subtrees (ascending order).
+  std::vector<unsigned int> joint_bodies;
+  /// \brief Root body of each subtree. Sorted by descending subtree size.
+  std::vector<unsigned int> roots;
+  /// \brief Bodies of each subtree (ascending order, starting with the
+  /// root).
+  std::vector<std::vector<unsigned int> > subtree_bodies;
+  /// \brief Whether a body is the root of a subtree (size body_count).
+  std::vector<bool> is_subtree_root;
+};
+
+}
+
+/* RBDL_SUBTREE_PARTITION_H */
+#endif
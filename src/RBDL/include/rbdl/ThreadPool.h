@@ -0,0 +1,109 @@
+/*
+ * RBDL - Rigid Body Dynamics Library
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_THREADPOOL_H
+#define RBDL_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rbdl/rbdl_config.h"
+
+namespace RigidBodyDynamics {
+
+/** \brief Work-stealing thread pool used by the parallel algorithms.
+ *
+ * The pool consists of GetNumThreads() participants: the calling thread
+ * (thread id 0) and GetNumThreads() - 1 worker threads (thread ids 1 ...
+ * GetNumThreads() - 1). Every participant owns a task queue. Tasks are
+ * distributed round-robin over the queues, each participant processes its
+ * own queue in LIFO order and steals from the front of the other queues
+ * once its own queue is empty.
+ *
+ * The thread id that is passed to each task is unique among the tasks that
+ * run concurrently and can therefore be used to index per-thread
+ * workspaces (e.g. copies of the Model).
+ *
+ * \note Submit(), Wait() and ParallelFor() must only be called from the
+ * thread that created the pool and tasks must not call them.
+ */
+class RBDL_DLLAPI ThreadPool {
+  public:
+    typedef std::function<void (unsigned int thread_id)> Task;
+    typedef std::function<void (unsigned int index, unsigned int thread_id)>
+      RangeTask;
+
+    /** \brief Creates the pool and starts its worker threads.
+     *
+     * \param num_threads total number of participating threads including
+     * the calling thread. 0 uses std::thread::hardware_concurrency().
+     */
+    explicit ThreadPool (unsigned int num_threads = 0);
+    ~ThreadPool ();
+
+    /// \brief Number of participants including the calling thread.
+    unsigned int GetNumThreads () const {
+      return static_cast<unsigned int>(mQueues.size());
+    }
+
+    /// \brief Queues a task. Call Wait() to run it.
+    void Submit (const Task &task);
+
+    /// \brief Processes queued tasks until all submitted tasks finished.
+    void Wait ();
+
+    /** \brief Calls func (i, thread_id) for all i in [begin, end).
+     *
+     * The range is split into chunks of grain_size indices that are
+     * executed as separate tasks. Returns once all indices have been
+     * processed.
+     */
+    void ParallelFor (
+        unsigned int begin,
+        unsigned int end,
+        const RangeTask &func,
+        unsigned int grain_size = 1);
+
+  private:
+    ThreadPool (const ThreadPool&);
+    ThreadPool& operator= (const ThreadPool&);
+
+    struct TaskQueue {
+      std::mutex mutex;
+      std::deque<Task> tasks;
+    };
+
+    bool PopTask (unsigned int thread_id, Task &task);
+    void RunTask (const Task &task, unsigned int thread_id);
+    void WorkerLoop (unsigned int thread_id);
+
+    std::vector<std::thread> mThreads;
+    std::vector<std::unique_ptr<TaskQueue> > mQueues;
+
+    std::mutex mMutex;
+    std::condition_variable mWorkAvailable;
+    std::condition_variable mWorkDone;
+
+    /// Number of tasks that are waiting in the queues.
+    std::atomic<unsigned int> mQueued;
+    /// Number of tasks that were submitted and have not yet finished.
+    std::atomic<unsigned int> mPending;
+
+    unsigned int mNextQueue;
+    bool mStop;
+};
+
+}
+
+/* RBDL_THREADPOOL_H */
+#endif
@@ -11,6 +11,7 @@
 #define RBDL_API_VERSION (@RBDL_VERSION_MAJOR@ << 16) + (@RBDL_VERSION_MINOR@ << 8) + @RBDL_VERSION_PATCH@
 
 #cmakedefine RBDL_USE_SIMPLE_MATH
+#cmakedefine RBDL_USE_SIMD_SINCOS
 #cmakedefine RBDL_ENABLE_LOGGING
 #cmakedefine RBDL_BUILD_COMMIT "@RBDL_BUILD_COMMIT@"
 #cmakedefine RBDL_BUILD_TYPE "@RBDL_BUILD_TYPE@"
@@ -19,6 +20,8 @@
 #cmakedefine RBDL_BUILD_COMPILER_VERSION "@RBDL_BUILD_COMPILER_VERSION@"
 #cmakedefine RBDL_BUILD_ADDON_LUAMODEL
 #cmakedefine RBDL_BUILD_ADDON_URDFREADER
+#cmakedefine RBDL_BUILD_ADDON_SIMULATION
+#cmakedefine RBDL_BUILD_ADDON_CONTACT
 #cmakedefine RBDL_BUILD_STATIC
 #cmakedefine RBDL_USE_ROS_URDF_LIBRARY
 #cmakedefine RBDL_BUILD_ADDON_MUSCLE_FITTING
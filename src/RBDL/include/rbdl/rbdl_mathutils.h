@@ -79,6 +79,22 @@ RBDL_DLLAPI bool SpatialMatrixCompareEpsilon (const SpatialMatrix &matrix_a,
 RBDL_DLLAPI bool SpatialVectorCompareEpsilon (const SpatialVector &vector_a,
     const SpatialVector &vector_b, double epsilon);
 
+/** \brief Computes the sine and cosine of n values in one pass.
+ *
+ * With RBDL_USE_SIMD_SINCOS (the default) the values are processed with
+ * SSE2 or AVX instructions (whichever is enabled at compile time, a
+ * scalar version of the same polynomials otherwise) and the result is the
+ * same for all instruction sets. The results may then differ from
+ * std::sin() and std::cos() in the last bit. Values with a magnitude
+ * above 1.0e6 as well as non-finite values are always passed on to
+ * std::sin() and std::cos().
+ *
+ * If RBDL was configured with RBDL_USE_SIMD_SINCOS=OFF the results are
+ * identical to std::sin() and std::cos().
+ */
+RBDL_DLLAPI void SinCos (unsigned int n, const double *x, double *s,
+    double *c);
+
 /** \brief Translates the inertia matrix to a new center. */
 RBDL_DLLAPI Matrix3d parallel_axis (const Matrix3d &inertia, double mass, const Vector3d &com);
 
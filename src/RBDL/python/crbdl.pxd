@@ -88,6 +88,11 @@ cdef extern from "<rbdl/SpatialAlgebraOperators.h>" namespace "RigidBodyDynamics
         Vector3d h
         double Ixx, Iyx, Iyy, Izx, Izy, Izz
 
+    cdef cppclass SpatialArticulatedBodyInertia:
+        SpatialArticulatedBodyInertia()
+        SpatialMatrix toMatrix()
+        void createFromMatrix(const SpatialMatrix &mat)
+
 cdef extern from "<rbdl/Body.h>" namespace "RigidBodyDynamics":
     cdef cppclass Body:
         Body()
@@ -203,7 +208,7 @@ cdef extern from "<rbdl/Model.h>" namespace "RigidBodyDynamics":
         vector[unsigned int] multdof3_w_index
 
         vector[SpatialVector] c
-        vector[SpatialMatrix] IA
+        vector[SpatialArticulatedBodyInertia] IA
         vector[SpatialVector] pA
         vector[SpatialVector] U
         VectorNd d
@@ -580,6 +580,50 @@ cdef class SpatialRigidBodyInertia:
         def __set__ (self, value):
             self.thisptr.Izz = value
 
+cdef class SpatialArticulatedBodyInertia:
+    cdef crbdl.SpatialArticulatedBodyInertia *thisptr
+    cdef free_on_dealloc
+
+    def __cinit__(self, uintptr_t address=0):
+        if address == 0:
+            self.free_on_dealloc = True
+            self.thisptr = new crbdl.SpatialArticulatedBodyInertia()
+        else:
+            self.free_on_dealloc = False
+            self.thisptr = <crbdl.SpatialArticulatedBodyInertia*>address
+
+    def __dealloc__(self):
+        if self.free_on_dealloc:
+            del self.thisptr
+
+    def __repr__(self):
+        return "rbdl.SpatialArticulatedBodyInertia (0x{:0x})".format(<uintptr_t><void *> self.thisptr)
+
+    # Constructors
+    @classmethod
+    def fromPointer(cls, uintptr_t address):
+        return SpatialArticulatedBodyInertia (address)
+
+    def toMatrix(self):
+        """ Symmetric 6x6 matrix of the packed inertia. """
+        cdef crbdl.SpatialMatrix mat
+        mat = self.thisptr.toMatrix()
+        result = np.ndarray ([6, 6])
+        for i in range (6):
+            for j in range (6):
+                result[i,j] = mat.coeff(i,j)
+
+        return result
+
+    def fromMatrix(self, value):
+        """ Sets the inertia from a symmetric 6x6 matrix. """
+        cdef crbdl.SpatialMatrix mat
+        for i in range (6):
+            for j in range (6):
+                (&(mat.coeff(i,j)))[0] = value[i][j]
+
+        self.thisptr.createFromMatrix (mat)
+
 ##############################
 #
 # Rigid Multibody Types
@@ -1011,7 +1055,7 @@ cdef class Model:
             return self.thisptr.multdof3_w_index
 
     %VectorWrapperAddProperty (TYPE=SpatialVector, MEMBER=c, PARENT=Model)%
-    %VectorWrapperAddProperty (TYPE=SpatialMatrix, MEMBER=IA, PARENT=Model)%
+    %VectorWrapperAddProperty (TYPE=SpatialArticulatedBodyInertia, MEMBER=IA, PARENT=Model)%
     %VectorWrapperAddProperty (TYPE=SpatialVector, MEMBER=pA, PARENT=Model)%
     %VectorWrapperAddProperty (TYPE=SpatialVector, MEMBER=U, PARENT=Model)%
 
@@ -444,7 +444,9 @@ inline void CompositeRigidBodyAlgorithmPtr (
 			unsigned int dof_index_j = dof_index_i;
 
 			while (model.lambda[j] != 0) {
-				F_63 = model.X_lambda[j].toMatrixTranspose() * (F_63);
+				for (unsigned int k = 0; k < 3; k++) {
+					F_63.col(k) = model.X_lambda[j].applyTranspose (F_63.col(k));
+				}
 				j = model.lambda[j];
 				dof_index_j = model.mJoints[j].q_index;
 
@@ -540,7 +542,7 @@ void ForwardDynamicsPtr (
 		*/
 
 		model.c[i] = model.c_J[i] + crossm(model.v[i],model.v_J[i]);
-		model.I[i].setSpatialMatrix (model.IA[i]);
+		model.IA[i] = model.I[i];
 
 		model.pA[i] = crossf(model.v[i],model.I[i] * model.v[i]);
 
@@ -571,13 +573,13 @@ void ForwardDynamicsPtr (
 //			LOG << "multdof3_u[" << i << "] = " << model.multdof3_u[i].transpose() << std::endl;
 			unsigned int lambda = model.lambda[i];
 			if (lambda != 0) {
-				SpatialMatrix Ia = model.IA[i] - model.multdof3_U[i] * model.multdof3_Dinv[i] * model.multdof3_U[i].transpose();
+				SpatialArticulatedBodyInertia Ia = model.IA[i];
+				Ia.rankUpdate (model.multdof3_U[i], model.multdof3_Dinv[i], -1.);
 				SpatialVector pa = model.pA[i] + Ia * model.c[i] + model.multdof3_U[i] * model.multdof3_Dinv[i] * model.multdof3_u[i];
+				model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
 #ifdef EIGEN_CORE_H
-				model.IA[lambda].noalias() += model.X_lambda[i].toMatrixTranspose() * Ia * model.X_lambda[i].toMatrix();
 				model.pA[lambda].noalias() += model.X_lambda[i].applyTranspose(pa);
 #else
-				model.IA[lambda] += model.X_lambda[i].toMatrixTranspose() * Ia * model.X_lambda[i].toMatrix();
 				model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
 #endif
 				LOG << "pA[" << lambda << "] = " << model.pA[lambda].transpose() << std::endl;
@@ -590,13 +592,13 @@ void ForwardDynamicsPtr (
 
 			unsigned int lambda = model.lambda[i];
 			if (lambda != 0) {
-				SpatialMatrix Ia = model.IA[i] - model.U[i] * (model.U[i] / model.d[i]).transpose();
+				SpatialArticulatedBodyInertia Ia = model.IA[i];
+				Ia.rankUpdate (model.U[i], -1. / model.d[i]);
 				SpatialVector pa = model.pA[i] + Ia * model.c[i] + model.U[i] * model.u[i] / model.d[i];
+				model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
 #ifdef EIGEN_CORE_H
-				model.IA[lambda].noalias() += model.X_lambda[i].toMatrixTranspose() * Ia * model.X_lambda[i].toMatrix();
 				model.pA[lambda].noalias() += model.X_lambda[i].applyTranspose(pa);
 #else
-				model.IA[lambda] += model.X_lambda[i].toMatrixTranspose() * Ia * model.X_lambda[i].toMatrix();
 				model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
 #endif
 				LOG << "pA[" << lambda << "] = " << model.pA[lambda].transpose() << std::endl;
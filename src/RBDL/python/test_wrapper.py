@@ -170,6 +170,25 @@ class SampleModel3R (unittest.TestCase):
 
         assert_almost_equal (tau, tau_id)
 
+    def test_ArticulatedBodyInertia (self):
+        """ Checks the articulated body inertias of ForwardDynamics """
+        rbdl.ForwardDynamics (
+                self.model,
+                self.q,
+                self.qdot,
+                self.tau,
+                self.qddot)
+
+        # the last body has no children: its articulated body inertia is
+        # its rigid body inertia
+        IA = self.model.IA[self.body_3].toMatrix()
+        assert_almost_equal (IA, IA.transpose())
+        assert_almost_equal (np.eye(3), IA[3:6,3:6])
+
+        inertia = rbdl.SpatialArticulatedBodyInertia()
+        inertia.fromMatrix (IA)
+        assert_almost_equal (IA, inertia.toMatrix())
+
     def test_NonlinearEffectsConsistency (self):
         """ Checks whether NonlinearEffects is consistent with InverseDynamics """
         q = np.random.rand (self.model.q_size)
@@ -5,6 +5,7 @@
  * Licensed under the zlib license. See LICENSE for more details.
  */
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <limits>
@@ -271,7 +272,10 @@ bool ConstraintSet::Bind (const Model &model) {
   GT_qr.compute(G.transpose());
   GT_qr_Q = MatrixNd::Zero (model.dof_count, model.dof_count);
   Y = MatrixNd::Zero (model.dof_count, G.rows());
-  Z = MatrixNd::Zero (model.dof_count, model.dof_count - G.rows());
+  // Redundant constraint sets (e.g. many frictional contacts) have more
+  // rows than degrees of freedom and no null-space.
+  Z = MatrixNd::Zero (model.dof_count,
+      std::max (0, static_cast<int>(model.dof_count) - static_cast<int>(G.rows())));
   qddot_y = VectorNd::Zero (model.dof_count);
   qddot_z = VectorNd::Zero (model.dof_count);
 
@@ -1125,7 +1129,7 @@ void ForwardDynamicsApplyConstraintForces (
   unsigned int i = 0;
 
   for (i = 1; i < model.mBodies.size(); i++) {
-    model.IA[i] = model.I[i].toMatrix();;
+    model.IA[i] = model.I[i];
     model.pA[i] = crossf(model.v[i],model.I[i] * model.v[i]);
 
     if (CS.f_ext_constraints[i] != SpatialVector::Zero()) {
@@ -1150,20 +1154,16 @@ void ForwardDynamicsApplyConstraintForces (
         - model.multdof3_S[i].transpose() * model.pA[i];
 
       if (lambda != 0) {
-        SpatialMatrix Ia = model.IA[i] - (model.multdof3_U[i]
-            * model.multdof3_Dinv[i]
-            * model.multdof3_U[i].transpose());
+        SpatialArticulatedBodyInertia Ia = model.IA[i];
+        Ia.rankUpdate (model.multdof3_U[i], model.multdof3_Dinv[i], -1.);
 
         SpatialVector pa = model.pA[i] + Ia * model.c[i]
           + model.multdof3_U[i] * model.multdof3_Dinv[i] * model.multdof3_u[i];
 
+        model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
 #ifdef EIGEN_CORE_H
-        model.IA[lambda].noalias() += (model.X_lambda[i].toMatrixTranspose()
-            * Ia * model.X_lambda[i].toMatrix());
         model.pA[lambda].noalias() += model.X_lambda[i].applyTranspose(pa);
 #else
-        model.IA[lambda] += (model.X_lambda[i].toMatrixTranspose()
-            * Ia * model.X_lambda[i].toMatrix());
         model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
 #endif
         LOG << "pA[" << lambda << "] = " << model.pA[lambda].transpose()
@@ -1175,17 +1175,14 @@ void ForwardDynamicsApplyConstraintForces (
 
       unsigned int lambda = model.lambda[i];
       if (lambda != 0) {
-        SpatialMatrix Ia = model.IA[i]
-          - model.U[i] * (model.U[i] / model.d[i]).transpose();
+        SpatialArticulatedBodyInertia Ia = model.IA[i];
+        Ia.rankUpdate (model.U[i], -1. / model.d[i]);
         SpatialVector pa =  model.pA[i] + Ia * model.c[i]
           + model.U[i] * model.u[i] / model.d[i];
+        model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
 #ifdef EIGEN_CORE_H
-        model.IA[lambda].noalias() += (model.X_lambda[i].toMatrixTranspose()
-            * Ia * model.X_lambda[i].toMatrix());
         model.pA[lambda].noalias() += model.X_lambda[i].applyTranspose(pa);
 #else
-        model.IA[lambda] += (model.X_lambda[i].toMatrixTranspose()
-            * Ia * model.X_lambda[i].toMatrix());
         model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
 #endif
         LOG << "pA[" << lambda << "] = "
@@ -1207,24 +1204,19 @@ void ForwardDynamicsApplyConstraintForces (
             * model.pA[i]);
 
       if (lambda != 0) {
-        SpatialMatrix Ia = model.IA[i]
+        SpatialArticulatedBodyInertia Ia (model.IA[i].toMatrix()
           - (   model.mCustomJoints[kI]->U
               * model.mCustomJoints[kI]->Dinv
-              * model.mCustomJoints[kI]->U.transpose());
+              * model.mCustomJoints[kI]->U.transpose()));
 
         SpatialVector pa = model.pA[i] + Ia * model.c[i]
           + (   model.mCustomJoints[kI]->U
               * model.mCustomJoints[kI]->Dinv
               * model.mCustomJoints[kI]->u);
+        model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
 #ifdef EIGEN_CORE_H
-        model.IA[lambda].noalias() += model.X_lambda[i].toMatrixTranspose()
-          * Ia * model.X_lambda[i].toMatrix();
-
         model.pA[lambda].noalias() += model.X_lambda[i].applyTranspose(pa);
 #else
-        model.IA[lambda] += model.X_lambda[i].toMatrixTranspose()
-          * Ia * model.X_lambda[i].toMatrix();
-
         model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
 #endif
         LOG << "pA[" << lambda << "] = " << model.pA[lambda].transpose()
@@ -18,6 +18,8 @@
 #include "rbdl/Body.h"
 #include "rbdl/Dynamics.h"
 #include "rbdl/Kinematics.h"
+#include "rbdl/SubtreePartition.h"
+#include "rbdl/ThreadPool.h"
 
 namespace RigidBodyDynamics {
 
@@ -36,11 +38,13 @@ RBDL_DLLAPI void InverseDynamics (
   model.v[0].setZero();
   model.a[0].set (0., 0., 0., -model.gravity[0], -model.gravity[1], -model.gravity[2]);
 
+  jcalc_sincos (model, Q);
+
   for (unsigned int i = 1; i < model.mBodies.size(); i++) {
     unsigned int q_index = model.mJoints[i].q_index;
     unsigned int lambda = model.lambda[i];
 
-    jcalc (model, i, Q, QDot);
+    jcalc (model, i, Q, QDot, true);
 
     model.v[i] = model.X_lambda[i].apply(model.v[lambda]) + model.v_J[i];
     model.c[i] = model.c_J[i] + crossm(model.v[i],model.v_J[i]);
@@ -118,8 +122,10 @@ RBDL_DLLAPI void NonlinearEffects (
   model.v[0].setZero();
   model.a[0] = spatial_gravity;
 
+  jcalc_sincos (model, Q);
+
   for (unsigned int i = 1; i < model.mJointUpdateOrder.size(); i++) {
-    jcalc (model, model.mJointUpdateOrder[i], Q, QDot);
+    jcalc (model, model.mJointUpdateOrder[i], Q, QDot, true);
   }
 
   for (unsigned int i = 1; i < model.mBodies.size(); i++) {
@@ -164,6 +170,214 @@ RBDL_DLLAPI void NonlinearEffects (
   }
 }
 
+RBDL_DLLAPI void GeneralizedMomentumEffects (
+    Model &model,
+    const VectorNd &Q,
+    const VectorNd &QDot,
+    VectorNd &Tau,
+    VectorNd *Momentum) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  SpatialVector spatial_gravity (0., 0., 0., -model.gravity[0], -model.gravity[1], -model.gravity[2]);
+
+  model.v[0].setZero();
+  model.a[0] = spatial_gravity;
+
+  jcalc_sincos (model, Q);
+
+  for (unsigned int i = 1; i < model.mJointUpdateOrder.size(); i++) {
+    jcalc (model, model.mJointUpdateOrder[i], Q, QDot, true);
+  }
+
+  // velocities, gravity accelerations, gravity forces and momenta
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    model.v[i] = model.X_lambda[i].apply(model.v[model.lambda[i]]) + model.v_J[i];
+    model.a[i] = model.X_lambda[i].apply(model.a[model.lambda[i]]);
+
+    if (!model.mBodies[i].mIsVirtual) {
+      model.f[i] = model.I[i] * model.a[i];
+      model.hc[i] = model.I[i] * model.v[i];
+    } else {
+      model.f[i].setZero();
+      model.hc[i].setZero();
+    }
+  }
+
+  // f and hc become the composite gravity forces and momenta of the
+  // subtrees, the cross product is not propagated to the parent
+  for (unsigned int i = model.mBodies.size() - 1; i > 0; i--) {
+    SpatialVector beta = model.f[i] + crossf(model.v[i], model.hc[i]);
+
+    if(model.mJoints[i].mJointType != JointTypeCustom){
+      if (model.mJoints[i].mDoFCount == 1) {
+        Tau[model.mJoints[i].q_index] = model.S[i].dot(beta);
+        if (Momentum != NULL) {
+          (*Momentum)[model.mJoints[i].q_index] = model.S[i].dot(model.hc[i]);
+        }
+      } else if (model.mJoints[i].mDoFCount == 3) {
+        Tau.block<3,1>(model.mJoints[i].q_index, 0)
+          = model.multdof3_S[i].transpose() * beta;
+        if (Momentum != NULL) {
+          Momentum->block<3,1>(model.mJoints[i].q_index, 0)
+            = model.multdof3_S[i].transpose() * model.hc[i];
+        }
+      }
+    } else if(model.mJoints[i].mJointType == JointTypeCustom) {
+      unsigned int k = model.mJoints[i].custom_joint_index;
+      Tau.block(model.mJoints[i].q_index,0,
+          model.mCustomJoints[k]->mDoFCount, 1)
+        = model.mCustomJoints[k]->S.transpose() * beta;
+      if (Momentum != NULL) {
+        Momentum->block(model.mJoints[i].q_index,0,
+            model.mCustomJoints[k]->mDoFCount, 1)
+          = model.mCustomJoints[k]->S.transpose() * model.hc[i];
+      }
+    }
+
+    if (model.lambda[i] != 0) {
+      model.f[model.lambda[i]] = model.f[model.lambda[i]] + model.X_lambda[i].applyTranspose(model.f[i]);
+      model.hc[model.lambda[i]] = model.hc[model.lambda[i]] + model.X_lambda[i].applyTranspose(model.hc[i]);
+    }
+  }
+}
+
+/* Fills the entries of H that couple the joint of body i with the joints
+ * of body i and all its ancestors. Requires the final composite inertia
+ * of body i. */
+static inline void CompositeRigidBodyAlgorithmColumns (
+    Model &model,
+    unsigned int i,
+    MatrixNd &H) {
+  unsigned int dof_index_i = model.mJoints[i].q_index;
+
+  if (model.mJoints[i].mDoFCount == 1
+      && model.mJoints[i].mJointType != JointTypeCustom) {
+
+    SpatialVector F             = model.Ic[i] * model.S[i];
+    H(dof_index_i, dof_index_i) = model.S[i].dot(F);
+
+    unsigned int j = i;
+    unsigned int dof_index_j = dof_index_i;
+
+    while (model.lambda[j] != 0) {
+      F = model.X_lambda[j].applyTranspose(F);
+      j = model.lambda[j];
+      dof_index_j = model.mJoints[j].q_index;
+
+      if(model.mJoints[j].mJointType != JointTypeCustom) {
+        if (model.mJoints[j].mDoFCount == 1) {
+          H(dof_index_i,dof_index_j) = F.dot(model.S[j]);
+          H(dof_index_j,dof_index_i) = H(dof_index_i,dof_index_j);
+        } else if (model.mJoints[j].mDoFCount == 3) {
+          Vector3d H_temp2 =
+            (F.transpose() * model.multdof3_S[j]).transpose();
+          LOG << F.transpose() << std::endl
+            << model.multdof3_S[j] << std::endl;
+          LOG << H_temp2.transpose() << std::endl;
+
+          H.block<1,3>(dof_index_i,dof_index_j) = H_temp2.transpose();
+          H.block<3,1>(dof_index_j,dof_index_i) = H_temp2;
+        }
+      } else if (model.mJoints[j].mJointType == JointTypeCustom){
+        unsigned int k      = model.mJoints[j].custom_joint_index;
+        unsigned int dof    = model.mCustomJoints[k]->mDoFCount;
+        VectorNd H_temp2    =
+          (F.transpose() * model.mCustomJoints[k]->S).transpose();
+
+        LOG << F.transpose()
+          << std::endl
+          << model.mCustomJoints[j]->S << std::endl;
+
+        LOG << H_temp2.transpose() << std::endl;
+
+        H.block(dof_index_i,dof_index_j,1,dof) = H_temp2.transpose();
+        H.block(dof_index_j,dof_index_i,dof,1) = H_temp2;
+      }
+    }
+  } else if (model.mJoints[i].mDoFCount == 3
+      && model.mJoints[i].mJointType != JointTypeCustom) {
+    Matrix63 F_63 = model.Ic[i].toMatrix() * model.multdof3_S[i];
+    H.block<3,3>(dof_index_i, dof_index_i) = model.multdof3_S[i].transpose() * F_63;
+
+    unsigned int j = i;
+    unsigned int dof_index_j = dof_index_i;
+
+    while (model.lambda[j] != 0) {
+      for (unsigned int k = 0; k < 3; k++) {
+        F_63.col(k) = model.X_lambda[j].applyTranspose (F_63.col(k));
+      }
+      j = model.lambda[j];
+      dof_index_j = model.mJoints[j].q_index;
+
+      if(model.mJoints[j].mJointType != JointTypeCustom){
+        if (model.mJoints[j].mDoFCount == 1) {
+          Vector3d H_temp2 = F_63.transpose() * (model.S[j]);
+
+          H.block<3,1>(dof_index_i,dof_index_j) = H_temp2;
+          H.block<1,3>(dof_index_j,dof_index_i) = H_temp2.transpose();
+        } else if (model.mJoints[j].mDoFCount == 3) {
+          Matrix3d H_temp2 = F_63.transpose() * (model.multdof3_S[j]);
+
+          H.block<3,3>(dof_index_i,dof_index_j) = H_temp2;
+          H.block<3,3>(dof_index_j,dof_index_i) = H_temp2.transpose();
+        }
+      } else if (model.mJoints[j].mJointType == JointTypeCustom){
+        unsigned int k = model.mJoints[j].custom_joint_index;
+        unsigned int dof = model.mCustomJoints[k]->mDoFCount;
+
+        MatrixNd H_temp2 = F_63.transpose() * (model.mCustomJoints[k]->S);
+
+        H.block(dof_index_i,dof_index_j,3,dof) = H_temp2;
+        H.block(dof_index_j,dof_index_i,dof,3) = H_temp2.transpose();
+      }
+    }
+  } else if (model.mJoints[i].mJointType == JointTypeCustom) {
+    unsigned int kI = model.mJoints[i].custom_joint_index;
+    unsigned int dofI = model.mCustomJoints[kI]->mDoFCount;
+
+    MatrixNd F_Nd = model.Ic[i].toMatrix()
+      * model.mCustomJoints[kI]->S;
+
+    H.block(dof_index_i, dof_index_i,dofI,dofI)
+      = model.mCustomJoints[kI]->S.transpose() * F_Nd;
+
+    unsigned int j = i;
+    unsigned int dof_index_j = dof_index_i;
+
+    while (model.lambda[j] != 0) {
+      for (unsigned int k = 0; k < F_Nd.cols(); k++) {
+        F_Nd.col(k) = model.X_lambda[j].applyTranspose (F_Nd.col(k));
+      }
+      j = model.lambda[j];
+      dof_index_j = model.mJoints[j].q_index;
+
+      if(model.mJoints[j].mJointType != JointTypeCustom){
+        if (model.mJoints[j].mDoFCount == 1) {
+          MatrixNd H_temp2 = F_Nd.transpose() * (model.S[j]);
+          H.block(   dof_index_i,  dof_index_j,
+              H_temp2.rows(),H_temp2.cols()) = H_temp2;
+          H.block(dof_index_j,dof_index_i,
+              H_temp2.cols(),H_temp2.rows()) = H_temp2.transpose();
+        } else if (model.mJoints[j].mDoFCount == 3) {
+          MatrixNd H_temp2 = F_Nd.transpose() * (model.multdof3_S[j]);
+          H.block(dof_index_i,   dof_index_j,
+              H_temp2.rows(),H_temp2.cols()) = H_temp2;
+          H.block(dof_index_j,   dof_index_i,
+              H_temp2.cols(),H_temp2.rows()) = H_temp2.transpose();
+        }
+      } else if (model.mJoints[j].mJointType == JointTypeCustom){
+        unsigned int k   = model.mJoints[j].custom_joint_index;
+        unsigned int dof = model.mCustomJoints[k]->mDoFCount;
+
+        MatrixNd H_temp2 = F_Nd.transpose() * (model.mCustomJoints[k]->S);
+
+        H.block(dof_index_i,dof_index_j,3,dof) = H_temp2;
+        H.block(dof_index_j,dof_index_i,dof,3) = H_temp2.transpose();
+      }
+    }
+  }
+}
+
 RBDL_DLLAPI void CompositeRigidBodyAlgorithm (
     Model& model,
     const VectorNd &Q,
@@ -173,9 +387,13 @@ RBDL_DLLAPI void CompositeRigidBodyAlgorithm (
 
   assert (H.rows() == model.dof_count && H.cols() == model.dof_count);
 
+  if (update_kinematics) {
+    jcalc_sincos (model, Q);
+  }
+
   for (unsigned int i = 1; i < model.mBodies.size(); i++) {
     if (update_kinematics) {
-      jcalc_X_lambda_S (model, i, Q);
+      jcalc_X_lambda_S (model, i, Q, true);
     }
     model.Ic[i] = model.I[i];
   }
@@ -185,130 +403,262 @@ RBDL_DLLAPI void CompositeRigidBodyAlgorithm (
       model.Ic[model.lambda[i]] = model.Ic[model.lambda[i]] + model.X_lambda[i].applyTranspose(model.Ic[i]);
     }
 
-    unsigned int dof_index_i = model.mJoints[i].q_index;
+    CompositeRigidBodyAlgorithmColumns (model, i, H);
+  }
+}
 
-    if (model.mJoints[i].mDoFCount == 1
-        && model.mJoints[i].mJointType != JointTypeCustom) {
+RBDL_DLLAPI void CompositeRigidBodyAlgorithmParallel (
+    Model& model,
+    const VectorNd &Q,
+    MatrixNd &H,
+    ThreadPool &pool,
+    const SubtreePartition &partition,
+    bool update_kinematics) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
 
-      SpatialVector F             = model.Ic[i] * model.S[i];
-      H(dof_index_i, dof_index_i) = model.S[i].dot(F);
-
-      unsigned int j = i;
-      unsigned int dof_index_j = dof_index_i;
-
-      while (model.lambda[j] != 0) {
-        F = model.X_lambda[j].applyTranspose(F);
-        j = model.lambda[j];
-        dof_index_j = model.mJoints[j].q_index;
-
-        if(model.mJoints[j].mJointType != JointTypeCustom) {
-          if (model.mJoints[j].mDoFCount == 1) {
-            H(dof_index_i,dof_index_j) = F.dot(model.S[j]);
-            H(dof_index_j,dof_index_i) = H(dof_index_i,dof_index_j);
-          } else if (model.mJoints[j].mDoFCount == 3) {
-            Vector3d H_temp2 =
-              (F.transpose() * model.multdof3_S[j]).transpose();
-            LOG << F.transpose() << std::endl
-              << model.multdof3_S[j] << std::endl;
-            LOG << H_temp2.transpose() << std::endl;
-
-            H.block<1,3>(dof_index_i,dof_index_j) = H_temp2.transpose();
-            H.block<3,1>(dof_index_j,dof_index_i) = H_temp2;
-          }
-        } else if (model.mJoints[j].mJointType == JointTypeCustom){
-          unsigned int k      = model.mJoints[j].custom_joint_index;
-          unsigned int dof    = model.mCustomJoints[k]->mDoFCount;
-          VectorNd H_temp2    =
-            (F.transpose() * model.mCustomJoints[k]->S).transpose();
-
-          LOG << F.transpose()
-            << std::endl
-            << model.mCustomJoints[j]->S << std::endl;
+  assert (H.rows() == model.dof_count && H.cols() == model.dof_count);
+  assert (partition.body_count == model.mBodies.size());
 
-          LOG << H_temp2.transpose() << std::endl;
+  if (update_kinematics) {
+    jcalc_sincos (model, Q);
+  }
 
-          H.block(dof_index_i,dof_index_j,1,dof) = H_temp2.transpose();
-          H.block(dof_index_j,dof_index_i,dof,1) = H_temp2;
+  for (unsigned int k = 0; k < partition.top_bodies.size(); k++) {
+    unsigned int i = partition.top_bodies[k];
+    if (update_kinematics) {
+      jcalc_X_lambda_S (model, i, Q, true);
+    }
+    model.Ic[i] = model.I[i];
+  }
+
+  // The entries of H that belong to a body only depend on its composite
+  // inertia and the transformations along its path to the root, so every
+  // subtree fills its own rows and columns. The composite inertias of the
+  // subtree roots are added to their parents below in the same order as
+  // in CompositeRigidBodyAlgorithm().
+  pool.ParallelFor (0, partition.roots.size(),
+      [&model, &Q, &H, &partition, update_kinematics] (unsigned int s,
+        unsigned int) {
+      const std::vector<unsigned int> &bodies = partition.subtree_bodies[s];
+
+      for (unsigned int k = 0; k < bodies.size(); k++) {
+        unsigned int i = bodies[k];
+        if (update_kinematics) {
+          jcalc_X_lambda_S (model, i, Q, true);
         }
+        model.Ic[i] = model.I[i];
       }
-    } else if (model.mJoints[i].mDoFCount == 3
-        && model.mJoints[i].mJointType != JointTypeCustom) {
-      Matrix63 F_63 = model.Ic[i].toMatrix() * model.multdof3_S[i];
-      H.block<3,3>(dof_index_i, dof_index_i) = model.multdof3_S[i].transpose() * F_63;
 
-      unsigned int j = i;
-      unsigned int dof_index_j = dof_index_i;
+      for (unsigned int k = bodies.size(); k > 0; k--) {
+        unsigned int i = bodies[k - 1];
 
-      while (model.lambda[j] != 0) {
-        F_63 = model.X_lambda[j].toMatrixTranspose() * (F_63);
-        j = model.lambda[j];
-        dof_index_j = model.mJoints[j].q_index;
+        if (k > 1) {
+          model.Ic[model.lambda[i]] = model.Ic[model.lambda[i]] + model.X_lambda[i].applyTranspose(model.Ic[i]);
+        }
 
-        if(model.mJoints[j].mJointType != JointTypeCustom){
-          if (model.mJoints[j].mDoFCount == 1) {
-            Vector3d H_temp2 = F_63.transpose() * (model.S[j]);
+        CompositeRigidBodyAlgorithmColumns (model, i, H);
+      }
+      });
 
-            H.block<3,1>(dof_index_i,dof_index_j) = H_temp2;
-            H.block<1,3>(dof_index_j,dof_index_i) = H_temp2.transpose();
-          } else if (model.mJoints[j].mDoFCount == 3) {
-            Matrix3d H_temp2 = F_63.transpose() * (model.multdof3_S[j]);
+  for (unsigned int k = partition.joint_bodies.size(); k > 0; k--) {
+    unsigned int i = partition.joint_bodies[k - 1];
 
-            H.block<3,3>(dof_index_i,dof_index_j) = H_temp2;
-            H.block<3,3>(dof_index_j,dof_index_i) = H_temp2.transpose();
-          }
-        } else if (model.mJoints[j].mJointType == JointTypeCustom){
-          unsigned int k = model.mJoints[j].custom_joint_index;
-          unsigned int dof = model.mCustomJoints[k]->mDoFCount;
+    if (model.lambda[i] != 0) {
+      model.Ic[model.lambda[i]] = model.Ic[model.lambda[i]] + model.X_lambda[i].applyTranspose(model.Ic[i]);
+    }
 
-          MatrixNd H_temp2 = F_63.transpose() * (model.mCustomJoints[k]->S);
+    if (!partition.is_subtree_root[i]) {
+      CompositeRigidBodyAlgorithmColumns (model, i, H);
+    }
+  }
+}
 
-          H.block(dof_index_i,dof_index_j,3,dof) = H_temp2;
-          H.block(dof_index_j,dof_index_i,dof,3) = H_temp2.transpose();
-        }
-      }
-    } else if (model.mJoints[i].mJointType == JointTypeCustom) {
-      unsigned int kI = model.mJoints[i].custom_joint_index;
-      unsigned int dofI = model.mCustomJoints[kI]->mDoFCount;
-
-      MatrixNd F_Nd = model.Ic[i].toMatrix()
-        * model.mCustomJoints[kI]->S;
-
-      H.block(dof_index_i, dof_index_i,dofI,dofI)
-        = model.mCustomJoints[kI]->S.transpose() * F_Nd;
-
-      unsigned int j = i;
-      unsigned int dof_index_j = dof_index_i;
-
-      while (model.lambda[j] != 0) {
-        F_Nd = model.X_lambda[j].toMatrixTranspose() * (F_Nd);
-        j = model.lambda[j];
-        dof_index_j = model.mJoints[j].q_index;
-
-        if(model.mJoints[j].mJointType != JointTypeCustom){
-          if (model.mJoints[j].mDoFCount == 1) {
-            MatrixNd H_temp2 = F_Nd.transpose() * (model.S[j]);
-            H.block(   dof_index_i,  dof_index_j,
-                H_temp2.rows(),H_temp2.cols()) = H_temp2;
-            H.block(dof_index_j,dof_index_i,
-                H_temp2.cols(),H_temp2.rows()) = H_temp2.transpose();
-          } else if (model.mJoints[j].mDoFCount == 3) {
-            MatrixNd H_temp2 = F_Nd.transpose() * (model.multdof3_S[j]);
-            H.block(dof_index_i,   dof_index_j,
-                H_temp2.rows(),H_temp2.cols()) = H_temp2;
-            H.block(dof_index_j,   dof_index_i,
-                H_temp2.cols(),H_temp2.rows()) = H_temp2.transpose();
-          }
-        } else if (model.mJoints[j].mJointType == JointTypeCustom){
-          unsigned int k   = model.mJoints[j].custom_joint_index;
-          unsigned int dof = model.mCustomJoints[k]->mDoFCount;
-
-          MatrixNd H_temp2 = F_Nd.transpose() * (model.mCustomJoints[k]->S);
-
-          H.block(dof_index_i,dof_index_j,3,dof) = H_temp2;
-          H.block(dof_index_j,dof_index_i,dof,3) = H_temp2.transpose();
-        }
-      }
+/* First sweep of the ABA for body i: joint kinematics, velocity, bias
+ * acceleration and the rigid body inertia and bias force. */
+static inline void ForwardDynamicsVelocities (
+    Model &model,
+    unsigned int i,
+    const VectorNd &Q,
+    const VectorNd &QDot,
+    std::vector<SpatialVector> *f_ext) {
+  unsigned int lambda = model.lambda[i];
+
+  jcalc (model, i, Q, QDot, true);
+
+  if (lambda != 0)
+    model.X_base[i] = model.X_lambda[i] * model.X_base[lambda];
+  else
+    model.X_base[i] = model.X_lambda[i];
+
+  model.v[i] = model.X_lambda[i].apply( model.v[lambda]) + model.v_J[i];
+
+  /*
+     LOG << "X_J (" << i << "):" << std::endl << X_J << std::endl;
+     LOG << "v_J (" << i << "):" << std::endl << v_J << std::endl;
+     LOG << "v_lambda" << i << ":" << std::endl << model.v.at(lambda) << std::endl;
+     LOG << "X_base (" << i << "):" << std::endl << model.X_base[i] << std::endl;
+     LOG << "X_lambda (" << i << "):" << std::endl << model.X_lambda[i] << std::endl;
+     LOG << "SpatialVelocity (" << i << "): " << model.v[i] << std::endl;
+     */
+  model.c[i] = model.c_J[i] + crossm(model.v[i],model.v_J[i]);
+  model.IA[i] = model.I[i];
+
+  model.pA[i] = crossf(model.v[i],model.I[i] * model.v[i]);
+
+  if (f_ext != NULL && (*f_ext)[i] != SpatialVector::Zero()) {
+    LOG << "External force (" << i << ") = " << model.X_base[i].toMatrixAdjoint() * (*f_ext)[i] << std::endl;
+    model.pA[i] -= model.X_base[i].toMatrixAdjoint() * (*f_ext)[i];
+  }
+}
+
+/* Second sweep of the ABA for body i: projects the articulated body
+ * inertia and bias force of body i onto its joint. Requires that all
+ * children of body i were propagated with
+ * ForwardDynamicsPropagateArticulatedInertia(). */
+static inline void ForwardDynamicsArticulatedInertia (
+    Model &model,
+    unsigned int i,
+    const VectorNd &Tau) {
+  unsigned int q_index = model.mJoints[i].q_index;
+
+  if (model.mJoints[i].mDoFCount == 1
+      && model.mJoints[i].mJointType != JointTypeCustom) {
+    model.U[i] = model.IA[i] * model.S[i];
+    model.d[i] = model.S[i].dot(model.U[i]);
+    model.u[i] = Tau[q_index] - model.S[i].dot(model.pA[i]);
+    //      LOG << "u[" << i << "] = " << model.u[i] << std::endl;
+  } else if (model.mJoints[i].mDoFCount == 3
+      && model.mJoints[i].mJointType != JointTypeCustom) {
+    model.multdof3_U[i] = model.IA[i] * model.multdof3_S[i];
+#ifdef EIGEN_CORE_H
+    model.multdof3_Dinv[i] = (model.multdof3_S[i].transpose()
+        * model.multdof3_U[i]).inverse().eval();
+#else
+    model.multdof3_Dinv[i] = (model.multdof3_S[i].transpose()
+        * model.multdof3_U[i]).inverse();
+#endif
+    Vector3d tau_temp(Tau.block(q_index,0,3,1));
+    model.multdof3_u[i] = tau_temp
+      - model.multdof3_S[i].transpose() * model.pA[i];
+
+    // LOG << "multdof3_u[" << i << "] = "
+    //                      << model.multdof3_u[i].transpose() << std::endl;
+  } else if (model.mJoints[i].mJointType == JointTypeCustom) {
+    unsigned int kI   = model.mJoints[i].custom_joint_index;
+    unsigned int dofI = model.mCustomJoints[kI]->mDoFCount;
+    model.mCustomJoints[kI]->U =
+      model.IA[i].toMatrix() * model.mCustomJoints[kI]->S;
+
+#ifdef EIGEN_CORE_H
+    model.mCustomJoints[kI]->Dinv
+      = (model.mCustomJoints[kI]->S.transpose()
+          * model.mCustomJoints[kI]->U).inverse().eval();
+#else
+    model.mCustomJoints[kI]->Dinv
+      = (model.mCustomJoints[kI]->S.transpose()
+          * model.mCustomJoints[kI]->U).inverse();
+#endif
+    VectorNd tau_temp(Tau.block(q_index,0,dofI,1));
+    model.mCustomJoints[kI]->u = tau_temp
+      - model.mCustomJoints[kI]->S.transpose() * model.pA[i];
+
+    //      LOG << "multdof3_u[" << i << "] = "
+    //      << model.multdof3_u[i].transpose() << std::endl;
+  }
+}
+
+/* Second sweep of the ABA for body i: adds the articulated body inertia
+ * and bias force that body i transmits through its joint to its parent
+ * (which must not be the root). */
+static inline void ForwardDynamicsPropagateArticulatedInertia (
+    Model &model,
+    unsigned int i) {
+  unsigned int lambda = model.lambda[i];
+  assert (lambda != 0);
+
+  SpatialArticulatedBodyInertia Ia;
+  SpatialVector pa;
+
+  if (model.mJoints[i].mDoFCount == 1
+      && model.mJoints[i].mJointType != JointTypeCustom) {
+    Ia = model.IA[i];
+    Ia.rankUpdate (model.U[i], -1. / model.d[i]);
+
+    pa =  model.pA[i]
+      + Ia * model.c[i]
+      + model.U[i] * model.u[i] / model.d[i];
+  } else if (model.mJoints[i].mDoFCount == 3
+      && model.mJoints[i].mJointType != JointTypeCustom) {
+    Ia = model.IA[i];
+    Ia.rankUpdate (model.multdof3_U[i], model.multdof3_Dinv[i], -1.);
+    pa = model.pA[i]
+      + Ia
+      * model.c[i]
+      + model.multdof3_U[i]
+      * model.multdof3_Dinv[i]
+      * model.multdof3_u[i];
+  } else if (model.mJoints[i].mJointType == JointTypeCustom) {
+    unsigned int kI = model.mJoints[i].custom_joint_index;
+    Ia = SpatialArticulatedBodyInertia (model.IA[i].toMatrix()
+        - (model.mCustomJoints[kI]->U
+          * model.mCustomJoints[kI]->Dinv
+          * model.mCustomJoints[kI]->U.transpose()));
+    pa =  model.pA[i]
+      + Ia * model.c[i]
+      + (model.mCustomJoints[kI]->U
+          * model.mCustomJoints[kI]->Dinv
+          * model.mCustomJoints[kI]->u);
+  }
+
+  model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
+#ifdef EIGEN_CORE_H
+  model.pA[lambda].noalias()
+    += model.X_lambda[i].applyTranspose(pa);
+#else
+  model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
+#endif
+  LOG << "pA[" << lambda << "] = "
+    << model.pA[lambda].transpose() << std::endl;
+}
+
+/* Third sweep of the ABA for body i: joint and body accelerations. */
+static inline void ForwardDynamicsAccelerations (
+    Model &model,
+    unsigned int i,
+    VectorNd &QDDot) {
+  unsigned int q_index = model.mJoints[i].q_index;
+  unsigned int lambda = model.lambda[i];
+  SpatialTransform X_lambda = model.X_lambda[i];
+
+  model.a[i] = X_lambda.apply(model.a[lambda]) + model.c[i];
+  LOG << "a'[" << i << "] = " << model.a[i].transpose() << std::endl;
+
+  if (model.mJoints[i].mDoFCount == 1
+      && model.mJoints[i].mJointType != JointTypeCustom) {
+    QDDot[q_index] = (1./model.d[i]) * (model.u[i] - model.U[i].dot(model.a[i]));
+    model.a[i] = model.a[i] + model.S[i] * QDDot[q_index];
+  } else if (model.mJoints[i].mDoFCount == 3
+      && model.mJoints[i].mJointType != JointTypeCustom) {
+    Vector3d qdd_temp = model.multdof3_Dinv[i] * (model.multdof3_u[i] - model.multdof3_U[i].transpose() * model.a[i]);
+    QDDot[q_index] = qdd_temp[0];
+    QDDot[q_index + 1] = qdd_temp[1];
+    QDDot[q_index + 2] = qdd_temp[2];
+    model.a[i] = model.a[i] + model.multdof3_S[i] * qdd_temp;
+  } else if (model.mJoints[i].mJointType == JointTypeCustom) {
+    unsigned int kI = model.mJoints[i].custom_joint_index;
+    unsigned int dofI=model.mCustomJoints[kI]->mDoFCount;
+
+    VectorNd qdd_temp = model.mCustomJoints[kI]->Dinv
+      * (  model.mCustomJoints[kI]->u
+          - model.mCustomJoints[kI]->U.transpose()
+          * model.a[i]);
+
+    for(unsigned int z=0; z < dofI; ++z){
+      QDDot[q_index+z] = qdd_temp[z];
     }
+
+    model.a[i] = model.a[i]
+      + model.mCustomJoints[kI]->S * qdd_temp;
   }
 }
 
@@ -333,220 +683,319 @@ RBDL_DLLAPI void ForwardDynamics (
   // Reset the velocity of the root body
   model.v[0].setZero();
 
+  jcalc_sincos (model, Q);
+
   for (i = 1; i < model.mBodies.size(); i++) {
-    unsigned int lambda = model.lambda[i];
+    ForwardDynamicsVelocities (model, i, Q, QDot, f_ext);
+  }
 
-    jcalc (model, i, Q, QDot);
+  // ClearLogOutput();
 
-    if (lambda != 0)
-      model.X_base[i] = model.X_lambda[i] * model.X_base[lambda];
-    else
-      model.X_base[i] = model.X_lambda[i];
-
-    model.v[i] = model.X_lambda[i].apply( model.v[lambda]) + model.v_J[i];
-
-    /*
-       LOG << "X_J (" << i << "):" << std::endl << X_J << std::endl;
-       LOG << "v_J (" << i << "):" << std::endl << v_J << std::endl;
-       LOG << "v_lambda" << i << ":" << std::endl << model.v.at(lambda) << std::endl;
-       LOG << "X_base (" << i << "):" << std::endl << model.X_base[i] << std::endl;
-       LOG << "X_lambda (" << i << "):" << std::endl << model.X_lambda[i] << std::endl;
-       LOG << "SpatialVelocity (" << i << "): " << model.v[i] << std::endl;
-       */
-    model.c[i] = model.c_J[i] + crossm(model.v[i],model.v_J[i]);
-    model.I[i].setSpatialMatrix (model.IA[i]);
+  LOG << "--- first loop ---" << std::endl;
 
-    model.pA[i] = crossf(model.v[i],model.I[i] * model.v[i]);
+  for (i = model.mBodies.size() - 1; i > 0; i--) {
+    ForwardDynamicsArticulatedInertia (model, i, Tau);
 
-    if (f_ext != NULL && (*f_ext)[i] != SpatialVector::Zero()) {
-      LOG << "External force (" << i << ") = " << model.X_base[i].toMatrixAdjoint() * (*f_ext)[i] << std::endl;
-      model.pA[i] -= model.X_base[i].toMatrixAdjoint() * (*f_ext)[i];
+    if (model.lambda[i] != 0) {
+      ForwardDynamicsPropagateArticulatedInertia (model, i);
     }
   }
 
-  // ClearLogOutput();
+  //  ClearLogOutput();
 
-  LOG << "--- first loop ---" << std::endl;
+  model.a[0] = spatial_gravity * -1.;
 
-  for (i = model.mBodies.size() - 1; i > 0; i--) {
-    unsigned int q_index = model.mJoints[i].q_index;
+  for (i = 1; i < model.mBodies.size(); i++) {
+    ForwardDynamicsAccelerations (model, i, QDDot);
+  }
 
-    if (model.mJoints[i].mDoFCount == 1
-        && model.mJoints[i].mJointType != JointTypeCustom) {
+  LOG << "QDDot = " << QDDot.transpose() << std::endl;
+}
 
-      model.U[i] = model.IA[i] * model.S[i];
-      model.d[i] = model.S[i].dot(model.U[i]);
-      model.u[i] = Tau[q_index] - model.S[i].dot(model.pA[i]);
-      //      LOG << "u[" << i << "] = " << model.u[i] << std::endl;
+RBDL_DLLAPI void ForwardDynamicsParallel (
+    Model &model,
+    const VectorNd &Q,
+    const VectorNd &QDot,
+    const VectorNd &Tau,
+    VectorNd &QDDot,
+    ThreadPool &pool,
+    const SubtreePartition &partition,
+    std::vector<SpatialVector> *f_ext) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
 
-      unsigned int lambda = model.lambda[i];
-      if (lambda != 0) {
-        SpatialMatrix Ia =    model.IA[i]
-          - model.U[i]
-          * (model.U[i] / model.d[i]).transpose();
+  assert (partition.body_count == model.mBodies.size());
 
-        SpatialVector pa =  model.pA[i]
-          + Ia * model.c[i]
-          + model.U[i] * model.u[i] / model.d[i];
+  SpatialVector spatial_gravity (0., 0., 0., model.gravity[0], model.gravity[1], model.gravity[2]);
 
-#ifdef EIGEN_CORE_H
-        model.IA[lambda].noalias()
-          += model.X_lambda[i].toMatrixTranspose()
-          * Ia * model.X_lambda[i].toMatrix();
-        model.pA[lambda].noalias()
-          += model.X_lambda[i].applyTranspose(pa);
-#else
-        model.IA[lambda]
-          += model.X_lambda[i].toMatrixTranspose()
-          * Ia * model.X_lambda[i].toMatrix();
+  model.v[0].setZero();
 
-        model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
-#endif
-        LOG << "pA[" << lambda << "] = "
-          << model.pA[lambda].transpose() << std::endl;
-      }
-    } else if (model.mJoints[i].mDoFCount == 3
-        && model.mJoints[i].mJointType != JointTypeCustom) {
-      model.multdof3_U[i] = model.IA[i] * model.multdof3_S[i];
-#ifdef EIGEN_CORE_H
-      model.multdof3_Dinv[i] = (model.multdof3_S[i].transpose()
-          * model.multdof3_U[i]).inverse().eval();
-#else
-      model.multdof3_Dinv[i] = (model.multdof3_S[i].transpose()
-          * model.multdof3_U[i]).inverse();
-#endif
-      Vector3d tau_temp(Tau.block(q_index,0,3,1));
-      model.multdof3_u[i] = tau_temp
-        - model.multdof3_S[i].transpose() * model.pA[i];
+  jcalc_sincos (model, Q);
 
-      // LOG << "multdof3_u[" << i << "] = "
-      //                      << model.multdof3_u[i].transpose() << std::endl;
-      unsigned int lambda = model.lambda[i];
-      if (lambda != 0) {
-        SpatialMatrix Ia = model.IA[i]
-          - model.multdof3_U[i]
-          * model.multdof3_Dinv[i]
-          * model.multdof3_U[i].transpose();
-        SpatialVector pa = model.pA[i]
-          + Ia
-          * model.c[i]
-          + model.multdof3_U[i]
-          * model.multdof3_Dinv[i]
-          * model.multdof3_u[i];
-#ifdef EIGEN_CORE_H
-        model.IA[lambda].noalias()
-          += model.X_lambda[i].toMatrixTranspose()
-          * Ia
-          * model.X_lambda[i].toMatrix();
+  for (unsigned int k = 0; k < partition.top_bodies.size(); k++) {
+    ForwardDynamicsVelocities (model, partition.top_bodies[k], Q, QDot,
+        f_ext);
+  }
 
-        model.pA[lambda].noalias()
-          += model.X_lambda[i].applyTranspose(pa);
-#else
-        model.IA[lambda]
-          += model.X_lambda[i].toMatrixTranspose()
-          * Ia
-          * model.X_lambda[i].toMatrix();
+  // The first two sweeps of a subtree only depend on the subtree itself
+  // and the velocity of the parent of its root. The contribution of the
+  // subtree root to its parent is added below so that every body
+  // accumulates the contributions of its children in the same order as in
+  // ForwardDynamics().
+  pool.ParallelFor (0, partition.roots.size(),
+      [&model, &Q, &QDot, &Tau, &partition, f_ext] (unsigned int s,
+        unsigned int) {
+      const std::vector<unsigned int> &bodies = partition.subtree_bodies[s];
+
+      for (unsigned int k = 0; k < bodies.size(); k++) {
+        ForwardDynamicsVelocities (model, bodies[k], Q, QDot, f_ext);
+      }
 
-        model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
-#endif
-        LOG << "pA[" << lambda << "] = "
-          << model.pA[lambda].transpose()
-          << std::endl;
+      for (unsigned int k = bodies.size(); k > 0; k--) {
+        unsigned int i = bodies[k - 1];
+        ForwardDynamicsArticulatedInertia (model, i, Tau);
+
+        if (k > 1) {
+          ForwardDynamicsPropagateArticulatedInertia (model, i);
+        }
       }
-    } else if (model.mJoints[i].mJointType == JointTypeCustom) {
-      unsigned int kI   = model.mJoints[i].custom_joint_index;
-      unsigned int dofI = model.mCustomJoints[kI]->mDoFCount;
-      model.mCustomJoints[kI]->U =
-        model.IA[i] * model.mCustomJoints[kI]->S;
+      });
 
-#ifdef EIGEN_CORE_H
-      model.mCustomJoints[kI]->Dinv
-        = (model.mCustomJoints[kI]->S.transpose()
-            * model.mCustomJoints[kI]->U).inverse().eval();
-#else
-      model.mCustomJoints[kI]->Dinv
-        = (model.mCustomJoints[kI]->S.transpose()
-            * model.mCustomJoints[kI]->U).inverse();
-#endif
-      VectorNd tau_temp(Tau.block(q_index,0,dofI,1));
-      model.mCustomJoints[kI]->u = tau_temp
-        - model.mCustomJoints[kI]->S.transpose() * model.pA[i];
+  for (unsigned int k = partition.joint_bodies.size(); k > 0; k--) {
+    unsigned int i = partition.joint_bodies[k - 1];
 
-      //      LOG << "multdof3_u[" << i << "] = "
-      //      << model.multdof3_u[i].transpose() << std::endl;
-      unsigned int lambda = model.lambda[i];
-      if (lambda != 0) {
-        SpatialMatrix Ia = model.IA[i]
-          - (model.mCustomJoints[kI]->U
-              * model.mCustomJoints[kI]->Dinv
-              * model.mCustomJoints[kI]->U.transpose());
-        SpatialVector pa =  model.pA[i]
-          + Ia * model.c[i]
-          + (model.mCustomJoints[kI]->U
-              * model.mCustomJoints[kI]->Dinv
-              * model.mCustomJoints[kI]->u);
+    if (!partition.is_subtree_root[i]) {
+      ForwardDynamicsArticulatedInertia (model, i, Tau);
+    }
 
-#ifdef EIGEN_CORE_H
-        model.IA[lambda].noalias() += model.X_lambda[i].toMatrixTranspose()
-          * Ia
-          * model.X_lambda[i].toMatrix();
-        model.pA[lambda].noalias() += model.X_lambda[i].applyTranspose(pa);
-#else
-        model.IA[lambda] += model.X_lambda[i].toMatrixTranspose()
-          * Ia
-          * model.X_lambda[i].toMatrix();
-        model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
-#endif
-        LOG << "pA[" << lambda << "] = "
-          << model.pA[lambda].transpose()
-          << std::endl;
+    if (model.lambda[i] != 0) {
+      ForwardDynamicsPropagateArticulatedInertia (model, i);
+    }
+  }
+
+  model.a[0] = spatial_gravity * -1.;
+
+  for (unsigned int k = 0; k < partition.top_bodies.size(); k++) {
+    ForwardDynamicsAccelerations (model, partition.top_bodies[k], QDDot);
+  }
+
+  pool.ParallelFor (0, partition.roots.size(),
+      [&model, &QDDot, &partition] (unsigned int s, unsigned int) {
+      const std::vector<unsigned int> &bodies = partition.subtree_bodies[s];
+
+      for (unsigned int k = 0; k < bodies.size(); k++) {
+        ForwardDynamicsAccelerations (model, bodies[k], QDDot);
       }
+      });
+
+  LOG << "QDDot = " << QDDot.transpose() << std::endl;
+}
+
+#ifndef RBDL_USE_SIMPLE_MATH
+typedef Eigen::Matrix<double, 6, Eigen::Dynamic, 0, 6, 6> HybridSubspace;
+typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, 6, 1> HybridVector;
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, 6, 6>
+  HybridMatrix;
+
+/* Number of degrees of freedom of the joint of body i whose accelerations
+ * are prescribed. */
+static inline unsigned int HybridDynamicsPrescribedCount (
+    const Model &model,
+    unsigned int i,
+    const std::vector<bool> &prescribed) {
+  unsigned int q_index = model.mJoints[i].q_index;
+  unsigned int count = 0;
+
+  for (unsigned int z = 0; z < model.mJoints[i].mDoFCount; z++) {
+    if (prescribed[q_index + z]) {
+      count++;
     }
   }
 
-  //  ClearLogOutput();
+  return count;
+}
 
-  model.a[0] = spatial_gravity * -1.;
+/* Motion subspace of the joint of body i. */
+static inline HybridSubspace HybridDynamicsJointSubspace (
+    const Model &model,
+    unsigned int i) {
+  if (model.mJoints[i].mJointType == JointTypeCustom) {
+    return model.mCustomJoints[model.mJoints[i].custom_joint_index]->S;
+  } else if (model.mJoints[i].mDoFCount == 1) {
+    return model.S[i];
+  }
 
-  for (i = 1; i < model.mBodies.size(); i++) {
-    unsigned int q_index = model.mJoints[i].q_index;
-    unsigned int lambda = model.lambda[i];
-    SpatialTransform X_lambda = model.X_lambda[i];
+  return model.multdof3_S[i];
+}
 
-    model.a[i] = X_lambda.apply(model.a[lambda]) + model.c[i];
-    LOG << "a'[" << i << "] = " << model.a[i].transpose() << std::endl;
+/* Splits the motion subspace S of the joint of body i into the columns
+ * with unknown accelerations (S_free) and computes the articulated
+ * quantities U, D^-1 and u (RBDA p. 130) for them. */
+static inline void HybridDynamicsFreeSubspace (
+    const Model &model,
+    unsigned int i,
+    const HybridSubspace &S,
+    const std::vector<bool> &prescribed,
+    const VectorNd &Tau,
+    HybridSubspace &S_free,
+    HybridSubspace &U,
+    HybridMatrix &Dinv,
+    HybridVector &u) {
+  unsigned int q_index = model.mJoints[i].q_index;
+  unsigned int free_count = S.cols()
+    - HybridDynamicsPrescribedCount (model, i, prescribed);
+
+  S_free.resize (6, free_count);
+  u.resize (free_count);
+
+  unsigned int k = 0;
+  for (unsigned int z = 0; z < S.cols(); z++) {
+    if (!prescribed[q_index + z]) {
+      S_free.col(k) = S.col(z);
+      u[k] = Tau[q_index + z] - S.col(z).dot (model.pA[i]);
+      k++;
+    }
+  }
 
-    if (model.mJoints[i].mDoFCount == 1
-        && model.mJoints[i].mJointType != JointTypeCustom) {
-      QDDot[q_index] = (1./model.d[i]) * (model.u[i] - model.U[i].dot(model.a[i]));
-      model.a[i] = model.a[i] + model.S[i] * QDDot[q_index];
-    } else if (model.mJoints[i].mDoFCount == 3
-        && model.mJoints[i].mJointType != JointTypeCustom) {
-      Vector3d qdd_temp = model.multdof3_Dinv[i] * (model.multdof3_u[i] - model.multdof3_U[i].transpose() * model.a[i]);
-      QDDot[q_index] = qdd_temp[0];
-      QDDot[q_index + 1] = qdd_temp[1];
-      QDDot[q_index + 2] = qdd_temp[2];
-      model.a[i] = model.a[i] + model.multdof3_S[i] * qdd_temp;
-    } else if (model.mJoints[i].mJointType == JointTypeCustom) {
-      unsigned int kI = model.mJoints[i].custom_joint_index;
-      unsigned int dofI=model.mCustomJoints[kI]->mDoFCount;
+  U.noalias() = model.IA[i].toMatrix() * S_free;
+  Dinv = (S_free.transpose() * U).inverse();
+}
 
-      VectorNd qdd_temp = model.mCustomJoints[kI]->Dinv
-        * (  model.mCustomJoints[kI]->u
-            - model.mCustomJoints[kI]->U.transpose()
-            * model.a[i]);
+/* Second sweep of the hybrid dynamics for a body whose joint has
+ * prescribed accelerations: adds the prescribed motion to the bias
+ * acceleration and propagates the articulated body inertia and bias force
+ * to the parent (if it is not the root). */
+static inline void HybridDynamicsArticulatedInertia (
+    Model &model,
+    unsigned int i,
+    const std::vector<bool> &prescribed,
+    const VectorNd &QDDot,
+    const VectorNd &Tau) {
+  unsigned int q_index = model.mJoints[i].q_index;
+  unsigned int lambda = model.lambda[i];
+  HybridSubspace S = HybridDynamicsJointSubspace (model, i);
+
+  for (unsigned int z = 0; z < S.cols(); z++) {
+    if (prescribed[q_index + z]) {
+      model.c[i] += S.col(z) * QDDot[q_index + z];
+    }
+  }
+
+  if (lambda == 0) {
+    return;
+  }
+
+  SpatialArticulatedBodyInertia Ia = model.IA[i];
+  SpatialVector pa;
+
+  if (HybridDynamicsPrescribedCount (model, i, prescribed) < S.cols()) {
+    HybridSubspace S_free, U;
+    HybridMatrix Dinv;
+    HybridVector u;
+    HybridDynamicsFreeSubspace (model, i, S, prescribed, Tau, S_free, U,
+        Dinv, u);
+
+    Ia = SpatialArticulatedBodyInertia (model.IA[i].toMatrix()
+        - U * Dinv * U.transpose());
+    pa = model.pA[i] + Ia * model.c[i] + U * (Dinv * u);
+  } else {
+    pa = model.pA[i] + Ia * model.c[i];
+  }
 
-      for(unsigned int z=0; z < dofI; ++z){
-        QDDot[q_index+z] = qdd_temp[z];
+  model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
+  model.pA[lambda].noalias() += model.X_lambda[i].applyTranspose(pa);
+}
+
+/* Third sweep of the hybrid dynamics for a body whose joint has
+ * prescribed accelerations: the accelerations of the free degrees of
+ * freedom and the torques of the prescribed ones. */
+static inline void HybridDynamicsAccelerations (
+    Model &model,
+    unsigned int i,
+    const std::vector<bool> &prescribed,
+    VectorNd &QDDot,
+    VectorNd &Tau) {
+  unsigned int q_index = model.mJoints[i].q_index;
+  unsigned int lambda = model.lambda[i];
+  HybridSubspace S = HybridDynamicsJointSubspace (model, i);
+
+  model.a[i] = model.X_lambda[i].apply(model.a[lambda]) + model.c[i];
+
+  if (HybridDynamicsPrescribedCount (model, i, prescribed) < S.cols()) {
+    HybridSubspace S_free, U;
+    HybridMatrix Dinv;
+    HybridVector u;
+    HybridDynamicsFreeSubspace (model, i, S, prescribed, Tau, S_free, U,
+        Dinv, u);
+
+    HybridVector qdd_free = Dinv * (u - U.transpose() * model.a[i]);
+    model.a[i] += S_free * qdd_free;
+
+    unsigned int k = 0;
+    for (unsigned int z = 0; z < S.cols(); z++) {
+      if (!prescribed[q_index + z]) {
+        QDDot[q_index + z] = qdd_free[k++];
       }
+    }
+  }
 
-      model.a[i] = model.a[i]
-        + model.mCustomJoints[kI]->S * qdd_temp;
+  // force transmitted by the joint to the articulated body of body i
+  SpatialVector f = model.IA[i] * model.a[i] + model.pA[i];
+  for (unsigned int z = 0; z < S.cols(); z++) {
+    if (prescribed[q_index + z]) {
+      Tau[q_index + z] = S.col(z).dot (f);
+    }
+  }
+}
+
+RBDL_DLLAPI void HybridDynamics (
+    Model &model,
+    const VectorNd &Q,
+    const VectorNd &QDot,
+    const std::vector<bool> &prescribed,
+    VectorNd &QDDot,
+    VectorNd &Tau,
+    std::vector<SpatialVector> *f_ext) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  assert (prescribed.size() == model.qdot_size);
+
+  SpatialVector spatial_gravity (0., 0., 0., model.gravity[0], model.gravity[1], model.gravity[2]);
+
+  model.v[0].setZero();
+
+  jcalc_sincos (model, Q);
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    ForwardDynamicsVelocities (model, i, Q, QDot, f_ext);
+  }
+
+  for (unsigned int i = model.mBodies.size() - 1; i > 0; i--) {
+    if (HybridDynamicsPrescribedCount (model, i, prescribed) > 0) {
+      HybridDynamicsArticulatedInertia (model, i, prescribed, QDDot, Tau);
+      continue;
+    }
+
+    ForwardDynamicsArticulatedInertia (model, i, Tau);
+
+    if (model.lambda[i] != 0) {
+      ForwardDynamicsPropagateArticulatedInertia (model, i);
+    }
+  }
+
+  model.a[0] = spatial_gravity * -1.;
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    if (HybridDynamicsPrescribedCount (model, i, prescribed) > 0) {
+      HybridDynamicsAccelerations (model, i, prescribed, QDDot, Tau);
+    } else {
+      ForwardDynamicsAccelerations (model, i, QDDot);
     }
   }
 
   LOG << "QDDot = " << QDDot.transpose() << std::endl;
+  LOG << "Tau   = " << Tau.transpose() << std::endl;
 }
+#endif
 
 RBDL_DLLAPI void ForwardDynamicsLagrangian (
     Model &model,
@@ -613,6 +1062,77 @@ RBDL_DLLAPI void ForwardDynamicsLagrangian (
   LOG << "x = " << QDDot << std::endl;
 }
 
+/* Computes the articulated body inertias IA together with U and D (or
+ * its inverse for multi dof joints) of all joints (RBDA p. 130). IA has to
+ * be initialized with the rigid body inertias. */
+static inline void CalcArticulatedBodyInertias (Model &model) {
+  for (unsigned int i = model.mBodies.size() - 1; i > 0; i--) {
+    // unsigned int q_index = model.mJoints[i].q_index;
+
+    if (model.mJoints[i].mDoFCount == 1
+        && model.mJoints[i].mJointType != JointTypeCustom) {
+      model.U[i] = model.IA[i] * model.S[i];
+      model.d[i] = model.S[i].dot(model.U[i]);
+      //      LOG << "u[" << i << "] = " << model.u[i] << std::endl;
+      unsigned int lambda = model.lambda[i];
+
+      if (lambda != 0) {
+        SpatialArticulatedBodyInertia Ia = model.IA[i];
+        Ia.rankUpdate (model.U[i], -1. / model.d[i]);
+        model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
+      }
+    } else if (model.mJoints[i].mDoFCount == 3
+        && model.mJoints[i].mJointType != JointTypeCustom) {
+
+      model.multdof3_U[i] = model.IA[i] * model.multdof3_S[i];
+
+#ifdef EIGEN_CORE_H
+      model.multdof3_Dinv[i] =
+        (model.multdof3_S[i].transpose()*model.multdof3_U[i]).inverse().eval();
+#else
+      model.multdof3_Dinv[i] =
+        (model.multdof3_S[i].transpose() * model.multdof3_U[i]).inverse();
+#endif
+      //      LOG << "mCustomJoints[kI]->u[" << i << "] = "
+      //<< model.mCustomJoints[kI]->u[i].transpose() << std::endl;
+
+      unsigned int lambda = model.lambda[i];
+
+      if (lambda != 0) {
+        SpatialArticulatedBodyInertia Ia = model.IA[i];
+        Ia.rankUpdate (model.multdof3_U[i], model.multdof3_Dinv[i], -1.);
+        model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
+      }
+    } else if (model.mJoints[i].mJointType == JointTypeCustom) {
+      unsigned int kI     = model.mJoints[i].custom_joint_index;
+      // unsigned int dofI   = model.mCustomJoints[kI]->mDoFCount;
+      model.mCustomJoints[kI]->U =
+        model.IA[i].toMatrix() * model.mCustomJoints[kI]->S;
+
+#ifdef EIGEN_CORE_H
+      model.mCustomJoints[kI]->Dinv = (model.mCustomJoints[kI]->S.transpose()
+          * model.mCustomJoints[kI]->U
+          ).inverse().eval();
+#else
+      model.mCustomJoints[kI]->Dinv=(model.mCustomJoints[kI]->S.transpose()
+          * model.mCustomJoints[kI]->U
+          ).inverse();
+#endif
+      //      LOG << "mCustomJoints[kI]->u[" << i << "] = "
+      //<< model.mCustomJoints[kI]->u.transpose() << std::endl;
+      unsigned int lambda = model.lambda[i];
+
+      if (lambda != 0) {
+        SpatialArticulatedBodyInertia Ia (model.IA[i].toMatrix()
+          - ( model.mCustomJoints[kI]->U
+              * model.mCustomJoints[kI]->Dinv
+              * model.mCustomJoints[kI]->U.transpose()));
+        model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
+      }
+    }
+  }
+}
+
 RBDL_DLLAPI void CalcMInvTimesTau ( Model &model,
     const VectorNd &Q,
     const VectorNd &Tau,
@@ -627,14 +1147,16 @@ RBDL_DLLAPI void CalcMInvTimesTau ( Model &model,
   model.a[0].setZero();
 
   if (update_kinematics) {
+    jcalc_sincos (model, Q);
+
     for (unsigned int i = 1; i < model.mBodies.size(); i++) {
-      jcalc_X_lambda_S (model, model.mJointUpdateOrder[i], Q);
+      jcalc_X_lambda_S (model, model.mJointUpdateOrder[i], Q, true);
 
       model.v_J[i].setZero();
       model.v[i].setZero();
       model.c[i].setZero();
       model.pA[i].setZero();
-      model.I[i].setSpatialMatrix (model.IA[i]);
+      model.IA[i] = model.I[i];
     }
   }
 
@@ -645,97 +1167,7 @@ RBDL_DLLAPI void CalcMInvTimesTau ( Model &model,
   // ClearLogOutput();
 
   if (update_kinematics) {
-    // Compute Articulate Body Inertias
-    for (unsigned int i = model.mBodies.size() - 1; i > 0; i--) {
-      // unsigned int q_index = model.mJoints[i].q_index;
-
-      if (model.mJoints[i].mDoFCount == 1
-          && model.mJoints[i].mJointType != JointTypeCustom) {
-        model.U[i] = model.IA[i] * model.S[i];
-        model.d[i] = model.S[i].dot(model.U[i]);
-        //      LOG << "u[" << i << "] = " << model.u[i] << std::endl;
-        unsigned int lambda = model.lambda[i];
-
-        if (lambda != 0) {
-          SpatialMatrix Ia = model.IA[i] -
-            model.U[i] * (model.U[i] / model.d[i]).transpose();
-#ifdef EIGEN_CORE_H
-          model.IA[lambda].noalias() += model.X_lambda[i].toMatrixTranspose()
-            * Ia
-            * model.X_lambda[i].toMatrix();
-#else
-          model.IA[lambda] += model.X_lambda[i].toMatrixTranspose()
-            * Ia
-            * model.X_lambda[i].toMatrix();
-#endif
-        }
-      } else if (model.mJoints[i].mDoFCount == 3
-          && model.mJoints[i].mJointType != JointTypeCustom) {
-
-        model.multdof3_U[i] = model.IA[i] * model.multdof3_S[i];
-
-#ifdef EIGEN_CORE_H
-        model.multdof3_Dinv[i] =
-          (model.multdof3_S[i].transpose()*model.multdof3_U[i]).inverse().eval();
-#else
-        model.multdof3_Dinv[i] =
-          (model.multdof3_S[i].transpose() * model.multdof3_U[i]).inverse();
-#endif
-        //      LOG << "mCustomJoints[kI]->u[" << i << "] = "
-        //<< model.mCustomJoints[kI]->u[i].transpose() << std::endl;
-
-        unsigned int lambda = model.lambda[i];
-
-        if (lambda != 0) {
-          SpatialMatrix Ia = model.IA[i]
-            - ( model.multdof3_U[i]
-                * model.multdof3_Dinv[i]
-                * model.multdof3_U[i].transpose());
-#ifdef EIGEN_CORE_H
-          model.IA[lambda].noalias() +=
-            model.X_lambda[i].toMatrixTranspose()
-            * Ia
-            * model.X_lambda[i].toMatrix();
-#else
-          model.IA[lambda] +=
-            model.X_lambda[i].toMatrixTranspose()
-            * Ia * model.X_lambda[i].toMatrix();
-#endif
-        }
-      } else if (model.mJoints[i].mJointType == JointTypeCustom) {
-        unsigned int kI     = model.mJoints[i].custom_joint_index;
-        // unsigned int dofI   = model.mCustomJoints[kI]->mDoFCount;
-        model.mCustomJoints[kI]->U = model.IA[i] * model.mCustomJoints[kI]->S;
-
-#ifdef EIGEN_CORE_H
-        model.mCustomJoints[kI]->Dinv = (model.mCustomJoints[kI]->S.transpose()
-            * model.mCustomJoints[kI]->U
-            ).inverse().eval();
-#else
-        model.mCustomJoints[kI]->Dinv=(model.mCustomJoints[kI]->S.transpose()
-            * model.mCustomJoints[kI]->U
-            ).inverse();
-#endif
-        //      LOG << "mCustomJoints[kI]->u[" << i << "] = "
-        //<< model.mCustomJoints[kI]->u.transpose() << std::endl;
-        unsigned int lambda = model.lambda[i];
-
-        if (lambda != 0) {
-          SpatialMatrix Ia = model.IA[i]
-            - ( model.mCustomJoints[kI]->U
-                * model.mCustomJoints[kI]->Dinv
-                * model.mCustomJoints[kI]->U.transpose());
-#ifdef EIGEN_CORE_H
-          model.IA[lambda].noalias() += model.X_lambda[i].toMatrixTranspose()
-            * Ia
-            * model.X_lambda[i].toMatrix();
-#else
-          model.IA[lambda] += model.X_lambda[i].toMatrixTranspose()
-            * Ia * model.X_lambda[i].toMatrix();
-#endif
-        }
-      }
-    }
+    CalcArticulatedBodyInertias (model);
   }
 
   // compute articulated bias forces
@@ -859,4 +1291,150 @@ RBDL_DLLAPI void CalcMInvTimesTau ( Model &model,
   LOG << "QDDot = " << QDDot.transpose() << std::endl;
 }
 
+#ifndef RBDL_USE_SIMPLE_MATH
+/* Backward sweep of CalcMInv() for body i: computes the rows of the joint
+ * of body i in the columns of its subtree from the articulated forces F_i
+ * and propagates F_i to the parent. Columns left of the joint are zero. */
+template <typename SubspaceType, typename UType, typename DinvType>
+static inline void CalcMInvBackwardRows (
+    Model &model,
+    unsigned int i,
+    const SubspaceType &S,
+    const UType &U,
+    const DinvType &Dinv,
+    MatrixNd &Minv) {
+  unsigned int q_index = model.mJoints[i].q_index;
+  unsigned int dof_count = model.mJoints[i].mDoFCount;
+  unsigned int col_count = model.dof_count - q_index;
+  unsigned int lambda = model.lambda[i];
+
+  Eigen::Block<MatrixNd> F_i =
+    model.minv_F.block (6 * i, q_index, 6, col_count);
+  Eigen::Block<MatrixNd> Minv_i =
+    Minv.block (q_index, q_index, dof_count, col_count);
+
+  // the columns of the joint itself are still zero in F_i
+  Minv_i.noalias() = -Dinv * (S.transpose() * F_i);
+  Minv_i.leftCols (dof_count) = Dinv;
+
+  if (lambda != 0) {
+    F_i.noalias() += U * Minv_i;
+    model.minv_F.block (6 * lambda, q_index, 6, col_count).noalias() +=
+      model.X_lambda[i].toMatrixTranspose() * F_i;
+  }
+}
+
+/* Forward sweep of CalcMInv() for body i: removes the effect of the
+ * accelerations of the parent from the rows of the joint of body i and
+ * computes the accelerations P_i. */
+template <typename SubspaceType, typename UType, typename DinvType>
+static inline void CalcMInvForwardRows (
+    Model &model,
+    unsigned int i,
+    const SubspaceType &S,
+    const UType &U,
+    const DinvType &Dinv,
+    MatrixNd &Minv) {
+  unsigned int q_index = model.mJoints[i].q_index;
+  unsigned int dof_count = model.mJoints[i].mDoFCount;
+  unsigned int col_count = model.dof_count - q_index;
+  unsigned int lambda = model.lambda[i];
+
+  Eigen::Block<MatrixNd> P_i =
+    model.minv_P.block (6 * i, q_index, 6, col_count);
+  Eigen::Block<MatrixNd> Minv_i =
+    Minv.block (q_index, q_index, dof_count, col_count);
+
+  if (lambda != 0) {
+    P_i.noalias() = model.X_lambda[i].toMatrix()
+      * model.minv_P.block (6 * lambda, q_index, 6, col_count);
+    Minv_i.noalias() -= Dinv * (U.transpose() * P_i);
+    P_i.noalias() += S * Minv_i;
+  } else {
+    P_i.noalias() = S * Minv_i;
+  }
+}
+
+RBDL_DLLAPI void CalcMInv (
+    Model &model,
+    const VectorNd &Q,
+    MatrixNd &Minv,
+    bool update_kinematics,
+    const std::vector<unsigned int> *body_ids) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  assert (Minv.rows() == model.dof_count && Minv.cols() == model.dof_count);
+
+  if (update_kinematics) {
+    jcalc_sincos (model, Q);
+
+    for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+      jcalc_X_lambda_S (model, model.mJointUpdateOrder[i], Q, true);
+      model.IA[i] = model.I[i];
+    }
+
+    CalcArticulatedBodyInertias (model);
+  }
+
+  // no-ops unless this is the first call or bodies were added since
+  model.minv_F.resize (6 * model.mBodies.size(), model.dof_count);
+  model.minv_P.resize (6 * model.mBodies.size(), model.dof_count);
+  model.minv_F.setZero();
+
+  // bodies whose rows are needed: the requested ones and their ancestors
+  std::vector<bool> needs_rows (model.mBodies.size(), body_ids == NULL);
+  if (body_ids != NULL) {
+    for (unsigned int k = 0; k < body_ids->size(); k++) {
+      unsigned int j = (*body_ids)[k];
+      assert (j > 0 && j < model.mBodies.size());
+
+      for (; j != 0 && !needs_rows[j]; j = model.lambda[j]) {
+        needs_rows[j] = true;
+      }
+    }
+  }
+
+  for (unsigned int i = model.mBodies.size() - 1; i > 0; i--) {
+    if (model.mJoints[i].mJointType == JointTypeCustom) {
+      CustomJoint *custom_joint =
+        model.mCustomJoints[model.mJoints[i].custom_joint_index];
+      CalcMInvBackwardRows (model, i, custom_joint->S, custom_joint->U,
+          custom_joint->Dinv, Minv);
+    } else if (model.mJoints[i].mDoFCount == 1) {
+      CalcMInvBackwardRows (model, i, model.S[i], model.U[i],
+          Eigen::Matrix<double, 1, 1> (1. / model.d[i]), Minv);
+    } else {
+      CalcMInvBackwardRows (model, i, model.multdof3_S[i],
+          model.multdof3_U[i], model.multdof3_Dinv[i], Minv);
+    }
+  }
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    if (!needs_rows[i]) {
+      continue;
+    }
+
+    if (model.mJoints[i].mJointType == JointTypeCustom) {
+      CustomJoint *custom_joint =
+        model.mCustomJoints[model.mJoints[i].custom_joint_index];
+      CalcMInvForwardRows (model, i, custom_joint->S, custom_joint->U,
+          custom_joint->Dinv, Minv);
+    } else if (model.mJoints[i].mDoFCount == 1) {
+      CalcMInvForwardRows (model, i, model.S[i], model.U[i],
+          Eigen::Matrix<double, 1, 1> (1. / model.d[i]), Minv);
+    } else {
+      CalcMInvForwardRows (model, i, model.multdof3_S[i],
+          model.multdof3_U[i], model.multdof3_Dinv[i], Minv);
+    }
+  }
+
+  // only the upper triangle has been computed
+  for (unsigned int j = 0; j < model.dof_count; j++) {
+    for (unsigned int k = j + 1; k < model.dof_count; k++) {
+      Minv(k, j) = Minv(j, k);
+    }
+  }
+}
+#endif
+
 } /* namespace RigidBodyDynamics */
@@ -0,0 +1,263 @@
+/*
+ * RBDL - Rigid Body Dynamics Library
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#include "rbdl/rbdl_mathutils.h"
+#include "rbdl/Logging.h"
+
+#include "rbdl/InverseKinematicsMultiStart.h"
+
+namespace RigidBodyDynamics {
+
+using namespace Math;
+
+InverseKinematicsMultiStart::InverseKinematicsMultiStart (
+    const Model &model,
+    unsigned int num_threads) :
+  prioritized (false),
+  stop_at_first_solution (true),
+  solution_tol (1.0e-8),
+  max_solution_priority (std::numeric_limits<unsigned int>::max()),
+  seed_range (0.5),
+  best_seed (0),
+  num_converged (0),
+  cancelled (false),
+  next_seed (0),
+  pool (num_threads) {
+  if (!model.mCustomJoints.empty()) {
+    std::cerr << "Error: InverseKinematicsMultiStart does not support models "
+      << "with custom joints (the thread copies would share them)."
+      << std::endl;
+    assert (0);
+    abort();
+  }
+
+  workspaces.resize (pool.GetNumThreads());
+
+  for (unsigned int i = 0; i < workspaces.size(); i++) {
+    ThreadWorkspace &ws = workspaces[i];
+    ws.model = model;
+    ws.q = VectorNd::Zero (model.q_size);
+  }
+}
+
+bool InverseKinematicsMultiStart::Solve (
+    const VectorNd &Qcurrent,
+    const MatrixNd &Seeds,
+    const InverseKinematicsConstraintSet &CS,
+    VectorNd &Qres) {
+  const Model &model = workspaces[0].model;
+  unsigned int num_seeds = Seeds.cols();
+
+  assert (Qcurrent.size() == model.q_size);
+  assert (Seeds.rows() == model.q_size);
+  assert (Qres.size() == model.q_size);
+  assert (num_seeds > 0);
+
+  seed_status.assign (num_seeds, SeedSkipped);
+  seed_error_norms.setConstant (num_seeds,
+      std::numeric_limits<double>::infinity());
+  seed_distances.setConstant (num_seeds,
+      std::numeric_limits<double>::infinity());
+  seed_results.resize (model.q_size, num_seeds);
+
+  // Copying reuses the buffers of the previous call if the constraint set
+  // has the same size.
+  for (unsigned int i = 0; i < workspaces.size(); i++) {
+    workspaces[i].CS = CS;
+    workspaces[i].CS.cancel = &cancelled;
+  }
+
+  cancelled = false;
+  next_seed = 0;
+
+  // Every thread takes the next seed that has not been started yet, so
+  // the seeds are started in the order of the columns independent of the
+  // scheduling of the pool.
+  pool.ParallelFor (0, std::min (pool.GetNumThreads(), num_seeds),
+      [this, &Qcurrent, &Seeds, num_seeds] (unsigned int,
+        unsigned int thread_id) {
+      for (unsigned int seed = next_seed++; seed < num_seeds;
+        seed = next_seed++) {
+        if (cancelled) {
+          break;
+        }
+        SolveSeed (seed, thread_id, Qcurrent, Seeds);
+      }
+      });
+
+  num_converged = 0;
+  best_seed = 0;
+  double best_error_norm = std::numeric_limits<double>::infinity();
+  double best_distance = std::numeric_limits<double>::infinity();
+
+  for (unsigned int s = 0; s < num_seeds; s++) {
+    if (seed_status[s] == SeedConverged) {
+      if (num_converged == 0 || seed_distances[s] < best_distance) {
+        best_seed = s;
+        best_distance = seed_distances[s];
+      }
+      num_converged++;
+    } else if (num_converged == 0
+        && seed_error_norms[s] < best_error_norm) {
+      best_seed = s;
+      best_error_norm = seed_error_norms[s];
+    }
+  }
+
+  LOG << "converged seeds: " << num_converged << " of " << num_seeds
+    << ", selected seed " << best_seed << std::endl;
+
+  if (seed_status[best_seed] == SeedSkipped) {
+    Qres = Qcurrent;
+    return false;
+  }
+
+  Qres = seed_results.col (best_seed);
+
+  return num_converged > 0;
+}
+
+void InverseKinematicsMultiStart::SolveSeed (
+    unsigned int seed,
+    unsigned int thread_id,
+    const VectorNd &Qcurrent,
+    const MatrixNd &Seeds) {
+  ThreadWorkspace &ws = workspaces[thread_id];
+  InverseKinematicsConstraintSet &CS = ws.CS;
+
+  ws.q = Seeds.col (seed);
+
+  bool success;
+#ifndef RBDL_USE_SIMPLE_MATH
+  if (prioritized) {
+    success = InverseKinematicsPrioritized (ws.model, ws.q, CS, ws.q);
+  } else
+#endif
+  {
+    success = InverseKinematics (ws.model, ws.q, CS, ws.q);
+  }
+
+  // residual of the priority levels that have to be satisfied, CS.e holds
+  // the residuals of the returned state
+  double squared_norm = 0.;
+  for (unsigned int k = 0; k < CS.constraint_type.size(); k++) {
+    if (CS.constraint_priority[k] > max_solution_priority) {
+      continue;
+    }
+    unsigned int row_end = k + 1 < CS.constraint_row_index.size()
+      ? CS.constraint_row_index[k + 1] : CS.num_constraints;
+    for (unsigned int r = CS.constraint_row_index[k]; r < row_end; r++) {
+      squared_norm += CS.e[r] * CS.e[r];
+    }
+  }
+
+  seed_results.col (seed) = ws.q;
+  seed_error_norms[seed] = std::sqrt (squared_norm);
+  seed_distances[seed] = ConfigurationDistance (Qcurrent, ws.q);
+
+  if (success && seed_error_norms[seed] < solution_tol) {
+    seed_status[seed] = SeedConverged;
+    if (stop_at_first_solution) {
+      cancelled = true;
+    }
+  } else if (cancelled) {
+    seed_status[seed] = SeedCancelled;
+  } else {
+    seed_status[seed] = SeedFailed;
+  }
+}
+
+void InverseKinematicsMultiStart::GenerateSeeds (
+    const VectorNd &Qcurrent,
+    const InverseKinematicsConstraintSet &CS,
+    unsigned int num_seeds,
+    MatrixNd &Seeds) {
+  const Model &model = workspaces[0].model;
+
+  assert (Qcurrent.size() == model.q_size);
+  assert (CS.q_min.size() == 0 || CS.q_min.size() == model.q_size);
+  assert (CS.q_max.size() == 0 || CS.q_max.size() == model.q_size);
+
+  Seeds.resize (model.q_size, num_seeds);
+
+  std::uniform_real_distribution<double> offset (-seed_range, seed_range);
+  std::uniform_real_distribution<double> unit (0., 1.);
+  std::normal_distribution<double> normal (0., 1.);
+
+  for (unsigned int s = 0; s < num_seeds; s++) {
+    if (s == 0) {
+      Seeds.col (s) = Qcurrent;
+      continue;
+    }
+
+    VectorNd seed = Qcurrent;
+
+    for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+      if (model.mJoints[i].mJointType == JointTypeSpherical) {
+        Vector3d axis (normal (random_engine), normal (random_engine),
+            normal (random_engine));
+        axis.normalize();
+        Quaternion quat = model.GetQuaternion (i, Qcurrent)
+          * Quaternion::fromAxisAngle (axis, offset (random_engine));
+        model.SetQuaternion (i, quat, seed);
+        continue;
+      }
+
+      unsigned int q_index = model.mJoints[i].q_index;
+      for (unsigned int z = 0; z < model.mJoints[i].mDoFCount; z++) {
+        unsigned int qi = q_index + z;
+        double lower = CS.q_min.size() > 0 ? CS.q_min[qi]
+          : -std::numeric_limits<double>::infinity();
+        double upper = CS.q_max.size() > 0 ? CS.q_max[qi]
+          : std::numeric_limits<double>::infinity();
+
+        if (std::isfinite (lower) && std::isfinite (upper)) {
+          seed[qi] = lower + unit (random_engine) * (upper - lower);
+        } else {
+          seed[qi] = Qcurrent[qi] + offset (random_engine);
+        }
+      }
+    }
+
+    Seeds.col (s) = seed;
+  }
+}
+
+double InverseKinematicsMultiStart::ConfigurationDistance (
+    const VectorNd &Q0,
+    const VectorNd &Q1) const {
+  const Model &model = workspaces[0].model;
+
+  double squared_distance = 0.;
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    if (model.mJoints[i].mJointType == JointTypeSpherical) {
+      // the quaternions q and -q describe the same orientation
+      double cos_half_angle = std::min (1.,
+          std::fabs (model.GetQuaternion (i, Q0).dot (
+              model.GetQuaternion (i, Q1))));
+      double angle = 2. * std::acos (cos_half_angle);
+      squared_distance += angle * angle;
+      continue;
+    }
+
+    unsigned int q_index = model.mJoints[i].q_index;
+    for (unsigned int z = 0; z < model.mJoints[i].mDoFCount; z++) {
+      double diff = Q1[q_index + z] - Q0[q_index + z];
+      squared_distance += diff * diff;
+    }
+  }
+
+  return std::sqrt (squared_distance);
+}
+
+}
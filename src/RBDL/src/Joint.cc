@@ -5,6 +5,7 @@
  * Licensed under the zlib license. See LICENSE for more details.
  */
 
+#include <algorithm>
 #include <iostream>
 #include <limits>
 #include <assert.h>
@@ -13,23 +14,89 @@
 
 #include "rbdl/Model.h"
 #include "rbdl/Joint.h"
+#include "rbdl/rbdl_mathutils.h"
 
 namespace RigidBodyDynamics {
 
 using namespace Math;
 
+/// \brief Sine and cosine of q[q_index], taken from Model::sin_q and
+/// Model::cos_q if jcalc_sincos() was called before.
+static inline void JointSinCos (
+    const Model &model,
+    const VectorNd &q,
+    unsigned int q_index,
+    bool sincos_computed,
+    double *s,
+    double *c) {
+  if (sincos_computed) {
+    *s = model.sin_q[q_index];
+    *c = model.cos_q[q_index];
+  } else {
+    sincos (q[q_index], s, c);
+  }
+}
+
+/// \brief Same as Xrot() but for precomputed sine and cosine of the angle.
+static inline SpatialTransform XrotSinCos (
+    double s,
+    double c,
+    const Vector3d &axis) {
+  return SpatialTransform (
+      Matrix3d (
+        axis[0] * axis[0] * (1.0f - c) + c,
+        axis[1] * axis[0] * (1.0f - c) + axis[2] * s,
+        axis[0] * axis[2] * (1.0f - c) - axis[1] * s,
+
+        axis[0] * axis[1] * (1.0f - c) - axis[2] * s,
+        axis[1] * axis[1] * (1.0f - c) + c,
+        axis[1] * axis[2] * (1.0f - c) + axis[0] * s,
+
+        axis[0] * axis[2] * (1.0f - c) + axis[1] * s,
+        axis[1] * axis[2] * (1.0f - c) - axis[0] * s,
+        axis[2] * axis[2] * (1.0f - c) + c
+        ),
+      Vector3d (0., 0., 0.)
+      );
+}
+
+RBDL_DLLAPI void jcalc_sincos (
+    Model &model,
+    const VectorNd &q
+    ) {
+  const unsigned int chunk_size = 32;
+  double x[chunk_size], s[chunk_size], c[chunk_size];
+
+  const unsigned int count = model.sincos_q_index.size();
+  for (unsigned int start = 0; start < count; start += chunk_size) {
+    unsigned int n = std::min (chunk_size, count - start);
+    for (unsigned int i = 0; i < n; i++) {
+      x[i] = q[model.sincos_q_index[start + i]];
+    }
+
+    SinCos (n, x, s, c);
+
+    for (unsigned int i = 0; i < n; i++) {
+      model.sin_q[model.sincos_q_index[start + i]] = s[i];
+      model.cos_q[model.sincos_q_index[start + i]] = c[i];
+    }
+  }
+}
+
 RBDL_DLLAPI void jcalc (
     Model &model,
     unsigned int joint_id,
     const VectorNd &q,
-    const VectorNd &qdot
+    const VectorNd &qdot,
+    bool sincos_computed
     ) {
   // exception if we calculate it for the root body
   assert (joint_id > 0);
 
   if (model.mJoints[joint_id].mJointType == JointTypeRevoluteX) {
     double s, c;
-    sincos (q[model.mJoints[joint_id].q_index], &s, &c);
+    JointSinCos (model, q, model.mJoints[joint_id].q_index, sincos_computed,
+        &s, &c);
 
     model.X_lambda[joint_id].E = Matrix3d (
         model.X_T[joint_id].E(0, 0),
@@ -49,7 +116,8 @@ RBDL_DLLAPI void jcalc (
     model.v_J[joint_id][0] = qdot[model.mJoints[joint_id].q_index];
   } else if (model.mJoints[joint_id].mJointType == JointTypeRevoluteY) {
     double s, c;
-    sincos (q[model.mJoints[joint_id].q_index], &s, &c);
+    JointSinCos (model, q, model.mJoints[joint_id].q_index, sincos_computed,
+        &s, &c);
 
     model.X_lambda[joint_id].E = Matrix3d (
         c * model.X_T[joint_id].E(0, 0) + -s * model.X_T[joint_id].E(2, 0),
@@ -69,7 +137,8 @@ RBDL_DLLAPI void jcalc (
     model.v_J[joint_id][1] = qdot[model.mJoints[joint_id].q_index];
   } else if (model.mJoints[joint_id].mJointType == JointTypeRevoluteZ) {
     double s, c;
-    sincos (q[model.mJoints[joint_id].q_index], &s, &c);
+    JointSinCos (model, q, model.mJoints[joint_id].q_index, sincos_computed,
+        &s, &c);
 
     model.X_lambda[joint_id].E = Matrix3d (
          c * model.X_T[joint_id].E(0, 0) + s * model.X_T[joint_id].E(1, 0),
@@ -101,7 +170,7 @@ RBDL_DLLAPI void jcalc (
     model.X_lambda[joint_id] = X_J * model.X_T[joint_id];
   } else if (model.mJoints[joint_id].mDoFCount == 1 &&
       model.mJoints[joint_id].mJointType != JointTypeCustom) {
-    SpatialTransform X_J = jcalc_XJ (model, joint_id, q);
+    SpatialTransform X_J = jcalc_XJ (model, joint_id, q, sincos_computed);
     model.v_J[joint_id] = 
       model.S[joint_id] * qdot[model.mJoints[joint_id].q_index];
     model.X_lambda[joint_id] = X_J * model.X_T[joint_id];
@@ -122,16 +191,12 @@ RBDL_DLLAPI void jcalc (
         0., 0., 0.);
     model.X_lambda[joint_id] = X_J * model.X_T[joint_id];
   } else if (model.mJoints[joint_id].mJointType == JointTypeEulerZYX) {
-    double q0 = q[model.mJoints[joint_id].q_index];
-    double q1 = q[model.mJoints[joint_id].q_index + 1];
-    double q2 = q[model.mJoints[joint_id].q_index + 2];
+    unsigned int q_index = model.mJoints[joint_id].q_index;
 
-    double s0 = sin (q0);
-    double c0 = cos (q0);
-    double s1 = sin (q1);
-    double c1 = cos (q1);
-    double s2 = sin (q2);
-    double c2 = cos (q2);
+    double s0, c0, s1, c1, s2, c2;
+    JointSinCos (model, q, q_index, sincos_computed, &s0, &c0);
+    JointSinCos (model, q, q_index + 1, sincos_computed, &s1, &c1);
+    JointSinCos (model, q, q_index + 2, sincos_computed, &s2, &c2);
 
     SpatialTransform X_J (Matrix3d(
         c0 * c1, s0 * c1, -s1,
@@ -163,16 +228,12 @@ RBDL_DLLAPI void jcalc (
         0.,0., 0.);
     model.X_lambda[joint_id] = X_J * model.X_T[joint_id];
   } else if (model.mJoints[joint_id].mJointType == JointTypeEulerXYZ) {
-    double q0 = q[model.mJoints[joint_id].q_index];
-    double q1 = q[model.mJoints[joint_id].q_index + 1];
-    double q2 = q[model.mJoints[joint_id].q_index + 2];
+    unsigned int q_index = model.mJoints[joint_id].q_index;
 
-    double s0 = sin (q0);
-    double c0 = cos (q0);
-    double s1 = sin (q1);
-    double c1 = cos (q1);
-    double s2 = sin (q2);
-    double c2 = cos (q2);
+    double s0, c0, s1, c1, s2, c2;
+    JointSinCos (model, q, q_index, sincos_computed, &s0, &c0);
+    JointSinCos (model, q, q_index + 1, sincos_computed, &s1, &c1);
+    JointSinCos (model, q, q_index + 2, sincos_computed, &s2, &c2);
 
     SpatialTransform X_J (Matrix3d(
         c2 * c1, s2 * c0 + c2 * s1 * s0, s2 * s0 - c2 * s1 * c0,
@@ -205,16 +266,12 @@ RBDL_DLLAPI void jcalc (
         );
     model.X_lambda[joint_id] = X_J * model.X_T[joint_id];
   } else if (model.mJoints[joint_id].mJointType == JointTypeEulerYXZ) {
-    double q0 = q[model.mJoints[joint_id].q_index];
-    double q1 = q[model.mJoints[joint_id].q_index + 1];
-    double q2 = q[model.mJoints[joint_id].q_index + 2];
+    unsigned int q_index = model.mJoints[joint_id].q_index;
 
-    double s0 = sin (q0);
-    double c0 = cos (q0);
-    double s1 = sin (q1);
-    double c1 = cos (q1);
-    double s2 = sin (q2);
-    double c2 = cos (q2);
+    double s0, c0, s1, c1, s2, c2;
+    JointSinCos (model, q, q_index, sincos_computed, &s0, &c0);
+    JointSinCos (model, q, q_index + 1, sincos_computed, &s1, &c1);
+    JointSinCos (model, q, q_index + 2, sincos_computed, &s2, &c2);
 
     SpatialTransform X_J (Matrix3d(
         c2 * c0 + s2 * s1 * s0, s2 * c1, -c2 * s0 + s2 * s1 * c0,
@@ -246,16 +303,12 @@ RBDL_DLLAPI void jcalc (
         );
     model.X_lambda[joint_id] = X_J * model.X_T[joint_id];
   } else if (model.mJoints[joint_id].mJointType == JointTypeEulerZXY) {
-    double q0 = q[model.mJoints[joint_id].q_index];
-    double q1 = q[model.mJoints[joint_id].q_index + 1];
-    double q2 = q[model.mJoints[joint_id].q_index + 2];
+    unsigned int q_index = model.mJoints[joint_id].q_index;
 
-    double s0 = sin (q0);
-    double c0 = cos (q0);
-    double s1 = sin (q1);
-    double c1 = cos (q1);
-    double s2 = sin (q2);
-    double c2 = cos (q2);
+    double s0, c0, s1, c1, s2, c2;
+    JointSinCos (model, q, q_index, sincos_computed, &s0, &c0);
+    JointSinCos (model, q, q_index + 1, sincos_computed, &s1, &c1);
+    JointSinCos (model, q, q_index + 2, sincos_computed, &s2, &c2);
 
     model.X_lambda[joint_id] = SpatialTransform (
         Matrix3d(
@@ -321,14 +374,18 @@ RBDL_DLLAPI void jcalc (
 RBDL_DLLAPI Math::SpatialTransform jcalc_XJ (
     Model &model,
     unsigned int joint_id,
-    const Math::VectorNd &q) {
+    const Math::VectorNd &q,
+    bool sincos_computed) {
   // exception if we calculate it for the root body
   assert (joint_id > 0);
 
   if (model.mJoints[joint_id].mDoFCount == 1
       && model.mJoints[joint_id].mJointType != JointTypeCustom) {
     if (model.mJoints[joint_id].mJointType == JointTypeRevolute) {
-      return Xrot (q[model.mJoints[joint_id].q_index], Vector3d (
+      double s, c;
+      JointSinCos (model, q, model.mJoints[joint_id].q_index,
+          sincos_computed, &s, &c);
+      return XrotSinCos (s, c, Vector3d (
             model.mJoints[joint_id].mJointAxes[0][0],
             model.mJoints[joint_id].mJointAxes[0][1],
             model.mJoints[joint_id].mJointAxes[0][2]
@@ -370,14 +427,16 @@ RBDL_DLLAPI Math::SpatialTransform jcalc_XJ (
 RBDL_DLLAPI void jcalc_X_lambda_S (
     Model &model,
     unsigned int joint_id,
-    const VectorNd &q
+    const VectorNd &q,
+    bool sincos_computed
     ) {
   // exception if we calculate it for the root body
   assert (joint_id > 0);
 
   if (model.mJoints[joint_id].mJointType == JointTypeRevoluteX) {
     double s, c;
-    sincos (q[model.mJoints[joint_id].q_index], &s, &c);
+    JointSinCos (model, q, model.mJoints[joint_id].q_index, sincos_computed,
+        &s, &c);
 
     model.X_lambda[joint_id].E = Matrix3d (
         model.X_T[joint_id].E(0, 0),
@@ -397,7 +456,8 @@ RBDL_DLLAPI void jcalc_X_lambda_S (
     model.S[joint_id][0] = 1.0;
   } else if (model.mJoints[joint_id].mJointType == JointTypeRevoluteY) {
     double s, c;
-    sincos (q[model.mJoints[joint_id].q_index], &s, &c);
+    JointSinCos (model, q, model.mJoints[joint_id].q_index, sincos_computed,
+        &s, &c);
 
     model.X_lambda[joint_id].E = Matrix3d (
         c * model.X_T[joint_id].E(0, 0) + -s * model.X_T[joint_id].E(2, 0),
@@ -417,7 +477,8 @@ RBDL_DLLAPI void jcalc_X_lambda_S (
     model.S[joint_id][1] = 1.;
   } else if (model.mJoints[joint_id].mJointType == JointTypeRevoluteZ) {
     double s, c;
-    sincos (q[model.mJoints[joint_id].q_index], &s, &c);
+    JointSinCos (model, q, model.mJoints[joint_id].q_index, sincos_computed,
+        &s, &c);
 
     model.X_lambda[joint_id].E = Matrix3d (
          c * model.X_T[joint_id].E(0, 0) + s * model.X_T[joint_id].E(1, 0),
@@ -448,7 +509,7 @@ RBDL_DLLAPI void jcalc_X_lambda_S (
   } else if (model.mJoints[joint_id].mDoFCount == 1
       && model.mJoints[joint_id].mJointType != JointTypeCustom){
     model.X_lambda[joint_id] = 
-      jcalc_XJ (model, joint_id, q) * model.X_T[joint_id];
+      jcalc_XJ (model, joint_id, q, sincos_computed) * model.X_T[joint_id];
     model.S[joint_id] = model.mJoints[joint_id].mJointAxes[0];
   } else if (model.mJoints[joint_id].mJointType == JointTypeSpherical) {
     model.X_lambda[joint_id] = SpatialTransform (
@@ -460,16 +521,12 @@ RBDL_DLLAPI void jcalc_X_lambda_S (
     model.multdof3_S[joint_id](1,1) = 1.;
     model.multdof3_S[joint_id](2,2) = 1.;
   } else if (model.mJoints[joint_id].mJointType == JointTypeEulerZYX) {
-    double q0 = q[model.mJoints[joint_id].q_index];
-    double q1 = q[model.mJoints[joint_id].q_index + 1];
-    double q2 = q[model.mJoints[joint_id].q_index + 2];
+    unsigned int q_index = model.mJoints[joint_id].q_index;
 
-    double s0 = sin (q0);
-    double c0 = cos (q0);
-    double s1 = sin (q1);
-    double c1 = cos (q1);
-    double s2 = sin (q2);
-    double c2 = cos (q2);
+    double s0, c0, s1, c1, s2, c2;
+    JointSinCos (model, q, q_index, sincos_computed, &s0, &c0);
+    JointSinCos (model, q, q_index + 1, sincos_computed, &s1, &c1);
+    JointSinCos (model, q, q_index + 2, sincos_computed, &s2, &c2);
 
     model.X_lambda[joint_id] = SpatialTransform ( 
         Matrix3d(
@@ -489,16 +546,12 @@ RBDL_DLLAPI void jcalc_X_lambda_S (
     model.multdof3_S[joint_id](2,0) = c1 * c2;
     model.multdof3_S[joint_id](2,1) = - s2;
   } else if (model.mJoints[joint_id].mJointType == JointTypeEulerXYZ) {
-    double q0 = q[model.mJoints[joint_id].q_index];
-    double q1 = q[model.mJoints[joint_id].q_index + 1];
-    double q2 = q[model.mJoints[joint_id].q_index + 2];
+    unsigned int q_index = model.mJoints[joint_id].q_index;
 
-    double s0 = sin (q0);
-    double c0 = cos (q0);
-    double s1 = sin (q1);
-    double c1 = cos (q1);
-    double s2 = sin (q2);
-    double c2 = cos (q2);
+    double s0, c0, s1, c1, s2, c2;
+    JointSinCos (model, q, q_index, sincos_computed, &s0, &c0);
+    JointSinCos (model, q, q_index + 1, sincos_computed, &s1, &c1);
+    JointSinCos (model, q, q_index + 2, sincos_computed, &s2, &c2);
 
     model.X_lambda[joint_id] = SpatialTransform (
         Matrix3d(
@@ -518,16 +571,12 @@ RBDL_DLLAPI void jcalc_X_lambda_S (
     model.multdof3_S[joint_id](2,0) = s1;
     model.multdof3_S[joint_id](2,2) = 1.;
   } else if (model.mJoints[joint_id].mJointType == JointTypeEulerYXZ ) {
-    double q0 = q[model.mJoints[joint_id].q_index];
-    double q1 = q[model.mJoints[joint_id].q_index + 1];
-    double q2 = q[model.mJoints[joint_id].q_index + 2];
+    unsigned int q_index = model.mJoints[joint_id].q_index;
 
-    double s0 = sin (q0);
-    double c0 = cos (q0);
-    double s1 = sin (q1);
-    double c1 = cos (q1);
-    double s2 = sin (q2);
-    double c2 = cos (q2);
+    double s0, c0, s1, c1, s2, c2;
+    JointSinCos (model, q, q_index, sincos_computed, &s0, &c0);
+    JointSinCos (model, q, q_index + 1, sincos_computed, &s1, &c1);
+    JointSinCos (model, q, q_index + 2, sincos_computed, &s2, &c2);
 
     model.X_lambda[joint_id] = SpatialTransform (
         Matrix3d(
@@ -547,16 +596,12 @@ RBDL_DLLAPI void jcalc_X_lambda_S (
     model.multdof3_S[joint_id](2,0) = -s1;
     model.multdof3_S[joint_id](2,2) = 1.;
   } else if (model.mJoints[joint_id].mJointType == JointTypeEulerZXY ) {
-    double q0 = q[model.mJoints[joint_id].q_index];
-    double q1 = q[model.mJoints[joint_id].q_index + 1];
-    double q2 = q[model.mJoints[joint_id].q_index + 2];
+    unsigned int q_index = model.mJoints[joint_id].q_index;
 
-    double s0 = sin (q0);
-    double c0 = cos (q0);
-    double s1 = sin (q1);
-    double c1 = cos (q1);
-    double s2 = sin (q2);
-    double c2 = cos (q2);
+    double s0, c0, s1, c1, s2, c2;
+    JointSinCos (model, q, q_index, sincos_computed, &s0, &c0);
+    JointSinCos (model, q, q_index + 1, sincos_computed, &s1, &c1);
+    JointSinCos (model, q, q_index + 2, sincos_computed, &s2, &c2);
 
     model.X_lambda[joint_id] = SpatialTransform (
         Matrix3d(
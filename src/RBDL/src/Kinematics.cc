@@ -8,6 +8,7 @@
 #include <iostream>
 #include <limits>
 #include <cstring>
+#include <algorithm>
 #include <assert.h>
 
 #include "rbdl/rbdl_mathutils.h"
@@ -31,11 +32,13 @@ RBDL_DLLAPI void UpdateKinematics(
 
   model.a[0].setZero();
 
+  jcalc_sincos (model, Q);
+
   for (i = 1; i < model.mBodies.size(); i++) {
     unsigned int q_index = model.mJoints[i].q_index;
     unsigned int lambda = model.lambda[i];
 
-    jcalc (model, i, Q, QDot);
+    jcalc (model, i, Q, QDot, true);
 
     if (lambda != 0) {
       model.X_base[i] = model.X_lambda[i] * model.X_base[lambda];
@@ -83,12 +86,14 @@ RBDL_DLLAPI void UpdateKinematicsCustom(
   unsigned int i;
 
   if (Q) {
+    jcalc_sincos (model, *Q);
+
     for (i = 1; i < model.mBodies.size(); i++) {
       unsigned int lambda = model.lambda[i];
 
       VectorNd QDot_zero (VectorNd::Zero (model.q_size));
 
-      jcalc (model, i, (*Q), QDot_zero);
+      jcalc (model, i, (*Q), QDot_zero, true);
 
       if (lambda != 0) {
         model.X_base[i] = model.X_lambda[i] * model.X_base[lambda];
@@ -102,7 +107,7 @@ RBDL_DLLAPI void UpdateKinematicsCustom(
     for (i = 1; i < model.mBodies.size(); i++) {
       unsigned int lambda = model.lambda[i];
 
-      jcalc (model, i, *Q, *QDot);
+      jcalc (model, i, *Q, *QDot, true);
 
       if (lambda != 0) {
         model.v[i] = model.X_lambda[i].apply(model.v[lambda]) + model.v_J[i];
@@ -613,81 +618,20 @@ RBDL_DLLAPI bool InverseKinematics (
   assert (body_id.size() == body_point.size());
   assert (body_id.size() == target_pos.size());
 
-  MatrixNd J = MatrixNd::Zero(3 * body_id.size(), model.qdot_size);
-  VectorNd e = VectorNd::Zero(3 * body_id.size());
-
-  Qres = Qinit;
-
-  for (unsigned int ik_iter = 0; ik_iter < max_iter; ik_iter++) {
-    UpdateKinematicsCustom (model, &Qres, NULL, NULL);
-
-    for (unsigned int k = 0; k < body_id.size(); k++) {
-      MatrixNd G (MatrixNd::Zero(3, model.qdot_size));
-      CalcPointJacobian (model, Qres, body_id[k], body_point[k], G, false);
-      Vector3d point_base =
-        CalcBodyToBaseCoordinates (model, Qres, body_id[k], body_point[k], false);
-      LOG << "current_pos = " << point_base.transpose() << std::endl;
-
-      for (unsigned int i = 0; i < 3; i++) {
-        for (unsigned int j = 0; j < model.qdot_size; j++) {
-          unsigned int row = k * 3 + i;
-          LOG << "i = " << i << " j = " << j << " k = " << k << " row = "
-            << row << " col = " << j << std::endl;
-          J(row, j) = G (i,j);
-        }
-
-        e[k * 3 + i] = target_pos[k][i] - point_base[i];
-      }
-    }
-
-    LOG << "J = " << J << std::endl;
-    LOG << "e = " << e.transpose() << std::endl;
-
-    // abort if we are getting "close"
-    if (e.norm() < step_tol) {
-      LOG << "Reached target close enough after " << ik_iter << " steps" << std::endl;
-      return true;
-    }
-
-    MatrixNd JJTe_lambda2_I =
-      J * J.transpose()
-      + lambda*lambda * MatrixNd::Identity(e.size(), e.size());
-
-    VectorNd z (body_id.size() * 3);
-    z = JJTe_lambda2_I.colPivHouseholderQr().solve (e);
-
-    LOG << "z = " << z << std::endl;
-
-    VectorNd delta_theta = J.transpose() * z;
-    LOG << "change = " << delta_theta << std::endl;
-
-    Qres = Qres + delta_theta;
-    LOG << "Qres = " << Qres.transpose() << std::endl;
-
-    if (delta_theta.norm() < step_tol) {
-      LOG << "reached convergence after " << ik_iter << " steps" << std::endl;
-      return true;
-    }
-
-    VectorNd test_1 (z.size());
-    VectorNd test_res (z.size());
-
-    test_1.setZero();
-
-    for (unsigned int i = 0; i < z.size(); i++) {
-      test_1[i] = 1.;
-
-      VectorNd test_delta = J.transpose() * test_1;
+  InverseKinematicsConstraintSet CS;
+  for (unsigned int k = 0; k < body_id.size(); k++) {
+    CS.AddPointConstraint (body_id[k], body_point[k], target_pos[k]);
+  }
 
-      test_res[i] = test_delta.squaredNorm();
+  CS.lambda = lambda * lambda;
+  CS.adaptive_damping = false;
+  CS.max_steps = max_iter;
+  CS.step_tol = step_tol;
+  CS.constraint_tol = step_tol;
 
-      test_1[i] = 0.;
-    }
-
-    LOG << "test_res = " << test_res.transpose() << std::endl;
-  }
+  Qres = Qinit;
 
-  return false;
+  return InverseKinematics (model, Qinit, CS, Qres);
 }
 
 RBDL_DLLAPI
@@ -718,20 +662,31 @@ InverseKinematicsConstraintSet::InverseKinematicsConstraintSet() {
   step_tol = 1e-12;
   constraint_tol = 1e-12;
   num_constraints = 0;
+  error_norm = 0.;
+  adaptive_damping = true;
+  max_level_step_norm = 0.5;
+  max_hard_priority = 0;
+  cancel = NULL;
+  step_norm = 0.;
+  damping = 0.;
+  num_rejected_steps = 0;
 }
 
 RBDL_DLLAPI
 unsigned int InverseKinematicsConstraintSet::AddPointConstraint(
     unsigned int body_id,
     const Vector3d& body_point,
-    const Vector3d& target_pos
+    const Vector3d& target_pos,
+    unsigned int priority
     ) {
   constraint_type.push_back (ConstraintTypePosition);
   body_ids.push_back(body_id);
   body_points.push_back(body_point);
   target_positions.push_back(target_pos);
   target_orientations.push_back(Matrix3d::Zero(3,3));
+  target_postures.push_back(VectorNd());
   constraint_row_index.push_back(num_constraints);
+  constraint_priority.push_back(priority);
   num_constraints = num_constraints + 3;
   return constraint_type.size() - 1;
 }
@@ -739,14 +694,17 @@ unsigned int InverseKinematicsConstraintSet::AddPointConstraint(
 RBDL_DLLAPI
 unsigned int InverseKinematicsConstraintSet::AddOrientationConstraint(
     unsigned int body_id,
-    const Matrix3d& target_orientation
+    const Matrix3d& target_orientation,
+    unsigned int priority
     ) {
   constraint_type.push_back (ConstraintTypeOrientation);
   body_ids.push_back(body_id);
   body_points.push_back(Vector3d::Zero());
   target_positions.push_back(Vector3d::Zero());
   target_orientations.push_back(target_orientation);
+  target_postures.push_back(VectorNd());
   constraint_row_index.push_back(num_constraints);
+  constraint_priority.push_back(priority);
   num_constraints = num_constraints + 3;
   return constraint_type.size() - 1;
 }
@@ -756,33 +714,370 @@ unsigned int InverseKinematicsConstraintSet::AddFullConstraint(
     unsigned int body_id,
     const Vector3d& body_point,
     const Vector3d& target_pos,
-    const Matrix3d& target_orientation
+    const Matrix3d& target_orientation,
+    unsigned int priority
     ) {
   constraint_type.push_back (ConstraintTypeFull);
   body_ids.push_back(body_id);
   body_points.push_back(body_point);
   target_positions.push_back(target_pos);
   target_orientations.push_back(target_orientation);
+  target_postures.push_back(VectorNd());
   constraint_row_index.push_back(num_constraints);
+  constraint_priority.push_back(priority);
   num_constraints = num_constraints + 6;
   return constraint_type.size() - 1;
 }
 
+RBDL_DLLAPI
+unsigned int InverseKinematicsConstraintSet::AddCoMConstraint(
+    const Vector3d& target_com,
+    unsigned int priority
+    ) {
+  constraint_type.push_back (ConstraintTypeCoM);
+  body_ids.push_back(0);
+  body_points.push_back(Vector3d::Zero());
+  target_positions.push_back(target_com);
+  target_orientations.push_back(Matrix3d::Zero(3,3));
+  target_postures.push_back(VectorNd());
+  constraint_row_index.push_back(num_constraints);
+  constraint_priority.push_back(priority);
+  num_constraints = num_constraints + 3;
+  return constraint_type.size() - 1;
+}
+
+RBDL_DLLAPI
+unsigned int InverseKinematicsConstraintSet::AddPostureConstraint(
+    const VectorNd& target_q,
+    unsigned int priority
+    ) {
+  constraint_type.push_back (ConstraintTypePosture);
+  body_ids.push_back(0);
+  body_points.push_back(Vector3d::Zero());
+  target_positions.push_back(Vector3d::Zero());
+  target_orientations.push_back(Matrix3d::Zero(3,3));
+  target_postures.push_back(target_q);
+  constraint_row_index.push_back(num_constraints);
+  constraint_priority.push_back(priority);
+  num_constraints = num_constraints + target_q.size();
+  return constraint_type.size() - 1;
+}
+
 RBDL_DLLAPI
 unsigned int InverseKinematicsConstraintSet::ClearConstraints()
 {
-  for (unsigned int i =0; i < constraint_type.size(); i++){
-    constraint_type.pop_back();
-    body_ids.pop_back();
-    body_points.pop_back();
-    target_positions.pop_back();
-    target_orientations.pop_back();
-    num_constraints = 0;
-  }
+  constraint_type.clear();
+  body_ids.clear();
+  body_points.clear();
+  target_positions.clear();
+  target_orientations.clear();
+  target_postures.clear();
+  constraint_row_index.clear();
+  constraint_priority.clear();
+  num_constraints = 0;
   return constraint_type.size();
 }
 
 
+/* Center of mass constraint k of CS. The Jacobian column of a joint is
+ * the velocity of the center of mass of its subtree times the subtree
+ * mass (relative to the total mass), which only needs the subtree masses
+ * and the subtree sums of mass times center of mass. */
+static void CalcIKCoMResidual (
+    Model &model,
+    const VectorNd &Q,
+    InverseKinematicsConstraintSet &CS,
+    unsigned int k,
+    VectorNd &e,
+    MatrixNd *J) {
+  unsigned int row = CS.constraint_row_index[k];
+
+  CS.subtree_masses.resize (model.mBodies.size());
+  CS.subtree_mass_moments.resize (model.mBodies.size());
+  CS.subtree_masses[0] = 0.;
+  CS.subtree_mass_moments[0].setZero();
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    double mass = model.mBodies[i].mMass;
+    CS.subtree_masses[i] = mass;
+    CS.subtree_mass_moments[i] = mass * CalcBodyToBaseCoordinates (model, Q,
+        i, model.mBodies[i].mCenterOfMass, false);
+  }
+
+  for (unsigned int i = model.mBodies.size() - 1; i > 0; i--) {
+    unsigned int lambda = model.lambda[i];
+    CS.subtree_masses[lambda] += CS.subtree_masses[i];
+    CS.subtree_mass_moments[lambda] += CS.subtree_mass_moments[i];
+  }
+
+  double total_mass = CS.subtree_masses[0];
+  assert (total_mass > 0.);
+
+  Vector3d com = CS.subtree_mass_moments[0] / total_mass;
+  for (unsigned int i = 0; i < 3; i++) {
+    e[row + i] = CS.target_positions[k][i] - com[i];
+  }
+
+  if (J == NULL) {
+    return;
+  }
+
+  for (unsigned int j = 1; j < model.mBodies.size(); j++) {
+    unsigned int q_index = model.mJoints[j].q_index;
+
+    for (unsigned int c = q_index; c < q_index + model.mJoints[j].mDoFCount;
+        c++) {
+      Vector3d omega (CS.G(0, c), CS.G(1, c), CS.G(2, c));
+      Vector3d v_com = (CS.subtree_masses[j]
+          * Vector3d (CS.G(3, c), CS.G(4, c), CS.G(5, c))
+          + omega.cross (CS.subtree_mass_moments[j])) / total_mass;
+
+      for (unsigned int i = 0; i < 3; i++) {
+        (*J)(row + i, c) = v_com[i];
+      }
+    }
+  }
+}
+
+/* Posture constraint k of CS. It has a row for each entry of Q. The
+ * rows of spherical joints hold the rotation vector (body coordinates)
+ * to the target orientation, the row of the w component stays zero. */
+static void CalcIKPostureResidual (
+    Model &model,
+    const VectorNd &Q,
+    InverseKinematicsConstraintSet &CS,
+    unsigned int k,
+    VectorNd &e,
+    MatrixNd *J) {
+  unsigned int row = CS.constraint_row_index[k];
+  const VectorNd &target_q = CS.target_postures[k];
+  assert (target_q.size() == model.q_size);
+
+  for (unsigned int j = 1; j < model.mBodies.size(); j++) {
+    unsigned int q_index = model.mJoints[j].q_index;
+
+    if (model.mJoints[j].mJointType == JointTypeSpherical) {
+      Quaternion delta = model.GetQuaternion (j, Q).conjugate()
+        * model.GetQuaternion (j, target_q);
+      if (delta[3] < 0.) {
+        delta = delta * -1.;
+      }
+
+      Vector3d axis (delta[0], delta[1], delta[2]);
+      double sin_half_angle = axis.norm();
+      Vector3d rotation = Vector3d::Zero();
+      if (sin_half_angle > 0.) {
+        rotation = axis * (2. * atan2 (sin_half_angle, delta[3])
+            / sin_half_angle);
+      }
+
+      for (unsigned int i = 0; i < 3; i++) {
+        e[row + q_index + i] = rotation[i];
+      }
+      e[row + model.multdof3_w_index[j]] = 0.;
+    } else {
+      for (unsigned int i = q_index;
+          i < q_index + model.mJoints[j].mDoFCount; i++) {
+        e[row + i] = target_q[i] - Q[i];
+      }
+    }
+
+    if (J == NULL) {
+      continue;
+    }
+
+    for (unsigned int i = q_index; i < q_index + model.mJoints[j].mDoFCount;
+        i++) {
+      (*J)(row + i, i) = 1.;
+    }
+  }
+}
+
+/* Computes the residuals of all constraints of CS at the current kinematic
+ * state and, if J is not NULL, their Jacobian. The motion subspaces of
+ * all joints are transformed to base coordinates once (CS.G) so that the
+ * Jacobian of each constraint only needs a cross product per column. */
+static void CalcIKConstraintResiduals (
+    Model &model,
+    const VectorNd &Q,
+    InverseKinematicsConstraintSet &CS,
+    VectorNd &e,
+    MatrixNd *J) {
+  if (J != NULL) {
+    J->setZero();
+
+    for (unsigned int j = 1; j < model.mBodies.size(); j++) {
+      unsigned int q_index = model.mJoints[j].q_index;
+      SpatialTransform X_base_inv = model.X_base[j].inverse();
+
+      if (model.mJoints[j].mJointType == JointTypeCustom) {
+        unsigned int k = model.mJoints[j].custom_joint_index;
+        CS.G.block(0, q_index, 6, model.mCustomJoints[k]->mDoFCount) =
+          X_base_inv.toMatrix() * model.mCustomJoints[k]->S;
+      } else if (model.mJoints[j].mDoFCount == 1) {
+        CS.G.block(0, q_index, 6, 1) = X_base_inv.apply (model.S[j]);
+      } else if (model.mJoints[j].mDoFCount == 3) {
+        CS.G.block(0, q_index, 6, 3) = X_base_inv.toMatrix()
+          * model.multdof3_S[j];
+      }
+    }
+  }
+
+  for (unsigned int k = 0; k < CS.body_ids.size(); k++) {
+    unsigned int row = CS.constraint_row_index[k];
+    InverseKinematicsConstraintSet::ConstraintType type =
+      CS.constraint_type[k];
+
+    if (type == InverseKinematicsConstraintSet::ConstraintTypeCoM) {
+      CalcIKCoMResidual (model, Q, CS, k, e, J);
+      continue;
+    } else if (type
+        == InverseKinematicsConstraintSet::ConstraintTypePosture) {
+      CalcIKPostureResidual (model, Q, CS, k, e, J);
+      continue;
+    }
+
+    // rows of the angular and the linear part of the constraint
+    int angular_row = -1;
+    int linear_row = -1;
+
+    if (type == InverseKinematicsConstraintSet::ConstraintTypeFull) {
+      angular_row = row;
+      linear_row = row + 3;
+    } else if (type
+        == InverseKinematicsConstraintSet::ConstraintTypeOrientation) {
+      angular_row = row;
+    } else if (type
+        == InverseKinematicsConstraintSet::ConstraintTypePosition) {
+      linear_row = row;
+    } else {
+      assert (false && !"Invalid inverse kinematics constraint");
+    }
+
+    Vector3d point_base = CalcBodyToBaseCoordinates (model, Q,
+        CS.body_ids[k], CS.body_points[k], false);
+
+    if (angular_row >= 0) {
+      Matrix3d R = CalcBodyWorldOrientation (model, Q, CS.body_ids[k],
+          false);
+      Vector3d angular_velocity = R.transpose()
+        * CalcAngularVelocityfromMatrix (R
+            * CS.target_orientations[k].transpose());
+
+      for (unsigned int i = 0; i < 3; i++) {
+        e[angular_row + i] = angular_velocity[i];
+      }
+    }
+
+    if (linear_row >= 0) {
+      for (unsigned int i = 0; i < 3; i++) {
+        e[linear_row + i] = CS.target_positions[k][i] - point_base[i];
+      }
+    }
+
+    if (J == NULL) {
+      continue;
+    }
+
+    unsigned int j = CS.body_ids[k];
+    if (model.IsFixedBodyId (j)) {
+      j = model.mFixedBodies[j - model.fixed_body_discriminator]
+        .mMovableParent;
+    }
+
+    for (; j != 0; j = model.lambda[j]) {
+      unsigned int q_index = model.mJoints[j].q_index;
+      unsigned int dof_count = model.mJoints[j].mDoFCount;
+
+      for (unsigned int c = q_index; c < q_index + dof_count; c++) {
+        Vector3d omega (CS.G(0, c), CS.G(1, c), CS.G(2, c));
+        Vector3d v_point = Vector3d (CS.G(3, c), CS.G(4, c), CS.G(5, c))
+          + omega.cross (point_base);
+
+        for (unsigned int i = 0; i < 3; i++) {
+          if (angular_row >= 0) {
+            (*J)(angular_row + i, c) = omega[i];
+          }
+          if (linear_row >= 0) {
+            (*J)(linear_row + i, c) = v_point[i];
+          }
+        }
+      }
+    }
+  }
+}
+
+/* Computes Q_out = Q + delta_q. Spherical joints are updated on their
+ * quaternions with delta_q as rotation vector in body coordinates. */
+static void IntegrateIKStep (
+    const Model &model,
+    const VectorNd &Q,
+    const VectorNd &delta_q,
+    VectorNd &Q_out) {
+  Q_out = Q;
+  for (unsigned int i = 0; i < model.qdot_size; i++) {
+    Q_out[i] += delta_q[i];
+  }
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    if (model.mJoints[i].mJointType != JointTypeSpherical) {
+      continue;
+    }
+
+    unsigned int q_index = model.mJoints[i].q_index;
+    Vector3d omega (delta_q[q_index], delta_q[q_index + 1],
+        delta_q[q_index + 2]);
+    double angle = omega.norm();
+    Quaternion quat = model.GetQuaternion (i, Q);
+
+    if (angle > 0.) {
+      quat = quat * Quaternion::fromAxisAngle (omega / angle, angle);
+    }
+
+    model.SetQuaternion (i, quat, Q_out);
+  }
+}
+
+/* Number of rows of constraint k of CS. */
+static inline unsigned int IKConstraintRowCount (
+    const InverseKinematicsConstraintSet &CS,
+    unsigned int k) {
+  if (k + 1 < CS.constraint_row_index.size()) {
+    return CS.constraint_row_index[k + 1] - CS.constraint_row_index[k];
+  }
+  return CS.num_constraints - CS.constraint_row_index[k];
+}
+
+/* Whether the solve was cancelled through the optional flag of CS. */
+static inline bool IKCancelled (const InverseKinematicsConstraintSet &CS) {
+  return CS.cancel != NULL && CS.cancel->load (std::memory_order_relaxed);
+}
+
+/* Shortens the entries of delta_q so that Q + delta_q stays within the
+ * joint limits of CS. Spherical joints are not limited. */
+static void ProjectIKStepOnJointLimits (
+    const Model &model,
+    const VectorNd &Q,
+    const InverseKinematicsConstraintSet &CS,
+    VectorNd &delta_q) {
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    if (model.mJoints[i].mJointType == JointTypeSpherical) {
+      continue;
+    }
+
+    unsigned int q_index = model.mJoints[i].q_index;
+    for (unsigned int z = 0; z < model.mJoints[i].mDoFCount; z++) {
+      unsigned int qi = q_index + z;
+      if (CS.q_max.size() > 0 && Q[qi] + delta_q[qi] > CS.q_max[qi]) {
+        delta_q[qi] = CS.q_max[qi] - Q[qi];
+      }
+      if (CS.q_min.size() > 0 && Q[qi] + delta_q[qi] < CS.q_min[qi]) {
+        delta_q[qi] = CS.q_min[qi] - Q[qi];
+      }
+    }
+  }
+}
+
 RBDL_DLLAPI
 bool InverseKinematics (
     Model &model,
@@ -792,111 +1087,442 @@ bool InverseKinematics (
     ) {
   assert (Qinit.size() == model.q_size);
   assert (Qres.size() == Qinit.size());
+  assert (CS.q_min.size() == 0 || CS.q_min.size() == model.q_size);
+  assert (CS.q_max.size() == 0 || CS.q_max.size() == model.q_size);
 
-  CS.J = MatrixNd::Zero(CS.num_constraints, model.qdot_size);
-  CS.e = VectorNd::Zero(CS.num_constraints);
+  unsigned int row_count = CS.num_constraints;
+  unsigned int col_count = model.qdot_size;
+  bool dual = row_count < col_count;
+  unsigned int normal_size = dual ? row_count : col_count;
+
+  if (CS.J.rows() != row_count || CS.J.cols() != col_count) {
+    CS.J.resize (row_count, col_count);
+  }
+  if (CS.G.rows() != 6 || CS.G.cols() != col_count) {
+    CS.G = MatrixNd::Zero (6, col_count);
+  }
+  if (CS.A.rows() != normal_size) {
+    CS.A.resize (normal_size, normal_size);
+  }
+  CS.e.resize (row_count);
+  CS.e_trial.resize (row_count);
+  CS.z.resize (row_count);
+  CS.delta_q.resize (col_count);
+  CS.q_trial.resize (model.q_size);
 
   Qres = Qinit;
 
-  for (CS.num_steps = 0; CS.num_steps < CS.max_steps; CS.num_steps++) {
-    UpdateKinematicsCustom (model, &Qres, NULL, NULL);
+  UpdateKinematicsCustom (model, &Qres, NULL, NULL);
+  CalcIKConstraintResiduals (model, Qres, CS, CS.e, &CS.J);
 
-    for (unsigned int k = 0; k < CS.body_ids.size(); k++) {
-      CS.G = MatrixNd::Zero(6, model.qdot_size);
-      CalcPointJacobian6D (model, Qres, CS.body_ids[k], CS.body_points[k], CS.G, false);
-      Vector3d point_base = CalcBodyToBaseCoordinates (model, Qres, CS.body_ids[k], CS.body_points[k], false);
-      Matrix3d R = CalcBodyWorldOrientation(model, Qres, CS.body_ids[k], false);
-      Vector3d angular_velocity = R.transpose()*CalcAngularVelocityfromMatrix(R*CS.target_orientations[k].transpose());
-
-      //assign offsets and Jacobians
-      if (CS.constraint_type[k] == InverseKinematicsConstraintSet::ConstraintTypeFull){
-        for (unsigned int i = 0; i < 3; i++){
-          unsigned int row = CS.constraint_row_index[k] + i;
-          CS.e[row + 3] = CS.target_positions[k][i] - point_base[i];
-          CS.e[row] = angular_velocity[i];
-          for (unsigned int j = 0; j < model.qdot_size; j++) {
-            CS.J(row + 3, j) = CS.G (i + 3,j);
-            CS.J(row, j) = CS.G (i,j);
-          }
-        }
-      }
-      else if (CS.constraint_type[k] == InverseKinematicsConstraintSet::ConstraintTypeOrientation){
-        for (unsigned int i = 0; i < 3; i++){
-          unsigned int row = CS.constraint_row_index[k] + i;
-          CS.e[row] = angular_velocity[i];
-          for (unsigned int j = 0; j < model.qdot_size; j++) {
-            CS.J(row, j) = CS.G (i,j);
-          }
-        }
-      }
-      else if (CS.constraint_type[k] == InverseKinematicsConstraintSet::ConstraintTypePosition){
-        for (unsigned int i = 0; i < 3; i++){
-          unsigned int row = CS.constraint_row_index[k] + i;
-          CS.e[row] = CS.target_positions[k][i] - point_base[i];
-          for (unsigned int j = 0; j < model.qdot_size; j++) {
-            CS.J(row, j) = CS.G (i + 3,j);
-          }
-        }
-      }
-      else {
-        assert (false && !"Invalid inverse kinematics constraint");
-      }
-    }
+  // the damping has to stay positive for the Cholesky factorization
+  const double min_damping = std::numeric_limits<double>::epsilon();
 
+  double cost = 0.5 * CS.e.squaredNorm();
+  double mu = std::max (CS.lambda, min_damping);
+  double nu = 2.;
+
+  CS.step_norm = 0.;
+  CS.num_rejected_steps = 0;
+
+  for (CS.num_steps = 0; CS.num_steps < CS.max_steps; CS.num_steps++) {
     LOG << "J = " << CS.J << std::endl;
     LOG << "e = " << CS.e.transpose() << std::endl;
     CS.error_norm = CS.e.norm();
+    CS.damping = mu;
 
     // abort if we are getting "close"
-    if (CS.error_norm < CS.step_tol) {
+    if (CS.error_norm < CS.constraint_tol) {
       LOG << "Reached target close enough after " << CS.num_steps << " steps" << std::endl;
       return true;
     }
+    if (IKCancelled (CS)) {
+      LOG << "Cancelled after " << CS.num_steps << " steps" << std::endl;
+      return false;
+    }
 
-    //     // "task space" from puppeteer
-    //     MatrixNd Ek = MatrixNd::Zero (CS.e.size(), CS.e.size());
-    //
-    //     for (size_t ei = 0; ei < CS.e.size(); ei ++) {
-    // //      Ek(ei,ei) = CS.error_norm * CS.error_norm * 0.5 + CS.lambda;
-    //       Ek(ei,ei) = CS.e[ei]*CS.e[ei] * 0.5 + CS.lambda;
-    //     }
-    //
-    //     MatrixNd JJT_Ek_wnI = CS.J * CS.J.transpose() + Ek;
-    //
-    //     VectorNd delta_theta = CS.J.transpose() * JJT_Ek_wnI.colPivHouseholderQr().solve (CS.e);
-    //
-    //     LOG << "change = " << delta_theta << std::endl;
+    // delta_q = (J^T J + mu I)^-1 J^T e = J^T (J J^T + mu I)^-1 e
+#ifdef EIGEN_CORE_H
+    if (dual) {
+      CS.A.noalias() = CS.J * CS.J.transpose();
+      CS.z = CS.e;
+    } else {
+      CS.A.noalias() = CS.J.transpose() * CS.J;
+      CS.delta_q.noalias() = CS.J.transpose() * CS.e;
+    }
+    CS.A.diagonal().array() += mu;
+
+    // factorizes A in place
+    Eigen::LLT<Eigen::Ref<MatrixNd> > llt (CS.A);
+    if (llt.info() != Eigen::Success) {
+      mu = mu * nu;
+      nu = 2. * nu;
+      CS.num_rejected_steps++;
+      continue;
+    }
 
+    if (dual) {
+      llt.solveInPlace (CS.z);
+      CS.delta_q.noalias() = CS.J.transpose() * CS.z;
+    } else {
+      llt.solveInPlace (CS.delta_q);
+    }
+#else
+    if (dual) {
+      CS.A = CS.J * CS.J.transpose();
+    } else {
+      CS.A = CS.J.transpose() * CS.J;
+    }
+    for (unsigned int i = 0; i < normal_size; i++) {
+      CS.A(i, i) += mu;
+    }
 
-    // "joint space" from puppeteer
+    if (dual) {
+      CS.z = CS.A.llt().solve (CS.e);
+      CS.delta_q = CS.J.transpose() * CS.z;
+    } else {
+      CS.delta_q = CS.A.llt().solve (CS.J.transpose() * CS.e);
+    }
+#endif
 
-    double Ek = 0.;
+    ProjectIKStepOnJointLimits (model, Qres, CS, CS.delta_q);
+    CS.step_norm = CS.delta_q.norm();
+    LOG << "change = " << CS.delta_q.transpose() << std::endl;
 
-    for (unsigned int ei = 0; ei < CS.e.size(); ei ++) {
-      Ek += CS.e[ei] * CS.e[ei] * 0.5;
+    if (CS.step_norm < CS.step_tol) {
+      LOG << "reached convergence after " << CS.num_steps << " steps" << std::endl;
+      return true;
     }
 
-    VectorNd ek = CS.J.transpose() * CS.e;
-    MatrixNd Wn = MatrixNd::Zero (Qres.size(), Qres.size());
+    IntegrateIKStep (model, Qres, CS.delta_q, CS.q_trial);
+    UpdateKinematicsCustom (model, &CS.q_trial, NULL, NULL);
+    CalcIKConstraintResiduals (model, CS.q_trial, CS, CS.e_trial, NULL);
+
+    // gain ratio of the actual and the predicted reduction of the cost
+    double cost_trial = 0.5 * CS.e_trial.squaredNorm();
+    double rho = 1.;
+
+    if (CS.adaptive_damping) {
+#ifdef EIGEN_CORE_H
+      CS.z = CS.e;
+      CS.z.noalias() -= CS.J * CS.delta_q;
+#else
+      CS.z = CS.e - CS.J * CS.delta_q;
+#endif
+      double predicted_reduction = cost - 0.5 * CS.z.squaredNorm();
+      rho = -1.;
+      if (predicted_reduction > 0.) {
+        rho = (cost - cost_trial) / predicted_reduction;
+      }
+    }
 
-    assert (ek.size() == Qres.size());
+    if (rho > 0.) {
+      Qres = CS.q_trial;
+      CS.e = CS.e_trial;
+      cost = cost_trial;
+      CalcIKConstraintResiduals (model, Qres, CS, CS.e, &CS.J);
 
-    for (unsigned int wi = 0; wi < Qres.size(); wi++) {
-      Wn(wi, wi) = ek[wi] * ek[wi] * 0.5 + CS.lambda;
-      //      Wn(wi, wi) = Ek + 1.0e-3;
+      if (CS.adaptive_damping) {
+        double r = 2. * rho - 1.;
+        mu = std::max (mu * std::max (1. / 3., 1. - r * r * r), min_damping);
+        nu = 2.;
+      }
+      LOG << "Qres = " << Qres.transpose() << std::endl;
+    } else {
+      mu = mu * nu;
+      nu = 2. * nu;
+      CS.num_rejected_steps++;
     }
+  }
 
-    MatrixNd A = CS.J.transpose() * CS.J + Wn;
-    VectorNd delta_theta = A.colPivHouseholderQr().solve(CS.J.transpose() * CS.e);
+  CS.error_norm = CS.e.norm();
+  CS.damping = mu;
 
-    Qres = Qres + delta_theta;
-    if (delta_theta.norm() < CS.step_tol) {
-      LOG << "reached convergence after " << CS.num_steps << " steps" << std::endl;
-      return true;
+  return false;
+}
+
+#ifndef RBDL_USE_SIMPLE_MATH
+/* Damping per unit residual of a priority level that takes all remaining
+ * directions of the null space of the higher levels. */
+static const double IKConflictingLevelDamping = 0.3;
+
+/* Sets the convergence status of the priority levels at the end of
+ * InverseKinematicsPrioritized() and returns whether all hard levels are
+ * satisfied. converged is true if the step of all levels vanished. */
+static bool FinishIKPriorityLevels (
+    InverseKinematicsConstraintSet &CS,
+    bool converged) {
+  bool hard_satisfied = true;
+
+  for (unsigned int l = 0; l < CS.priority_error_norms.size(); l++) {
+    if (CS.priority_error_norms[l] < CS.constraint_tol) {
+      CS.priority_level_status[l] =
+        InverseKinematicsConstraintSet::PriorityLevelSatisfied;
+      continue;
+    }
+
+    if (converged || CS.priority_step_norms[l] < CS.step_tol) {
+      CS.priority_level_status[l] =
+        InverseKinematicsConstraintSet::PriorityLevelConverged;
+    } else {
+      CS.priority_level_status[l] =
+        InverseKinematicsConstraintSet::PriorityLevelNotConverged;
+    }
+
+    unsigned int k = CS.priority_constraints[CS.priority_levels[l]];
+    if (CS.constraint_priority[k] <= CS.max_hard_priority) {
+      hard_satisfied = false;
     }
   }
 
-  return false;
+  return hard_satisfied;
+}
+
+RBDL_DLLAPI
+bool InverseKinematicsPrioritized (
+    Model &model,
+    const Math::VectorNd &Qinit,
+    InverseKinematicsConstraintSet &CS,
+    Math::VectorNd &Qres
+    ) {
+  assert (Qinit.size() == model.q_size);
+  assert (Qres.size() == Qinit.size());
+  assert (CS.q_min.size() == 0 || CS.q_min.size() == model.q_size);
+  assert (CS.q_max.size() == 0 || CS.q_max.size() == model.q_size);
+  assert (CS.constraint_priority.size() == CS.constraint_type.size());
+
+  unsigned int constraint_count = CS.constraint_type.size();
+  unsigned int row_count = CS.num_constraints;
+  unsigned int col_count = model.qdot_size;
+
+  if (CS.J.rows() != row_count || CS.J.cols() != col_count) {
+    CS.J.resize (row_count, col_count);
+  }
+  if (CS.J_priority.rows() != col_count || CS.J_priority.cols() != row_count) {
+    CS.J_priority.resize (col_count, row_count);
+  }
+  if (CS.G.rows() != 6 || CS.G.cols() != col_count) {
+    CS.G = MatrixNd::Zero (6, col_count);
+  }
+  if (CS.Z.rows() != col_count || CS.Z.cols() != col_count) {
+    CS.Z.resize (col_count, col_count);
+  }
+  CS.e.resize (row_count);
+  CS.e_priority.resize (row_count);
+  CS.delta_q.resize (col_count);
+  CS.q_trial.resize (model.q_size);
+  CS.level_step.resize (col_count);
+  CS.householder_workspace.resize (col_count);
+
+  // sort the constraints by priority (stable within a level)
+  CS.priority_constraints.clear();
+  CS.priority_levels.clear();
+
+  unsigned int max_level_rows = 0;
+  unsigned int priority = 0;
+  while (CS.priority_constraints.size() < constraint_count) {
+    unsigned int next_priority = std::numeric_limits<unsigned int>::max();
+    unsigned int level_begin = CS.priority_constraints.size();
+    unsigned int level_rows = 0;
+
+    for (unsigned int k = 0; k < constraint_count; k++) {
+      if (CS.constraint_priority[k] == priority) {
+        CS.priority_constraints.push_back (k);
+        level_rows += IKConstraintRowCount (CS, k);
+      } else if (CS.constraint_priority[k] > priority) {
+        next_priority = std::min (next_priority, CS.constraint_priority[k]);
+      }
+    }
+
+    if (CS.priority_constraints.size() > level_begin) {
+      CS.priority_levels.push_back (level_begin);
+      max_level_rows = std::max (max_level_rows, level_rows);
+    }
+    priority = next_priority;
+  }
+  CS.priority_levels.push_back (constraint_count);
+
+  unsigned int level_count = CS.priority_levels.size() - 1;
+  CS.priority_error_norms.resize (level_count);
+  CS.priority_step_norms.assign (level_count,
+      std::numeric_limits<double>::infinity());
+  CS.priority_level_status.resize (level_count);
+
+  unsigned int max_normal_size = std::min (max_level_rows, col_count);
+  if (CS.A.rows() < max_normal_size) {
+    CS.A.resize (max_normal_size, max_normal_size);
+  }
+
+  // the damping has to stay positive for the Cholesky factorization
+  const double mu = std::max (CS.lambda,
+      std::numeric_limits<double>::epsilon());
+
+  Qres = Qinit;
+  CS.step_norm = 0.;
+  CS.damping = mu;
+  CS.num_rejected_steps = 0;
+
+  for (CS.num_steps = 0; ; CS.num_steps++) {
+    UpdateKinematicsCustom (model, &Qres, NULL, NULL);
+    CalcIKConstraintResiduals (model, Qres, CS, CS.e, &CS.J);
+
+    CS.error_norm = CS.e.norm();
+    bool satisfied = true;
+    for (unsigned int l = 0; l < level_count; l++) {
+      double squared_norm = 0.;
+      for (unsigned int c = CS.priority_levels[l];
+          c < CS.priority_levels[l + 1]; c++) {
+        unsigned int k = CS.priority_constraints[c];
+        squared_norm += CS.e.segment (CS.constraint_row_index[k],
+            IKConstraintRowCount (CS, k)).squaredNorm();
+      }
+      CS.priority_error_norms[l] = sqrt (squared_norm);
+      satisfied = satisfied && CS.priority_error_norms[l] < CS.constraint_tol;
+    }
+
+    if (satisfied) {
+      LOG << "Reached target close enough after " << CS.num_steps << " steps" << std::endl;
+      return FinishIKPriorityLevels (CS, true);
+    }
+    if (IKCancelled (CS)) {
+      FinishIKPriorityLevels (CS, false);
+      return false;
+    }
+    if (CS.num_steps == CS.max_steps) {
+      return FinishIKPriorityLevels (CS, false);
+    }
+
+    // levels without remaining directions do not move
+    std::fill (CS.priority_step_norms.begin(), CS.priority_step_norms.end(),
+        0.);
+    CS.delta_q.setZero();
+    unsigned int null_space_dim = col_count;
+    unsigned int level_start = 0;
+
+    for (unsigned int l = 0; l < level_count && null_space_dim > 0; l++) {
+      unsigned int level_rows = 0;
+
+      // transposed Jacobian (J_k Z_{k-1})^T in the null space of the
+      // higher levels and the residual e_k - J_k delta_q that remains
+      // after their steps (Z_0 = I)
+      for (unsigned int c = CS.priority_levels[l];
+          c < CS.priority_levels[l + 1]; c++) {
+        unsigned int k = CS.priority_constraints[c];
+        unsigned int rows = IKConstraintRowCount (CS, k);
+        unsigned int col = level_start + level_rows;
+        Eigen::Block<MatrixNd> J_k = CS.J.middleRows (
+            CS.constraint_row_index[k], rows);
+
+        if (l == 0) {
+          CS.J_priority.middleCols (col, rows) = J_k.transpose();
+        } else {
+          CS.J_priority.block (0, col, null_space_dim, rows).noalias() =
+            CS.Z.leftCols (null_space_dim).transpose() * J_k.transpose();
+        }
+
+        CS.e_priority.segment (col, rows) = CS.e.segment (
+            CS.constraint_row_index[k], rows);
+        if (l > 0) {
+          CS.e_priority.segment (col, rows).noalias() -= J_k * CS.delta_q;
+        }
+        level_rows += rows;
+      }
+
+      Eigen::Block<MatrixNd> JZ_t = CS.J_priority.block (0, level_start,
+          null_space_dim, level_rows);
+      Eigen::VectorBlock<VectorNd> e_level = CS.e_priority.segment (
+          level_start, level_rows);
+      Eigen::VectorBlock<VectorNd> u = CS.level_step.head (null_space_dim);
+      level_start += level_rows;
+
+      // the damping grows with the residual so that unreachable targets
+      // do not cause large steps close to singularities. A level that
+      // takes all remaining directions usually conflicts with the higher
+      // levels: its Gauss-Newton model misses the curvature of their null
+      // space, which is proportional to the residual.
+      double mu_level = mu + (level_rows < null_space_dim
+          ? 0.5 * e_level.squaredNorm()
+          : IKConflictingLevelDamping * e_level.norm());
+
+      if (level_rows >= null_space_dim) {
+        // the level takes all remaining directions:
+        // u = ((J Z)^T J Z + mu I)^-1 (J Z)^T e
+        u.noalias() = JZ_t * e_level;
+        Eigen::Ref<MatrixNd> A_level = CS.A.topLeftCorner (null_space_dim,
+            null_space_dim);
+        A_level.noalias() = JZ_t * JZ_t.transpose();
+        A_level.diagonal().array() += mu_level;
+        Eigen::LLT<Eigen::Ref<MatrixNd> > llt (A_level);
+
+        llt.solveInPlace (u);
+      } else {
+        // u = (J Z)^T (J Z (J Z)^T + mu I)^-1 e
+        Eigen::Ref<MatrixNd> A_level = CS.A.topLeftCorner (level_rows,
+            level_rows);
+        A_level.noalias() = JZ_t.transpose() * JZ_t;
+        A_level.diagonal().array() += mu_level;
+        Eigen::LLT<Eigen::Ref<MatrixNd> > llt (A_level);
+
+        llt.solveInPlace (e_level);
+        u.noalias() = JZ_t * e_level;
+      }
+
+      // limits the step of unreachable or nearly singular levels
+      double u_norm = u.norm();
+      CS.priority_step_norms[l] = u_norm;
+      if (u_norm > CS.max_level_step_norm) {
+        u *= CS.max_level_step_norm / u_norm;
+      }
+
+      if (l == 0) {
+        CS.delta_q = u;
+      } else {
+        CS.delta_q.noalias() += CS.Z.leftCols (null_space_dim) * u;
+      }
+
+      if (level_rows >= null_space_dim || l + 1 == level_count) {
+        break;
+      }
+
+      // Householder QR decomposition (J Z)^T = Q R in place, the last
+      // columns of Z Q span the null space of the level within the null
+      // space of the higher levels
+      if (l == 0) {
+        CS.Z.setIdentity();
+      }
+      for (unsigned int i = 0; i < level_rows; i++) {
+        Eigen::Ref<VectorNd> v = JZ_t.col(i).tail (null_space_dim - i);
+        double tau, beta;
+        v.makeHouseholderInPlace (tau, beta);
+
+        JZ_t.block (i, i + 1, null_space_dim - i, level_rows - i - 1)
+          .applyHouseholderOnTheLeft (v.tail (null_space_dim - i - 1), tau,
+              CS.householder_workspace.data());
+        CS.Z.middleCols (i, null_space_dim - i).applyHouseholderOnTheRight (
+            v.tail (null_space_dim - i - 1), tau,
+            CS.householder_workspace.data());
+      }
+
+      for (unsigned int i = 0; i < null_space_dim - level_rows; i++) {
+        CS.Z.col(i) = CS.Z.col(level_rows + i);
+      }
+      null_space_dim -= level_rows;
+    }
+
+    ProjectIKStepOnJointLimits (model, Qres, CS, CS.delta_q);
+
+    CS.step_norm = CS.delta_q.norm();
+    LOG << "change = " << CS.delta_q.transpose() << std::endl;
+
+    if (CS.step_norm < CS.step_tol) {
+      LOG << "reached convergence after " << CS.num_steps << " steps" << std::endl;
+      return FinishIKPriorityLevels (CS, true);
+    }
+
+    IntegrateIKStep (model, Qres, CS.delta_q, CS.q_trial);
+    Qres = CS.q_trial;
+  }
 }
+#endif
 
 }
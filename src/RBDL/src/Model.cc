@@ -59,7 +59,7 @@ Model::Model() {
 
   // Dynamic variables
   c.push_back(zero_spatial);
-  IA.push_back(SpatialMatrix::Identity());
+  IA.push_back(SpatialArticulatedBodyInertia(SpatialMatrix::Identity()));
   pA.push_back(zero_spatial);
   U.push_back(zero_spatial);
 
@@ -386,13 +386,31 @@ unsigned int Model::AddBody(
 
   qdot_size = qdot_size + joint.mDoFCount;
 
+  // angles whose sine and cosine are computed in one batch by jcalc_sincos()
+  unsigned int q_index = mJoints[mJoints.size() - 1].q_index;
+  if (joint.mJointType == JointTypeRevolute
+      || joint.mJointType == JointTypeRevoluteX
+      || joint.mJointType == JointTypeRevoluteY
+      || joint.mJointType == JointTypeRevoluteZ) {
+    sincos_q_index.push_back (q_index);
+  } else if (joint.mJointType == JointTypeEulerZYX
+      || joint.mJointType == JointTypeEulerXYZ
+      || joint.mJointType == JointTypeEulerYXZ
+      || joint.mJointType == JointTypeEulerZXY) {
+    sincos_q_index.push_back (q_index);
+    sincos_q_index.push_back (q_index + 1);
+    sincos_q_index.push_back (q_index + 2);
+  }
+  sin_q = VectorNd::Zero (q_size);
+  cos_q = VectorNd::Ones (q_size);
+
   // we have to invert the transformation as it is later always used from the
   // child bodies perspective.
   X_T.push_back(joint_frame * movable_parent_transform);
 
   // Dynamic variables
   c.push_back(SpatialVector(0., 0., 0., 0., 0., 0.));
-  IA.push_back(SpatialMatrix::Zero(6,6));
+  IA.push_back(SpatialArticulatedBodyInertia());
   pA.push_back(SpatialVector(0., 0., 0., 0., 0., 0.));
   U.push_back(SpatialVector(0., 0., 0., 0., 0., 0.));
 
@@ -0,0 +1,123 @@
+/*
+ * RBDL - Rigid Body Dynamics Library
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <algorithm>
+#include <cassert>
+
+#include "rbdl/Model.h"
+#include "rbdl/SubtreePartition.h"
+
+namespace RigidBodyDynamics {
+
+SubtreePartition::SubtreePartition () :
+  body_count (0)
+{}
+
+SubtreePartition::SubtreePartition (const Model &model,
+    unsigned int num_subtrees) :
+  body_count (0) {
+  Init (model, num_subtrees);
+}
+
+namespace {
+
+struct LargerSubtree {
+  explicit LargerSubtree (const std::vector<unsigned int> &size) :
+    subtree_size (size)
+  {}
+
+  bool operator() (unsigned int a, unsigned int b) const {
+    if (subtree_size[a] != subtree_size[b]) {
+      return subtree_size[a] > subtree_size[b];
+    }
+    return a < b;
+  }
+
+  const std::vector<unsigned int> &subtree_size;
+};
+
+}
+
+void SubtreePartition::Init (const Model &model, unsigned int num_subtrees) {
+  body_count = model.mBodies.size();
+
+  top_bodies.clear();
+  joint_bodies.clear();
+  roots.clear();
+  subtree_bodies.clear();
+  is_subtree_root.assign (body_count, false);
+
+  // children always have larger ids than their parents
+  std::vector<unsigned int> subtree_size (body_count, 1);
+  for (unsigned int i = body_count - 1; i > 0; i--) {
+    subtree_size[model.lambda[i]] += subtree_size[i];
+  }
+
+  unsigned int max_size = body_count - 1;
+  if (num_subtrees > 1) {
+    max_size = (body_count - 1 + num_subtrees - 1) / num_subtrees;
+  }
+  max_size = std::max (max_size, 1u);
+
+  std::vector<unsigned int> stack (model.mu[0].begin(), model.mu[0].end());
+  while (!stack.empty()) {
+    unsigned int i = stack.back();
+    stack.pop_back();
+
+    // splitting only helps at branch points, so follow serial chains
+    unsigned int branch = i;
+    while (model.mu[branch].size() == 1) {
+      branch = model.mu[branch][0];
+    }
+
+    if (subtree_size[i] <= max_size || model.mu[branch].empty()) {
+      roots.push_back (i);
+      is_subtree_root[i] = true;
+    } else {
+      for (unsigned int j = branch; j != i; j = model.lambda[j]) {
+        top_bodies.push_back (j);
+      }
+      top_bodies.push_back (i);
+      stack.insert (stack.end(), model.mu[branch].begin(),
+          model.mu[branch].end());
+    }
+  }
+
+  std::sort (top_bodies.begin(), top_bodies.end());
+  std::sort (roots.begin(), roots.end(), LargerSubtree (subtree_size));
+
+  joint_bodies = top_bodies;
+  joint_bodies.insert (joint_bodies.end(), roots.begin(), roots.end());
+  std::sort (joint_bodies.begin(), joint_bodies.end());
+
+  // subtree index of every body that is part of a subtree
+  std::vector<int> subtree_index (body_count, -1);
+  for (unsigned int k = 0; k < roots.size(); k++) {
+    subtree_index[roots[k]] = k;
+  }
+
+  subtree_bodies.resize (roots.size());
+  for (unsigned int i = 1; i < body_count; i++) {
+    if (subtree_index[i] < 0 && subtree_index[model.lambda[i]] >= 0) {
+      subtree_index[i] = subtree_index[model.lambda[i]];
+    }
+
+    if (subtree_index[i] >= 0) {
+      subtree_bodies[subtree_index[i]].push_back (i);
+    }
+  }
+
+#ifndef NDEBUG
+  unsigned int partitioned_count = top_bodies.size();
+  for (unsigned int k = 0; k < subtree_bodies.size(); k++) {
+    partitioned_count += subtree_bodies[k].size();
+  }
+  assert (partitioned_count == body_count - 1);
+#endif
+}
+
+}
@@ -0,0 +1,174 @@
+/*
+ * RBDL - Rigid Body Dynamics Library
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <algorithm>
+#include <cassert>
+
+#include "rbdl/ThreadPool.h"
+
+namespace RigidBodyDynamics {
+
+ThreadPool::ThreadPool (unsigned int num_threads) :
+  mQueued (0),
+  mPending (0),
+  mNextQueue (0),
+  mStop (false) {
+  if (num_threads == 0) {
+    num_threads = std::max (1u, std::thread::hardware_concurrency());
+  }
+
+  for (unsigned int i = 0; i < num_threads; i++) {
+    mQueues.push_back (std::unique_ptr<TaskQueue> (new TaskQueue));
+  }
+
+  // thread id 0 is the thread that calls Wait()
+  for (unsigned int i = 1; i < num_threads; i++) {
+    mThreads.push_back (std::thread (&ThreadPool::WorkerLoop, this, i));
+  }
+}
+
+ThreadPool::~ThreadPool () {
+  Wait();
+
+  {
+    std::lock_guard<std::mutex> lock (mMutex);
+    mStop = true;
+  }
+  mWorkAvailable.notify_all();
+
+  for (unsigned int i = 0; i < mThreads.size(); i++) {
+    mThreads[i].join();
+  }
+}
+
+void ThreadPool::Submit (const Task &task) {
+  TaskQueue &queue = *mQueues[mNextQueue];
+  mNextQueue = (mNextQueue + 1) % mQueues.size();
+
+  mPending++;
+  {
+    std::lock_guard<std::mutex> lock (queue.mutex);
+    queue.tasks.push_back (task);
+    mQueued++;
+  }
+
+  // Taking the lock ensures that a worker that just checked for work is
+  // already waiting and receives the notification.
+  {
+    std::lock_guard<std::mutex> lock (mMutex);
+  }
+  mWorkAvailable.notify_one();
+}
+
+bool ThreadPool::PopTask (unsigned int thread_id, Task &task) {
+  // own queue first (most recently submitted task) ...
+  {
+    TaskQueue &queue = *mQueues[thread_id];
+    std::lock_guard<std::mutex> lock (queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = queue.tasks.back();
+      queue.tasks.pop_back();
+      mQueued--;
+      return true;
+    }
+  }
+
+  // ... then steal the oldest task of another participant
+  for (unsigned int i = 1; i < mQueues.size(); i++) {
+    TaskQueue &queue = *mQueues[(thread_id + i) % mQueues.size()];
+    std::lock_guard<std::mutex> lock (queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = queue.tasks.front();
+      queue.tasks.pop_front();
+      mQueued--;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ThreadPool::RunTask (const Task &task, unsigned int thread_id) {
+  task (thread_id);
+
+  if (--mPending == 0) {
+    {
+      std::lock_guard<std::mutex> lock (mMutex);
+    }
+    mWorkDone.notify_all();
+  }
+}
+
+void ThreadPool::WorkerLoop (unsigned int thread_id) {
+  Task task;
+
+  while (true) {
+    if (PopTask (thread_id, task)) {
+      RunTask (task, thread_id);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock (mMutex);
+    mWorkAvailable.wait (lock, [this] {
+        return mStop || mQueued > 0;
+        });
+
+    if (mStop && mQueued == 0) {
+      return;
+    }
+  }
+}
+
+void ThreadPool::Wait () {
+  Task task;
+
+  while (mPending > 0) {
+    if (PopTask (0, task)) {
+      RunTask (task, 0);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock (mMutex);
+    mWorkDone.wait (lock, [this] {
+        return mPending == 0 || mQueued > 0;
+        });
+  }
+}
+
+void ThreadPool::ParallelFor (
+    unsigned int begin,
+    unsigned int end,
+    const RangeTask &func,
+    unsigned int grain_size) {
+  assert (grain_size > 0);
+
+  if (end <= begin) {
+    return;
+  }
+
+  // run small ranges directly
+  if (mQueues.size() == 1 || end - begin <= grain_size) {
+    for (unsigned int i = begin; i < end; i++) {
+      func (i, 0);
+    }
+    return;
+  }
+
+  for (unsigned int chunk_begin = begin; chunk_begin < end;
+      chunk_begin += grain_size) {
+    unsigned int chunk_end = std::min (end, chunk_begin + grain_size);
+    Submit ([&func, chunk_begin, chunk_end] (unsigned int thread_id) {
+        for (unsigned int i = chunk_begin; i < chunk_end; i++) {
+          func (i, thread_id);
+        }
+      });
+  }
+
+  Wait();
+}
+
+}
@@ -14,6 +14,14 @@
 #include <rbdl/rbdl_mathutils.h>
 #include <rbdl/Model.h>
 
+#ifdef RBDL_USE_SIMD_SINCOS
+#if defined (__AVX__)
+#include <immintrin.h>
+#elif defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+#endif
+
 #include "rbdl/Logging.h"
 
 namespace RigidBodyDynamics {
@@ -315,5 +323,195 @@ RBDL_DLLAPI void SparseSolveLTx (Model &model, Math::MatrixNd &L, Math::VectorNd
   }
 }
 
+#ifdef RBDL_USE_SIMD_SINCOS
+// Range reduction by multiples of pi/2 (Cody-Waite with pi/2 split into
+// three parts) followed by the minimax polynomials of the Cephes library on
+// [-pi/4, pi/4].
+static const double SinCosMaxArgument = 1.0e6;
+static const double TwoOverPi = 6.36619772367581343076e-1;
+static const double PiOver2_1 = 1.57079625129699707031e0;
+static const double PiOver2_2 = 7.54978941586159635336e-8;
+static const double PiOver2_3 = 5.39030285815811905290e-15;
+static const double RoundMagic = 6755399441055744.0; // 1.5 * 2^52
+
+static const double SinCoef[6] = {
+   1.58962301576546568060e-10,
+  -2.50507477628578072866e-8,
+   2.75573136213857245213e-6,
+  -1.98412698295895385996e-4,
+   8.33333333332211858878e-3,
+  -1.66666666666666307295e-1
+};
+
+static const double CosCoef[6] = {
+  -1.13585365213876817300e-11,
+   2.08757008419747316778e-9,
+  -2.75573141792967388112e-7,
+   2.48015872888517045348e-5,
+  -1.38888888888730564116e-3,
+   4.16666666666665929218e-2
+};
+
+static inline void SinCosScalar (double x, double *s, double *c) {
+  if (!(std::fabs (x) <= SinCosMaxArgument)) {
+    *s = std::sin (x);
+    *c = std::cos (x);
+    return;
+  }
+
+  double k = (x * TwoOverPi + RoundMagic) - RoundMagic;
+  double r = ((x - k * PiOver2_1) - k * PiOver2_2) - k * PiOver2_3;
+  double z = r * r;
+
+  double sin_poly = SinCoef[0];
+  double cos_poly = CosCoef[0];
+  for (unsigned int i = 1; i < 6; i++) {
+    sin_poly = sin_poly * z + SinCoef[i];
+    cos_poly = cos_poly * z + CosCoef[i];
+  }
+  double sin_r = r + r * z * sin_poly;
+  double cos_r = (1. - 0.5 * z) + z * z * cos_poly;
+
+  switch (static_cast<long long>(k) & 3) {
+    case 0: *s = sin_r; *c = cos_r; break;
+    case 1: *s = cos_r; *c = -sin_r; break;
+    case 2: *s = -sin_r; *c = -cos_r; break;
+    default: *s = -cos_r; *c = sin_r; break;
+  }
+}
+#endif
+
+RBDL_DLLAPI void SinCos (unsigned int n, const double *x, double *s,
+    double *c) {
+  unsigned int i = 0;
+
+#ifdef RBDL_USE_SIMD_SINCOS
+#if defined (__AVX__)
+  const __m256d max_argument = _mm256_set1_pd (SinCosMaxArgument);
+  const __m256d sign_mask = _mm256_set1_pd (-0.);
+  const __m256d one = _mm256_set1_pd (1.);
+  const __m256d two = _mm256_set1_pd (2.);
+
+  for (; i + 4 <= n; i += 4) {
+    __m256d xv = _mm256_loadu_pd (x + i);
+    __m256d in_range = _mm256_cmp_pd (_mm256_andnot_pd (sign_mask, xv),
+        max_argument, _CMP_LE_OQ);
+    if (_mm256_movemask_pd (in_range) != 0xf) {
+      for (unsigned int j = i; j < i + 4; j++) {
+        SinCosScalar (x[j], &s[j], &c[j]);
+      }
+      continue;
+    }
+
+    __m256d k = _mm256_sub_pd (_mm256_add_pd (
+          _mm256_mul_pd (xv, _mm256_set1_pd (TwoOverPi)),
+          _mm256_set1_pd (RoundMagic)), _mm256_set1_pd (RoundMagic));
+    __m256d r = _mm256_sub_pd (xv,
+        _mm256_mul_pd (k, _mm256_set1_pd (PiOver2_1)));
+    r = _mm256_sub_pd (r, _mm256_mul_pd (k, _mm256_set1_pd (PiOver2_2)));
+    r = _mm256_sub_pd (r, _mm256_mul_pd (k, _mm256_set1_pd (PiOver2_3)));
+    __m256d z = _mm256_mul_pd (r, r);
+
+    __m256d sin_poly = _mm256_set1_pd (SinCoef[0]);
+    __m256d cos_poly = _mm256_set1_pd (CosCoef[0]);
+    for (unsigned int j = 1; j < 6; j++) {
+      sin_poly = _mm256_add_pd (_mm256_mul_pd (sin_poly, z),
+          _mm256_set1_pd (SinCoef[j]));
+      cos_poly = _mm256_add_pd (_mm256_mul_pd (cos_poly, z),
+          _mm256_set1_pd (CosCoef[j]));
+    }
+    __m256d sin_r = _mm256_add_pd (r,
+        _mm256_mul_pd (_mm256_mul_pd (r, z), sin_poly));
+    __m256d cos_r = _mm256_add_pd (
+        _mm256_sub_pd (one, _mm256_mul_pd (_mm256_set1_pd (0.5), z)),
+        _mm256_mul_pd (_mm256_mul_pd (z, z), cos_poly));
+
+    // quadrant k mod 4 and whether it is odd
+    __m256d quadrant = _mm256_sub_pd (k, _mm256_mul_pd (_mm256_set1_pd (4.),
+          _mm256_floor_pd (_mm256_mul_pd (k, _mm256_set1_pd (0.25)))));
+    __m256d odd = _mm256_cmp_pd (_mm256_sub_pd (k, _mm256_mul_pd (two,
+            _mm256_floor_pd (_mm256_mul_pd (k, _mm256_set1_pd (0.5))))),
+        one, _CMP_EQ_OQ);
+    __m256d sin_sign = _mm256_and_pd (sign_mask,
+        _mm256_cmp_pd (quadrant, two, _CMP_GE_OQ));
+    __m256d cos_sign = _mm256_and_pd (sign_mask, _mm256_cmp_pd (
+          _mm256_andnot_pd (sign_mask,
+            _mm256_sub_pd (quadrant, _mm256_set1_pd (1.5))),
+          one, _CMP_LT_OQ));
+
+    _mm256_storeu_pd (s + i, _mm256_xor_pd (
+          _mm256_blendv_pd (sin_r, cos_r, odd), sin_sign));
+    _mm256_storeu_pd (c + i, _mm256_xor_pd (
+          _mm256_blendv_pd (cos_r, sin_r, odd), cos_sign));
+  }
+#elif defined (__SSE2__)
+  const __m128d max_argument = _mm_set1_pd (SinCosMaxArgument);
+  const __m128d sign_mask = _mm_set1_pd (-0.);
+  const __m128i sign_bit = _mm_castpd_si128 (sign_mask);
+  const __m128i one = _mm_set_epi32 (0, 1, 0, 1);
+
+  for (; i + 2 <= n; i += 2) {
+    __m128d xv = _mm_loadu_pd (x + i);
+    __m128d in_range = _mm_cmple_pd (_mm_andnot_pd (sign_mask, xv),
+        max_argument);
+    if (_mm_movemask_pd (in_range) != 0x3) {
+      SinCosScalar (x[i], &s[i], &c[i]);
+      SinCosScalar (x[i + 1], &s[i + 1], &c[i + 1]);
+      continue;
+    }
+
+    // the low bits of the mantissa of k_magic contain k
+    __m128d k_magic = _mm_add_pd (_mm_mul_pd (xv, _mm_set1_pd (TwoOverPi)),
+        _mm_set1_pd (RoundMagic));
+    __m128d k = _mm_sub_pd (k_magic, _mm_set1_pd (RoundMagic));
+    __m128d r = _mm_sub_pd (xv, _mm_mul_pd (k, _mm_set1_pd (PiOver2_1)));
+    r = _mm_sub_pd (r, _mm_mul_pd (k, _mm_set1_pd (PiOver2_2)));
+    r = _mm_sub_pd (r, _mm_mul_pd (k, _mm_set1_pd (PiOver2_3)));
+    __m128d z = _mm_mul_pd (r, r);
+
+    __m128d sin_poly = _mm_set1_pd (SinCoef[0]);
+    __m128d cos_poly = _mm_set1_pd (CosCoef[0]);
+    for (unsigned int j = 1; j < 6; j++) {
+      sin_poly = _mm_add_pd (_mm_mul_pd (sin_poly, z),
+          _mm_set1_pd (SinCoef[j]));
+      cos_poly = _mm_add_pd (_mm_mul_pd (cos_poly, z),
+          _mm_set1_pd (CosCoef[j]));
+    }
+    __m128d sin_r = _mm_add_pd (r, _mm_mul_pd (_mm_mul_pd (r, z), sin_poly));
+    __m128d cos_r = _mm_add_pd (
+        _mm_sub_pd (_mm_set1_pd (1.), _mm_mul_pd (_mm_set1_pd (0.5), z)),
+        _mm_mul_pd (_mm_mul_pd (z, z), cos_poly));
+
+    // bit 0 of k swaps sine and cosine, bit 1 of k (k + 1) negates the
+    // sine (cosine)
+    __m128i k_bits = _mm_castpd_si128 (k_magic);
+    __m128i odd = _mm_srai_epi32 (_mm_slli_epi64 (k_bits, 63), 31);
+    __m128d swap = _mm_castsi128_pd (
+        _mm_shuffle_epi32 (odd, _MM_SHUFFLE (3, 3, 1, 1)));
+    __m128d sin_sign = _mm_castsi128_pd (
+        _mm_and_si128 (_mm_slli_epi64 (k_bits, 62), sign_bit));
+    __m128d cos_sign = _mm_castsi128_pd (_mm_and_si128 (
+          _mm_slli_epi64 (_mm_add_epi64 (k_bits, one), 62), sign_bit));
+
+    __m128d sin_result = _mm_or_pd (_mm_and_pd (swap, cos_r),
+        _mm_andnot_pd (swap, sin_r));
+    __m128d cos_result = _mm_or_pd (_mm_and_pd (swap, sin_r),
+        _mm_andnot_pd (swap, cos_r));
+
+    _mm_storeu_pd (s + i, _mm_xor_pd (sin_result, sin_sign));
+    _mm_storeu_pd (c + i, _mm_xor_pd (cos_result, cos_sign));
+  }
+#endif
+
+  for (; i < n; i++) {
+    SinCosScalar (x[i], &s[i], &c[i]);
+  }
+#else
+  for (; i < n; i++) {
+    sincos (x[i], &s[i], &c[i]);
+  }
+#endif
+}
+
 } /* Math */
 } /* RigidBodyDynamics */
@@ -722,3 +722,18 @@ TEST_FIXTURE (Human36, ForwardDynamicsContactsImpulses) {
   CHECK_ARRAY_CLOSE (Vector3d(0., 0., 0.).data(), heel_left_velocity.data(), 3, TEST_PREC);
   CHECK_ARRAY_CLOSE (Vector3d(0., 0., 0.).data(), heel_right_velocity.data(), 3, TEST_PREC);
 }
+
+TEST ( TestConstraintSetBindMoreConstraintsThanDoFs ) {
+  Model model;
+  unsigned int body_id = model.AddBody (0, Xtrans (Vector3d (0., 0., 0.)),
+      Joint (SpatialVector (0., 0., 1., 0., 0., 0.)),
+      Body (1., Vector3d (1., 0., 0.), Vector3d (1., 1., 1.)));
+
+  ConstraintSet constraint_set;
+  constraint_set.AddContactConstraint (body_id, Vector3d (1., 0., 0.), Vector3d (1., 0., 0.));
+  constraint_set.AddContactConstraint (body_id, Vector3d (1., 0., 0.), Vector3d (0., 1., 0.));
+
+  CHECK (constraint_set.Bind (model));
+  CHECK_EQUAL (2u, constraint_set.size());
+  CHECK_EQUAL (0, constraint_set.Z.cols());
+}
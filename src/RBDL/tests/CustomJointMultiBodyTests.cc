@@ -923,6 +923,63 @@ TEST_FIXTURE (CustomJointMultiBodyFixture, CalcMInvTimestau) {
 
 }
 
+TEST_FIXTURE (CustomJointMultiBodyFixture, CalcMInv) {
+
+  for(int idx =0; idx < NUMBER_OF_MODELS; ++idx){
+    unsigned int dof = reference_model.at(idx).dof_count;
+    for (unsigned int i = 0; i < dof; i++) {
+      q.at(idx)[i]    = (i+0.1) * 9.133758561390194e-01;
+    }
+
+    //reference
+    MatrixNd minv_ref = MatrixNd::Zero(dof, dof);
+    CalcMInv(reference_model.at(idx), q.at(idx), minv_ref, true);
+
+    //custom
+    MatrixNd minv_cus = MatrixNd::Zero(dof, dof);
+    CalcMInv(custom_model.at(idx), q.at(idx), minv_cus, true);
+
+    //check.
+    CHECK_ARRAY_CLOSE(minv_ref.data(),
+                      minv_cus.data(),
+                      dof * dof,
+                      TEST_PREC);
+  }
+
+}
+
+TEST_FIXTURE (CustomJointMultiBodyFixture, HybridDynamics) {
+
+  for(int idx =0; idx < NUMBER_OF_MODELS; ++idx){
+    unsigned int dof = reference_model.at(idx).dof_count;
+    vector<bool> prescribed (dof, false);
+    for (unsigned int i = 0; i < dof; i++) {
+      q.at(idx)[i]     = (i+0.1) * 9.133758561390194e-01;
+      qdot.at(idx)[i]  = (i+0.1) * 6.323592462254095e-01;
+      qddot.at(idx)[i] = (i+0.1) * 2.785084389030448e-01;
+      tau.at(idx)[i]   = (i+0.1) * 9.754040499940952e-02;
+      prescribed[i]    = (i % 2 == 0);
+    }
+
+    //reference
+    VectorNd qddot_ref = qddot.at(idx);
+    VectorNd tau_ref   = tau.at(idx);
+    HybridDynamics(reference_model.at(idx), q.at(idx), qdot.at(idx),
+                   prescribed, qddot_ref, tau_ref);
+
+    //custom
+    VectorNd qddot_cus = qddot.at(idx);
+    VectorNd tau_cus   = tau.at(idx);
+    HybridDynamics(custom_model.at(idx), q.at(idx), qdot.at(idx),
+                   prescribed, qddot_cus, tau_cus);
+
+    //check.
+    CHECK_ARRAY_CLOSE(qddot_ref.data(), qddot_cus.data(), dof, TEST_PREC);
+    CHECK_ARRAY_CLOSE(tau_ref.data(), tau_cus.data(), dof, TEST_PREC);
+  }
+
+}
+
 TEST_FIXTURE (CustomJointMultiBodyFixture, ForwardDynamicsContactsKokkevis){
 
   for(int idx =0; idx < NUMBER_OF_MODELS; ++idx){
@@ -11,6 +11,8 @@
 #include "rbdl/Constraints.h"
 
 #include "Fixtures.h"
+#include "Human36Fixture.h"
+#include "Rok3Fixture.h"
 
 using namespace std;
 using namespace RigidBodyDynamics;
@@ -733,3 +735,273 @@ TEST_FIXTURE ( FixedBase3DoF, SolveMInvTimesNonZeroQDotKinematicsUpdate) {
 
   CHECK_ARRAY_CLOSE (qddot_solve_llt.data(), qddot_minv.data(), model->dof_count, TEST_PREC);
 }
+
+TEST_FIXTURE ( FixedBase3DoF, CalcMInvMatchesInverse ) {
+  for (unsigned int i = 0; i < model->dof_count; i++) {
+    Q[i] = rand() / static_cast<double>(RAND_MAX);
+  }
+
+  MatrixNd M (MatrixNd::Zero(model->dof_count, model->dof_count));
+  CompositeRigidBodyAlgorithm (*model, Q, M);
+  MatrixNd Minv_llt = M.llt().solve (
+      MatrixNd::Identity (model->dof_count, model->dof_count));
+
+  MatrixNd Minv (MatrixNd::Zero(model->dof_count, model->dof_count));
+  CalcMInv (*model, Q, Minv);
+
+  CHECK_ARRAY_CLOSE (Minv_llt.data(), Minv.data(), Minv.size(), TEST_PREC);
+}
+
+TEST_FIXTURE ( Human36, CalcMInvHuman36 ) {
+  for (unsigned int i = 0; i < q.size(); i++) {
+    q[i] = 0.4 * sin (1.1 * i + 0.2);
+  }
+
+  Model *models[] = { model_emulated, model_3dof };
+  for (unsigned int m = 0; m < 2; m++) {
+    Model &human = *models[m];
+
+    MatrixNd M (MatrixNd::Zero (human.dof_count, human.dof_count));
+    CompositeRigidBodyAlgorithm (human, q, M);
+    MatrixNd Minv_llt = M.llt().solve (
+        MatrixNd::Identity (human.dof_count, human.dof_count));
+
+    // the massless bodies of the emulated joints yield large entries
+    double prec = 1.0e-12 * Minv_llt.cwiseAbs().maxCoeff();
+
+    MatrixNd Minv (MatrixNd::Zero (human.dof_count, human.dof_count));
+    CalcMInv (human, q, Minv);
+    CHECK_ARRAY_CLOSE (Minv_llt.data(), Minv.data(), Minv.size(), prec);
+
+    // reuses the articulated body inertias of the previous call
+    Minv.setZero();
+    CalcMInv (human, q, Minv, false);
+    CHECK_ARRAY_CLOSE (Minv_llt.data(), Minv.data(), Minv.size(), prec);
+  }
+}
+
+TEST_FIXTURE ( Rok3, CalcMInvSelectedBlocksRok3 ) {
+  for (unsigned int i = 0; i < model->dof_count; i++) {
+    q[i] = 0.2 * sin (0.8 * i + 0.1);
+  }
+  Quaternion base_quat (0.05, -0.1, 0.2, 0.95);
+  base_quat /= base_quat.norm();
+  model->SetQuaternion (base_id, base_quat, q);
+
+  MatrixNd M (MatrixNd::Zero (model->dof_count, model->dof_count));
+  CompositeRigidBodyAlgorithm (*model, q, M);
+  MatrixNd Minv_llt = M.llt().solve (
+      MatrixNd::Identity (model->dof_count, model->dof_count));
+
+  MatrixNd Minv (MatrixNd::Zero (model->dof_count, model->dof_count));
+  CalcMInv (*model, q, Minv);
+  CHECK_ARRAY_CLOSE (Minv_llt.data(), Minv.data(), Minv.size(), 1.0e-10);
+
+  // the floating base and the ankle roll joint of the left foot
+  unsigned int ankle_roll_id = model->mFixedBodies[foot_id[0]
+    - model->fixed_body_discriminator].mMovableParent;
+  vector<unsigned int> body_ids;
+  body_ids.push_back (base_id);
+  body_ids.push_back (ankle_roll_id);
+
+  MatrixNd Minv_blocks (MatrixNd::Zero (model->dof_count, model->dof_count));
+  CalcMInv (*model, q, Minv_blocks, true, &body_ids);
+
+  for (unsigned int a = 0; a < body_ids.size(); a++) {
+    const Joint &joint_a = model->mJoints[body_ids[a]];
+    for (unsigned int b = 0; b < body_ids.size(); b++) {
+      const Joint &joint_b = model->mJoints[body_ids[b]];
+
+      for (unsigned int j = 0; j < joint_a.mDoFCount; j++) {
+        for (unsigned int k = 0; k < joint_b.mDoFCount; k++) {
+          CHECK_CLOSE (Minv_llt(joint_a.q_index + j, joint_b.q_index + k),
+              Minv_blocks(joint_a.q_index + j, joint_b.q_index + k),
+              1.0e-10);
+        }
+      }
+    }
+  }
+}
+
+TEST_FIXTURE ( Human36, HybridDynamicsNothingPrescribed ) {
+  for (unsigned int i = 0; i < q.size(); i++) {
+    q[i] = 0.3 * sin (1.3 * i);
+    qdot[i] = 0.2 * cos (0.7 * i);
+    tau[i] = 0.5 * sin (0.4 * i + 1.);
+  }
+
+  Model *models[] = { model_emulated, model_3dof };
+  for (unsigned int m = 0; m < 2; m++) {
+    Model &human = *models[m];
+
+    VectorNd qddot_ref = VectorNd::Zero (human.qdot_size);
+    ForwardDynamics (human, q, qdot, tau, qddot_ref);
+
+    vector<bool> prescribed (human.qdot_size, false);
+    VectorNd qddot_hybrid = VectorNd::Zero (human.qdot_size);
+    VectorNd tau_hybrid = tau;
+    HybridDynamics (human, q, qdot, prescribed, qddot_hybrid, tau_hybrid);
+
+    CHECK_ARRAY_EQUAL (qddot_ref.data(), qddot_hybrid.data(),
+        qddot_ref.size());
+    CHECK_ARRAY_EQUAL (tau.data(), tau_hybrid.data(), tau.size());
+  }
+}
+
+TEST_FIXTURE ( Human36, HybridDynamicsAllPrescribed ) {
+  for (unsigned int i = 0; i < q.size(); i++) {
+    q[i] = 0.3 * sin (1.3 * i);
+    qdot[i] = 0.2 * cos (0.7 * i);
+    qddot[i] = 0.4 * sin (0.9 * i + 0.5);
+  }
+
+  Model *models[] = { model_emulated, model_3dof };
+  for (unsigned int m = 0; m < 2; m++) {
+    Model &human = *models[m];
+
+    VectorNd tau_ref = VectorNd::Zero (human.qdot_size);
+    InverseDynamics (human, q, qdot, qddot, tau_ref);
+
+    vector<bool> prescribed (human.qdot_size, true);
+    VectorNd qddot_hybrid = qddot;
+    VectorNd tau_hybrid = VectorNd::Zero (human.qdot_size);
+    HybridDynamics (human, q, qdot, prescribed, qddot_hybrid, tau_hybrid);
+
+    CHECK_ARRAY_EQUAL (qddot.data(), qddot_hybrid.data(), qddot.size());
+    CHECK_ARRAY_CLOSE (tau_ref.data(), tau_hybrid.data(), tau_ref.size(),
+        1.0e-10);
+  }
+}
+
+TEST_FIXTURE ( Human36, HybridDynamicsMixed ) {
+  for (unsigned int i = 0; i < q.size(); i++) {
+    q[i] = 0.3 * sin (1.3 * i);
+    qdot[i] = 0.2 * cos (0.7 * i);
+    qddot[i] = 0.4 * sin (0.9 * i + 0.5);
+    tau[i] = 0.5 * sin (0.4 * i + 1.);
+  }
+
+  Model *models[] = { model_emulated, model_3dof };
+  for (unsigned int m = 0; m < 2; m++) {
+    Model &human = *models[m];
+
+    // also splits the 3-dof joints of model_3dof
+    vector<bool> prescribed (human.qdot_size, false);
+    for (unsigned int i = 0; i < human.qdot_size; i += 3) {
+      prescribed[i] = true;
+    }
+
+    vector<SpatialVector> f_ext (human.mBodies.size(), SpatialVector::Zero());
+    f_ext[3] = SpatialVector (0.2, -0.1, 0.3, 5., -2., 10.);
+
+    VectorNd qddot_hybrid = qddot;
+    VectorNd tau_hybrid = tau;
+    HybridDynamics (human, q, qdot, prescribed, qddot_hybrid, tau_hybrid,
+        &f_ext);
+
+    for (unsigned int i = 0; i < human.qdot_size; i++) {
+      if (prescribed[i]) {
+        CHECK_EQUAL (qddot[i], qddot_hybrid[i]);
+      } else {
+        CHECK_EQUAL (tau[i], tau_hybrid[i]);
+      }
+    }
+
+    // the completed accelerations and torques have to be consistent
+    VectorNd qddot_fd = VectorNd::Zero (human.qdot_size);
+    ForwardDynamics (human, q, qdot, tau_hybrid, qddot_fd, &f_ext);
+    CHECK_ARRAY_CLOSE (qddot_hybrid.data(), qddot_fd.data(), qddot_fd.size(),
+        1.0e-9);
+
+    VectorNd tau_id = VectorNd::Zero (human.qdot_size);
+    InverseDynamics (human, q, qdot, qddot_hybrid, tau_id, &f_ext);
+    CHECK_ARRAY_CLOSE (tau_hybrid.data(), tau_id.data(), tau_id.size(),
+        1.0e-9);
+  }
+}
+
+TEST_FIXTURE ( Rok3, HybridDynamicsPrescribedTorsoRok3 ) {
+  for (unsigned int i = 0; i < model->qdot_size; i++) {
+    q[i] = 0.2 * sin (0.8 * i + 0.1);
+    qdot[i] = 0.3 * cos (0.5 * i);
+    tau[i] = 2. * sin (0.3 * i + 0.2);
+  }
+  Quaternion base_quat (0.05, -0.1, 0.2, 0.95);
+  base_quat /= base_quat.norm();
+  model->SetQuaternion (base_id, base_quat, q);
+
+  // replays the torso motion, the legs and the floating base are free
+  unsigned int torso_index = model->mJoints[torso_id].q_index;
+  vector<bool> prescribed (model->qdot_size, false);
+  prescribed[torso_index] = true;
+  qddot[torso_index] = 1.5;
+  tau[torso_index] = 0.;
+
+  VectorNd qddot_hybrid = qddot;
+  VectorNd tau_hybrid = tau;
+  HybridDynamics (*model, q, qdot, prescribed, qddot_hybrid, tau_hybrid);
+
+  CHECK_EQUAL (1.5, qddot_hybrid[torso_index]);
+
+  VectorNd qddot_fd = VectorNd::Zero (model->qdot_size);
+  ForwardDynamics (*model, q, qdot, tau_hybrid, qddot_fd);
+  CHECK_ARRAY_CLOSE (qddot_hybrid.data(), qddot_fd.data(), qddot_fd.size(),
+      1.0e-10);
+}
+
+TEST_FIXTURE ( Rok3, GeneralizedMomentumEffectsRok3 ) {
+  for (unsigned int i = 0; i < model->qdot_size; i++) {
+    q[i] = 0.2 * sin (0.8 * i + 0.1);
+    qdot[i] = 0.7 * cos (0.5 * i);
+  }
+  Quaternion base_quat (0.05, -0.1, 0.2, 0.95);
+  base_quat /= base_quat.norm();
+  model->SetQuaternion (base_id, base_quat, q);
+
+  VectorNd tau_momentum = VectorNd::Zero (model->qdot_size);
+  VectorNd momentum = VectorNd::Zero (model->qdot_size);
+  GeneralizedMomentumEffects (*model, q, qdot, tau_momentum, &momentum);
+
+  MatrixNd M (MatrixNd::Zero (model->qdot_size, model->qdot_size));
+  CompositeRigidBodyAlgorithm (*model, q, M);
+  VectorNd momentum_crba = M * qdot;
+  CHECK_ARRAY_CLOSE (momentum_crba.data(), momentum.data(), momentum.size(),
+      1.0e-10);
+
+  // dM/dt qdot by central differences along qdot, the base orientation
+  // moves with the angular velocity of the spherical joint
+  double h = 1.0e-6;
+  unsigned int omega_index = model->mJoints[base_id].q_index;
+  Vector4d quat_dot = base_quat.omegaToQDot (Vector3d (qdot[omega_index],
+        qdot[omega_index + 1], qdot[omega_index + 2]));
+  MatrixNd M_plus (MatrixNd::Zero (model->qdot_size, model->qdot_size));
+  MatrixNd M_minus (MatrixNd::Zero (model->qdot_size, model->qdot_size));
+  VectorNd q_plus = q;
+  VectorNd q_minus = q;
+  q_plus.head (model->qdot_size) += h * qdot;
+  q_minus.head (model->qdot_size) -= h * qdot;
+  Vector4d quat_plus = base_quat + h * quat_dot;
+  Vector4d quat_minus = base_quat - h * quat_dot;
+  model->SetQuaternion (base_id, Quaternion (quat_plus.normalized()), q_plus);
+  model->SetQuaternion (base_id, Quaternion (quat_minus.normalized()),
+      q_minus);
+  CompositeRigidBodyAlgorithm (*model, q_plus, M_plus);
+  CompositeRigidBodyAlgorithm (*model, q_minus, M_minus);
+  VectorNd Mdot_qdot = (M_plus - M_minus) * qdot / (2. * h);
+
+  // g = N(q, 0), C qdot = N(q, qdot) - g, C^T qdot = dM/dt qdot - C qdot
+  VectorNd gravity = VectorNd::Zero (model->qdot_size);
+  VectorNd nonlinear = VectorNd::Zero (model->qdot_size);
+  NonlinearEffects (*model, q, VectorNd::Zero (model->qdot_size), gravity);
+  NonlinearEffects (*model, q, qdot, nonlinear);
+  VectorNd tau_reference = gravity - (Mdot_qdot - (nonlinear - gravity));
+
+  CHECK_ARRAY_CLOSE (tau_reference.data(), tau_momentum.data(),
+      tau_momentum.size(), 1.0e-6);
+
+  // without motion only gravity remains
+  GeneralizedMomentumEffects (*model, q, VectorNd::Zero (model->qdot_size),
+      tau_momentum);
+  CHECK_ARRAY_CLOSE (gravity.data(), tau_momentum.data(),
+      tau_momentum.size(), 1.0e-12);
+}
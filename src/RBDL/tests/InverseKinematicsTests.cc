@@ -1,6 +1,7 @@
 #include <UnitTest++.h>
 
 #include <iostream>
+#include <limits>
 
 #include "rbdl/rbdl_mathutils.h"
 #include "rbdl/rbdl_utils.h"
@@ -8,8 +9,10 @@
 
 #include "rbdl/Model.h"
 #include "rbdl/Kinematics.h"
+#include "rbdl/InverseKinematicsMultiStart.h"
 
 #include "Human36Fixture.h"
+#include "Rok3Fixture.h"
 
 using namespace std;
 using namespace RigidBodyDynamics;
@@ -270,3 +273,337 @@ TEST_FIXTURE ( Human36, ManyBodyFullConstraints ) {
   CHECK_ARRAY_CLOSE (target_orientation4.data(), result_orientation4.data(), 9, TEST_PREC); 
   CHECK_ARRAY_CLOSE (target_orientation5.data(), result_orientation5.data(), 9, TEST_PREC); 
 }
+
+TEST_FIXTURE ( Human36, JointLimits ) {
+  q[HipRightRY] = 0.3;
+  q[KneeRightRY] = 0.3;
+  q[AnkleRightRY] = 0.3;
+
+  Vector3d local_point (1., 0., 0.);
+
+  UpdateKinematicsCustom (*model, &q, NULL, NULL);
+  Vector3d target_position = CalcBodyToBaseCoordinates (*model, q, body_id_emulated[BodyFootRight], local_point);
+
+  q.setZero();
+
+  InverseKinematicsConstraintSet cs;
+  cs.AddPointConstraint (body_id_emulated[BodyFootRight], local_point, target_position);
+
+  // the knee must not bend beyond 0.1 so that the target is reached with
+  // the remaining joints
+  cs.q_min = VectorNd::Constant (model->q_size, -numeric_limits<double>::infinity());
+  cs.q_max = VectorNd::Constant (model->q_size, numeric_limits<double>::infinity());
+  cs.q_min[KneeRightRY] = -0.1;
+  cs.q_max[KneeRightRY] = 0.1;
+
+  VectorNd qres (q);
+
+  bool result = InverseKinematics (*model, q, cs, qres);
+
+  CHECK (result);
+  CHECK_CLOSE (0., cs.error_norm, 1.0e-10);
+  CHECK (qres[KneeRightRY] >= -0.1 && qres[KneeRightRY] <= 0.1);
+}
+
+TEST_FIXTURE ( Human36, ConvergenceDiagnostics ) {
+  randomizeStates();
+
+  Vector3d local_point (0., 1., 0.);
+
+  UpdateKinematicsCustom (*model, &q, NULL, NULL);
+  Vector3d target_position = CalcBodyToBaseCoordinates (*model, q, body_id_emulated[BodyHandRight], local_point);
+  Matrix3d target_orientation = CalcBodyWorldOrientation (*model, q, body_id_emulated[BodyHandRight], false);
+
+  q.setZero();
+
+  InverseKinematicsConstraintSet cs;
+  cs.AddFullConstraint (body_id_emulated[BodyHandRight], local_point, target_position, target_orientation);
+
+  VectorNd qres (q);
+  bool result = InverseKinematics (*model, q, cs, qres);
+
+  CHECK (result);
+  CHECK (cs.num_steps > 0);
+  CHECK (cs.num_steps < cs.max_steps);
+  CHECK (cs.damping > 0.);
+  CHECK_CLOSE (0., cs.error_norm, TEST_PREC);
+
+  // a second solve reuses the workspace and yields the same result
+  unsigned int num_steps = cs.num_steps;
+  VectorNd qres_repeated (q);
+  result = InverseKinematics (*model, q, cs, qres_repeated);
+
+  CHECK (result);
+  CHECK_EQUAL (num_steps, cs.num_steps);
+  CHECK_ARRAY_EQUAL (qres.data(), qres_repeated.data(), qres.size());
+}
+
+TEST_FIXTURE ( Rok3, FloatingBaseFullConstraints ) {
+  VectorNd q_target (q);
+  for (unsigned int i = 0; i < model->qdot_size; i++) {
+    q_target[i] = 0.2 * sin (0.8 * i + 0.1);
+  }
+  Quaternion base_quat (0.05, -0.1, 0.2, 0.95);
+  base_quat /= base_quat.norm();
+  model->SetQuaternion (base_id, base_quat, q_target);
+
+  UpdateKinematicsCustom (*model, &q_target, NULL, NULL);
+
+  InverseKinematicsConstraintSet cs;
+  for (unsigned int k = 0; k < 2; k++) {
+    cs.AddFullConstraint (foot_id[k], Vector3d (0.05, 0., -0.02),
+        CalcBodyToBaseCoordinates (*model, q_target, foot_id[k], Vector3d (0.05, 0., -0.02), false),
+        CalcBodyWorldOrientation (*model, q_target, foot_id[k], false));
+  }
+  cs.AddFullConstraint (torso_id, Vector3d (0., 0., 0.3),
+      CalcBodyToBaseCoordinates (*model, q_target, torso_id, Vector3d (0., 0., 0.3), false),
+      CalcBodyWorldOrientation (*model, q_target, torso_id, false));
+
+  VectorNd qres (q);
+  bool result = InverseKinematics (*model, q, cs, qres);
+
+  CHECK (result);
+  CHECK_CLOSE (0., cs.error_norm, TEST_PREC);
+
+  // the quaternion of the floating base stays normalized
+  CHECK_CLOSE (1., model->GetQuaternion (base_id, qres).norm(), TEST_PREC);
+
+  UpdateKinematicsCustom (*model, &qres, NULL, NULL);
+  for (unsigned int k = 0; k < 2; k++) {
+    Vector3d result_position = CalcBodyToBaseCoordinates (*model, qres, foot_id[k], Vector3d (0.05, 0., -0.02), false);
+    CHECK_ARRAY_CLOSE (cs.target_positions[k].data(), result_position.data(), 3, TEST_PREC);
+  }
+}
+
+struct Rok3WholeBodyTargets : public Rok3 {
+  Rok3WholeBodyTargets () {
+    // crouched posture with the base tilted forward
+    q_target = q;
+    for (unsigned int i = 0; i < model->qdot_size; i++) {
+      q_target[i] = 0.15 * sin (1.3 * i + 0.4);
+    }
+    Quaternion base_quat (0.02, 0.1, -0.05, 0.99);
+    base_quat /= base_quat.norm();
+    model->SetQuaternion (base_id, base_quat, q_target);
+
+    UpdateKinematicsCustom (*model, &q_target, NULL, NULL);
+    for (unsigned int k = 0; k < 2; k++) {
+      foot_position[k] = CalcBodyToBaseCoordinates (*model, q_target, foot_id[k], Vector3d::Zero(), false);
+      foot_orientation[k] = CalcBodyWorldOrientation (*model, q_target, foot_id[k], false);
+    }
+
+    double mass;
+    RigidBodyDynamics::Utils::CalcCenterOfMass (*model, q_target, qdot, NULL, mass, com, NULL, NULL, NULL, NULL, false);
+  }
+
+  VectorNd q_target;
+  Vector3d foot_position[2];
+  Matrix3d foot_orientation[2];
+  Vector3d com;
+};
+
+TEST_FIXTURE ( Rok3WholeBodyTargets, PrioritizedWholeBody ) {
+  InverseKinematicsConstraintSet cs;
+  cs.AddFullConstraint (foot_id[0], Vector3d::Zero(), foot_position[0], foot_orientation[0], 0);
+  cs.AddCoMConstraint (com, 1);
+  cs.AddFullConstraint (foot_id[1], Vector3d::Zero(), foot_position[1], foot_orientation[1], 2);
+  // the nominal posture conflicts with the other targets
+  cs.AddPostureConstraint (q, 3);
+  cs.max_hard_priority = 2;
+
+  VectorNd qres (q);
+  bool result = InverseKinematicsPrioritized (*model, q, cs, qres);
+
+  CHECK (result);
+  CHECK (cs.num_steps < cs.max_steps);
+  CHECK_EQUAL (4u, cs.priority_error_norms.size());
+  CHECK_CLOSE (0., cs.priority_error_norms[0], TEST_PREC);
+  CHECK_CLOSE (0., cs.priority_error_norms[1], TEST_PREC);
+  CHECK_CLOSE (0., cs.priority_error_norms[2], TEST_PREC);
+  CHECK (cs.priority_error_norms[3] > 1.0e-3);
+  CHECK_EQUAL (4u, cs.priority_level_status.size());
+  for (unsigned int l = 0; l < 3; l++) {
+    CHECK_EQUAL (InverseKinematicsConstraintSet::PriorityLevelSatisfied, cs.priority_level_status[l]);
+  }
+  CHECK_EQUAL (InverseKinematicsConstraintSet::PriorityLevelConverged, cs.priority_level_status[3]);
+  CHECK_CLOSE (1., model->GetQuaternion (base_id, qres).norm(), TEST_PREC);
+
+  UpdateKinematicsCustom (*model, &qres, NULL, NULL);
+  for (unsigned int k = 0; k < 2; k++) {
+    Vector3d result_position = CalcBodyToBaseCoordinates (*model, qres, foot_id[k], Vector3d::Zero(), false);
+    CHECK_ARRAY_CLOSE (foot_position[k].data(), result_position.data(), 3, TEST_PREC);
+  }
+
+  double mass;
+  Vector3d result_com;
+  Utils::CalcCenterOfMass (*model, qres, qdot, NULL, mass, result_com, NULL, NULL, NULL, NULL, false);
+  CHECK_ARRAY_CLOSE (com.data(), result_com.data(), 3, TEST_PREC);
+}
+
+TEST_FIXTURE ( Rok3WholeBodyTargets, PrioritizedConflictingLevels ) {
+  // the swing foot target is out of reach and must not disturb the
+  // stance foot and the center of mass
+  InverseKinematicsConstraintSet cs;
+  cs.AddCoMConstraint (com, 1);
+  cs.AddPointConstraint (foot_id[1], Vector3d::Zero(), foot_position[1] + Vector3d (1.5, 0., 0.5), 2);
+  cs.AddFullConstraint (foot_id[0], Vector3d::Zero(), foot_position[0], foot_orientation[0], 0);
+
+  // the swing leg slowly approaches its stretched configuration, which
+  // keeps disturbing the stance foot slightly
+  cs.constraint_tol = 1.0e-8;
+  VectorNd qres (q);
+  bool result = InverseKinematicsPrioritized (*model, q, cs, qres);
+
+  // only the stance foot is a hard constraint
+  CHECK (result);
+  CHECK_EQUAL (3u, cs.priority_error_norms.size());
+  CHECK_CLOSE (0., cs.priority_error_norms[0], 1.0e-8);
+  CHECK_CLOSE (0., cs.priority_error_norms[1], 1.0e-6);
+  CHECK (cs.priority_error_norms[2] > 0.1);
+  CHECK (cs.step_norm < 0.01);
+  CHECK_EQUAL (InverseKinematicsConstraintSet::PriorityLevelSatisfied, cs.priority_level_status[0]);
+  CHECK (cs.priority_level_status[2] != InverseKinematicsConstraintSet::PriorityLevelSatisfied);
+
+  // the unreachable swing foot fails the solve once it is a hard constraint
+  cs.max_hard_priority = 2;
+  qres = q;
+  result = InverseKinematicsPrioritized (*model, q, cs, qres);
+
+  CHECK (!result);
+  CHECK (cs.priority_error_norms[2] > 0.1);
+}
+
+TEST_FIXTURE ( Rok3WholeBodyTargets, PostureConstraint ) {
+  InverseKinematicsConstraintSet cs;
+  cs.AddPostureConstraint (q_target);
+
+  VectorNd qres (q);
+  bool result = InverseKinematicsPrioritized (*model, q, cs, qres);
+
+  CHECK (result);
+  CHECK_CLOSE (0., cs.error_norm, TEST_PREC);
+  CHECK_ARRAY_CLOSE (q_target.data(), qres.data(), q_target.size(), TEST_PREC);
+
+  // the same constraint with the unprioritized solver
+  qres = q;
+  result = InverseKinematics (*model, q, cs, qres);
+
+  CHECK (result);
+  CHECK_ARRAY_CLOSE (q_target.data(), qres.data(), q_target.size(), TEST_PREC);
+}
+
+struct Rok3KneeTargets : public Rok3 {
+  Rok3KneeTargets () {
+    // the left foot pose of a bent knee is also reached with the knee
+    // bent the other way
+    hip_yaw_index = model->mJoints[torso_id + 1].q_index;
+    knee_index = hip_yaw_index + 3;
+
+    VectorNd q_target (q);
+    q_target[hip_yaw_index + 1] = 0.1;
+    q_target[hip_yaw_index + 2] = -0.4;
+    q_target[knee_index] = 0.8;
+    q_target[knee_index + 1] = -0.4;
+
+    UpdateKinematicsCustom (*model, &q_target, NULL, NULL);
+    cs.AddFullConstraint (base_id, Vector3d::Zero(), Vector3d::Zero(), Matrix3d::Identity());
+    cs.AddFullConstraint (foot_id[0], Vector3d::Zero(),
+        CalcBodyToBaseCoordinates (*model, q_target, foot_id[0], Vector3d::Zero(), false),
+        CalcBodyWorldOrientation (*model, q_target, foot_id[0], false));
+
+    seeds.resize (model->q_size, 3);
+    for (unsigned int s = 0; s < 3; s++) {
+      seeds.col (s) = q;
+    }
+    seeds(knee_index, 0) = 0.8;
+    seeds(knee_index, 1) = -0.8;
+    seeds(knee_index, 2) = 0.3;
+
+    q_current = q;
+    q_current[knee_index] = -0.5;
+  }
+
+  unsigned int hip_yaw_index;
+  unsigned int knee_index;
+  InverseKinematicsConstraintSet cs;
+  MatrixNd seeds;
+  VectorNd q_current;
+};
+
+TEST_FIXTURE ( Rok3KneeTargets, MultiStartSelectsClosestSolution ) {
+  InverseKinematicsMultiStart multi_start (*model, 2);
+  multi_start.stop_at_first_solution = false;
+
+  VectorNd qres (q);
+  bool result = multi_start.Solve (q_current, seeds, cs, qres);
+
+  CHECK (result);
+  CHECK_EQUAL (3u, multi_start.num_converged);
+  CHECK_EQUAL (1u, multi_start.best_seed);
+  CHECK_CLOSE (0.8, multi_start.seed_results(knee_index, 0), 1.0e-8);
+  CHECK_CLOSE (-0.8, qres[knee_index], 1.0e-8);
+  CHECK_CLOSE (multi_start.ConfigurationDistance (q_current, qres), multi_start.seed_distances[1], TEST_PREC);
+
+  // the constraint set is copied and stays untouched
+  CHECK_EQUAL (0u, cs.num_steps);
+  CHECK (cs.cancel == NULL);
+
+  UpdateKinematicsCustom (*model, &qres, NULL, NULL);
+  Vector3d result_position = CalcBodyToBaseCoordinates (*model, qres, foot_id[0], Vector3d::Zero(), false);
+  CHECK_ARRAY_CLOSE (cs.target_positions[1].data(), result_position.data(), 3, TEST_PREC);
+}
+
+TEST_FIXTURE ( Rok3KneeTargets, MultiStartStopsAtFirstSolution ) {
+  // with a single thread the seeds run one after the other
+  InverseKinematicsMultiStart multi_start (*model, 1);
+
+  VectorNd qres (q);
+  bool result = multi_start.Solve (q_current, seeds, cs, qres);
+
+  CHECK (result);
+  CHECK_EQUAL (1u, multi_start.num_converged);
+  CHECK_EQUAL (0u, multi_start.best_seed);
+  CHECK_EQUAL (InverseKinematicsMultiStart::SeedConverged, multi_start.seed_status[0]);
+  CHECK_EQUAL (InverseKinematicsMultiStart::SeedSkipped, multi_start.seed_status[1]);
+  CHECK_EQUAL (InverseKinematicsMultiStart::SeedSkipped, multi_start.seed_status[2]);
+  CHECK_CLOSE (0.8, qres[knee_index], 1.0e-8);
+}
+
+TEST_FIXTURE ( Rok3KneeTargets, MultiStartGenerateSeeds ) {
+  InverseKinematicsMultiStart multi_start (*model, 1);
+
+  cs.q_min = VectorNd::Constant (model->q_size, -std::numeric_limits<double>::infinity());
+  cs.q_max = VectorNd::Constant (model->q_size, std::numeric_limits<double>::infinity());
+  cs.q_min[knee_index] = 0.;
+  cs.q_max[knee_index] = 1.5;
+
+  MatrixNd random_seeds;
+  multi_start.GenerateSeeds (q_current, cs, 6, random_seeds);
+
+  CHECK_EQUAL (6, random_seeds.cols());
+  CHECK_ARRAY_CLOSE (q_current.data(), random_seeds.col (0).data(), q_current.size(), TEST_PREC);
+  for (unsigned int s = 1; s < 6; s++) {
+    VectorNd seed = random_seeds.col (s);
+    CHECK_CLOSE (1., model->GetQuaternion (base_id, seed).norm(), TEST_PREC);
+    CHECK (seed[knee_index] >= 0. && seed[knee_index] <= 1.5);
+    CHECK (fabs (seed[hip_yaw_index] - q_current[hip_yaw_index]) <= multi_start.seed_range);
+  }
+
+  // the knee limit only admits the solution with the positive knee angle
+  VectorNd qres (q);
+  bool result = multi_start.Solve (q_current, random_seeds, cs, qres);
+
+  CHECK (result);
+  CHECK_CLOSE (0.8, qres[knee_index], 1.0e-8);
+}
+
+TEST_FIXTURE ( Rok3KneeTargets, CancelledSolve ) {
+  std::atomic<bool> cancel (true);
+  cs.cancel = &cancel;
+
+  VectorNd qres (q);
+  CHECK (!InverseKinematics (*model, seeds.col (0), cs, qres));
+  CHECK_EQUAL (0u, cs.num_steps);
+  CHECK (!InverseKinematicsPrioritized (*model, seeds.col (0), cs, qres));
+  CHECK_EQUAL (0u, cs.num_steps);
+}
@@ -107,3 +107,31 @@ TEST (SpatialMatrix_Multiplication) {
 
   CHECK_ARRAY_CLOSE (correct_result.data(), test_result.data(), 6 * 6, TEST_PREC);
 }
+
+TEST (SinCosBatch) {
+  const unsigned int n = 11;
+  double x[n] = {
+    0., -0., 0.3, -1.2, M_PI * 0.5, M_PI, -3. * M_PI * 0.25, 7.5, -123.4,
+    1.0e5, 2.0e7
+  };
+  double s[n], c[n];
+  double s_ref[n], c_ref[n];
+
+  SinCos (n, x, s, c);
+
+  for (unsigned int i = 0; i < n; i++) {
+    s_ref[i] = sin (x[i]);
+    c_ref[i] = cos (x[i]);
+  }
+
+  CHECK_ARRAY_CLOSE (s_ref, s, n, TEST_PREC);
+  CHECK_ARRAY_CLOSE (c_ref, c, n, TEST_PREC);
+
+  // results must not depend on the position within the batch
+  for (unsigned int i = 0; i < n; i++) {
+    double si, ci;
+    SinCos (1, &x[i], &si, &ci);
+    CHECK_EQUAL (s[i], si);
+    CHECK_EQUAL (c[i], ci);
+  }
+}
@@ -0,0 +1,255 @@
+#include <UnitTest++.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "rbdl/rbdl.h"
+#include "rbdl/SubtreePartition.h"
+#include "rbdl/ThreadPool.h"
+
+#include "Human36Fixture.h"
+#include "Rok3Fixture.h"
+
+using namespace std;
+using namespace RigidBodyDynamics;
+using namespace RigidBodyDynamics::Math;
+
+struct BranchedModelFixture {
+  BranchedModelFixture () {
+    model = new Model;
+    model->gravity = Vector3d (0., -9.81, 0.);
+
+    Body body (1.2, Vector3d (0.1, -0.2, 0.05), Vector3d (0.2, 0.1, 0.15));
+
+    unsigned int base_id = model->AddBody (0, SpatialTransform(),
+        Joint (JointTypeFloatingBase), body);
+
+    // four limbs with a branching end effector each
+    for (unsigned int limb = 0; limb < 4; limb++) {
+      unsigned int parent_id = base_id;
+      Vector3d offset (0.3 * cos (limb * M_PI * 0.5), -0.1,
+          0.3 * sin (limb * M_PI * 0.5));
+
+      parent_id = model->AddBody (parent_id, Xtrans (offset),
+          Joint (JointTypeEulerZYX), body);
+      for (unsigned int k = 0; k < 3; k++) {
+        JointType joint_type = (k % 2 == 0) ? JointTypeRevoluteX
+          : JointTypeRevoluteZ;
+        parent_id = model->AddBody (parent_id,
+            Xtrans (Vector3d (0., -0.25, 0.02 * k)), Joint (joint_type),
+            body);
+      }
+
+      for (unsigned int finger = 0; finger < 3; finger++) {
+        unsigned int finger_id = model->AddBody (parent_id,
+            Xtrans (Vector3d (0.05 * finger, -0.1, 0.)),
+            Joint (JointTypeRevoluteY), body);
+        model->AddBody (finger_id, Xtrans (Vector3d (0., -0.05, 0.)),
+            Joint (JointTypeRevoluteX), body);
+      }
+    }
+
+    Q = VectorNd::Zero (model->q_size);
+    QDot = VectorNd::Zero (model->qdot_size);
+    Tau = VectorNd::Zero (model->qdot_size);
+
+    for (unsigned int i = 0; i < model->q_size; i++) {
+      Q[i] = 0.4 * sin (0.9 * i + 0.3);
+    }
+    for (unsigned int i = 0; i < model->qdot_size; i++) {
+      QDot[i] = 0.6 * cos (1.1 * i - 0.2);
+      Tau[i] = 0.5 * sin (1.7 * i + 0.4);
+    }
+
+    Quaternion base_quat (0.2, -0.1, 0.3, 0.9);
+    base_quat /= base_quat.norm();
+    model->SetQuaternion (base_id, base_quat, Q);
+
+    f_ext.assign (model->mBodies.size(), SpatialVector::Zero());
+    for (unsigned int i = 3; i < model->mBodies.size(); i += 5) {
+      f_ext[i] = SpatialVector (0.1 * i, -0.2, 0.3, 1., -0.5 * i, 2.);
+    }
+  }
+
+  ~BranchedModelFixture () {
+    delete model;
+  }
+
+  Model *model;
+
+  VectorNd Q;
+  VectorNd QDot;
+  VectorNd Tau;
+
+  vector<SpatialVector> f_ext;
+};
+
+TEST_FIXTURE ( BranchedModelFixture, TestSubtreePartitionCoversModel ) {
+  const unsigned int num_subtrees = 8;
+  SubtreePartition partition (*model, num_subtrees);
+
+  unsigned int max_size = (model->mBodies.size() - 1 + num_subtrees - 1)
+    / num_subtrees;
+
+  CHECK_EQUAL (model->mBodies.size(), partition.body_count);
+  CHECK (partition.roots.size() >= num_subtrees);
+  CHECK_EQUAL (partition.roots.size(), partition.subtree_bodies.size());
+  CHECK_EQUAL (partition.top_bodies.size() + partition.roots.size(),
+      partition.joint_bodies.size());
+
+  vector<int> visits (model->mBodies.size(), 0);
+  for (unsigned int k = 0; k < partition.top_bodies.size(); k++) {
+    visits[partition.top_bodies[k]]++;
+    CHECK (!partition.is_subtree_root[partition.top_bodies[k]]);
+  }
+
+  for (unsigned int s = 0; s < partition.roots.size(); s++) {
+    const vector<unsigned int> &bodies = partition.subtree_bodies[s];
+
+    // larger subtrees have to be serial chains
+    if (bodies.size() > max_size) {
+      for (unsigned int k = 0; k < bodies.size(); k++) {
+        CHECK (model->mu[bodies[k]].size() <= 1);
+      }
+    }
+    CHECK_EQUAL (partition.roots[s], bodies[0]);
+    CHECK (partition.is_subtree_root[bodies[0]]);
+
+    if (s > 0) {
+      CHECK (bodies.size() <= partition.subtree_bodies[s - 1].size());
+    }
+
+    for (unsigned int k = 0; k < bodies.size(); k++) {
+      visits[bodies[k]]++;
+
+      if (k > 0) {
+        CHECK (bodies[k - 1] < bodies[k]);
+        CHECK (!partition.is_subtree_root[bodies[k]]);
+      }
+    }
+  }
+
+  CHECK_EQUAL (0, visits[0]);
+  for (unsigned int i = 1; i < visits.size(); i++) {
+    CHECK_EQUAL (1, visits[i]);
+  }
+}
+
+TEST_FIXTURE ( BranchedModelFixture, TestForwardDynamicsParallelMatchesSerial ) {
+  VectorNd qddot_ref = VectorNd::Zero (model->qdot_size);
+  ForwardDynamics (*model, Q, QDot, Tau, qddot_ref, &f_ext);
+
+  unsigned int thread_counts[] = { 1, 2, 4 };
+  for (unsigned int t = 0; t < 3; t++) {
+    ThreadPool pool (thread_counts[t]);
+
+    unsigned int subtree_counts[] = { 1, 4 * pool.GetNumThreads(), 1000 };
+    for (unsigned int s = 0; s < 3; s++) {
+      SubtreePartition partition (*model, subtree_counts[s]);
+
+      VectorNd qddot = VectorNd::Zero (model->qdot_size);
+      ForwardDynamicsParallel (*model, Q, QDot, Tau, qddot, pool, partition,
+          &f_ext);
+
+      CHECK_ARRAY_EQUAL (qddot_ref.data(), qddot.data(), qddot.size());
+    }
+  }
+}
+
+TEST_FIXTURE ( Human36, TestForwardDynamicsParallelHuman36 ) {
+  for (unsigned int i = 0; i < q.size(); i++) {
+    q[i] = 0.3 * sin (1.3 * i);
+    qdot[i] = 0.2 * cos (0.7 * i);
+    tau[i] = 0.5 * sin (0.4 * i + 1.);
+  }
+
+  ThreadPool pool (3);
+
+  Model *models[] = { model_emulated, model_3dof };
+  for (unsigned int m = 0; m < 2; m++) {
+    Model &human = *models[m];
+
+    VectorNd qddot_ref = VectorNd::Zero (human.qdot_size);
+    ForwardDynamics (human, q, qdot, tau, qddot_ref);
+
+    SubtreePartition partition (human, 4 * pool.GetNumThreads());
+    VectorNd qddot_parallel = VectorNd::Zero (human.qdot_size);
+    ForwardDynamicsParallel (human, q, qdot, tau, qddot_parallel, pool,
+        partition);
+
+    CHECK_ARRAY_EQUAL (qddot_ref.data(), qddot_parallel.data(),
+        qddot_ref.size());
+  }
+}
+
+TEST_FIXTURE ( BranchedModelFixture, TestCompositeRigidBodyAlgorithmParallelMatchesSerial ) {
+  MatrixNd H_ref = MatrixNd::Zero (model->qdot_size, model->qdot_size);
+  CompositeRigidBodyAlgorithm (*model, Q, H_ref);
+
+  unsigned int thread_counts[] = { 1, 2, 4 };
+  for (unsigned int t = 0; t < 3; t++) {
+    ThreadPool pool (thread_counts[t]);
+
+    unsigned int subtree_counts[] = { 1, 4 * pool.GetNumThreads(), 1000 };
+    for (unsigned int s = 0; s < 3; s++) {
+      SubtreePartition partition (*model, subtree_counts[s]);
+
+      MatrixNd H = MatrixNd::Zero (model->qdot_size, model->qdot_size);
+      CompositeRigidBodyAlgorithmParallel (*model, Q, H, pool, partition);
+
+      CHECK_ARRAY_EQUAL (H_ref.data(), H.data(), H.size());
+    }
+  }
+}
+
+TEST_FIXTURE ( Rok3, TestCompositeRigidBodyAlgorithmParallelRok3 ) {
+  for (unsigned int i = 0; i < model->dof_count; i++) {
+    q[i] = 0.2 * sin (0.8 * i + 0.1);
+  }
+  Quaternion base_quat (0.05, -0.1, 0.2, 0.95);
+  base_quat /= base_quat.norm();
+  model->SetQuaternion (base_id, base_quat, q);
+
+  MatrixNd H_ref = MatrixNd::Zero (model->qdot_size, model->qdot_size);
+  CompositeRigidBodyAlgorithm (*model, q, H_ref);
+
+  ThreadPool pool (3);
+  SubtreePartition partition (*model, 4 * pool.GetNumThreads());
+
+  // the torso and both legs are subtrees, the floating base is on top
+  CHECK_EQUAL (3u, partition.roots.size());
+  CHECK_EQUAL (2u, partition.top_bodies.size());
+  CHECK_EQUAL (torso_id, partition.roots[2]);
+
+  MatrixNd H = MatrixNd::Zero (model->qdot_size, model->qdot_size);
+  CompositeRigidBodyAlgorithmParallel (*model, q, H, pool, partition);
+  CHECK_ARRAY_EQUAL (H_ref.data(), H.data(), H.size());
+
+  // kinematics are already up to date
+  H.setZero();
+  CompositeRigidBodyAlgorithmParallel (*model, q, H, pool, partition, false);
+  CHECK_ARRAY_EQUAL (H_ref.data(), H.data(), H.size());
+}
+
+TEST_FIXTURE ( Human36, TestCompositeRigidBodyAlgorithmParallelHuman36 ) {
+  for (unsigned int i = 0; i < q.size(); i++) {
+    q[i] = 0.3 * sin (1.3 * i);
+  }
+
+  ThreadPool pool (4);
+
+  Model *models[] = { model_emulated, model_3dof };
+  for (unsigned int m = 0; m < 2; m++) {
+    Model &human = *models[m];
+
+    MatrixNd H_ref = MatrixNd::Zero (human.qdot_size, human.qdot_size);
+    CompositeRigidBodyAlgorithm (human, q, H_ref);
+
+    SubtreePartition partition (human, 4 * pool.GetNumThreads());
+    MatrixNd H = MatrixNd::Zero (human.qdot_size, human.qdot_size);
+    CompositeRigidBodyAlgorithmParallel (human, q, H, pool, partition);
+
+    CHECK_ARRAY_EQUAL (H_ref.data(), H.data(), H.size());
+  }
+}
@@ -0,0 +1,93 @@
+#ifndef RBDL_ROK3_FIXTURE
+#define RBDL_ROK3_FIXTURE
+
+#include "rbdl/rbdl.h"
+
+/* Model of the RoK-3 biped as loaded by the Gazebo plugin from
+ * rok3_model.urdf with a floating base: a torso and two legs with six
+ * revolute joints each and fixed feet. */
+struct Rok3 {
+  Rok3 () {
+    using namespace RigidBodyDynamics;
+    using namespace RigidBodyDynamics::Math;
+
+    model = new Model;
+    model->gravity = Vector3d (0., 0., -9.81);
+
+    base_id = model->AddBody (0, SpatialTransform(),
+        Joint (JointTypeFloatingBase),
+        Body (4.91195, Vector3d (-0.00929, 0., 0.00778),
+          Vector3d (0.0365, 0.00772, 0.03493)));
+
+    torso_id = model->AddBody (base_id, Xtrans (Vector3d (-0.0305, 0., 0.)),
+        Joint (JointTypeRevoluteZ),
+        Body (8.7701, Vector3d (0.00349, 0.0005, 0.22547),
+          Vector3d (0.10602, 0.09214, 0.08651)));
+
+    foot_id[0] = addLeg (1.);
+    foot_id[1] = addLeg (-1.);
+
+    q = VectorNd::Zero (model->q_size);
+    qdot = VectorNd::Zero (model->qdot_size);
+    qddot = VectorNd::Zero (model->qdot_size);
+    tau = VectorNd::Zero (model->qdot_size);
+
+    model->SetQuaternion (base_id, Quaternion (0., 0., 0., 1.), q);
+  }
+
+  ~Rok3 () {
+    delete model;
+  }
+
+  /// Adds the left (side = 1) or right (side = -1) leg and returns the id
+  /// of the fixed foot body.
+  unsigned int addLeg (double side) {
+    using namespace RigidBodyDynamics;
+    using namespace RigidBodyDynamics::Math;
+
+    unsigned int hip_yaw_id = model->AddBody (base_id,
+        Xtrans (Vector3d (0., side * 0.105, -0.1512)),
+        Joint (JointTypeRevoluteZ),
+        Body (0.52735, Vector3d (0.00818, 0., 0.05977),
+          Vector3d (0.00108, 0.0026, 0.00191)));
+    unsigned int hip_roll_id = model->AddBody (hip_yaw_id,
+        SpatialTransform(), Joint (JointTypeRevoluteX),
+        Body (3.9265, Vector3d (0.008, side * 0.01822, -1.0e-5),
+          Vector3d (0.00689, 0.00735, 0.00861)));
+    unsigned int hip_pitch_id = model->AddBody (hip_roll_id,
+        SpatialTransform(), Joint (JointTypeRevoluteY),
+        Body (4.9728, Vector3d (0.01373, side * 0.0244, -0.22423),
+          Vector3d (0.07468, 0.07322, 0.01579)));
+    unsigned int knee_id = model->AddBody (hip_pitch_id,
+        Xtrans (Vector3d (0., 0., -0.35)), Joint (JointTypeRevoluteY),
+        Body (3.378, Vector3d (0.01497, side * 0.0128, -0.18288),
+          Vector3d (0.05941, 0.05717, 0.00957)));
+    unsigned int ankle_pitch_id = model->AddBody (knee_id,
+        Xtrans (Vector3d (0., -side * 0.001, -0.35)),
+        Joint (JointTypeRevoluteY),
+        Body (1.5671, Vector3d (0.01836, -side * 0.00287, 0.00268),
+          Vector3d (0.00139, 0.00331, 0.00315)));
+    unsigned int ankle_roll_id = model->AddBody (ankle_pitch_id,
+        SpatialTransform(), Joint (JointTypeRevoluteX),
+        Body (0.20333, Vector3d (0.01905, 0., -0.03706),
+          Vector3d (0.00011, 0.00063, 0.00059)));
+
+    return model->AddBody (ankle_roll_id,
+        Xtrans (Vector3d (0., side * 0.001, -0.09)), Joint (JointTypeFixed),
+        Body (0.92659, Vector3d (0., -side * 0.001, 0.00861),
+          Vector3d (0.00107, 0.00323, 0.00412)));
+  }
+
+  RigidBodyDynamics::Model *model;
+
+  unsigned int base_id;
+  unsigned int torso_id;
+  unsigned int foot_id[2];
+
+  RigidBodyDynamics::Math::VectorNd q;
+  RigidBodyDynamics::Math::VectorNd qdot;
+  RigidBodyDynamics::Math::VectorNd qddot;
+  RigidBodyDynamics::Math::VectorNd tau;
+};
+
+#endif
@@ -178,14 +178,14 @@ TEST ( TestSparseFactorizationMultiDof) {
   x_3dof = b;
   SparseSolveLx (model_3dof, H_3dof, x_3dof);
 
-  CHECK_ARRAY_CLOSE (x_emulated.data(), x_3dof.data(), x_emulated.size(), 1.0e-9);
+  CHECK_ARRAY_CLOSE (x_emulated.data(), x_3dof.data(), x_emulated.size(), TEST_PREC * x_emulated.norm());
 
   x_emulated = b;
   SparseSolveLTx (model_emulated, H_emulated, x_emulated);
   x_3dof = b;
   SparseSolveLTx (model_3dof, H_3dof, x_3dof);
 
-  CHECK_ARRAY_CLOSE (x_emulated.data(), x_3dof.data(), x_emulated.size(), 1.0e-9);
+  CHECK_ARRAY_CLOSE (x_emulated.data(), x_3dof.data(), x_emulated.size(), TEST_PREC * x_emulated.norm());
 }
 
 TEST ( TestSparseFactorizationMultiDofAndFixed) {
@@ -541,6 +541,133 @@ TEST(TestSpatialTransformApplyTransposeSpatialRigidBodyInertiaFull) {
       );
 }
 
+TEST(TestSpatialTransformApplyTransposeSymmetric) {
+  // articulated body inertias are symmetric but in general not the inertia
+  // of a rigid body
+  SpatialMatrix A (
+      2.1, 0.3, 0.2, 0.4, -0.1, 0.3,
+      0.3, 1.7, 0.5, 0.2, 0.6, -0.2,
+      0.2, 0.5, 1.9, -0.3, 0.1, 0.5,
+      0.4, 0.2, -0.3, 3.1, 0.7, 0.2,
+      -0.1, 0.6, 0.1, 0.7, 2.8, 0.4,
+      0.3, -0.2, 0.5, 0.2, 0.4, 2.5
+      );
+
+  SpatialTransform X (
+      Xrotz (0.5) *
+      Xroty (0.9) *
+      Xrotx (0.2) *
+      Xtrans (Vector3d (1.1, 1.2, 1.3))
+      );
+
+  SpatialMatrix A_transformed = X.applyTransposeSymmetric (A);
+  SpatialMatrix A_matrix_transformed = X.toMatrixTranspose() * A * X.toMatrix();
+
+  CHECK_ARRAY_CLOSE (
+      A_matrix_transformed.data(),
+      A_transformed.data(),
+      36,
+      TEST_PREC
+      );
+}
+
+TEST(TestSpatialArticulatedBodyInertiaPacked) {
+  SpatialMatrix A (
+      2.1, 0.3, 0.2, 0.4, -0.1, 0.3,
+      0.3, 1.7, 0.5, 0.2, 0.6, -0.2,
+      0.2, 0.5, 1.9, -0.3, 0.1, 0.5,
+      0.4, 0.2, -0.3, 3.1, 0.7, 0.2,
+      -0.1, 0.6, 0.1, 0.7, 2.8, 0.4,
+      0.3, -0.2, 0.5, 0.2, 0.4, 2.5
+      );
+  SpatialArticulatedBodyInertia IA (A);
+  SpatialMatrix A_unpacked = IA.toMatrix();
+
+  CHECK_ARRAY_CLOSE (A.data(), A_unpacked.data(), 36, TEST_PREC);
+
+  SpatialVector v (1.1, -1.2, 1.3, 0.4, -0.5, 0.6);
+  SpatialVector Av = A * v;
+  SpatialVector IAv = IA * v;
+
+  CHECK_ARRAY_CLOSE (Av.data(), IAv.data(), 6, TEST_PREC);
+
+  SpatialRigidBodyInertia rbi (1.3, Vector3d (0.1, -0.2, 0.3),
+      Matrix3d (1.1, 0.2, 0.3, 0.2, 1.4, 0.5, 0.3, 0.5, 1.7));
+  SpatialMatrix rbi_matrix = rbi.toMatrix();
+  SpatialMatrix rbi_unpacked = SpatialArticulatedBodyInertia (rbi).toMatrix();
+
+  CHECK_ARRAY_CLOSE (rbi_matrix.data(), rbi_unpacked.data(), 36, TEST_PREC);
+}
+
+TEST(TestSpatialArticulatedBodyInertiaRankUpdate) {
+  SpatialMatrix A (
+      2.1, 0.3, 0.2, 0.4, -0.1, 0.3,
+      0.3, 1.7, 0.5, 0.2, 0.6, -0.2,
+      0.2, 0.5, 1.9, -0.3, 0.1, 0.5,
+      0.4, 0.2, -0.3, 3.1, 0.7, 0.2,
+      -0.1, 0.6, 0.1, 0.7, 2.8, 0.4,
+      0.3, -0.2, 0.5, 0.2, 0.4, 2.5
+      );
+  SpatialVector u (1.1, -1.2, 1.3, 0.4, -0.5, 0.6);
+
+  SpatialArticulatedBodyInertia IA (A);
+  IA.rankUpdate (u, -0.7);
+  SpatialMatrix A_reference = A - 0.7 * u * u.transpose();
+  SpatialMatrix A_updated = IA.toMatrix();
+
+  CHECK_ARRAY_CLOSE (A_reference.data(), A_updated.data(), 36, TEST_PREC);
+
+  Matrix63 U;
+  U << 0.1, 0.2, -0.3,
+    0.4, -0.5, 0.6,
+    -0.7, 0.8, 0.9,
+    1.0, 0.1, -0.2,
+    0.3, -0.4, 0.5,
+    0.6, 0.7, -0.8;
+  Matrix3d M (1.2, 0.1, 0.3, 0.1, 0.9, -0.2, 0.3, -0.2, 1.5);
+
+  IA = SpatialArticulatedBodyInertia (A);
+  IA.rankUpdate (U, M, -1.);
+  A_reference = A - U * M * U.transpose();
+  A_updated = IA.toMatrix();
+
+  CHECK_ARRAY_CLOSE (A_reference.data(), A_updated.data(), 36, TEST_PREC);
+
+  Matrix63 AU = A * U;
+  Matrix63 IAU = SpatialArticulatedBodyInertia (A) * U;
+
+  CHECK_ARRAY_CLOSE (AU.data(), IAU.data(), 18, TEST_PREC);
+}
+
+TEST(TestSpatialTransformApplyTransposeArticulatedBodyInertia) {
+  SpatialMatrix A (
+      2.1, 0.3, 0.2, 0.4, -0.1, 0.3,
+      0.3, 1.7, 0.5, 0.2, 0.6, -0.2,
+      0.2, 0.5, 1.9, -0.3, 0.1, 0.5,
+      0.4, 0.2, -0.3, 3.1, 0.7, 0.2,
+      -0.1, 0.6, 0.1, 0.7, 2.8, 0.4,
+      0.3, -0.2, 0.5, 0.2, 0.4, 2.5
+      );
+
+  SpatialTransform X (
+      Xrotz (0.5) *
+      Xroty (0.9) *
+      Xrotx (0.2) *
+      Xtrans (Vector3d (1.1, 1.2, 1.3))
+      );
+
+  SpatialMatrix A_transformed =
+    X.applyTranspose (SpatialArticulatedBodyInertia (A)).toMatrix();
+  SpatialMatrix A_matrix_transformed = X.toMatrixTranspose() * A * X.toMatrix();
+
+  CHECK_ARRAY_CLOSE (
+      A_matrix_transformed.data(),
+      A_transformed.data(),
+      36,
+      TEST_PREC
+      );
+}
+
 TEST(TestSpatialRigidBodyInertiaCreateFromMatrix) {
   double mass = 1.1;
   Vector3d com (0., 0., 0.);
@@ -0,0 +1,89 @@
+#include <UnitTest++.h>
+
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+#include "rbdl/rbdl.h"
+#include "rbdl/ThreadPool.h"
+
+using namespace std;
+using namespace RigidBodyDynamics;
+using namespace RigidBodyDynamics::Math;
+
+TEST ( TestThreadPoolParallelForVisitsAllIndices ) {
+  ThreadPool pool (4);
+  CHECK_EQUAL (4u, pool.GetNumThreads());
+
+  vector<int> visits (1000, 0);
+  vector<unsigned int> thread_ids (1000, 0);
+
+  pool.ParallelFor (0, 1000, [&visits, &thread_ids] (unsigned int i,
+        unsigned int thread_id) {
+      visits[i]++;
+      thread_ids[i] = thread_id;
+      }, 7);
+
+  for (unsigned int i = 0; i < visits.size(); i++) {
+    CHECK_EQUAL (1, visits[i]);
+    CHECK (thread_ids[i] < pool.GetNumThreads());
+  }
+}
+
+TEST ( TestThreadPoolSubmitWait ) {
+  ThreadPool pool (3);
+
+  atomic<int> sum (0);
+  for (int i = 1; i <= 100; i++) {
+    pool.Submit ([&sum, i] (unsigned int) {
+        sum += i;
+        });
+  }
+  pool.Wait();
+
+  CHECK_EQUAL (5050, sum.load());
+
+  // the pool can be reused
+  for (int i = 1; i <= 100; i++) {
+    pool.Submit ([&sum, i] (unsigned int) {
+        sum -= i;
+        });
+  }
+  pool.Wait();
+
+  CHECK_EQUAL (0, sum.load());
+}
+
+TEST ( TestThreadPoolSingleThread ) {
+  ThreadPool pool (1);
+  CHECK_EQUAL (1u, pool.GetNumThreads());
+
+  vector<unsigned int> order;
+  pool.ParallelFor (3, 8, [&order] (unsigned int i, unsigned int thread_id) {
+      CHECK_EQUAL (0u, thread_id);
+      order.push_back (i);
+      });
+
+  CHECK_EQUAL (5u, order.size());
+  for (unsigned int i = 0; i < order.size(); i++) {
+    CHECK_EQUAL (i + 3, order[i]);
+  }
+}
+
+TEST ( TestThreadPoolPerThreadWorkspace ) {
+  ThreadPool pool (4);
+
+  // each participant accumulates into its own slot without locking
+  vector<double> partial_sums (pool.GetNumThreads(), 0.);
+  pool.ParallelFor (0, 10000, [&partial_sums] (unsigned int i,
+        unsigned int thread_id) {
+      partial_sums[thread_id] += static_cast<double>(i);
+      }, 64);
+
+  double sum = 0.;
+  for (unsigned int i = 0; i < partial_sums.size(); i++) {
+    sum += partial_sums[i];
+  }
+
+  CHECK_EQUAL (9999. * 10000. * 0.5, sum);
+}
@@ -16,6 +16,8 @@ using namespace std;
 using namespace RigidBodyDynamics;
 using namespace RigidBodyDynamics::Math;
 
+const double TEST_PREC = 1.0e-12;
+
 TEST_FIXTURE(FloatingBase12DoF, TestKineticEnergy) {
   VectorNd q = VectorNd::Zero(model->q_size);
   VectorNd qdot = VectorNd::Zero(model->q_size);
@@ -31,7 +33,7 @@ TEST_FIXTURE(FloatingBase12DoF, TestKineticEnergy) {
   double kinetic_energy_ref = 0.5 * qdot.transpose() * H * qdot;
   double kinetic_energy = Utils::CalcKineticEnergy (*model, q, qdot);
 
-  CHECK_EQUAL (kinetic_energy_ref, kinetic_energy);
+  CHECK_CLOSE (kinetic_energy_ref, kinetic_energy, TEST_PREC);
 }
 
 TEST(TestPotentialEnergy) {
@@ -32,6 +32,7 @@
 //* Header file for RBDL and Eigen
 #include <rbdl/rbdl.h> // Rigid Body Dynamics Library (RBDL)
 #include <rbdl/addons/urdfreader/urdfreader.h> // urdf model read using RBDL
+#include <rbdl/addons/locomotion/locomotion.h> // walking pattern generation using RBDL
 #include <Eigen/Dense> // Eigen is a C++ template library for linear algebra: matrices, vectors, numerical solvers, and related algorithms.
 
 #define PI      3.141592
@@ -122,6 +123,94 @@ namespace gazebo
         } ROBO_JOINT;
         ROBO_JOINT* joint;
 
+        //* Walking pattern variables
+        Addons::Locomotion::ZMPPreviewGains preview_gains; // ZMP preview control gains, cached next to the urdf file
+        Addons::Locomotion::WalkingPatternGenerator walking; // CoM and foot trajectories from the footstep plan
+        Addons::Locomotion::LIPModelPredictiveControl mpc; // CoM with the ZMP bounded to the support feet, replans at 100 Hz (MPC task only)
+        bool use_mpc; // Pelvis above the MPC CoM instead of the preview control CoM
+        Vector3d com_state_x, com_state_y; // cart-table states of the MPC CoM (IK task)
+        double com_jerk_x, com_jerk_y; // first jerks of the last MPC solution, [m/s^3]
+        double walk_goal_x; // x of the front foot at the end of the walk, [m]
+        double step_length; // forward distance of the planned footsteps, [m]
+
+        Model* leg_model; // base_link fixed at the origin, foot targets are relative to the pelvis
+        InverseKinematicsConstraintSet leg_ik; // full constraints of L_Foot (0) and R_Foot (1)
+        VectorNd leg_q; // IK solution, warm start of the next tick
+        unsigned int leg_q_index[13]; // index in leg_q of each joint
+
+        double pelvis_height; // Height of the pelvis (and the CoM) above the ground, [m]
+        double ready_time; // Time to bend the knees into the walking posture, [s]
+
+        //* Floating base estimation variables
+        sensors::ImuSensorPtr imu; // IMU of base_link, looked up on the first update
+        Addons::Locomotion::FloatingBaseEstimator base_estimator; // base pose and velocity from the IMU and the leg kinematics
+        bool base_estimator_initialized;
+        VectorNd leg_q_actual; // measured joint positions in the order of leg_model
+        unsigned int L_foot_id, R_foot_id; // L_Foot and R_Foot bodies of leg_model (sole frames of the LS/RS sensors)
+
+        //* Foot force/torque sensor variables
+        Addons::Locomotion::FootWrenchProcessor foot_wrench; // filtered LS/RS wrenches, centers of pressure, measured ZMP and contacts
+
+        //* Generalized momentum observer variables
+        Model* rok3_model; // floating base model of the urdf file
+        Addons::Locomotion::MomentumObserver momentum_observer; // external joint torques from the commanded torques and the joint states
+        bool momentum_observer_initialized;
+        VectorNd rok3_q, rok3_qdot, rok3_tau; // states and commanded torques in the order of rok3_model
+        unsigned int rok3_q_index[13]; // index in rok3_q and rok3_qdot of each joint
+        unsigned int rok3_base_id, rok3_L_foot_id, rok3_R_foot_id; // base_link, L_Foot and R_Foot bodies of rok3_model
+        Vector3d L_foot_force_estimate, R_foot_force_estimate; // ground forces on the soles from the residuals of the leg joints, [N]
+        bool upper_body_collision; // residual of the waist joint above the threshold
+
+        //* Multi-rate control variables
+        struct MPCInput // CoM state at sample and the footstep plan for the references
+        {
+            long sample;
+            Vector3d state_x, state_y;
+            Addons::Locomotion::WalkingPlan plan; // without the preview window of the pattern generator
+        };
+        struct CoMPlan // first jerks of the MPC solution for the CoM state at sample
+        {
+            long sample;
+            double jerk_x, jerk_y;
+        };
+        struct WalkingStatus // state of the walking pattern for the footstep planner
+        {
+            long sample;
+            bool finished;
+            Vector3d left_foot, right_foot;
+        };
+        struct FootstepPlan // footsteps planned from the walking status at status_sample
+        {
+            long status_sample;
+            std::vector<Addons::Locomotion::Footstep> footsteps;
+        };
+
+        unsigned int ik_period; // period of the walking pattern, IK and MPC, [1 ms ticks]
+        double estimation_dt; // time since the last run of the estimation task, [s]
+        double last_estimation_time;
+
+        MPCInput ik_mpc_input; // written by the IK task
+        MPCInput mpc_input; // copied at the release of the MPC task
+        WalkingStatus planner_status; // copied at the release of the footstep planner
+        unsigned long com_plan_sequence, footstep_plan_sequence, joint_target_sequence; // last values read from the channels
+        long footstep_plan_sample; // sample at which the last footstep plan was applied
+        VectorNd joint_target; // joint targets of the IK task at the end of its period
+        VectorNd servo_start, servo_goal; // joint targets the servo interpolates between
+        unsigned int servo_step; // servo ticks since the last joint targets
+
+        Addons::Locomotion::DoubleBufferedChannel<MPCInput> mpc_input_channel; // IK -> MPC
+        Addons::Locomotion::DoubleBufferedChannel<CoMPlan> com_plan_channel; // MPC -> IK
+        Addons::Locomotion::DoubleBufferedChannel<WalkingStatus> walking_status_channel; // IK -> footstep planner
+        Addons::Locomotion::DoubleBufferedChannel<FootstepPlan> footstep_plan_channel; // footstep planner -> IK
+        Addons::Locomotion::DoubleBufferedChannel<VectorNd> joint_target_channel; // IK -> servo
+        Addons::Locomotion::ControlScheduler scheduler; // declared after the data of the tasks, its worker threads stop first
+
+        ros::NodeHandle* nh;
+        ros::Publisher base_estimate_pub; // position, velocity, roll-pitch-yaw and update time (last, mean, max) [us]
+        ros::Publisher foot_wrench_pub; // LS/RS wrenches, centers of pressure, contacts, measured ZMP and update time (last, max) [us]
+        ros::Publisher momentum_observer_pub; // estimated L/R sole forces, waist residual, collision and update time (last, max) [us]
+        ros::Publisher scheduler_pub; // mean and max run time [us] and overruns of each task, max tick time [us] and tick overruns
+
     public:
         //*** Functions for RoK-3 Simulation in Gazebo ***//
         void Load(physics::ModelPtr _model, sdf::ElementPtr /*_sdf*/); // Loading model data and initializing the system before simulation 
@@ -134,6 +223,23 @@ namespace gazebo
 
         void initializeJoint(); // Initialize joint variables for joint control
         void SetJointPIDgain(); // Set each joint PID gain for joint control
+
+        void initializeWalking(const char* urdf_path); // Preview gains, footstep plan and leg IK for walking
+        void walkingPattern(); // Walking pattern and leg IK for the joint targets 10 ms ahead
+        void balanceMPC(); // MPC of the CoM for the state at the end of the IK period (worker thread)
+        void planFootsteps(); // Footsteps towards walk_goal_x once the walking pattern is finished (worker thread)
+        void integrateCoM(Vector3d& state, double jerk, double duration); // Cart-table state after duration with constant jerk
+        void interpolateJointTargets(); // Joint targets of the servo between the last two IK results
+
+        void initializeEstimator(); // Floating base estimator and its publisher
+        void estimateBase(); // Update of the floating base estimate with the IMU and the leg kinematics
+        void processFootWrench(); // Filtering, centers of pressure, measured ZMP and contacts of the LS/RS sensors
+
+        void initializeObserver(); // Generalized momentum observer on the floating base model
+        void observeMomentum(); // External joint torques, sole forces and collisions from the commanded torques
+
+        void initializeScheduler(); // Tasks of the multi-rate controller and the publisher of their timing
+        void reportScheduler(); // Timing and overruns of the tasks
     };
     GZ_REGISTER_MODEL_PLUGIN(rok3_plugin);
 }
@@ -654,9 +760,10 @@ void gazebo::rok3_plugin::Load(physics::ModelPtr _model, sdf::ElementPtr /*_sdf*
     printf(C_GREEN "RBDL API version = %d\n" C_RESET, version_test);
 
     //* model.urdf file based model data input to [Model* rok3_model] for using RBDL
-    Model* rok3_model = new Model();
-    Addons::URDFReadFromFile("/home/lsh356812/.gazebo/models/rok3_model/urdf/rok3_model.urdf", rok3_model, true, true);
+    const char* urdf_path = "/home/lsh356812/.gazebo/models/rok3_model/urdf/rok3_model.urdf";
     //↑↑↑ Check File Path ↑↑↑
+    rok3_model = new Model();
+    Addons::URDFReadFromFile(urdf_path, rok3_model, true, true);
     nDoF = rok3_model->dof_count - 6; // Get degrees of freedom, except position and orientation of the robot
     joint = new ROBO_JOINT[nDoF]; // Generation joint variables struct
 
@@ -664,6 +771,18 @@ void gazebo::rok3_plugin::Load(physics::ModelPtr _model, sdf::ElementPtr /*_sdf*
     initializeJoint();
     SetJointPIDgain();
 
+    //* walking pattern generation and leg inverse kinematics
+    initializeWalking(urdf_path);
+
+    //* floating base estimation with the IMU and the leg kinematics
+    initializeEstimator();
+
+    //* external torques and collisions with the generalized momentum observer
+    initializeObserver();
+
+    //* tasks of the multi-rate controller
+    initializeScheduler();
+
 
     //* setting for getting dt
     last_update_time = model->GetWorld()->GetSimTime();
@@ -690,22 +809,9 @@ void gazebo::rok3_plugin::UpdateAlgorithm()
 
     //* Read Sensors data
     GetjointData();
-    
-    joint[LHY].targetRadian = 10*3.14/180;
-    joint[LHR].targetRadian = 20*3.14/180;
-    joint[LHP].targetRadian = 30*3.14/180;
-    joint[LKN].targetRadian = 40*3.14/180;
-    joint[LAP].targetRadian = 50*3.14/180;
-    joint[LAR].targetRadian = 60*3.14/180;
-    
-    
-    
-    
-    
-    
-    
-    //* Joint Controller
-    jointController();
+
+    //* Estimation (500 Hz), walking pattern and leg IK (100 Hz), servo (1 kHz), MPC and footsteps on worker threads
+    scheduler.Tick();
 }
 
 void gazebo::rok3_plugin::jointController()
@@ -873,3 +979,529 @@ void gazebo::rok3_plugin::SetJointPIDgain()
     joint[WST].Kd = 2.;
 }
 
+void gazebo::rok3_plugin::initializeWalking(const char* urdf_path)
+{
+    /*
+     * Preview control gains, footstep plan and leg inverse kinematics
+     * The pattern advances one 1 ms sample per tick of the scheduler
+     */
+    pelvis_height = 0.85;
+    ready_time = 2.0;
+    ik_period = 10;
+
+    //* ZMP preview gains are computed once and cached next to the urdf file
+    preview_gains.sample_time = 0.001;
+    preview_gains.com_height = pelvis_height;
+    preview_gains.preview_time = 1.6;
+    if (!preview_gains.LoadOrCompute(std::string(urdf_path) + ".zmp_preview_gains")) {
+        printf(C_RED "ZMP preview gains could not be computed\n" C_RESET);
+    }
+
+    //* Both soles on the ground below the hip joints, the footstep planner walks 1 m in steps of 0.1 m after the knees are bent
+    Vector3d L_foot_start(0, 0.105, 0);
+    Vector3d R_foot_start(0, -0.105, 0);
+    walking.Init(preview_gains, L_foot_start, R_foot_start);
+    walk_goal_x = 1.0;
+    step_length = 0.1;
+    footstep_plan_sequence = 0;
+    footstep_plan_sample = -1;
+
+    //* MPC over 1.6 s in 16 samples of 0.1 s, the ZMP stays inside the soles with a margin
+    use_mpc = true;
+    mpc.Init(16, 0.1, pelvis_height);
+    com_state_x = walking.state_x;
+    com_state_y = walking.state_y;
+    com_jerk_x = com_jerk_y = 0;
+    com_plan_sequence = 0;
+
+    //* Leg model without floating base, so that base_link (the pelvis) is the reference frame of the IK
+    leg_model = new Model();
+    Addons::URDFReadFromFile(urdf_path, leg_model, false, false);
+
+    const char* link_names[13] = {
+        "Upper_body_link",
+        "L_Hip_yaw_link", "L_Hip_roll_pitch_link", "L_Thigh_link", "L_Calf_link", "L_Ankle_pitch_link", "L_Ankle_roll_link",
+        "R_Hip_yaw_link", "R_Hip_roll_pitch_link", "R_Thigh_link", "R_Calf_link", "R_Ankle_pitch_link", "R_Ankle_roll_link"
+    };
+    for (int j = 0; j < 13; j++) {
+        leg_q_index[j] = leg_model->mJoints[leg_model->GetBodyId(link_names[j])].q_index;
+    }
+
+    //* Initial guess with the knees bent forward
+    leg_q = VectorXd::Zero(leg_model->q_size);
+    leg_q(leg_q_index[LHP]) = leg_q(leg_q_index[RHP]) = -0.4;
+    leg_q(leg_q_index[LKN]) = leg_q(leg_q_index[RKN]) = 0.8;
+    leg_q(leg_q_index[LAP]) = leg_q(leg_q_index[RAP]) = -0.4;
+
+    leg_ik.AddFullConstraint(leg_model->GetBodyId("L_Foot"), Vector3d::Zero(), Vector3d::Zero(), Matrix3d::Identity());
+    leg_ik.AddFullConstraint(leg_model->GetBodyId("R_Foot"), Vector3d::Zero(), Vector3d::Zero(), Matrix3d::Identity());
+    leg_ik.max_steps = 20;
+
+    //* The servo holds the initial posture until the first IK result
+    joint_target = VectorXd::Zero(nDoF);
+    servo_start = VectorXd::Zero(nDoF);
+    servo_goal = VectorXd::Zero(nDoF);
+    servo_step = 0;
+    joint_target_sequence = 0;
+}
+
+void gazebo::rok3_plugin::walkingPattern()
+{
+    /*
+     * Walking pattern and leg IK for the joint targets at the end of the IK period, runs every ik_period ticks
+     * The pelvis is kept above the CoM of the cart-table model (or of the MPC) at pelvis_height
+     * The MPC solves for the CoM state at the end of the period on its worker thread, its jerk applies from then on
+     */
+    double period = ik_period * scheduler.tick_time;
+
+    //* Jerk of the MPC solution for the current CoM state
+    CoMPlan plan;
+    unsigned long sequence = com_plan_channel.Read(plan);
+    if (sequence != com_plan_sequence) {
+        com_plan_sequence = sequence;
+        com_jerk_x = plan.jerk_x;
+        com_jerk_y = plan.jerk_y;
+        if (plan.sample != walking.sample) {
+            printf(C_YELLOW "MPC solution of sample %ld applied at sample %ld\n" C_RESET, plan.sample, walking.sample);
+        }
+    }
+
+    //* New footsteps once the last plan is finished, plans from before the last change are outdated
+    if (walking.IsFinished() && footstep_plan_channel.GetSequence() != footstep_plan_sequence) {
+        FootstepPlan footstep_plan;
+        footstep_plan_sequence = footstep_plan_channel.Read(footstep_plan);
+        if (footstep_plan.status_sample > footstep_plan_sample && !footstep_plan.footsteps.empty()) {
+            walking.SetFootsteps(footstep_plan.footsteps, std::max(0.5, ready_time + 1.0 - time));
+            footstep_plan_sample = walking.sample;
+        }
+    }
+
+    for (unsigned int i = 0; i < ik_period; i++) {
+        walking.Step();
+    }
+    integrateCoM(com_state_x, com_jerk_x, period);
+    integrateCoM(com_state_y, com_jerk_y, period);
+
+    //* The MPC replans from the CoM state at the end of this period
+    ik_mpc_input.sample = walking.sample;
+    ik_mpc_input.state_x = com_state_x;
+    ik_mpc_input.state_y = com_state_y;
+    ik_mpc_input.plan = walking.GetPlan(); // reuses the capacity of the previous plan
+    mpc_input_channel.Write(ik_mpc_input);
+
+    Vector3d pelvis(walking.com_position(0), walking.com_position(1), pelvis_height);
+    if (use_mpc) {
+        pelvis << com_state_x(0), com_state_y(0), pelvis_height;
+    }
+    leg_ik.target_positions[0] = walking.left_foot - pelvis;
+    leg_ik.target_positions[1] = walking.right_foot - pelvis;
+    InverseKinematics(*leg_model, leg_q, leg_ik, leg_q);
+
+    //* Bend the knees smoothly from the initial posture during ready_time
+    double target_time = time + period;
+    double ready = 1.0;
+    if (target_time < ready_time) {
+        ready = 0.5 * (1 - cos(PI * target_time / ready_time));
+    }
+
+    for (int j = 0; j < nDoF; j++) {
+        joint_target(j) = ready * leg_q(leg_q_index[j]);
+    }
+    joint_target(WST) = 0;
+    joint_target_channel.Write(joint_target);
+
+    WalkingStatus status;
+    status.sample = walking.sample;
+    status.finished = walking.IsFinished();
+    status.left_foot = walking.left_foot;
+    status.right_foot = walking.right_foot;
+    walking_status_channel.Write(status);
+}
+
+void gazebo::rok3_plugin::balanceMPC()
+{
+    /*
+     * MPC of the CoM for the state at the end of the IK period, runs on a worker thread
+     * The references start 100 ms after the state, the solution is applied by the next run of the IK task
+     */
+    mpc.state_x = mpc_input.state_x;
+    mpc.state_y = mpc_input.state_y;
+    mpc.SetReferences(mpc_input.plan, mpc_input.sample + 100, 100, 0.09, 0.045);
+    if (!mpc.Solve()) {
+        printf(C_YELLOW "MPC did not converge in %u iterations\n" C_RESET, mpc.iterations);
+    }
+
+    CoMPlan plan;
+    plan.sample = mpc_input.sample;
+    plan.jerk_x = mpc.jerk_x;
+    plan.jerk_y = mpc.jerk_y;
+    com_plan_channel.Write(plan);
+}
+
+void gazebo::rok3_plugin::planFootsteps()
+{
+    /*
+     * Footsteps towards walk_goal_x once the walking pattern is finished, runs on a worker thread
+     * The left foot steps first, each step lands step_length in front of the rear foot
+     */
+    if (!planner_status.finished) {
+        return;
+    }
+
+    const Vector3d& left_foot = planner_status.left_foot;
+    const Vector3d& right_foot = planner_status.right_foot;
+    if (std::max(left_foot(0), right_foot(0)) >= walk_goal_x - 1e-3) {
+        return;
+    }
+
+    double rear = std::min(left_foot(0), right_foot(0));
+    int num_steps = (int) round((walk_goal_x - rear) / step_length);
+
+    FootstepPlan plan;
+    plan.status_sample = planner_status.sample;
+    for (int i = 1; i <= num_steps; i++) {
+        bool left = (i % 2 == 1);
+        double x = std::min(rear + step_length * i, walk_goal_x);
+        plan.footsteps.push_back(Addons::Locomotion::Footstep(Vector3d(x, left ? left_foot(1) : right_foot(1), 0), left));
+    }
+    footstep_plan_channel.Write(plan);
+}
+
+void gazebo::rok3_plugin::integrateCoM(Vector3d& state, double jerk, double duration)
+{
+    /*
+     * Cart-table state (position, velocity, acceleration) after duration with constant jerk
+     */
+    double d2 = duration * duration;
+    double d3 = d2 * duration;
+    state = Vector3d(state(0) + duration * state(1) + 0.5 * d2 * state(2) + d3 / 6. * jerk,
+            state(1) + duration * state(2) + 0.5 * d2 * jerk,
+            state(2) + duration * jerk);
+}
+
+void gazebo::rok3_plugin::interpolateJointTargets()
+{
+    /*
+     * Joint targets of the servo between the last two IK results
+     * The IK targets the end of its period, the servo reaches them when the next ones arrive
+     * A late IK result holds the last targets
+     */
+    if (joint_target_channel.GetSequence() != joint_target_sequence) {
+        servo_start = servo_goal;
+        joint_target_sequence = joint_target_channel.Read(servo_goal);
+        servo_step = 0;
+    }
+
+    double s = std::min(1.0, (double) servo_step / ik_period);
+    double velocity_scale = (servo_step < ik_period) ? 1.0 / (ik_period * scheduler.tick_time) : 0.0;
+    servo_step++;
+
+    for (int j = 0; j < nDoF; j++) {
+        joint[j].targetRadian = servo_start(j) + s * (servo_goal(j) - servo_start(j));
+        joint[j].targetVelocity = velocity_scale * (servo_goal(j) - servo_start(j));
+    }
+}
+
+void gazebo::rok3_plugin::initializeEstimator()
+{
+    /*
+     * Floating base estimator, foot wrench processing and their publishers
+     * The estimator is initialized with the base pose of gazebo on the first update with IMU data
+     */
+    base_estimator_initialized = false;
+    leg_q_actual = VectorXd::Zero(leg_model->q_size);
+    L_foot_id = leg_model->GetBodyId("L_Foot");
+    R_foot_id = leg_model->GetBodyId("R_Foot");
+
+    //* 4th order Butterworth at 30 Hz sampled by the 500 Hz estimation task, the soles are 6 mm below the sensor frames
+    foot_wrench.sensor_height = 0.006;
+    foot_wrench.contact_on_force = 50;
+    foot_wrench.contact_off_force = 20;
+    foot_wrench.Init(0.002, 30, 4);
+
+    nh = NULL;
+    if (ros::isInitialized()) {
+        nh = new ros::NodeHandle("rok3");
+        base_estimate_pub = nh->advertise<std_msgs::Float32MultiArray>("base_estimate", 1);
+        foot_wrench_pub = nh->advertise<std_msgs::Float32MultiArray>("foot_wrench", 1);
+    } else {
+        printf(C_YELLOW "ROS is not initialized, the base estimate and the foot wrenches are not published\n" C_RESET);
+    }
+}
+
+void gazebo::rok3_plugin::estimateBase()
+{
+    /*
+     * Update of the floating base estimate with the IMU and the leg kinematics
+     * Feet are in contact as detected by the force/torque sensors, the estimate is published at 100 Hz
+     */
+    if (!imu) {
+        imu = std::dynamic_pointer_cast<sensors::ImuSensor>(sensors::get_sensor("imu"));
+        if (!imu) {
+            return;
+        }
+    }
+
+    for (int j = 0; j < nDoF; j++) {
+        leg_q_actual(leg_q_index[j]) = joint[j].actualRadian;
+    }
+
+    if (!base_estimator_initialized) {
+        math::Pose base_pose = model->GetLink("base_link")->GetWorldPose();
+        Eigen::Quaterniond base_rotation(base_pose.rot.w, base_pose.rot.x, base_pose.rot.y, base_pose.rot.z);
+        base_estimator.Init(*leg_model, L_foot_id, R_foot_id, leg_q_actual,
+                Vector3d(base_pose.pos.x, base_pose.pos.y, base_pose.pos.z), base_rotation.toRotationMatrix());
+        base_estimator_initialized = true;
+        return;
+    }
+
+    ignition::math::Vector3d gyro = imu->AngularVelocity();
+    ignition::math::Vector3d acc = imu->LinearAcceleration();
+
+    base_estimator.Update(Vector3d(gyro.X(), gyro.Y(), gyro.Z()), Vector3d(acc.X(), acc.Y(), acc.Z()), estimation_dt,
+            *leg_model, leg_q_actual, foot_wrench.left_contact, foot_wrench.right_contact);
+
+    if (nh != NULL && scheduler.tick % 10 == 0) {
+        Vector3d ypr = base_estimator.orientation.eulerAngles(2, 1, 0);
+
+        std_msgs::Float32MultiArray msg;
+        msg.data.resize(12);
+        for (int i = 0; i < 3; i++) {
+            msg.data[i] = base_estimator.position(i);
+            msg.data[3 + i] = base_estimator.velocity(i);
+            msg.data[6 + i] = ypr(2 - i);
+        }
+        msg.data[9] = base_estimator.update_time * 1e6;
+        msg.data[10] = base_estimator.GetMeanUpdateTime() * 1e6;
+        msg.data[11] = base_estimator.max_update_time * 1e6;
+        base_estimate_pub.publish(msg);
+    }
+}
+
+void gazebo::rok3_plugin::processFootWrench()
+{
+    /*
+     * Filtering, centers of pressure, measured ZMP and contacts of the LS/RS sensors
+     * The joints measure the wrench of the ankle on the sole, the ground applies the opposite one
+     * The measured ZMP uses the sole poses of the last base estimate, it is published at 100 Hz
+     */
+    physics::JointWrench L_wrench = LS->GetForceTorque(0);
+    physics::JointWrench R_wrench = RS->GetForceTorque(0);
+
+    foot_wrench.Update(-Vector3d(L_wrench.body2Force.x, L_wrench.body2Force.y, L_wrench.body2Force.z),
+            -Vector3d(L_wrench.body2Torque.x, L_wrench.body2Torque.y, L_wrench.body2Torque.z),
+            -Vector3d(R_wrench.body2Force.x, R_wrench.body2Force.y, R_wrench.body2Force.z),
+            -Vector3d(R_wrench.body2Torque.x, R_wrench.body2Torque.y, R_wrench.body2Torque.z));
+
+    if (base_estimator_initialized) {
+        const Matrix3d& base_R = base_estimator.orientation;
+
+        foot_wrench.ComputeZMP(
+                base_estimator.position + base_R * CalcBodyToBaseCoordinates(*leg_model, leg_q_actual, L_foot_id, Vector3d::Zero(), true),
+                base_R * CalcBodyWorldOrientation(*leg_model, leg_q_actual, L_foot_id, false).transpose(),
+                base_estimator.position + base_R * CalcBodyToBaseCoordinates(*leg_model, leg_q_actual, R_foot_id, Vector3d::Zero(), false),
+                base_R * CalcBodyWorldOrientation(*leg_model, leg_q_actual, R_foot_id, false).transpose());
+    }
+
+    if (nh != NULL && scheduler.tick % 10 == 0) {
+        std_msgs::Float32MultiArray msg;
+        msg.data.resize(22);
+        for (int i = 0; i < 3; i++) {
+            msg.data[i] = foot_wrench.left_force(i);
+            msg.data[3 + i] = foot_wrench.left_moment(i);
+            msg.data[6 + i] = foot_wrench.right_force(i);
+            msg.data[9 + i] = foot_wrench.right_moment(i);
+        }
+        for (int i = 0; i < 2; i++) {
+            msg.data[12 + i] = foot_wrench.left_cop(i);
+            msg.data[14 + i] = foot_wrench.right_cop(i);
+            msg.data[18 + i] = foot_wrench.zmp(i);
+        }
+        msg.data[16] = foot_wrench.left_contact;
+        msg.data[17] = foot_wrench.right_contact;
+        msg.data[20] = foot_wrench.update_time * 1e6;
+        msg.data[21] = foot_wrench.max_update_time * 1e6;
+        foot_wrench_pub.publish(msg);
+    }
+}
+
+void gazebo::rok3_plugin::initializeObserver()
+{
+    /*
+     * Generalized momentum observer on the floating base model and its publisher
+     * The observer is started on the first update with a base estimate
+     */
+    momentum_observer_initialized = false;
+    upper_body_collision = false;
+    L_foot_force_estimate = Vector3d::Zero();
+    R_foot_force_estimate = Vector3d::Zero();
+
+    rok3_q = VectorXd::Zero(rok3_model->q_size);
+    rok3_qdot = VectorXd::Zero(rok3_model->qdot_size);
+    rok3_tau = VectorXd::Zero(rok3_model->qdot_size);
+
+    const char* link_names[13] = {
+        "Upper_body_link",
+        "L_Hip_yaw_link", "L_Hip_roll_pitch_link", "L_Thigh_link", "L_Calf_link", "L_Ankle_pitch_link", "L_Ankle_roll_link",
+        "R_Hip_yaw_link", "R_Hip_roll_pitch_link", "R_Thigh_link", "R_Calf_link", "R_Ankle_pitch_link", "R_Ankle_roll_link"
+    };
+    for (int j = 0; j < 13; j++) {
+        rok3_q_index[j] = rok3_model->mJoints[rok3_model->GetBodyId(link_names[j])].q_index;
+    }
+    rok3_base_id = rok3_model->GetBodyId("base_link");
+    rok3_L_foot_id = rok3_model->GetBodyId("L_Foot");
+    rok3_R_foot_id = rok3_model->GetBodyId("R_Foot");
+
+    //* 50 rad/s bandwidth, the waist collides above 20 Nm
+    momentum_observer.gain = 50;
+    momentum_observer.threshold = 20;
+
+    if (nh != NULL) {
+        momentum_observer_pub = nh->advertise<std_msgs::Float32MultiArray>("momentum_observer", 1);
+    }
+}
+
+void gazebo::rok3_plugin::observeMomentum()
+{
+    /*
+     * External joint torques from the commanded torques and the joint states
+     * The base state comes from the estimator, the joint torques are the ones commanded in the last servo tick
+     * The residuals of each leg give the ground force on its sole, a residual of the waist is a collision of the upper body
+     */
+    if (!base_estimator_initialized) {
+        return;
+    }
+
+    //* Base position, orientation (RBDL stores the transposed rotation) and velocity
+    ignition::math::Vector3d gyro = imu->AngularVelocity();
+    rok3_q.head(3) = base_estimator.position;
+    rok3_model->SetQuaternion(rok3_base_id, Math::Quaternion::fromMatrix(base_estimator.orientation.transpose()), rok3_q);
+    rok3_qdot.head(3) = base_estimator.velocity;
+    rok3_qdot.segment(3, 3) = Vector3d(gyro.X(), gyro.Y(), gyro.Z()) - base_estimator.gyroscope_bias;
+
+    for (int j = 0; j < nDoF; j++) {
+        rok3_q(rok3_q_index[j]) = joint[j].actualRadian;
+        rok3_qdot(rok3_q_index[j]) = joint[j].actualVelocity;
+        rok3_tau(rok3_q_index[j]) = joint[j].targetTorque;
+    }
+
+    if (!momentum_observer_initialized) {
+        momentum_observer.Init(*rok3_model, rok3_q, rok3_qdot);
+        momentum_observer_initialized = true;
+        return;
+    }
+
+    momentum_observer.Update(*rok3_model, rok3_q, rok3_qdot, rok3_tau, estimation_dt);
+
+    //* The floating base is loaded by both feet, the leg joints only by their own foot
+    momentum_observer.EstimateContactForce(*rok3_model, rok3_q, rok3_L_foot_id, Vector3d::Zero(), L_foot_force_estimate, true, 6);
+    momentum_observer.EstimateContactForce(*rok3_model, rok3_q, rok3_R_foot_id, Vector3d::Zero(), R_foot_force_estimate, false, 6);
+
+    bool collision = momentum_observer.exceeded[rok3_q_index[WST]];
+    if (collision && !upper_body_collision) {
+        printf(C_YELLOW "Collision of the upper body, waist residual = %.1f Nm\n" C_RESET,
+                momentum_observer.residual(rok3_q_index[WST]));
+    }
+    upper_body_collision = collision;
+
+    if (nh != NULL && scheduler.tick % 10 == 0) {
+        std_msgs::Float32MultiArray msg;
+        msg.data.resize(10);
+        for (int i = 0; i < 3; i++) {
+            msg.data[i] = L_foot_force_estimate(i);
+            msg.data[3 + i] = R_foot_force_estimate(i);
+        }
+        msg.data[6] = momentum_observer.residual(rok3_q_index[WST]);
+        msg.data[7] = upper_body_collision;
+        msg.data[8] = momentum_observer.update_time * 1e6;
+        msg.data[9] = momentum_observer.max_update_time * 1e6;
+        momentum_observer_pub.publish(msg);
+    }
+}
+
+void gazebo::rok3_plugin::initializeScheduler()
+{
+    /*
+     * Tasks of the multi-rate controller on the 1 ms tick of UpdateAlgorithm() and the publisher of their timing
+     * The inline tasks of a tick run in the order in which they are added, the servo uses the targets of the IK of the same tick
+     * MPC and footstep planning run on worker threads, they copy their inputs at the release and publish their results one period later
+     */
+    estimation_dt = 0;
+    last_estimation_time = 0;
+
+    scheduler.tick_time = 0.001;
+    scheduler.wait_for_workers = false; // a late MPC or planner skips its release instead of delaying the servo
+
+    //* Foot wrenches and contacts, base pose and velocity, external torques and collisions at 500 Hz
+    scheduler.AddTask("estimation", [this] {
+        estimation_dt = time - last_estimation_time;
+        last_estimation_time = time;
+        processFootWrench();
+        estimateBase();
+        observeMomentum();
+    }, 2);
+
+    //* Walking pattern and leg IK at 100 Hz
+    unsigned int ik_task = scheduler.AddTask("ik", [this] { walkingPattern(); }, ik_period);
+    scheduler.AddOutput(ik_task, mpc_input_channel);
+    scheduler.AddOutput(ik_task, walking_status_channel);
+    scheduler.AddOutput(ik_task, joint_target_channel);
+
+    //* Balance MPC at 100 Hz
+    unsigned int mpc_task = scheduler.AddTask("mpc", [this] { balanceMPC(); }, ik_period, 0, true);
+    scheduler.SetReleaseFunction(mpc_task, [this] { mpc_input_channel.Read(mpc_input); });
+    scheduler.AddOutput(mpc_task, com_plan_channel);
+
+    //* Footstep planning at 10 Hz
+    unsigned int planner_task = scheduler.AddTask("footsteps", [this] { planFootsteps(); }, 100, 0, true);
+    scheduler.SetReleaseFunction(planner_task, [this] { walking_status_channel.Read(planner_status); });
+    scheduler.AddOutput(planner_task, footstep_plan_channel);
+
+    //* Joint servo at 1 kHz
+    scheduler.AddTask("servo", [this] {
+        interpolateJointTargets();
+        jointController();
+    }, 1);
+
+    //* Timing of the tasks at 10 Hz
+    scheduler.AddTask("report", [this] { reportScheduler(); }, 100, 5);
+
+    if (nh != NULL) {
+        scheduler_pub = nh->advertise<std_msgs::Float32MultiArray>("scheduler", 1);
+    }
+}
+
+void gazebo::rok3_plugin::reportScheduler()
+{
+    /*
+     * Timing and overruns of the tasks, printed every 10 s and published at 10 Hz
+     * A worker overruns if its last job has not finished at its next release, an inline task if it takes longer than its period
+     */
+    unsigned int num_tasks = scheduler.GetNumTasks();
+    bool print = (scheduler.tick % 10000 == 5);
+
+    std_msgs::Float32MultiArray msg;
+    msg.data.resize(3 * num_tasks + 2);
+    for (unsigned int i = 0; i < num_tasks; i++) {
+        Addons::Locomotion::ControlScheduler::TaskStats stats = scheduler.GetTaskStats(i);
+        msg.data[3 * i] = stats.GetMeanTime() * 1e6;
+        msg.data[3 * i + 1] = stats.max_time * 1e6;
+        msg.data[3 * i + 2] = stats.num_overruns;
+
+        if (print) {
+            printf("%s task (%u ms%s): mean %.1f us, max %.1f us, %lu overruns in %lu runs\n", stats.name.c_str(), stats.period,
+                    stats.worker ? ", worker" : "", stats.GetMeanTime() * 1e6, stats.max_time * 1e6, stats.num_overruns, stats.num_runs);
+        }
+    }
+    msg.data[3 * num_tasks] = scheduler.max_tick_time * 1e6;
+    msg.data[3 * num_tasks + 1] = scheduler.num_tick_overruns;
+
+    if (print && scheduler.num_tick_overruns > 0) {
+        printf(C_YELLOW "%lu ticks took longer than %.1f ms (max %.1f us)\n" C_RESET, scheduler.num_tick_overruns,
+                scheduler.tick_time * 1e3, scheduler.max_tick_time * 1e6);
+    }
+
+    if (nh != NULL) {
+        scheduler_pub.publish(msg);
+    }
+}